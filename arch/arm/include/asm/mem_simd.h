@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SIMD implementations of the arm64 memory routines
+ */
+
+#ifndef __ASM_ARM_MEM_SIMD_H
+#define __ASM_ARM_MEM_SIMD_H
+
+/* Implementation used by memcpy(), memmove() and memset() for large sizes */
+#define MEM_SIMD_NONE		0
+#define MEM_SIMD_NEON		1
+#define MEM_SIMD_SVE		2
+
+/* Smallest size passed to the SIMD routines */
+#define MEM_SIMD_MIN_SIZE	256
+
+#ifndef __ASSEMBLY__
+/* Implementation in use (MEM_SIMD_...), selected after relocation */
+extern int arm64_mem_simd;
+#endif
+
+#endif
@@ -52,6 +52,12 @@
  * CPTR_EL2 bits definitions
  */
 #define CPTR_EL2_RES1		(3 << 12 | 0x3ff)           /* Reserved, RES1 */
+#define CPTR_EL2_TZ		(1 << 8)                    /* Trap SVE       */
+
+/*
+ * CPTR_EL3 bits definitions
+ */
+#define CPTR_EL3_EZ		(1 << 8)                    /* Enable SVE     */
 
 /*
  * SCTLR_EL2 bits definitions
@@ -103,11 +109,14 @@
  */
 #define ID_AA64PFR0_EL1_EL3	(0xF << 12) /* EL3 implemented                */
 #define ID_AA64PFR0_EL1_EL2	(0xF << 8)  /* EL2 implemented                */
+#define ID_AA64PFR0_EL1_ADVSIMD	(0xF << 20) /* Advanced SIMD, 0xF if absent   */
+#define ID_AA64PFR0_EL1_SVE	(0xFUL << 32) /* SVE implemented              */
 
 /*
  * CPACR_EL1 bits definitions
  */
 #define CPACR_EL1_FPEN_EN	(3 << 20) /* SIMD and FP instruction enabled  */
+#define CPACR_EL1_ZEN_EN	(3 << 16) /* SVE instructions enabled         */
 
 /*
  * SCTLR_EL1 bits definitions
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Selection of the SIMD memory routines on arm64
+ */
+
+#define LOG_CATEGORY LOGC_ARCH
+
+#include <event.h>
+#include <log.h>
+#include <asm/barriers.h>
+#include <asm/mem_simd.h>
+#include <asm/system.h>
+
+/* This is read by memcpy() before relocation, when BSS is not available */
+int arm64_mem_simd __section(".data") = MEM_SIMD_NONE;
+
+/* Allow SVE at the current exception level, with the longest vectors */
+static void mem_simd_enable_sve(void)
+{
+	ulong val;
+
+	switch (current_el()) {
+	case 3:
+		asm volatile("mrs %0, cptr_el3" : "=r" (val));
+		asm volatile("msr cptr_el3, %0" : : "r" (val | CPTR_EL3_EZ));
+		isb();
+		asm volatile("msr S3_6_C1_C2_0, %0" : : "r" (0xfUL)); /* ZCR_EL3 */
+		break;
+	case 2:
+		asm volatile("mrs %0, cptr_el2" : "=r" (val));
+		asm volatile("msr cptr_el2, %0" : : "r" (val & ~CPTR_EL2_TZ));
+		isb();
+		asm volatile("msr S3_4_C1_C2_0, %0" : : "r" (0xfUL)); /* ZCR_EL2 */
+		break;
+	default:
+		asm volatile("mrs %0, cpacr_el1" : "=r" (val));
+		asm volatile("msr cpacr_el1, %0" : : "r" (val | CPACR_EL1_ZEN_EN));
+		isb();
+		asm volatile("msr S3_0_C1_C2_0, %0" : : "r" (0xfUL)); /* ZCR_EL1 */
+		break;
+	}
+	isb();
+}
+
+static int arm64_mem_simd_init(void)
+{
+	u64 pfr0;
+
+	asm volatile("mrs %0, id_aa64pfr0_el1" : "=r" (pfr0));
+	if ((pfr0 & ID_AA64PFR0_EL1_ADVSIMD) == ID_AA64PFR0_EL1_ADVSIMD)
+		return 0;
+
+	if (IS_ENABLED(CONFIG_ARM64_MEM_SVE) && (pfr0 & ID_AA64PFR0_EL1_SVE)) {
+		mem_simd_enable_sve();
+		arm64_mem_simd = MEM_SIMD_SVE;
+	} else {
+		arm64_mem_simd = MEM_SIMD_NEON;
+	}
+	log_debug("Using %s for memory routines\n",
+		  arm64_mem_simd == MEM_SIMD_SVE ? "SVE" : "NEON");
+
+	return 0;
+}
+EVENT_SPY_SIMPLE(EVT_DM_POST_INIT_R, arm64_mem_simd_init);
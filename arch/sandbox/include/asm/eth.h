@@ -71,6 +71,17 @@ int sandbox_eth_recv_ping_req(struct udevice *dev);
 typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
 				   unsigned int len);
 
+/**
+ * A packet generator, called when the network stack looks for received
+ * packets and none are queued
+ *
+ * dev - device pointer
+ */
+typedef int sandbox_eth_rx_hand_f(struct udevice *dev);
+
+/* Largest number of received packets which the network stack may hold */
+#define SANDBOX_ETH_RX_HOLD_MAX	8
+
 /**
  * struct eth_sandbox_priv - memory for sandbox mock driver
  *
@@ -83,7 +94,16 @@ typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
  * recv_packet_length - lengths of the packet returned as received
  * recv_packets - number of packets returned
  * tx_handler - function to generate responses to sent packets
+ * rx_handler - function to queue more packets when none are left, or NULL
  * priv - a pointer to some structure a test may want to keep track of
+ * rx_hold_bufs - extra packet buffers used while the network stack may hold
+ *	received packets (see eth_pdata::rx_hold), NULL if it may not
+ * rx_spare - buffers not in use, which replace those held in
+ *	recv_packet_buffer
+ * rx_spares - number of entries in rx_spare
+ * rx_held - packets returned by recv() and not yet passed to free_pkt(),
+ *	NULL for unused entries
+ * rx_held_count - number of packets in rx_held
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
@@ -95,7 +115,13 @@ struct eth_sandbox_priv {
 	int recv_packet_length[PKTBUFSRX];
 	int recv_packets;
 	sandbox_eth_tx_hand_f *tx_handler;
+	sandbox_eth_rx_hand_f *rx_handler;
 	void *priv;
+	uchar *rx_hold_bufs;
+	uchar *rx_spare[SANDBOX_ETH_RX_HOLD_MAX + 1];
+	int rx_spares;
+	uchar *rx_held[SANDBOX_ETH_RX_HOLD_MAX + 1];
+	int rx_held_count;
 };
 
 /*
@@ -105,6 +131,16 @@ struct eth_sandbox_priv {
  */
 void sandbox_eth_set_tx_handler(int index, sandbox_eth_tx_hand_f *handler);
 
+/*
+ * Set packet generator
+ *
+ * This lets a test send more packets than fit in the receive queue at once,
+ * for example a whole window of them in reply to one packet.
+ *
+ * handler - The func ptr to call when no packets are queued, or NULL for none
+ */
+void sandbox_eth_set_rx_handler(int index, sandbox_eth_rx_hand_f *handler);
+
 /*
  * Set priv ptr
  *
@@ -112,4 +148,18 @@ void sandbox_eth_set_tx_handler(int index, sandbox_eth_tx_hand_f *handler);
  */
 void sandbox_eth_set_priv(int index, void *priv);
 
+/*
+ * Let the network stack hold received packets
+ *
+ * Set eth_pdata::rx_hold for the device, so that received packets stay valid
+ * until they are passed to free_pkt(), in any order. Packets which are queued
+ * but not yet received are dropped.
+ *
+ * index - interface to set it for
+ * count - number of packets which may be held, up to SANDBOX_ETH_RX_HOLD_MAX,
+ *	or 0 to have them passed back before the next recv(), as by default
+ * Return: 0 if OK, -EBUSY if packets are still held, other -ve on error
+ */
+int sandbox_eth_set_rx_hold(int index, int count);
+
 #endif /* __ETH_H */
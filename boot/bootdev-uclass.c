@@ -17,6 +17,7 @@
 #include <part.h>
 #include <sort.h>
 #include <spl.h>
+#include <uthread.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
@@ -155,9 +156,7 @@ int bootdev_find_in_blk(struct udevice *dev, struct udevice *blk,
 	 */
 	iter->max_part = MAX_PART_PER_BOOTDEV;
 
-	if (iter->flags & BOOTFLOWIF_SINGLE_PARTITION) {
-		/* a particular partition was specified, scan it without checking */
-	} else if (!iter->part) {
+	if (!iter->part && !(iter->flags & BOOTFLOWIF_SINGLE_PARTITION)) {
 		/* This is the whole disk, check if we have bootable partitions */
 		iter->first_bootable = part_get_bootable(desc);
 		log_debug("checking bootable=%d\n", iter->first_bootable);
@@ -167,8 +166,12 @@ int bootdev_find_in_blk(struct udevice *dev, struct udevice *blk,
 		 * for filesystems or partition contents on this disk
 		 */
 
-	/* if there are bootable partitions, scan only those */
-	} else if ((iter->flags & BOOTFLOWIF_ONLY_BOOTABLE) &&
+	/*
+	 * if there are bootable partitions, scan only those, unless a
+	 * particular partition was specified
+	 */
+	} else if (!(iter->flags & BOOTFLOWIF_SINGLE_PARTITION) &&
+		   (iter->flags & BOOTFLOWIF_ONLY_BOOTABLE) &&
 		   iter->first_bootable >= 0 &&
 		   (iter->first_bootable ? !info.bootable : iter->part != 1)) {
 		log_debug("Skipping non-bootable partition %d\n", iter->part);
@@ -762,6 +765,18 @@ int bootdev_setup_iter(struct bootflow_iter *iter, const char *label,
 			iter->cur_label = -1;
 			ret = bootdev_next_label(iter, &dev, &method_flags);
 		} else {
+			/*
+			 * When working through all bootdevs, start every hunter
+			 * now. The iteration still goes in priority order,
+			 * waiting for the hunters of each priority as it
+			 * reaches it, but slow hunters no longer hold up the
+			 * bootdevs found by faster ones.
+			 */
+			if (iter->flags & BOOTFLOWIF_HUNT) {
+				ret = bootdev_hunt_start(show);
+				if (ret)
+					return log_msg_ret("sta", ret);
+			}
 			ret = bootdev_next_prio(iter, &dev);
 			method_flags = 0;
 		}
@@ -780,16 +795,13 @@ int bootdev_setup_iter(struct bootflow_iter *iter, const char *label,
 	return 0;
 }
 
-static int bootdev_hunt_drv(struct bootdev_hunter *info, uint seq, bool show)
+/* Run a hunter, unless it has been used already */
+static int bootdev_run_hunter(struct bootstd_priv *std,
+			      struct bootdev_hunter *info, uint seq, bool show)
 {
 	const char *name = uclass_get_name(info->uclass);
-	struct bootstd_priv *std;
 	int ret;
 
-	ret = bootstd_get_priv(&std);
-	if (ret)
-		return log_msg_ret("std", ret);
-
 	if (!(std->hunters_used & BIT(seq))) {
 		if (show)
 			printf("Hunting with: %s\n",
@@ -807,6 +819,115 @@ static int bootdev_hunt_drv(struct bootdev_hunter *info, uint seq, bool show)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BOOTDEV_HUNT_PARALLEL)
+/* Whether to show the hunters started by bootdev_hunt_start() */
+static bool hunt_show;
+
+/* Set by bootdev_hunt_cancel() to stop hunters which have not started */
+static bool hunt_cancel;
+
+static void bootdev_hunt_thread(void *arg)
+{
+	struct bootdev_hunter *info = arg;
+	struct bootdev_hunter *start;
+	struct bootstd_priv *std;
+	uint seq;
+	int ret;
+
+	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
+	seq = info - start;
+	if (bootstd_get_priv(&std))
+		return;
+	if (hunt_cancel) {
+		/* Leave the hunter unused, so it runs if it is needed later */
+		std->hunters_busy &= ~BIT(seq);
+		return;
+	}
+	ret = bootdev_run_hunter(std, info, seq, hunt_show);
+	if (ret)
+		log_debug("Background hunter %s failed (err=%d)\n",
+			  uclass_get_name(info->uclass), ret);
+	std->hunters_busy &= ~BIT(seq);
+}
+
+/* Wait until none of the hunters in @mask is running in the background */
+static void bootdev_hunt_wait(struct bootstd_priv *std, uint mask)
+{
+	while (std->hunters_busy & mask)
+		uthread_schedule();
+}
+
+int bootdev_hunt_start(bool show)
+{
+	struct bootdev_hunter *start;
+	struct bootstd_priv *std;
+	int n_ent, i;
+	int ret;
+
+	ret = bootstd_get_priv(&std);
+	if (ret)
+		return log_msg_ret("std", ret);
+
+	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
+	n_ent = ll_entry_count(struct bootdev_hunter, bootdev_hunter);
+	hunt_show = show;
+	hunt_cancel = false;
+	for (i = 0; i < n_ent; i++) {
+		struct bootdev_hunter *info = start + i;
+
+		if (!info->hunt ||
+		    ((std->hunters_used | std->hunters_busy) & BIT(i)))
+			continue;
+
+		/* If there is no thread, the hunter runs when it is needed */
+		if (uthread_create(NULL, bootdev_hunt_thread, info, 0, 0)) {
+			log_debug("Cannot start hunter %s\n",
+				  uclass_get_name(info->uclass));
+			continue;
+		}
+		std->hunters_busy |= BIT(i);
+	}
+
+	return 0;
+}
+
+void bootdev_hunt_cancel(void)
+{
+	hunt_cancel = true;
+}
+
+void bootdev_hunt_finish(void)
+{
+	struct bootstd_priv *std;
+
+	bootdev_hunt_cancel();
+	if (!bootstd_get_priv(&std))
+		bootdev_hunt_wait(std, ~0U);
+}
+#else
+static inline void bootdev_hunt_wait(struct bootstd_priv *std, uint mask)
+{
+}
+#endif
+
+static int bootdev_hunt_drv(struct bootdev_hunter *info, uint seq, bool show)
+{
+	struct bootstd_priv *std;
+	int ret;
+
+	ret = bootstd_get_priv(&std);
+	if (ret)
+		return log_msg_ret("std", ret);
+
+	/*
+	 * If the hunter is running in the background, let it finish. Should it
+	 * have failed, it runs again here so the caller sees the error.
+	 */
+	bootdev_hunt_wait(std, BIT(seq));
+
+	return bootdev_run_hunter(std, info, seq, show);
+}
+
 int bootdev_hunt(const char *spec, bool show)
 {
 	struct bootdev_hunter *start;
@@ -823,6 +944,11 @@ int bootdev_hunt(const char *spec, bool show)
 	if (spec) {
 		trailing_strtoln_end(spec, NULL, &end);
 		len = end - spec;
+	} else {
+		/* Hunt with everything at once, then collect the results */
+		result = bootdev_hunt_start(show);
+		if (result)
+			return log_msg_ret("sta", result);
 	}
 
 	for (i = 0; i < n_ent; i++) {
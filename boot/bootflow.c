@@ -13,6 +13,7 @@
 #include <dm.h>
 #include <env_internal.h>
 #include <malloc.h>
+#include <malloc_arena.h>
 #include <serial.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
@@ -98,7 +99,11 @@ void bootflow_iter_init(struct bootflow_iter *iter, int flags)
 
 void bootflow_iter_uninit(struct bootflow_iter *iter)
 {
-	free(iter->method_order);
+	bootdev_hunt_finish();
+	if (iter->arena)
+		malloc_arena_destroy(iter->arena);
+	else
+		free(iter->method_order);
 }
 
 int bootflow_iter_drop_bootmeth(struct bootflow_iter *iter,
@@ -511,7 +516,11 @@ int bootflow_boot(struct bootflow *bflow)
 	if (bflow->state != BOOTFLOWST_READY)
 		return log_msg_ret("load", -EPROTO);
 
+	/* This bootflow needs no more bootdevs, so stop looking for them */
+	bootdev_hunt_cancel();
+	bootflow_cache_save(bflow);
 	ret = bootmeth_boot(bflow->method, bflow);
+	bootflow_cache_drop();
 	if (ret)
 		return log_msg_ret("boot", ret);
 
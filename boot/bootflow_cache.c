@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Remembering the last bootflow booted, so it can be tried first next time
+ *
+ * The record is kept in the environment as a single line, e.g.
+ *
+ *    mmc1:2 extlinux /extlinux/extlinux.conf 1c5 9a3c2b71
+ *
+ * giving the label and partition, bootmeth, filename, size and CRC32 of the
+ * bootflow file. The label limits the next scan to one partition of one
+ * media device, so only its hunter is run, and the bootflow is used if it
+ * produces exactly the same record.
+ */
+
+#define LOG_CATEGORY UCLASS_BOOTSTD
+
+#include <bootflow.h>
+#include <dm.h>
+#include <env.h>
+#include <env_internal.h>
+#include <log.h>
+#include <vsprintf.h>
+#include <asm/global_data.h>
+#include <u-boot/crc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+enum {
+	/* Maximum length of a record */
+	REC_MAX_LEN	= 256,
+};
+
+/**
+ * bootflow_cache_rec() - Produce the record for a bootflow
+ *
+ * @bflow: Bootflow to record
+ * @buf: Returns the record
+ * @size: Size of @buf
+ * Return: 0 if OK, -ENOENT if the bootflow cannot be recorded, e.g. because it
+ *	comes from a global bootmeth, -E2BIG if @buf is too small
+ */
+static int bootflow_cache_rec(const struct bootflow *bflow, char *buf,
+			      int size)
+{
+	struct udevice *media;
+	enum uclass_id id;
+	const char *name;
+	u32 crc = 0;
+	int len;
+
+	if (!bflow->dev || !bflow->fname)
+		return -ENOENT;
+
+	/* USB storage is selected with the 'usb' label, not the uclass name */
+	media = dev_get_parent(bflow->dev);
+	id = device_get_uclass_id(media);
+	name = id == UCLASS_MASS_STORAGE ? "usb" : uclass_get_name(id);
+
+	if (bflow->buf)
+		crc = crc32(0, (uchar *)bflow->buf, bflow->size);
+	len = snprintf(buf, size, "%s%d:%d %s %s %x %08x", name, dev_seq(media),
+		       bflow->part, bflow->method->name, bflow->fname,
+		       bflow->size, crc);
+	if (len >= size)
+		return -E2BIG;
+
+	return 0;
+}
+
+int bootflow_cache_find(int flags, struct bootflow *bflow)
+{
+	char want[REC_MAX_LEN], label[REC_MAX_LEN], rec[REC_MAX_LEN];
+	struct bootflow_iter iter;
+	const char *saved;
+	char *p;
+	int ret;
+
+	/* Take a copy, since scanning may update the environment */
+	saved = env_get(BOOTFLOW_CACHE_VAR);
+	if (!saved)
+		return -ENOENT;
+	strlcpy(want, saved, sizeof(want));
+	strlcpy(label, want, sizeof(label));
+	p = strchr(label, ' ');
+	if (!p)
+		return log_msg_ret("rec", -EINVAL);
+	*p = '\0';
+
+	log_debug("Looking for cached bootflow with label '%s'\n", label);
+	for (ret = bootflow_scan_first(NULL, label, &iter,
+				       flags & ~BOOTFLOWIF_ALL, bflow);
+	     ret != -ENODEV; ret = bootflow_scan_next(&iter, bflow)) {
+		if (!ret && !bootflow_cache_rec(bflow, rec, sizeof(rec)) &&
+		    !strcmp(rec, want))
+			break;
+		bootflow_free(bflow);
+	}
+	bootflow_iter_uninit(&iter);
+	if (ret)
+		return log_msg_ret("fnd", -ENOENT);
+
+	return 0;
+}
+
+/* Update the record, saving the environment if requested and it changes */
+static void bootflow_cache_set(const char *rec, bool save)
+{
+	const char *saved = env_get(BOOTFLOW_CACHE_VAR);
+
+	if (!saved && !rec)
+		return;
+	if (saved && rec && !strcmp(saved, rec))
+		return;
+	if (env_set(BOOTFLOW_CACHE_VAR, rec)) {
+		log_warning("Cannot update bootflow cache\n");
+		return;
+	}
+	/* Don't complain on every boot if the environment cannot be saved */
+	if (save &&
+	    env_get_location(ENVOP_SAVE, gd->env_load_prio) != ENVL_NOWHERE)
+		env_save();
+}
+
+void bootflow_cache_save(const struct bootflow *bflow)
+{
+	char rec[REC_MAX_LEN];
+
+	bootflow_cache_set(bootflow_cache_rec(bflow, rec, sizeof(rec)) ?
+			   NULL : rec, true);
+}
+
+void bootflow_cache_drop(void)
+{
+	/*
+	 * Don't save here: the next bootflow to be booted saves its own
+	 * record, so a run of failed boots writes the environment only once
+	 */
+	bootflow_cache_set(NULL, false);
+}
@@ -314,6 +314,9 @@ static int bootm_find_os(const char *cmd_name, const char *addr_fit)
 		printf("ERROR %dE: can't get kernel image!\n", ret);
 		return 1;
 	}
+	/* Only a FIT kernel can have its hash checked while it is loaded */
+	if (genimg_get_format(os_hdr) != IMAGE_FORMAT_FIT)
+		images.fit_os_hash_defer = false;
 
 	/* get image parameters */
 	switch (genimg_get_format(os_hdr)) {
@@ -600,6 +603,55 @@ static int handle_decomp_error(int comp_type, size_t uncomp_size,
 #endif
 
 #ifndef USE_HOSTCC
+/**
+ * bootm_decomp_hashed() - Decompress the OS while checking its FIT hashes
+ *
+ * Each chunk of the image is hashed just before it is decompressed (or
+ * copied), so the data is only read once. This is used when fit_image_load()
+ * has left the hash check to bootm_load_os()
+ *
+ * @images:	Images information, with a FIT os image
+ * @load:	Address to load the OS to
+ * @load_buf:	Pointer to @load
+ * @image_buf:	Pointer to the OS image data
+ * @load_endp:	Returns the end address of the loaded OS
+ * Return: 0 if OK, -EACCES if the hashes do not match, other -ve value if
+ *	decompression failed
+ */
+static int bootm_decomp_hashed(struct bootm_headers *images, ulong load,
+			       void *load_buf, void *image_buf,
+			       ulong *load_endp)
+{
+	struct image_info *os = &images->os;
+	struct fit_hash_stream hs;
+	int ret;
+
+	ret = fit_image_hash_stream_start(&hs, images->fit_hdr_os,
+					  images->fit_noffset_os);
+	if (ret) {
+		printf("Cannot check kernel hash (err=%d)\n", ret);
+		*load_endp = load;
+		return -EACCES;
+	}
+	ret = image_decomp_tap(os->comp, load, os->image_start, os->type,
+			       load_buf, image_buf, os->image_len,
+			       CONFIG_SYS_BOOTM_LEN, load_endp,
+			       fit_image_hash_stream_tap, &hs);
+	if (ret) {
+		fit_image_hash_stream_abort(&hs);
+		return ret;
+	}
+
+	puts("   Verifying Hash Integrity ... ");
+	if (fit_image_hash_stream_finish(&hs)) {
+		puts("Bad Data Hash\n");
+		return -EACCES;
+	}
+	puts("OK\n");
+
+	return 0;
+}
+
 static int bootm_load_os(struct bootm_headers *images, int boot_progress)
 {
 	struct image_info os = images->os;
@@ -635,9 +687,19 @@ static int bootm_load_os(struct bootm_headers *images, int boot_progress)
 
 	load_buf = map_sysmem(load, 0);
 	image_buf = map_sysmem(os.image_start, image_len);
-	err = image_decomp(os.comp, load, os.image_start, os.type,
-			   load_buf, image_buf, image_len,
-			   CONFIG_SYS_BOOTM_LEN, &load_end);
+	if (CONFIG_IS_ENABLED(FIT_HASH_STREAM) && images->fit_os_hash_defer) {
+		err = bootm_decomp_hashed(images, load, load_buf, image_buf,
+					  &load_end);
+		if (err == -EACCES) {
+			bootstage_error(BOOTSTAGE_ID_FIT_KERNEL_START +
+					BOOTSTAGE_SUB_HASH);
+			return err;
+		}
+	} else {
+		err = image_decomp(os.comp, load, os.image_start, os.type,
+				   load_buf, image_buf, image_len,
+				   CONFIG_SYS_BOOTM_LEN, &load_end);
+	}
 	if (err) {
 		err = handle_decomp_error(os.comp, load_end - load,
 					  CONFIG_SYS_BOOTM_LEN, err);
@@ -984,8 +1046,12 @@ int bootm_run_states(struct bootm_info *bmi, int states)
 	if (!ret && (states & BOOTM_STATE_PRE_LOAD))
 		ret = bootm_pre_load(bmi->addr_img);
 
-	if (!ret && (states & BOOTM_STATE_FINDOS))
+	if (!ret && (states & BOOTM_STATE_FINDOS)) {
+		/* Let bootm_load_os() check the kernel hash if it runs now */
+		images->fit_os_hash_defer = CONFIG_IS_ENABLED(FIT_HASH_STREAM) &&
+			(states & BOOTM_STATE_LOADOS);
 		ret = bootm_find_os(bmi->cmd_name, bmi->addr_img);
+	}
 
 	if (!ret && (states & BOOTM_STATE_FINDOTHER)) {
 		ulong img_addr;
@@ -15,6 +15,7 @@
 #include <env_internal.h>
 #include <fs.h>
 #include <malloc.h>
+#include <malloc_arena.h>
 #include <mapmem.h>
 #include <dm/uclass-internal.h>
 
@@ -123,7 +124,17 @@ int bootmeth_setup_iter_order(struct bootflow_iter *iter, bool include_global)
 	if (!count)
 		return log_msg_ret("count", -ENOENT);
 
-	order = calloc(count, sizeof(struct udevice *));
+	/* The order is only needed until the scan finishes */
+	order = NULL;
+	if (CONFIG_IS_ENABLED(MALLOC_ARENA)) {
+		if (!iter->arena)
+			iter->arena = malloc_arena_create("bootflow_scan");
+		if (iter->arena)
+			order = malloc_arena_zalloc(iter->arena,
+						    count * sizeof(*order));
+	} else {
+		order = calloc(count, sizeof(struct udevice *));
+	}
 	if (!order)
 		return log_msg_ret("order", -ENOMEM);
 
@@ -190,6 +190,7 @@ static void fit_image_print_data(const void *fit, int noffset, const char *p,
 	int value_len;
 	const char *algo;
 	const char *padding;
+	uint chunk_size;
 	bool required;
 	int ret, i;
 
@@ -213,6 +214,9 @@ static void fit_image_print_data(const void *fit, int noffset, const char *p,
 	if (padding)
 		printf("%s  %s padding: %s\n", p, type, padding);
 
+	if (!fit_image_hash_get_chunk_size(fit, noffset, &chunk_size))
+		printf("%s  %s chunk:   %#x\n", p, type, chunk_size);
+
 	ret = fit_image_hash_get_value(fit, noffset, &value,
 				       &value_len);
 	printf("%s  %s value:   ", p, type);
@@ -1137,6 +1141,22 @@ int fit_image_hash_get_value(const void *fit, int noffset, uint8_t **value,
 	return 0;
 }
 
+int fit_image_hash_get_chunk_size(const void *fit, int noffset,
+				  uint *chunk_sizep)
+{
+	const fdt32_t *val;
+	int len;
+
+	val = fdt_getprop(fit, noffset, FIT_CHUNK_SIZE_PROP, &len);
+	if (!val)
+		return -ENOENT;
+	if (len != sizeof(*val) || !fdt32_to_cpu(*val))
+		return -EINVAL;
+	*chunk_sizep = fdt32_to_cpu(*val);
+
+	return 0;
+}
+
 /**
  * fit_image_hash_get_ignore - get hash ignore flag
  * @fit: pointer to the FIT format image header
@@ -1290,6 +1310,86 @@ int calculate_hash(const void *data, int data_len, const char *name,
 	return 0;
 }
 
+int calculate_chunk_hashes(const void *data, size_t size, const char *algo,
+			   uint chunk_size, uint8_t *values, int *values_len)
+{
+	uint count = fit_hash_chunk_count(size, chunk_size);
+	int value_len = 0;
+	size_t ofs;
+	uint i;
+
+	for (i = 0; i < count; i++) {
+		ofs = (size_t)i * chunk_size;
+		if (calculate_hash(data + ofs,
+				   size - ofs < chunk_size ? size - ofs : chunk_size,
+				   algo, values + i * value_len, &value_len))
+			return -1;
+	}
+	*values_len = count * value_len;
+
+	return 0;
+}
+
+/*
+ * Check a chunked hash. The root hash in @fit_value covers the chunk hashes,
+ * so that is checked first, then each chunk of the data.
+ */
+static int fit_image_check_chunks(const void *fit, int noffset,
+				  const char *algo, uint chunk_size,
+				  const void *data, size_t size,
+				  const uint8_t *fit_value, int fit_value_len,
+				  char **err_msgp)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(uint8_t, value, FIT_MAX_HASH_LEN);
+	const uint8_t *chunk_values;
+	int chunk_len, value_len;
+	uint8_t *values;
+	int ret;
+
+	chunk_values = fdt_getprop(fit, noffset, FIT_CHUNK_VALUE_PROP,
+				   &chunk_len);
+	if (!chunk_values) {
+		*err_msgp = "Can't get chunk hash values property";
+		return -1;
+	}
+
+	if (calculate_hash(chunk_values, chunk_len, algo, value, &value_len)) {
+		*err_msgp = "Unsupported hash algorithm";
+		return -1;
+	}
+	if (value_len != fit_value_len) {
+		*err_msgp = "Bad hash value len";
+		return -1;
+	} else if (memcmp(value, fit_value, value_len) != 0) {
+		*err_msgp = "Bad hash value";
+		return -1;
+	}
+
+	if (chunk_len != fit_hash_chunk_count(size, chunk_size) * value_len) {
+		*err_msgp = "Bad chunk hash values len";
+		return -1;
+	}
+	if (!chunk_len)
+		return 0;
+
+	values = malloc(chunk_len);
+	if (!values) {
+		*err_msgp = "Out of memory for chunk hash values";
+		return -1;
+	}
+	ret = calculate_chunk_hashes(data, size, algo, chunk_size, values,
+				     &value_len);
+	if (!ret && memcmp(values, chunk_values, chunk_len))
+		ret = -1;
+	free(values);
+	if (ret) {
+		*err_msgp = "Bad chunk hash value";
+		return -1;
+	}
+
+	return 0;
+}
+
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 				size_t size, char **err_msgp)
 {
@@ -1298,7 +1398,9 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	const char *algo;
 	uint8_t *fit_value;
 	int fit_value_len;
+	uint chunk_size;
 	int ignore;
+	int ret;
 
 	*err_msgp = NULL;
 
@@ -1322,6 +1424,16 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
+	ret = fit_image_hash_get_chunk_size(fit, noffset, &chunk_size);
+	if (ret == -EINVAL) {
+		*err_msgp = "Bad chunk size";
+		return -1;
+	} else if (!ret) {
+		return fit_image_check_chunks(fit, noffset, algo, chunk_size,
+					      data, size, fit_value,
+					      fit_value_len, err_msgp);
+	}
+
 	if (calculate_hash(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
@@ -1446,6 +1558,191 @@ err:
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(FIT_HASH_STREAM)
+/**
+ * fit_image_needs_sig() - Check if images must be verified by a required key
+ *
+ * @key_blob:	FDT containing public keys
+ * Return: true if @key_blob has a key marked as required for images
+ */
+static bool fit_image_needs_sig(const void *key_blob)
+{
+	const char *required;
+	int key_node, noffset;
+
+	key_node = fdt_subnode_offset(key_blob, 0, FIT_SIG_NODENAME);
+	if (key_node < 0)
+		return false;
+
+	fdt_for_each_subnode(noffset, key_blob, key_node) {
+		required = fdt_getprop(key_blob, noffset, FIT_KEY_REQUIRED,
+				       NULL);
+		if (required && !strcmp(required, "image"))
+			return true;
+	}
+
+	return false;
+}
+
+bool fit_image_hash_stream_check(const void *fit, int image_noffset)
+{
+	const char *name = fit_get_name(fit, image_noffset, NULL);
+	const char *algo_name;
+	struct hash_algo *algo;
+	int noffset, ignore;
+	int count = 0;
+
+	/* Leave anything unusual to fit_image_verify() */
+	if ((IS_ENABLED(CONFIG_FIT_SIGNATURE) && strchr(name, '@')) ||
+	    (FIT_IMAGE_ENABLE_VERIFY && fit_image_needs_sig(gd_fdt_blob())) ||
+	    CONFIG_IS_ENABLED(FIT_IMAGE_POST_PROCESS) ||
+	    fdt_subnode_offset(fit, image_noffset, FIT_CIPHER_NODENAME) >= 0)
+		return false;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		name = fit_get_name(fit, noffset, NULL);
+		if (FIT_IMAGE_ENABLE_VERIFY &&
+		    !strncmp(name, FIT_SIG_NODENAME, strlen(FIT_SIG_NODENAME)))
+			return false;
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore)
+			continue;
+		/* The value of a chunked hash is not the hash of the data */
+		if (fdt_getprop(fit, noffset, FIT_CHUNK_SIZE_PROP, NULL) ||
+		    fdt_getprop(fit, noffset, FIT_CHUNK_VALUE_PROP, NULL))
+			return false;
+		if (fit_image_hash_get_algo(fit, noffset, &algo_name) ||
+		    hash_progressive_lookup_algo(algo_name, &algo) ||
+		    ++count > FIT_HASH_STREAM_MAX)
+			return false;
+	}
+
+	return true;
+}
+
+int fit_image_hash_stream_start(struct fit_hash_stream *hs, const void *fit,
+				int image_noffset)
+{
+	const char *name, *algo_name;
+	struct hash_algo *algo;
+	int noffset, ignore;
+
+	memset(hs, '\0', sizeof(*hs));
+	hs->fit = fit;
+	hs->noffset = image_noffset;
+	if (!fit_image_hash_stream_check(fit, image_noffset))
+		return -ENOTSUPP;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		name = fit_get_name(fit, noffset, NULL);
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore)
+			continue;
+		fit_image_hash_get_algo(fit, noffset, &algo_name);
+		hash_progressive_lookup_algo(algo_name, &algo);
+		if (algo->hash_init(algo, &hs->ctx[hs->count])) {
+			fit_image_hash_stream_abort(hs);
+			return -ENOMEM;
+		}
+		hs->node[hs->count] = noffset;
+		hs->algo[hs->count++] = algo;
+	}
+
+	return 0;
+}
+
+int fit_image_hash_stream_update(struct fit_hash_stream *hs, const void *data,
+				 ulong len)
+{
+	struct hash_algo *algo;
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		algo = hs->algo[i];
+		if (!hs->ctx[i])
+			return -EIO;
+		if (algo->hash_update(algo, hs->ctx[i], data, len, 0)) {
+			/* the context has been freed */
+			hs->ctx[i] = NULL;
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+int fit_image_hash_stream_tap(void *hs, const void *data, ulong len)
+{
+	return fit_image_hash_stream_update(hs, data, len);
+}
+
+int fit_image_hash_stream_finish(struct fit_hash_stream *hs)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	const char *err_msg = NULL;
+	struct hash_algo *algo;
+	uint8_t *fit_value;
+	int fit_value_len;
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		algo = hs->algo[i];
+		if (!hs->ctx[i]) {
+			err_msg = "Hash calculation failed";
+			break;
+		}
+		printf("%s", algo->name);
+		if (algo->hash_finish(algo, hs->ctx[i], value, sizeof(value))) {
+			hs->ctx[i] = NULL;
+			err_msg = "Hash calculation failed";
+			break;
+		}
+		hs->ctx[i] = NULL;
+		if (fit_image_hash_get_value(hs->fit, hs->node[i], &fit_value,
+					     &fit_value_len)) {
+			err_msg = "Can't get hash value property";
+			break;
+		}
+		if (algo->digest_size != fit_value_len) {
+			err_msg = "Bad hash value len";
+			break;
+		} else if (memcmp(value, fit_value, fit_value_len)) {
+			err_msg = "Bad hash value";
+			break;
+		}
+		puts("+ ");
+	}
+	if (!err_msg)
+		return 0;
+
+	printf(" error!\n%s for '%s' hash node in '%s' image node\n",
+	       err_msg, fit_get_name(hs->fit, hs->node[i], NULL),
+	       fit_get_name(hs->fit, hs->noffset, NULL));
+	fit_image_hash_stream_abort(hs);
+
+	return -EACCES;
+}
+
+void fit_image_hash_stream_abort(struct fit_hash_stream *hs)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		if (hs->ctx[i])
+			hs->algo[i]->hash_finish(hs->algo[i], hs->ctx[i],
+						 value, sizeof(value));
+		hs->ctx[i] = NULL;
+	}
+}
+#endif /* FIT_HASH_STREAM */
+
 /**
  * fit_all_image_verify - verify data integrity for all images
  * @fit: pointer to the FIT format image header
@@ -2072,6 +2369,8 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 	ulong load, load_end, data, len;
 	uint8_t os, comp;
 	const char *prop_name;
+	struct fit_hash_stream hs;
+	bool hash_os, hash_load;
 	int ret;
 
 	fit = map_sysmem(addr, 0);
@@ -2147,7 +2446,23 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+	/*
+	 * Check the hashes while the data is loaded below, or leave that to
+	 * bootm_load_os() for the kernel
+	 */
+	hash_os = false;
+	hash_load = false;
+	if (CONFIG_IS_ENABLED(FIT_HASH_STREAM) && images->verify &&
+	    fit_image_hash_stream_check(fit, noffset)) {
+		if (image_type == IH_TYPE_KERNEL && images->fit_os_hash_defer)
+			hash_os = true;
+		else if (load_op != FIT_LOAD_IGNORED)
+			hash_load = true;
+	}
+	if (image_type == IH_TYPE_KERNEL)
+		images->fit_os_hash_defer = hash_os;
+	ret = fit_image_select(fit, noffset,
+			       images->verify && !hash_os && !hash_load);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
@@ -2266,8 +2581,14 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 		load = data;	/* No load address specified */
 	}
 
+	if (hash_load && fit_image_hash_stream_start(&hs, fit, noffset)) {
+		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
+		return -EACCES;
+	}
+
 	comp = IH_COMP_NONE;
 	loadbuf = buf;
+	ret = 0;
 	/* Kernel images get decompressed later in bootm_load_os(). */
 	if (!fit_image_get_comp(fit, noffset, &comp) &&
 	    comp != IH_COMP_NONE &&
@@ -2284,9 +2605,19 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 		} else {
 			loadbuf = map_sysmem(load, max_decomp_len);
 		}
-		if (image_decomp(comp, load, data, image_type,
-				loadbuf, buf, len, max_decomp_len, &load_end)) {
+		if (hash_load)
+			ret = image_decomp_tap(comp, load, data, image_type,
+					       loadbuf, buf, len,
+					       max_decomp_len, &load_end,
+					       fit_image_hash_stream_tap, &hs);
+		else
+			ret = image_decomp(comp, load, data, image_type,
+					   loadbuf, buf, len, max_decomp_len,
+					   &load_end);
+		if (ret) {
 			printf("Error decompressing %s\n", prop_name);
+			if (hash_load)
+				fit_image_hash_stream_abort(&hs);
 
 			return -ENOEXEC;
 		}
@@ -2294,7 +2625,25 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 	} else if (load != data) {
 		log_debug("copying\n");
 		loadbuf = map_sysmem(load, len);
-		memcpy(loadbuf, buf, len);
+		if (hash_load)
+			ret = image_move_tap(loadbuf, buf, len,
+					     fit_image_hash_stream_tap, &hs);
+		else
+			memcpy(loadbuf, buf, len);
+	} else if (hash_load) {
+		ret = fit_image_hash_stream_update(&hs, buf, len);
+	}
+
+	if (hash_load) {
+		puts("   Verifying Hash Integrity ... ");
+		if (ret)
+			fit_image_hash_stream_abort(&hs);
+		if (ret || fit_image_hash_stream_finish(&hs)) {
+			puts("Bad Data Hash\n");
+			bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
+			return -EACCES;
+		}
+		puts("OK\n");
 	}
 
 	if (image_type == IH_TYPE_RAMDISK && comp != IH_COMP_NONE)
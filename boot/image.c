@@ -540,6 +540,119 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 	return 0;
 }
 
+int image_move_tap(void *dst, const void *src, ulong len,
+		   int (*tap)(void *priv, const void *buf, ulong len),
+		   void *priv)
+{
+	ulong chunk, done;
+	int ret;
+
+	/*
+	 * Copying forwards would overwrite data not yet passed on if the
+	 * destination overlaps the end of the source
+	 */
+	if (dst > src && dst < src + len) {
+		ret = tap(priv, src, len);
+		if (!ret)
+			memmove_wd(dst, (void *)src, len, CHUNKSZ);
+		return ret;
+	}
+
+	for (done = 0; done < len; done += chunk) {
+		chunk = len - done;
+		if (chunk > CHUNKSZ)
+			chunk = CHUNKSZ;
+		ret = tap(priv, src + done, chunk);
+		if (ret)
+			return ret;
+		memmove_wd(dst + done, (void *)src + done, chunk, CHUNKSZ);
+	}
+
+	return 0;
+}
+
+/**
+ * struct decomp_tap - Keeps the error returned by the image_decomp_tap() caller
+ *
+ * @tap:	Caller's function
+ * @priv:	Caller's private data
+ * @ret:	Error returned by @tap, if any
+ */
+struct decomp_tap {
+	int (*tap)(void *priv, const void *buf, ulong len);
+	void *priv;
+	int ret;
+};
+
+static int decomp_tap(void *priv, const void *buf, ulong len)
+{
+	struct decomp_tap *dt = priv;
+
+	dt->ret = dt->tap(dt->priv, buf, len);
+
+	return dt->ret;
+}
+
+int image_decomp_tap(int comp, ulong load, ulong image_start, int type,
+		     void *load_buf, void *image_buf, ulong image_len,
+		     uint unc_len, ulong *load_end,
+		     int (*tap)(void *priv, const void *buf, ulong len),
+		     void *priv)
+{
+	struct decomp_tap dt = { .tap = tap, .priv = priv };
+	struct abuf in, out;
+	ulong len = 0;
+	int ret = -ENOSYS;
+
+	*load_end = load;
+	switch (comp) {
+	case IH_COMP_NONE:
+		if (load == image_start || image_len > unc_len)
+			break;
+		print_decomp_msg(comp, type, false, load);
+		ret = image_move_tap(load_buf, image_buf, image_len, decomp_tap,
+				     &dt);
+		len = image_len;
+		break;
+	case IH_COMP_GZIP:
+		if (tools_build() || !CONFIG_IS_ENABLED(GZIP))
+			break;
+		print_decomp_msg(comp, type, false, load);
+		len = image_len;
+		ret = gunzip_tap(load_buf, unc_len, image_buf, &len,
+				 decomp_tap, &dt);
+		break;
+	case IH_COMP_ZSTD:
+		if (tools_build() || !CONFIG_IS_ENABLED(ZSTD))
+			break;
+		print_decomp_msg(comp, type, false, load);
+		abuf_init_set(&in, image_buf, image_len);
+		abuf_init_set(&out, load_buf, unc_len);
+		ret = zstd_decompress_tap(&in, &out, decomp_tap, &dt);
+		if (ret >= 0) {
+			len = ret;
+			ret = 0;
+		}
+		break;
+	}
+
+	if (ret == -ENOSYS) {
+		/* No incremental support, so pass everything on first */
+		ret = tap(priv, image_buf, image_len);
+		if (ret)
+			return ret;
+
+		return image_decomp(comp, load, image_start, type, load_buf,
+				    image_buf, image_len, unc_len, load_end);
+	}
+
+	*load_end = load + len;
+	if (dt.ret)
+		return dt.ret;
+
+	return ret;
+}
+
 const table_entry_t *get_table_entry(const table_entry_t *table, int id)
 {
 	for (; table->id >= 0; ++table) {
@@ -4,6 +4,7 @@
  * Author: Eric Nelson<eric@nelint.com>
  *
  */
+#include <blk.h>
 #include <command.h>
 #include <config.h>
 #include <malloc.h>
@@ -13,16 +14,36 @@
 static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 		     int argc, char *const argv[])
 {
+	struct block_cache_dev_stats dstats;
 	struct block_cache_stats stats;
+	int seq;
+
 	blkcache_stats(&stats);
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
+	       "evictions: %u\n"
 	       "entries: %u\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max cache entries: %u\n"
+	       "ways: %u\n"
+	       "size: %lu bytes\n"
+	       "max read-ahead: %u blocks\n",
+	       stats.hits, stats.misses, stats.evictions, stats.entries,
+	       stats.max_blocks_per_entry, stats.max_entries, stats.ways,
+	       stats.size, stats.max_readahead);
+
+	for (seq = 0; !blkcache_dev_stats(seq, &dstats); seq++) {
+		if (!seq)
+			printf("\n%-10s %3s %10s %10s %10s %10s\n", "Interface",
+			       "Dev", "Hits", "Misses", "Evictions",
+			       "Read-ahead");
+		printf("%-10s %3d %10u %10u %10u %10u\n",
+		       blk_get_uclass_name(dstats.iftype), dstats.devnum,
+		       dstats.hits, dstats.misses, dstats.evictions,
+		       dstats.readahead);
+	}
+
 	return 0;
 }
 
@@ -71,5 +92,5 @@ U_BOOT_CMD(
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
 	"blkcache configure <blocks> <entries> "
-	"- set max blocks per entry and max cache entries\n"
+	"- set blocks per cache line and max cache entries\n"
 );
@@ -200,6 +200,16 @@ static int do_bootflow_scan(struct cmd_tbl *cmdtp, int flag, int argc,
 		bootstd_clear_bootflows_for_bootdev(dev);
 	else
 		bootstd_clear_glob();
+
+	/* Try the bootflow which was booted last time, if it is still there */
+	if (boot && !menu && !dev && !label &&
+	    !bootflow_cache_find(flags & ~BOOTFLOWIF_SHOW, &bflow)) {
+		if (list)
+			printf("Using bootflow from last boot\n");
+		bootflow_run_boot(NULL, &bflow);
+		bootflow_free(&bflow);
+	}
+
 	for (i = 0,
 	     ret = bootflow_scan_first(dev, label, &iter, flags, &bflow);
 	     i < 1000 && ret != -ENODEV;
@@ -57,19 +57,39 @@ static int do_cyclic_demo(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static void show_latency(struct cyclic_info *cyclic)
+{
+#if defined(CONFIG_CYCLIC_LATENCY_STATS)
+	int i;
+
+	if (!cyclic->run_cnt)
+		return;
+	printf("  latency: avg %lld us, max %u us, jitter %u us\n",
+	       lldiv(cyclic->lat_total_us, cyclic->run_cnt),
+	       cyclic->lat_max_us, cyclic->jitter >> 4);
+	printf("  histogram:");
+	for (i = 0; i < CYCLIC_LAT_BUCKETS - 1; i++)
+		printf(" <%uus: %u", cyclic_lat_limit_us(i),
+		       cyclic->lat_hist[i]);
+	printf(" more: %u\n", cyclic->lat_hist[i]);
+#endif
+}
+
 static int do_cyclic_list(struct cmd_tbl *cmdtp, int flag, int argc,
 			  char *const argv[])
 {
 	struct cyclic_info *cyclic;
 	struct hlist_node *tmp;
 	u64 cnt, freq;
+	uint rem;
 
 	hlist_for_each_entry_safe(cyclic, tmp, cyclic_get_list(), list) {
 		cnt = cyclic->run_cnt * 1000000ULL * 100ULL;
 		freq = lldiv(cnt, timer_get_us() - cyclic->start_time_us);
+		rem = do_div(freq, 100);
 		printf("function: %s, cpu-time: %lld us, frequency: %lld.%02d times/s\n",
-		       cyclic->name, cyclic->cpu_time_us,
-		       lldiv(freq, 100), do_div(freq, 100));
+		       cyclic->name, cyclic->cpu_time_us, freq, rem);
+		show_latency(cyclic);
 	}
 
 	return 0;
@@ -16,11 +16,13 @@
 #include <command.h>
 #include <console.h>
 #include <display_options.h>
+#include <div64.h>
 #ifdef CONFIG_MTD_NOR_FLASH
 #include <flash.h>
 #endif
 #include <hash.h>
 #include <log.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <rand.h>
 #include <time.h>
@@ -31,6 +33,7 @@
 #include <linux/compiler.h>
 #include <linux/ctype.h>
 #include <linux/delay.h>
+#include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -1309,6 +1312,87 @@ static int do_random(struct cmd_tbl *cmdtp, int flag, int argc,
 }
 #endif
 
+#ifdef CONFIG_CMD_MEM_BENCH
+/* Amount of data to move for each size class, to get a stable result */
+#define MEM_BENCH_TOTAL		SZ_16M
+#define MEM_BENCH_MIN		64
+
+/**
+ * mem_bench_rate() - Work out the bandwidth of a test run
+ *
+ * @bytes: Number of bytes processed
+ * @us: Time taken in microseconds
+ * Return: bandwidth in MB/s
+ */
+static ulong mem_bench_rate(u64 bytes, ulong us)
+{
+	return lldiv(bytes, max(us, 1UL));
+}
+
+static int do_mem_bench(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	ulong max_size = SZ_1M;
+	ulong size;
+	u8 *src, *dst;
+
+	if (argc > 2)
+		return CMD_RET_USAGE;
+	if (argc == 2)
+		max_size = hextoul(argv[1], NULL);
+	if (max_size < MEM_BENCH_MIN) {
+		printf("Size must be at least %#x\n", MEM_BENCH_MIN);
+		return CMD_RET_FAILURE;
+	}
+
+	/* Allow room for memmove() to shift the data along */
+	src = malloc(max_size + MEM_BENCH_MIN);
+	dst = malloc(max_size);
+	if (!src || !dst) {
+		printf("Out of memory\n");
+		free(src);
+		free(dst);
+		return CMD_RET_FAILURE;
+	}
+	memset(src, 0xa5, max_size + MEM_BENCH_MIN);
+	memset(dst, 0, max_size);
+
+	printf("%10s  %12s  %12s  %12s\n", "Size", "memcpy", "memmove",
+	       "memset");
+	for (size = MEM_BENCH_MIN; size <= max_size; size *= 4) {
+		ulong loops = max(MEM_BENCH_TOTAL / size, 1UL);
+		ulong cpy, move, set;
+		u64 bytes = (u64)loops * size;
+		ulong start, i;
+
+		start = timer_get_us();
+		for (i = 0; i < loops; i++)
+			memcpy(dst, src, size);
+		cpy = timer_get_us() - start;
+
+		start = timer_get_us();
+		for (i = 0; i < loops; i++)
+			memmove(src + MEM_BENCH_MIN, src, size);
+		move = timer_get_us() - start;
+
+		start = timer_get_us();
+		for (i = 0; i < loops; i++)
+			memset(dst, i, size);
+		set = timer_get_us() - start;
+
+		printf("%10lx  %7lu MB/s  %7lu MB/s  %7lu MB/s\n", size,
+		       mem_bench_rate(bytes, cpy), mem_bench_rate(bytes, move),
+		       mem_bench_rate(bytes, set));
+		if (ctrlc())
+			break;
+	}
+	free(src);
+	free(dst);
+
+	return CMD_RET_SUCCESS;
+}
+#endif /* CONFIG_CMD_MEM_BENCH */
+
 /**************************************************/
 U_BOOT_CMD(
 	md,	3,	1,	do_mem_md,
@@ -1430,3 +1514,12 @@ U_BOOT_CMD(
 	"   - Fill 'len' bytes of memory starting at 'addr' with random data\n"
 );
 #endif
+
+#ifdef CONFIG_CMD_MEM_BENCH
+U_BOOT_LONGHELP(mem,
+	"bench [max_size] - measure memcpy(), memmove() and memset() bandwidth\n"
+	"    for sizes from 0x40 up to max_size (default 0x100000)");
+
+U_BOOT_CMD_WITH_SUBCMDS(mem, "memory operations", mem_help_text,
+	U_BOOT_SUBCMD_MKENT(bench, 2, 1, do_mem_bench));
+#endif /* CONFIG_CMD_MEM_BENCH */
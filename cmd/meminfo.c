@@ -10,6 +10,8 @@
 #include <display_options.h>
 #include <lmb.h>
 #include <malloc.h>
+#include <malloc_arena.h>
+#include <malloc_slab.h>
 #include <mapmem.h>
 #include <asm/global_data.h>
 
@@ -51,17 +53,10 @@ static void show_lmb(const struct lmb *lmb, ulong *uptop)
 	}
 }
 
-static int do_meminfo(struct cmd_tbl *cmdtp, int flag, int argc,
-		      char *const argv[])
+static void show_map(void)
 {
 	ulong upto, stk_bot;
 
-	puts("DRAM:  ");
-	print_size(gd->ram_size, "\n");
-
-	if (!IS_ENABLED(CONFIG_CMD_MEMINFO_MAP))
-		return 0;
-
 	arch_dump_mem_attrs();
 
 	printf("\n%-12s %8s %8s %8s %8s\n", "Region", "Base", "Size", "End",
@@ -94,6 +89,48 @@ static int do_meminfo(struct cmd_tbl *cmdtp, int flag, int argc,
 	if (IS_ENABLED(CONFIG_LMB))
 		show_lmb(lmb_get(), &upto);
 	print_region("free", gd->ram_base, upto, &upto);
+}
+
+static void show_slabs(void)
+{
+	struct malloc_slab_info info;
+	uint seq;
+
+	printf("\n%-12s %8s %8s %8s %8s\n", "Slab", "Pages", "Used", "Peak",
+	       "Free");
+	printf("------------------------------------------------\n");
+	for (seq = 0; !malloc_slab_get_info(seq, &info); seq++)
+		printf("%-12u %8u %8u %8u %8u\n", info.size, info.pages,
+		       info.used, info.peak, info.free);
+}
+
+static void show_arenas(void)
+{
+	struct list_head *head = malloc_arena_list();
+	struct malloc_arena *arena;
+
+	if (list_empty(head))
+		return;
+	printf("\n%-12s %8s %8s %8s %8s\n", "Arena", "Blocks", "Size", "Used",
+	       "Peak");
+	printf("------------------------------------------------\n");
+	list_for_each_entry(arena, head, sibling)
+		printf("%-12s %8u %8lx %8lx %8lx\n", arena->name,
+		       arena->nblocks, arena->size, arena->used, arena->peak);
+}
+
+static int do_meminfo(struct cmd_tbl *cmdtp, int flag, int argc,
+		      char *const argv[])
+{
+	puts("DRAM:  ");
+	print_size(gd->ram_size, "\n");
+
+	if (IS_ENABLED(CONFIG_CMD_MEMINFO_MAP))
+		show_map();
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB))
+		show_slabs();
+	if (CONFIG_IS_ENABLED(MALLOC_ARENA))
+		show_arenas();
 
 	return 0;
 }
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Write a network download to storage as it arrives
+ */
+
+#include <blk.h>
+#include <command.h>
+#include <display_options.h>
+#include <net-sink.h>
+#include <part.h>
+#include <vsprintf.h>
+
+static int do_netsink(struct cmd_tbl *cmdtp, int flag, int argc,
+		      char *const argv[])
+{
+	struct net_sink sink = {};
+	struct disk_partition info;
+	int repeatable = 0;
+	int nargs, ret;
+	s64 written;
+
+	if (argc < 4)
+		return CMD_RET_USAGE;
+
+	if (!strcmp(argv[1], "blk")) {
+		sink.type = NET_SINK_BLK;
+		nargs = 5;
+	} else if (!strcmp(argv[1], "sparse")) {
+		sink.type = NET_SINK_SPARSE;
+		nargs = 4;
+	} else if (!strcmp(argv[1], "file")) {
+		sink.type = NET_SINK_FILE;
+		nargs = 5;
+	} else {
+		return CMD_RET_USAGE;
+	}
+	if (argc <= nargs)
+		return CMD_RET_USAGE;
+
+	if (sink.type == NET_SINK_FILE) {
+		sink.ifname = argv[2];
+		sink.dev_part = argv[3];
+		sink.fname = argv[4];
+	} else {
+		if (blk_get_device_part_str(argv[2], argv[3], &sink.desc,
+					    &info, 1) < 0)
+			return CMD_RET_FAILURE;
+		sink.start = info.start;
+		sink.size = info.size;
+		if (sink.type == NET_SINK_BLK) {
+			lbaint_t offset = simple_strtoul(argv[4], NULL, 16);
+
+			if (offset >= sink.size) {
+				printf("Start block " LBAFU " is beyond the end\n",
+				       offset);
+				return CMD_RET_FAILURE;
+			}
+			sink.start += offset;
+			sink.size -= offset;
+		}
+	}
+
+	ret = net_sink_start(&sink);
+	if (ret) {
+		printf("Cannot set up netsink (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+	ret = cmd_process(flag, argc - nargs, argv + nargs, &repeatable, NULL);
+	written = net_sink_finish(&sink, ret != CMD_RET_SUCCESS);
+	if (ret)
+		return ret;
+	if (written < 0) {
+		printf("Write failed (err=%lld)\n", written);
+		return CMD_RET_FAILURE;
+	}
+	if (!written) {
+		printf("Nothing was written\n");
+		return CMD_RET_FAILURE;
+	}
+	printf("Wrote ");
+	print_size(written, "\n");
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_LONGHELP(netsink,
+	"blk <interface> <dev[:part]> <blk#> command [args...]\n"
+	"    - write the file downloaded by command to the device, from\n"
+	"      block blk# (hex) on\n"
+	"netsink sparse <interface> <dev[:part]> command [args...]\n"
+	"    - expand the Android sparse image downloaded by command onto the\n"
+	"      device or partition\n"
+	"netsink file <interface> <dev[:part]> <filename> command [args...]\n"
+	"    - write the file downloaded by command to a file\n"
+	"\n"
+	"command is tftpboot or wget; its load address is not used");
+
+U_BOOT_CMD(netsink, CONFIG_SYS_MAXARGS, 0, do_netsink,
+	   "write a download to storage as it arrives", netsink_help_text);
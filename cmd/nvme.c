@@ -6,11 +6,51 @@
 
 #include <blk.h>
 #include <command.h>
+#include <div64.h>
 #include <dm.h>
+#include <mapmem.h>
 #include <nvme.h>
+#include <time.h>
 
 static int nvme_curr_dev;
 
+static int do_nvme_bench(int argc, char *const argv[])
+{
+	struct blk_desc *desc;
+	struct udevice *udev;
+	ulong addr, blk, cnt, bytes, kbps;
+	u64 start, elapsed;
+	long n;
+	int ret;
+
+	addr = hextoul(argv[2], NULL);
+	blk = hextoul(argv[3], NULL);
+	cnt = hextoul(argv[4], NULL);
+
+	ret = blk_get_device(UCLASS_NVME, nvme_curr_dev, &udev);
+	if (ret < 0)
+		return CMD_RET_FAILURE;
+	desc = dev_get_uclass_plat(udev);
+
+	/* measure the device, not the block cache */
+	blkcache_invalidate(desc->uclass_id, desc->devnum);
+
+	start = timer_get_us();
+	n = blk_read(udev, blk, cnt, map_sysmem(addr, cnt * desc->blksz));
+	elapsed = timer_get_us() - start;
+	if (n != cnt) {
+		printf("Read failed: %ld\n", n);
+		return CMD_RET_FAILURE;
+	}
+
+	bytes = cnt * desc->blksz;
+	kbps = elapsed ? lldiv((u64)bytes * 1000000 / 1024, elapsed) : 0;
+	printf("%lu bytes read in %llu us, %lu.%03lu MiB/s\n", bytes,
+	       elapsed, kbps / 1024, (kbps % 1024) * 1000 / 1024);
+
+	return 0;
+}
+
 static int do_nvme(struct cmd_tbl *cmdtp, int flag, int argc,
 		   char *const argv[])
 {
@@ -38,6 +78,9 @@ static int do_nvme(struct cmd_tbl *cmdtp, int flag, int argc,
 		}
 	}
 
+	if (argc == 5 && !strcmp(argv[1], "bench"))
+		return do_nvme_bench(argc, argv);
+
 	return blk_common_cmd(argc, argv, UCLASS_NVME, &nvme_curr_dev);
 }
 
@@ -52,5 +95,7 @@ U_BOOT_CMD(
 	"nvme read addr blk# cnt - read `cnt' blocks starting at block\n"
 	"     `blk#' to memory address `addr'\n"
 	"nvme write addr blk# cnt - write `cnt' blocks starting at block\n"
-	"     `blk#' from memory address `addr'"
+	"     `blk#' from memory address `addr'\n"
+	"nvme bench addr blk# cnt - time reading `cnt' blocks starting at\n"
+	"     block `blk#' to memory address `addr'"
 );
@@ -28,6 +28,27 @@ struct hlist_head *cyclic_get_list(void)
 	return (struct hlist_head *)&gd->cyclic_list;
 }
 
+/*
+ * Insert @cyclic into the list, which is kept sorted by next_call. Functions
+ * with the same next_call are run in the order they were inserted.
+ */
+static void cyclic_insert(struct cyclic_info *cyclic)
+{
+	struct cyclic_info *pos, *last = NULL;
+
+	hlist_for_each_entry(pos, cyclic_get_list(), list) {
+		if (time_after64(pos->next_call, cyclic->next_call)) {
+			hlist_add_before(&cyclic->list, &pos->list);
+			return;
+		}
+		last = pos;
+	}
+	if (last)
+		hlist_add_after(&last->list, &cyclic->list);
+	else
+		hlist_add_head(&cyclic->list, cyclic_get_list());
+}
+
 void cyclic_register(struct cyclic_info *cyclic, cyclic_func_t func,
 		     uint64_t delay_us, const char *name)
 {
@@ -38,7 +59,9 @@ void cyclic_register(struct cyclic_info *cyclic, cyclic_func_t func,
 	cyclic->name = name;
 	cyclic->delay_us = delay_us;
 	cyclic->start_time_us = get_timer_us(0);
-	hlist_add_head(&cyclic->list, cyclic_get_list());
+	/* Run the function on the next call to schedule() */
+	cyclic->next_call = cyclic->start_time_us;
+	cyclic_insert(cyclic);
 }
 
 void cyclic_unregister(struct cyclic_info *cyclic)
@@ -46,45 +69,110 @@ void cyclic_unregister(struct cyclic_info *cyclic)
 	hlist_del(&cyclic->list);
 }
 
+static void cyclic_account_latency(struct cyclic_info *cyclic, uint64_t now)
+{
+#if defined(CONFIG_CYCLIC_LATENCY_STATS)
+	uint32_t lat, diff;
+	int bucket;
+
+	lat = min_t(uint64_t, now - cyclic->next_call, U32_MAX);
+	cyclic->lat_total_us += lat;
+	cyclic->lat_max_us = max(cyclic->lat_max_us, lat);
+
+	/* J += (|D| - J) / 16, with J kept in 1/16 us */
+	if (cyclic->run_cnt) {
+		diff = lat > cyclic->lat_last_us ? lat - cyclic->lat_last_us :
+			cyclic->lat_last_us - lat;
+		cyclic->jitter += diff - ((cyclic->jitter + 8) >> 4);
+	}
+	cyclic->lat_last_us = lat;
+
+	for (bucket = 0; bucket < CYCLIC_LAT_BUCKETS - 1; bucket++) {
+		if (lat < cyclic_lat_limit_us(bucket))
+			break;
+	}
+	cyclic->lat_hist[bucket]++;
+#endif
+}
+
 static void cyclic_run(void)
 {
+	struct hlist_head *head = cyclic_get_list();
+	struct hlist_node *tail = NULL;
 	struct cyclic_info *cyclic;
-	struct hlist_node *tmp;
-	uint64_t now, cpu_time;
+	HLIST_HEAD(due);
+	uint64_t now, end, cpu_time;
+
+	/*
+	 * The list is sorted by next_call, so there is nothing to do unless
+	 * the first function is due. This is the common case, since
+	 * schedule() is called far more often than any cyclic function.
+	 */
+	if (hlist_empty(head))
+		return;
+	now = get_timer_us(0);
+	cyclic = hlist_entry(head->first, struct cyclic_info, list);
+	if (time_before64(now, cyclic->next_call))
+		return;
 
 	/* Prevent recursion */
 	if (gd->flags & GD_FLG_CYCLIC_RUNNING)
 		return;
 
 	gd->flags |= GD_FLG_CYCLIC_RUNNING;
-	hlist_for_each_entry_safe(cyclic, tmp, cyclic_get_list(), list) {
+
+	/*
+	 * Move the functions which are due to a separate list first, so that
+	 * each one is called at most once here, even with a zero delay. They
+	 * are at the start of the list, in order.
+	 */
+	while (!hlist_empty(head)) {
+		struct hlist_node *node = head->first;
+
+		cyclic = hlist_entry(node, struct cyclic_info, list);
+		if (time_before64(now, cyclic->next_call))
+			break;
+		hlist_del(node);
+		if (tail)
+			hlist_add_after(tail, node);
+		else
+			hlist_add_head(node, &due);
+		tail = node;
+	}
+
+	while (!hlist_empty(&due)) {
+		cyclic = hlist_entry(due.first, struct cyclic_info, list);
+
 		/*
-		 * Check if this cyclic function needs to get called, e.g.
-		 * do not call the cyclic func too often
+		 * Put it back in the list before calling it, so that the
+		 * function can unregister itself
 		 */
-		now = get_timer_us(0);
-		if (time_after_eq64(now, cyclic->next_call)) {
-			/* Call cyclic function and account it's cpu-time */
-			cyclic->next_call = now + cyclic->delay_us;
-			cyclic->func(cyclic);
-			cyclic->run_cnt++;
-			cpu_time = get_timer_us(0) - now;
-			cyclic->cpu_time_us += cpu_time;
-
-			/* Check if cpu-time exceeds max allowed time */
-			if ((cpu_time > CONFIG_CYCLIC_MAX_CPU_TIME_US) &&
-			    (!cyclic->already_warned)) {
-				pr_err("cyclic function %s took too long: %lldus vs %dus max\n",
-				       cyclic->name, cpu_time,
-				       CONFIG_CYCLIC_MAX_CPU_TIME_US);
-
-				/*
-				 * Don't disable this function, just warn once
-				 * about this exceeding CPU time usage
-				 */
-				cyclic->already_warned = true;
-			}
+		hlist_del(&cyclic->list);
+		cyclic_account_latency(cyclic, now);
+		cyclic->next_call = now + cyclic->delay_us;
+		cyclic_insert(cyclic);
+
+		/* Call cyclic function and account it's cpu-time */
+		cyclic->func(cyclic);
+		cyclic->run_cnt++;
+		end = get_timer_us(0);
+		cpu_time = end - now;
+		cyclic->cpu_time_us += cpu_time;
+
+		/* Check if cpu-time exceeds max allowed time */
+		if ((cpu_time > CONFIG_CYCLIC_MAX_CPU_TIME_US) &&
+		    (!cyclic->already_warned)) {
+			pr_err("cyclic function %s took too long: %lldus vs %dus max\n",
+			       cyclic->name, cpu_time,
+			       CONFIG_CYCLIC_MAX_CPU_TIME_US);
+
+			/*
+			 * Don't disable this function, just warn once
+			 * about this exceeding CPU time usage
+			 */
+			cyclic->already_warned = true;
 		}
+		now = end;
 	}
 	gd->flags &= ~GD_FLG_CYCLIC_RUNNING;
 }
@@ -16,6 +16,7 @@
 #include <asm/global_data.h>
 
 #include <malloc.h>
+#include <malloc_slab.h>
 #include <mapmem.h>
 #include <string.h>
 #include <asm/io.h>
@@ -603,6 +604,8 @@ void mem_malloc_init(ulong start, ulong size)
 	mem_malloc_start = (ulong)map_sysmem(start, size);
 	mem_malloc_end = mem_malloc_start + size;
 	mem_malloc_brk = mem_malloc_start;
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB))
+		mem_malloc_brk += malloc_slab_init(mem_malloc_start, size);
 
 #ifdef CONFIG_SYS_MALLOC_DEFAULT_TO_INIT
 	malloc_init();
@@ -1279,6 +1282,13 @@ Void_t* mALLOc_impl(bytes) size_t bytes;
   if (bytes > CONFIG_SYS_MALLOC_LEN || (long)bytes < 0)
      return NULL;
 
+  if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)) {
+    Void_t *mem = malloc_slab_alloc(bytes);
+
+    if (mem)
+      return mem;
+  }
+
   nb = request2size(bytes);  /* padded request size; */
 
   /* Check for exact match in a bin */
@@ -1549,6 +1559,11 @@ void fREe_impl(mem) Void_t* mem;
   if (mem == NULL)                              /* free(0) has no effect */
     return;
 
+  if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB) && malloc_slab_owns(mem)) {
+    malloc_slab_free(mem);
+    return;
+  }
+
   p = mem2chunk(mem);
   hd = p->size;
 
@@ -1707,6 +1722,19 @@ Void_t* rEALLOc_impl(oldmem, bytes) Void_t* oldmem; size_t bytes;
       return NULL;
   }
 
+  /* Slab objects cannot grow in place, so move them if needed */
+  if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB) && malloc_slab_owns(oldmem)) {
+    oldsize = malloc_slab_usable_size(oldmem);
+    if (bytes <= oldsize)
+      return oldmem;
+    newmem = mALLOc_impl(bytes);
+    if (newmem) {
+      memcpy(newmem, oldmem, oldsize);
+      fREe_impl(oldmem);
+    }
+    return newmem;
+  }
+
   newp    = oldp    = mem2chunk(oldmem);
   newsize = oldsize = chunksize(oldp);
 
@@ -1980,6 +2008,17 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
 
   if (m == NULL) return NULL; /* propagate failure */
 
+  /*
+   * A slab object is aligned to its size, a power of two, which is normally
+   * larger than the alignment since the request included padding for it
+   */
+  if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB) && malloc_slab_owns(m)) {
+    if (((unsigned long)(m)) % alignment == 0)
+      return m;
+    fREe_impl(m);
+    return NULL;
+  }
+
   p = mem2chunk(m);
 
   if ((((unsigned long)(m)) % alignment) == 0) /* aligned */
@@ -2116,6 +2155,11 @@ Void_t* cALLOc_impl(n, elem_size) size_t n; size_t elem_size;
 		return mem;
 	}
 #endif
+    /* MALLOC_ZERO() may clear more than sz, so use memset() */
+    if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB) && malloc_slab_owns(mem)) {
+      memset(mem, '\0', sz);
+      return mem;
+    }
     p = mem2chunk(mem);
 
     /* Two optional cases in which clearing not necessary */
@@ -2343,6 +2387,8 @@ size_t malloc_usable_size(mem) Void_t* mem;
   mchunkptr p;
   if (mem == NULL)
     return 0;
+  else if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB) && malloc_slab_owns(mem))
+    return malloc_slab_usable_size(mem);
   else
   {
     p = mem2chunk(mem);
@@ -2390,6 +2436,9 @@ static void malloc_update_mallinfo(void)
 
   current_mallinfo.ordblks = navail;
   current_mallinfo.uordblks = sbrked_mem - avail;
+  /* The slab region is outside sbrked_mem, so count its objects here */
+  if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB))
+    current_mallinfo.uordblks += malloc_slab_in_use();
   current_mallinfo.fordblks = avail;
   current_mallinfo.hblks = n_mmaps;
   current_mallinfo.hblkhd = mmapped_mem;
@@ -195,7 +195,8 @@ static int __maybe_unused hash_finish_crc32(struct hash_algo *algo, void *ctx,
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint32_t *)dest_buf) = *((uint32_t *)ctx);
+	/* Big-endian, as with crc32_wd_buf() */
+	*((uint32_t *)dest_buf) = cpu_to_uimage(*((uint32_t *)ctx));
 	free(ctx);
 	return 0;
 }
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Named arenas for allocations which are released together
+ *
+ * Some work, such as scanning for bootflows or looking through a filesystem,
+ * makes many small allocations which all become garbage at the same point.
+ * Allocating them from an arena means they are packed together in a few large
+ * blocks and can be released in one go, without the caller having to track
+ * each one or leaving holes scattered through the heap.
+ */
+
+#define LOG_CATEGORY LOGC_ALLOC
+
+#include <log.h>
+#include <malloc.h>
+#include <malloc_arena.h>
+#include <string.h>
+#include <linux/kernel.h>
+
+/* Alignment of allocations, the same as malloc() provides */
+#define ARENA_ALIGN	(2 * sizeof(size_t))
+
+/**
+ * struct arena_block - A block of memory owned by an arena
+ *
+ * @next: Previous block allocated for the arena, or NULL if none
+ * @size: Number of bytes in @data
+ * @used: Number of bytes of @data allocated
+ * @data: Memory for allocations
+ */
+struct arena_block {
+	struct arena_block *next;
+	ulong size;
+	ulong used;
+	char data[] __aligned(ARENA_ALIGN);
+};
+
+static LIST_HEAD(arena_head);
+
+struct malloc_arena *malloc_arena_create(const char *name)
+{
+	struct malloc_arena *arena;
+
+	arena = calloc(1, sizeof(*arena));
+	if (!arena)
+		return NULL;
+	arena->name = name;
+	list_add_tail(&arena->sibling, &arena_head);
+
+	return arena;
+}
+
+void *malloc_arena_alloc(struct malloc_arena *arena, size_t size)
+{
+	struct arena_block *blk = arena->blocks;
+	ulong len = ALIGN(size, ARENA_ALIGN);
+	void *ptr;
+
+	if (!blk || blk->size - blk->used < len) {
+		ulong bsize = max_t(ulong, len, CONFIG_MALLOC_ARENA_BLOCK_SIZE);
+
+		blk = malloc(sizeof(*blk) + bsize);
+		if (!blk)
+			return NULL;
+		log_debug("arena '%s': new block of %lx\n", arena->name, bsize);
+		blk->size = bsize;
+		blk->used = 0;
+		blk->next = arena->blocks;
+		arena->blocks = blk;
+		arena->nblocks++;
+		arena->size += bsize;
+	}
+	ptr = blk->data + blk->used;
+	blk->used += len;
+	arena->used += len;
+	arena->peak = max(arena->peak, arena->used);
+	arena->count++;
+
+	return ptr;
+}
+
+void *malloc_arena_zalloc(struct malloc_arena *arena, size_t size)
+{
+	void *ptr;
+
+	ptr = malloc_arena_alloc(arena, size);
+	if (ptr)
+		memset(ptr, '\0', size);
+
+	return ptr;
+}
+
+char *malloc_arena_strdup(struct malloc_arena *arena, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *ptr;
+
+	ptr = malloc_arena_alloc(arena, len);
+	if (ptr)
+		memcpy(ptr, str, len);
+
+	return ptr;
+}
+
+void malloc_arena_reset(struct malloc_arena *arena)
+{
+	struct arena_block *blk, *next;
+
+	for (blk = arena->blocks; blk; blk = next) {
+		next = blk->next;
+		free(blk);
+	}
+	arena->blocks = NULL;
+	arena->nblocks = 0;
+	arena->size = 0;
+	arena->used = 0;
+	arena->count = 0;
+}
+
+void malloc_arena_destroy(struct malloc_arena *arena)
+{
+	if (!arena)
+		return;
+	malloc_arena_reset(arena);
+	list_del(&arena->sibling);
+	free(arena);
+}
+
+struct list_head *malloc_arena_list(void)
+{
+	return &arena_head;
+}
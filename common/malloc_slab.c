@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Size-class slabs for small malloc() allocations
+ *
+ * Small objects are the majority of allocations in U-Boot (device private
+ * data, environment entries, path strings, network buffers) and many of them
+ * are short-lived. Serving them from the general dlmalloc bins scatters them
+ * through the heap and leaves it too fragmented for the large buffers needed
+ * later in boot.
+ *
+ * Instead, a region at the start of the malloc() pool is split into pages,
+ * each of which holds objects of just one size class. Free objects are kept
+ * on a per-class list threaded through the objects themselves, so allocating
+ * and freeing are constant-time and never touch the dlmalloc heap. Once a page
+ * is given to a class it stays with it. When the region is full, allocations
+ * fall back to dlmalloc.
+ */
+
+#define LOG_CATEGORY LOGC_ALLOC
+
+#include <errno.h>
+#include <log.h>
+#include <malloc_slab.h>
+#include <string.h>
+#include <linux/kernel.h>
+#include <valgrind/valgrind.h>
+
+#define SLAB_PAGES	(CONFIG_SYS_MALLOC_SLAB_LEN / SLAB_PAGE_SIZE)
+
+static const ushort slab_size[] = { 16, 32, 64, 128, SLAB_MAX_SIZE };
+
+#define SLAB_CLASSES	ARRAY_SIZE(slab_size)
+
+/**
+ * struct slab_class - Information about a size class
+ *
+ * @free: First free object, whose first word points to the next
+ * @pages: Number of pages assigned to this class
+ * @used: Number of objects allocated
+ * @peak: Largest value @used has reached
+ */
+struct slab_class {
+	void *free;
+	uint pages;
+	uint used;
+	uint peak;
+};
+
+static struct slab_class slab_class[SLAB_CLASSES];
+
+/* Class of each page, plus one, or 0 if not yet assigned */
+static u8 slab_page_class[SLAB_PAGES];
+
+static ulong slab_base, slab_end;
+static uint slab_next_page;
+
+ulong malloc_slab_init(ulong start, ulong size)
+{
+	ulong base = ALIGN(start, SLAB_PAGE_SIZE);
+
+	memset(slab_class, '\0', sizeof(slab_class));
+	memset(slab_page_class, '\0', sizeof(slab_page_class));
+	slab_next_page = 0;
+	slab_base = 0;
+	slab_end = 0;
+	if (base + SLAB_PAGES * SLAB_PAGE_SIZE > start + size / 2) {
+		log_warning("malloc pool too small for slabs\n");
+		return 0;
+	}
+	slab_base = base;
+	slab_end = base + SLAB_PAGES * SLAB_PAGE_SIZE;
+	log_debug("slabs at %lx-%lx\n", slab_base, slab_end);
+
+	return slab_end - start;
+}
+
+/* Give a new page to a class and put all its objects on the free list */
+static int slab_add_page(uint cls)
+{
+	struct slab_class *sc = &slab_class[cls];
+	uint size = slab_size[cls];
+	char *page, *obj;
+
+	if (slab_next_page == SLAB_PAGES)
+		return -ENOSPC;
+	slab_page_class[slab_next_page] = cls + 1;
+	page = (char *)slab_base + slab_next_page++ * SLAB_PAGE_SIZE;
+	for (obj = page + SLAB_PAGE_SIZE - size; obj >= page; obj -= size) {
+		*(void **)obj = sc->free;
+		sc->free = obj;
+	}
+	sc->pages++;
+
+	return 0;
+}
+
+void *malloc_slab_alloc(size_t bytes)
+{
+	struct slab_class *sc;
+	void *ptr;
+	uint cls;
+
+	if (bytes > SLAB_MAX_SIZE || !slab_base)
+		return NULL;
+	for (cls = 0; slab_size[cls] < bytes; cls++)
+		;
+	sc = &slab_class[cls];
+	if (!sc->free && slab_add_page(cls))
+		return NULL;
+
+	ptr = sc->free;
+	sc->free = *(void **)ptr;
+	sc->used++;
+	sc->peak = max(sc->peak, sc->used);
+	VALGRIND_MALLOCLIKE_BLOCK(ptr, bytes, 0, false);
+
+	return ptr;
+}
+
+bool malloc_slab_owns(const void *ptr)
+{
+	return (ulong)ptr >= slab_base && (ulong)ptr < slab_end;
+}
+
+static struct slab_class *slab_class_of(const void *ptr, uint *sizep)
+{
+	uint cls = slab_page_class[((ulong)ptr - slab_base) / SLAB_PAGE_SIZE];
+
+	assert(cls);
+	*sizep = slab_size[cls - 1];
+
+	return &slab_class[cls - 1];
+}
+
+void malloc_slab_free(void *ptr)
+{
+	struct slab_class *sc;
+	uint size;
+
+	sc = slab_class_of(ptr, &size);
+	assert(!(((ulong)ptr - slab_base) % size));
+	*(void **)ptr = sc->free;
+	sc->free = ptr;
+	sc->used--;
+	VALGRIND_FREELIKE_BLOCK(ptr, 0);
+}
+
+size_t malloc_slab_usable_size(const void *ptr)
+{
+	uint size;
+
+	slab_class_of(ptr, &size);
+
+	return size;
+}
+
+ulong malloc_slab_in_use(void)
+{
+	ulong total = 0;
+	uint cls;
+
+	for (cls = 0; cls < SLAB_CLASSES; cls++)
+		total += (ulong)slab_class[cls].used * slab_size[cls];
+
+	return total;
+}
+
+int malloc_slab_get_info(uint seq, struct malloc_slab_info *info)
+{
+	const struct slab_class *sc;
+
+	if (seq >= SLAB_CLASSES)
+		return -ENOENT;
+	sc = &slab_class[seq];
+	info->size = slab_size[seq];
+	info->pages = sc->pages;
+	info->used = sc->used;
+	info->peak = sc->peak;
+	info->free = sc->pages * (SLAB_PAGE_SIZE / info->size) - sc->used;
+
+	return 0;
+}
@@ -219,12 +219,14 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 	const void *data;
 	const void *fit = ctx->fit;
 	bool external_data = false;
+	struct fit_hash_stream hs;
+	bool hash_load;
+	int ret;
 
 	log_debug("starting\n");
 	if (CONFIG_IS_ENABLED(BOOTMETH_VBE) &&
 	    xpl_get_phase(info) != IH_PHASE_NONE) {
 		enum image_phase_t phase;
-		int ret;
 
 		ret = fit_image_get_phase(fit, node, &phase);
 		/* if the image is for any phase, let's use it */
@@ -316,7 +318,10 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 		src = (void *)data;	/* cast away const */
 	}
 
-	if (CONFIG_IS_ENABLED(FIT_SIGNATURE)) {
+	/* Hash the data as it is copied or decompressed, if possible */
+	hash_load = CONFIG_IS_ENABLED(FIT_HASH_STREAM) &&
+		!fit_image_hash_stream_start(&hs, fit, node);
+	if (CONFIG_IS_ENABLED(FIT_SIGNATURE) && !hash_load) {
 		printf("## Checking hash(es) for Image %s ... ",
 		       fit_get_name(fit, node, NULL));
 		if (!fit_image_verify_with_data(fit, node, gd_fdt_blob(), src,
@@ -331,8 +336,15 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 	load_ptr = map_sysmem(load_addr, length);
 	if (IS_ENABLED(CONFIG_SPL_GZIP) && image_comp == IH_COMP_GZIP) {
 		size = length;
-		if (gunzip(load_ptr, CONFIG_SYS_BOOTM_LEN, src, &size)) {
+		if (hash_load)
+			ret = gunzip_tap(load_ptr, CONFIG_SYS_BOOTM_LEN, src,
+					 &size, fit_image_hash_stream_tap, &hs);
+		else
+			ret = gunzip(load_ptr, CONFIG_SYS_BOOTM_LEN, src, &size);
+		if (ret) {
 			puts("Uncompressing error\n");
+			if (hash_load)
+				fit_image_hash_stream_abort(&hs);
 			return -EIO;
 		}
 		length = size;
@@ -340,16 +352,40 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 		size = CONFIG_SYS_BOOTM_LEN;
 		ulong loadEnd;
 
-		if (image_decomp(IH_COMP_LZMA, CONFIG_SYS_LOAD_ADDR, 0, 0,
-				 load_ptr, src, length, size, &loadEnd)) {
+		if (hash_load)
+			ret = image_decomp_tap(IH_COMP_LZMA,
+					       CONFIG_SYS_LOAD_ADDR, 0, 0,
+					       load_ptr, src, length, size,
+					       &loadEnd,
+					       fit_image_hash_stream_tap, &hs);
+		else
+			ret = image_decomp(IH_COMP_LZMA, CONFIG_SYS_LOAD_ADDR,
+					   0, 0, load_ptr, src, length, size,
+					   &loadEnd);
+		if (ret) {
 			puts("Uncompressing error\n");
+			if (hash_load)
+				fit_image_hash_stream_abort(&hs);
 			return -EIO;
 		}
 		length = loadEnd - CONFIG_SYS_LOAD_ADDR;
+	} else if (hash_load) {
+		ret = image_move_tap(load_ptr, src, length,
+				     fit_image_hash_stream_tap, &hs);
+		if (ret)
+			fit_image_hash_stream_abort(&hs);
 	} else {
 		memcpy(load_ptr, src, length);
 	}
 
+	if (hash_load) {
+		printf("## Checking hash(es) for Image %s ... ",
+		       fit_get_name(fit, node, NULL));
+		if (ret || fit_image_hash_stream_finish(&hs))
+			return -EPERM;
+		puts("OK\n");
+	}
+
 	if (image_info) {
 		ulong entry_point;
 
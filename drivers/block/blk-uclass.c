@@ -8,16 +8,34 @@
 
 #include <blk.h>
 #include <dm.h>
+#include <fs.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
+#include <uthread.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
 #include <linux/err.h>
+#include <u-boot/schedule.h>
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
 
+/**
+ * struct blk_uc_priv - uclass-private data for each block device
+ *
+ * @lock: Serialises calls into the driver, since reads submitted with
+ *	blk_submit_read() may run in a uthread which yields part-way through
+ * @write_seq: Changed on each write or erase, see blk_get_write_seq()
+ */
+struct blk_uc_priv {
+	struct uthread_mutex lock;
+	ulong write_seq;
+};
+
+/* Source of write sequence numbers, never reused while U-Boot runs */
+static ulong blk_write_seq_next;
+
 static struct {
 	enum uclass_id id;
 	const char *name;
@@ -409,6 +427,37 @@ int blk_get_device(int uclass_id, int devnum, struct udevice **devp)
 	return device_probe(*devp);
 }
 
+static void blk_lock(struct udevice *dev)
+{
+	struct blk_uc_priv *priv = dev_get_uclass_priv(dev);
+
+	if (priv)
+		uthread_mutex_lock(&priv->lock);
+}
+
+static void blk_unlock(struct udevice *dev)
+{
+	struct blk_uc_priv *priv = dev_get_uclass_priv(dev);
+
+	if (priv)
+		uthread_mutex_unlock(&priv->lock);
+}
+
+static void blk_bump_write_seq(struct udevice *dev)
+{
+	struct blk_uc_priv *priv = dev_get_uclass_priv(dev);
+
+	if (priv)
+		priv->write_seq = ++blk_write_seq_next;
+}
+
+ulong blk_get_write_seq(struct udevice *dev)
+{
+	struct blk_uc_priv *priv = dev_get_uclass_priv(dev);
+
+	return priv ? priv->write_seq : 0;
+}
+
 struct blk_bounce_buffer {
 	struct udevice		*dev;
 	struct bounce_buffer	state;
@@ -429,19 +478,13 @@ static int blk_buffer_aligned(struct bounce_buffer *state)
 	return 1;	/* Default, any buffer is OK */
 }
 
-long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
+static long blk_read_dev(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+			 void *buf)
 {
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
 	const struct blk_ops *ops = blk_get_ops(dev);
 	ulong blks_read;
 
-	if (!ops->read)
-		return -ENOSYS;
-
-	if (blkcache_read(desc->uclass_id, desc->devnum,
-			  start, blkcnt, desc->blksz, buf))
-		return blkcnt;
-
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
 		int ret;
@@ -467,6 +510,131 @@ long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
 	return blks_read;
 }
 
+static long blk_read_cached(struct udevice *dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buf)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	lbaint_t ra_start, ra_cnt;
+	char *ra_buf;
+
+	if (blkcache_read(desc->uclass_id, desc->devnum,
+			  start, blkcnt, desc->blksz, buf))
+		return blkcnt;
+
+	/* widen the read so that whole lines and read-ahead get cached */
+	ra_buf = blkcache_readahead(desc->uclass_id, desc->devnum, start,
+				    blkcnt, desc->blksz, desc->lba, &ra_start,
+				    &ra_cnt);
+	if (ra_buf && blk_read_dev(dev, ra_start, ra_cnt, ra_buf) == ra_cnt) {
+		memcpy(buf, ra_buf + (start - ra_start) * desc->blksz,
+		       blkcnt * desc->blksz);
+		return blkcnt;
+	}
+
+	return blk_read_dev(dev, start, blkcnt, buf);
+}
+
+long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+	long blks_read;
+
+	if (!ops->read)
+		return -ENOSYS;
+
+	blk_lock(dev);
+	blks_read = blk_read_cached(dev, start, blkcnt, buf);
+	blk_unlock(dev);
+
+	return blks_read;
+}
+
+static void blk_req_thread(void *arg)
+{
+	struct blk_req *req = arg;
+
+	req->result = blk_read(req->dev, req->start, req->blkcnt, req->buffer);
+	req->done = true;
+}
+
+int blk_submit_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		    void *buffer, struct blk_req *req)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	int ret;
+
+	if (!ops->read)
+		return -ENOSYS;
+
+	memset(req, '\0', sizeof(*req));
+	req->dev = dev;
+	req->start = start;
+	req->blkcnt = blkcnt;
+	req->buffer = buffer;
+
+	if (blkcache_read(desc->uclass_id, desc->devnum,
+			  start, blkcnt, desc->blksz, buffer)) {
+		req->result = blkcnt;
+		req->done = true;
+		return 0;
+	}
+
+	if (ops->submit_read && ops->poll && !desc->bb) {
+		req->native = true;
+		blk_lock(dev);
+		while ((ret = ops->submit_read(dev, req)) == -EBUSY) {
+			/* queue full: reap completions and try again */
+			ret = ops->poll(dev);
+			if (ret)
+				break;
+		}
+		blk_unlock(dev);
+
+		return ret;
+	}
+
+	/* without uthreads this runs the read to completion */
+	if (uthread_create(NULL, blk_req_thread, req, 0, 0))
+		return -ENOMEM;
+
+	return 0;
+}
+
+int blk_req_poll(struct blk_req *req)
+{
+	int ret;
+
+	if (req->done)
+		return 0;
+
+	if (req->native) {
+		const struct blk_ops *ops = blk_get_ops(req->dev);
+
+		blk_lock(req->dev);
+		ret = ops->poll(req->dev);
+		blk_unlock(req->dev);
+		if (ret)
+			return ret;
+	} else {
+		uthread_schedule();
+	}
+
+	return req->done ? 0 : -EBUSY;
+}
+
+long blk_req_wait(struct blk_req *req)
+{
+	int ret;
+
+	while ((ret = blk_req_poll(req)) == -EBUSY)
+		schedule();
+	if (ret)
+		return ret;
+
+	return req->result;
+}
+
 long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 	       const void *buf)
 {
@@ -478,7 +646,9 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		return -ENOSYS;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blk_bump_write_seq(dev);
 
+	blk_lock(dev);
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
 		int ret;
@@ -487,8 +657,10 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 						   blkcnt * desc->blksz,
 						   GEN_BB_READ, desc->blksz,
 						   blk_buffer_aligned);
-		if (ret)
+		if (ret) {
+			blk_unlock(dev);
 			return ret;
+		}
 
 		blks_written = ops->write(dev, start, blkcnt,
 					  bbstate.state.bounce_buffer);
@@ -497,6 +669,7 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 	} else {
 		blks_written = ops->write(dev, start, blkcnt, buf);
 	}
+	blk_unlock(dev);
 
 	return blks_written;
 }
@@ -505,13 +678,19 @@ long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 {
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
 	const struct blk_ops *ops = blk_get_ops(dev);
+	long blks_erased;
 
 	if (!ops->erase)
 		return -ENOSYS;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blk_bump_write_seq(dev);
+
+	blk_lock(dev);
+	blks_erased = ops->erase(dev, start, blkcnt);
+	blk_unlock(dev);
 
-	return ops->erase(dev, start, blkcnt);
+	return blks_erased;
 }
 
 ulong blk_dread(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
@@ -852,6 +1031,9 @@ static int part_create_block_devices(struct udevice *blk_dev)
 
 static int blk_post_probe(struct udevice *dev)
 {
+	/* Whatever was cached about a previous device here is now stale */
+	blk_bump_write_seq(dev);
+
 	if (CONFIG_IS_ENABLED(PARTITIONS) && blk_enabled()) {
 		struct blk_desc *desc = dev_get_uclass_plat(dev);
 
@@ -865,9 +1047,22 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+
+	blkcache_remove(desc->uclass_id, desc->devnum);
+	if (!IS_ENABLED(CONFIG_XPL_BUILD))
+		fs_umount_blk(desc);
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
+	.per_device_auto	= sizeof(struct blk_uc_priv),
 	.per_device_plat_auto	= sizeof(struct blk_desc),
 };
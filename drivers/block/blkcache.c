@@ -3,142 +3,447 @@
  * Copyright (C) Nelson Integration, LLC 2016
  * Author: Eric Nelson<eric@nelint.com>
  *
+ * The cache is split into lines of a fixed, power-of-two number of blocks,
+ * aligned to that number of blocks on the device. Lines are held in a
+ * set-associative table: the set is chosen by hashing the interface type,
+ * device number and line address, and the least-recently-used way of the set
+ * is replaced on a miss. The total memory held by lines is bounded by a byte
+ * budget: the table is sized from the budget and the block size of the first
+ * device cached, and if devices with larger blocks use up the budget before
+ * the table is full, the least-recently-used lines anywhere in the cache are
+ * dropped to make room.
+ *
+ * On a miss, blk_read() asks blkcache_readahead() how much to read. Requests
+ * are widened to whole lines and, when a device is read sequentially, a
+ * read-ahead window is added which doubles on each sequential miss up to a
+ * configured limit.
  */
 #include <blk.h>
 #include <log.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <asm/global_data.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 
-struct block_cache_node {
-	struct list_head lh;
+/* Block size used by 'blkcache configure' to set the byte budget */
+#define BLKCACHE_NOMINAL_BLKSZ	512
+
+/**
+ * struct block_cache_line - one cached, line-aligned run of blocks
+ *
+ * @iftype:	uclass_id of the device
+ * @devnum:	device number within @iftype
+ * @blksz:	block size of the device, in bytes
+ * @tag:	first block of the line (aligned to the line size)
+ * @stamp:	value of the access clock at last use, for LRU replacement
+ * @cache:	cached data, or NULL if the line is not in use
+ */
+struct block_cache_line {
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
 	unsigned long blksz;
+	lbaint_t tag;
+	uint stamp;
 	char *cache;
 };
 
-static LIST_HEAD(block_cache);
+/**
+ * struct block_cache_dev - per-device cache state
+ *
+ * @lh:		node in the block_cache_devs list
+ * @stats:	counters for this device
+ * @next:	block following the last request, for stream detection
+ * @ra_end:	block following the last read-ahead window
+ * @ra_blocks:	current read-ahead window in blocks, 0 if not streaming
+ * @ra_buf:	buffer for reads widened by blkcache_readahead()
+ * @ra_buf_size: size of @ra_buf in bytes
+ *
+ * The read-ahead buffer is per device, since reads on different devices may
+ * be in progress at the same time in different uthreads.
+ */
+struct block_cache_dev {
+	struct list_head lh;
+	struct block_cache_dev_stats stats;
+	lbaint_t next;
+	lbaint_t ra_end;
+	lbaint_t ra_blocks;
+	char *ra_buf;
+	ulong ra_buf_size;
+};
+
+static struct block_cache_line *lines;
+static LIST_HEAD(block_cache_devs);
+static uint line_shift;
+static uint cache_clock;
+static ulong bytes_used;
+/* true if the number of lines was set by blkcache_configure() */
+static bool entries_fixed;
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_blocks_per_entry = CONFIG_BLOCK_CACHE_LINE_BLOCKS,
+	.max_entries = CONFIG_VAL(BLOCK_CACHE_SIZE) /
+		(CONFIG_BLOCK_CACHE_LINE_BLOCKS * BLKCACHE_NOMINAL_BLKSZ),
+	.ways = CONFIG_BLOCK_CACHE_WAYS,
+	.size = CONFIG_VAL(BLOCK_CACHE_SIZE),
+	.max_readahead = CONFIG_BLOCK_CACHE_READAHEAD,
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
-{
-	struct block_cache_node *node;
-
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
+/*
+ * cache_normalise() - round the geometry to something the table can use
+ *
+ * Lines must be a power of two blocks and the number of sets must be a power
+ * of two, so that both can be found with shifts and masks.
+ */
+static void cache_normalise(void)
+{
+	uint ways = CONFIG_BLOCK_CACHE_WAYS;
+	uint sets;
+
+	if (!_stats.max_blocks_per_entry) {
+		_stats.max_entries = 0;
+		return;
+	}
+	_stats.max_blocks_per_entry =
+		rounddown_pow_of_two(_stats.max_blocks_per_entry);
+	line_shift = ilog2(_stats.max_blocks_per_entry);
+
+	if (_stats.max_entries < ways)
+		ways = _stats.max_entries ? _stats.max_entries : 1;
+	sets = _stats.max_entries / ways;
+	if (sets)
+		sets = rounddown_pow_of_two(sets);
+	_stats.ways = ways;
+	_stats.max_entries = sets * ways;
+}
+
+static int cache_setup(unsigned long blksz)
+{
+	if (lines)
+		return 0;
+
+	/* there is no point having more lines than fit in the budget */
+	if (!entries_fixed && _stats.max_blocks_per_entry)
+		_stats.max_entries = _stats.size /
+			(rounddown_pow_of_two(_stats.max_blocks_per_entry) *
+			 blksz);
+	cache_normalise();
+	if (!_stats.max_entries)
+		return -ENOSPC;
+
+	lines = calloc(_stats.max_entries, sizeof(*lines));
+	if (!lines)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static struct block_cache_dev *cache_dev(int iftype, int devnum)
+{
+	struct block_cache_dev *cdev;
+
+	list_for_each_entry(cdev, &block_cache_devs, lh) {
+		if (cdev->stats.iftype == iftype &&
+		    cdev->stats.devnum == devnum) {
+			if (block_cache_devs.next != &cdev->lh) {
+				/* keep the busiest devices at the front */
+				list_del(&cdev->lh);
+				list_add(&cdev->lh, &block_cache_devs);
 			}
-			return node;
+			return cdev;
 		}
-	return 0;
+	}
+
+	cdev = calloc(1, sizeof(*cdev));
+	if (!cdev)
+		return NULL;
+	cdev->stats.iftype = iftype;
+	cdev->stats.devnum = devnum;
+	list_add(&cdev->lh, &block_cache_devs);
+
+	return cdev;
+}
+
+static struct block_cache_line *cache_set(int iftype, int devnum,
+					  lbaint_t tag)
+{
+	u64 key;
+	uint set;
+
+	key = ((u64)tag >> line_shift) ^ ((u64)iftype << 56) ^
+		((u64)devnum << 48);
+	set = (uint)((key * 0x9e3779b97f4a7c15ULL) >> 32);
+	set &= _stats.max_entries / _stats.ways - 1;
+
+	return &lines[set * _stats.ways];
+}
+
+static struct block_cache_line *cache_lookup(int iftype, int devnum,
+					     unsigned long blksz, lbaint_t tag)
+{
+	struct block_cache_line *line = cache_set(iftype, devnum, tag);
+	uint i;
+
+	for (i = 0; i < _stats.ways; i++, line++) {
+		if (line->cache && line->tag == tag &&
+		    line->devnum == devnum && line->iftype == iftype &&
+		    line->blksz == blksz)
+			return line;
+	}
+
+	return NULL;
+}
+
+static void cache_drop(struct block_cache_line *line)
+{
+	free(line->cache);
+	bytes_used -= line->blksz << line_shift;
+	line->cache = NULL;
+	_stats.entries--;
+}
+
+static void cache_evict(struct block_cache_line *line)
+{
+	struct block_cache_dev *owner;
+
+	debug("evict: start " LBAF "\n", line->tag);
+	owner = cache_dev(line->iftype, line->devnum);
+	if (owner)
+		owner->stats.evictions++;
+	_stats.evictions++;
+}
+
+/* Find the least-recently-used line in the whole cache, or NULL if empty */
+static struct block_cache_line *cache_lru(void)
+{
+	struct block_cache_line *line, *lru = NULL;
+	uint i;
+
+	for (i = 0, line = lines; i < _stats.max_entries; i++, line++) {
+		if (line->cache &&
+		    (!lru || (int)(line->stamp - lru->stamp) < 0))
+			lru = line;
+	}
+
+	return lru;
+}
+
+static void cache_insert(int iftype, int devnum, unsigned long blksz,
+			 lbaint_t tag, const char *src)
+{
+	ulong bytes = blksz << line_shift;
+	struct block_cache_line *line, *victim;
+	uint i;
+
+	line = cache_lookup(iftype, devnum, blksz, tag);
+	if (!line) {
+		/* pick an unused way, else the least-recently used one */
+		line = cache_set(iftype, devnum, tag);
+		for (victim = line, i = 0; i < _stats.ways; i++, line++) {
+			if (!line->cache) {
+				victim = line;
+				break;
+			}
+			if ((int)(line->stamp - victim->stamp) < 0)
+				victim = line;
+		}
+		line = victim;
+
+		if (line->cache) {
+			cache_evict(line);
+			if (line->blksz == blksz)
+				_stats.entries--;
+			else
+				cache_drop(line);
+		}
+
+		if (!line->cache) {
+			/* larger blocks may use up the budget first */
+			while (bytes_used + bytes > _stats.size) {
+				victim = cache_lru();
+				if (!victim)
+					return;
+				cache_evict(victim);
+				cache_drop(victim);
+			}
+			line->cache = malloc(bytes);
+			if (!line->cache)
+				return;
+			bytes_used += bytes;
+		}
+
+		line->iftype = iftype;
+		line->devnum = devnum;
+		line->blksz = blksz;
+		line->tag = tag;
+		_stats.entries++;
+	}
+
+	debug("fill: start " LBAF ", count %u\n", tag,
+	      _stats.max_blocks_per_entry);
+	memcpy(line->cache, src, bytes);
+	line->stamp = ++cache_clock;
 }
 
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	lbaint_t mask = _stats.max_blocks_per_entry - 1;
+	lbaint_t end = start + blkcnt;
+	struct block_cache_line *line;
+	struct block_cache_dev *cdev;
+	char *dst = buffer;
+	lbaint_t blk, tag;
+
+	if (!lines)
+		return 0;
+
+	cdev = cache_dev(iftype, devnum);
+	if (!cdev)
+		return 0;
+
+	/* all lines must be present, since a partial hit still needs I/O */
+	for (tag = start & ~mask; tag < end; tag += mask + 1) {
+		if (!cache_lookup(iftype, devnum, blksz, tag)) {
+			debug("miss: start " LBAF ", count " LBAFU "\n",
+			      start, blkcnt);
+			++cdev->stats.misses;
+			++_stats.misses;
+			return 0;
+		}
+	}
+
+	for (blk = start; blk < end; ) {
+		lbaint_t offset, count;
+
+		line = cache_lookup(iftype, devnum, blksz, blk & ~mask);
+		offset = blk - line->tag;
+		count = min(mask + 1 - offset, end - blk);
+		memcpy(dst, line->cache + offset * blksz, count * blksz);
+		line->stamp = ++cache_clock;
+		dst += count * blksz;
+		blk += count;
 	}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
+	debug("hit: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+	cdev->next = end;
+	++cdev->stats.hits;
+	++_stats.hits;
+
+	return 1;
 }
 
 void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	lbaint_t mask = _stats.max_blocks_per_entry - 1;
+	lbaint_t end = start + blkcnt;
+	const char *src = buffer;
+	lbaint_t tag;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
+	/* don't let a single large transfer flush the whole cache */
+	if (blkcnt * blksz > _stats.size / 2)
 		return;
 
-	if (_stats.max_entries == 0)
+	if (cache_setup(blksz))
 		return;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
+	/* only whole lines are cached */
+	for (tag = (start + mask) & ~mask; tag + mask < end; tag += mask + 1)
+		cache_insert(iftype, devnum, blksz, tag,
+			     src + (tag - start) * blksz);
+}
+
+void *blkcache_readahead(int iftype, int devnum,
+			 lbaint_t start, lbaint_t blkcnt,
+			 unsigned long blksz, lbaint_t lba,
+			 lbaint_t *ra_startp, lbaint_t *ra_cntp)
+{
+	lbaint_t mask = _stats.max_blocks_per_entry - 1;
+	struct block_cache_dev *cdev;
+	lbaint_t ra_start, ra_end;
+	ulong bytes;
+
+	if (cache_setup(blksz))
+		return NULL;
+
+	cdev = cache_dev(iftype, devnum);
+	if (!cdev)
+		return NULL;
+
+	if (start == cdev->next || start == cdev->ra_end) {
+		/* sequential stream: grow the window on each miss */
+		if (!cdev->ra_blocks)
+			cdev->ra_blocks = min_t(lbaint_t, mask + 1,
+						_stats.max_readahead);
+		else
+			cdev->ra_blocks = min_t(lbaint_t, cdev->ra_blocks * 2,
+						_stats.max_readahead);
 	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
+		cdev->ra_blocks = 0;
 	}
+	cdev->next = start + blkcnt;
+
+	ra_start = start & ~mask;
+	ra_end = (start + blkcnt + cdev->ra_blocks + mask) & ~mask;
+	if (lba && ra_end > lba)
+		ra_end = lba;
+	if (ra_end < start + blkcnt ||
+	    (ra_start == start && ra_end == start + blkcnt))
+		return NULL;
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
+	bytes = (ra_end - ra_start) * blksz;
+	if (bytes > _stats.size / 2)
+		return NULL;
+
+	if (bytes > cdev->ra_buf_size) {
+		free(cdev->ra_buf);
+		cdev->ra_buf = malloc_cache_aligned(bytes);
+		if (!cdev->ra_buf) {
+			cdev->ra_buf_size = 0;
+			return NULL;
 		}
+		cdev->ra_buf_size = bytes;
 	}
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+	cdev->ra_end = ra_end;
+	cdev->stats.readahead += ra_end - (start + blkcnt);
+	*ra_startp = ra_start;
+	*ra_cntp = ra_end - ra_start;
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	return cdev->ra_buf;
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
-
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if (iftype == -1 ||
-		    (node->iftype == iftype && node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
+	struct block_cache_dev *cdev;
+	uint i;
+
+	if (lines) {
+		for (i = 0; i < _stats.max_entries; i++) {
+			struct block_cache_line *line = &lines[i];
+
+			if (line->cache && (iftype == -1 ||
+			    (line->iftype == iftype &&
+			     line->devnum == devnum)))
+				cache_drop(line);
+		}
+	}
+
+	list_for_each_entry(cdev, &block_cache_devs, lh) {
+		if (iftype == -1 || (cdev->stats.iftype == iftype &&
+				     cdev->stats.devnum == devnum)) {
+			cdev->next = 0;
+			cdev->ra_end = 0;
+			cdev->ra_blocks = 0;
+			free(cdev->ra_buf);
+			cdev->ra_buf = NULL;
+			cdev->ra_buf_size = 0;
 		}
 	}
 }
@@ -147,14 +452,21 @@ void blkcache_configure(unsigned blocks, unsigned entries)
 {
 	/* invalidate cache if there is a change */
 	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries))
+	    (entries != _stats.max_entries)) {
 		blkcache_invalidate(-1, 0);
+		free(lines);
+		lines = NULL;
+	}
 
 	_stats.max_blocks_per_entry = blocks;
 	_stats.max_entries = entries;
+	entries_fixed = true;
+	_stats.size = (ulong)blocks * entries * BLKCACHE_NOMINAL_BLKSZ;
+	cache_normalise();
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -162,9 +474,57 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
+}
+
+int blkcache_dev_stats(int seq, struct block_cache_dev_stats *stats)
+{
+	struct block_cache_dev *cdev;
+
+	list_for_each_entry(cdev, &block_cache_devs, lh) {
+		if (seq--)
+			continue;
+		memcpy(stats, &cdev->stats, sizeof(*stats));
+		cdev->stats.hits = 0;
+		cdev->stats.misses = 0;
+		cdev->stats.evictions = 0;
+		cdev->stats.readahead = 0;
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+void blkcache_remove(int iftype, int devnum)
+{
+	struct block_cache_dev *cdev, *n;
+
+	blkcache_invalidate(iftype, devnum);
+	list_for_each_entry_safe(cdev, n, &block_cache_devs, lh) {
+		if (cdev->stats.iftype == iftype &&
+		    cdev->stats.devnum == devnum) {
+			list_del(&cdev->lh);
+			free(cdev);
+		}
+	}
+
+	/* Release the table once no device has anything cached */
+	if (!_stats.entries) {
+		free(lines);
+		lines = NULL;
+	}
 }
 
 void blkcache_free(void)
 {
+	struct block_cache_dev *cdev, *n;
+
 	blkcache_invalidate(-1, 0);
+	free(lines);
+	lines = NULL;
+	list_for_each_entry_safe(cdev, n, &block_cache_devs, lh) {
+		list_del(&cdev->lh);
+		free(cdev->ra_buf);
+		free(cdev);
+	}
 }
@@ -11,6 +11,8 @@
 #include <debug_uart.h>
 #include <errno.h>
 #include <log.h>
+#include <malloc.h>
+#include <asm/global_data.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -20,6 +22,8 @@
 #include <fdtdec.h>
 #include <linux/compiler.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 struct driver *lists_driver_lookup_name(const char *name)
 {
 	struct driver *drv =
@@ -196,11 +200,186 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   struct driver *drv, bool pre_reloc_only)
+/* Value of dm_compat_ent.drv where several strings have the same tag */
+#define DM_COMPAT_MULTI		0xffff
+
+/**
+ * struct dm_compat_ent - Slot in the compatible-string index
+ *
+ * @tag: Upper 16 bits of the hash of the compatible string, or 0 if the slot
+ *	is empty
+ * @drv: Index of the driver in the driver linker list, or DM_COMPAT_MULTI
+ */
+struct dm_compat_ent {
+	u16 tag;
+	u16 drv;
+};
+
+/**
+ * struct dm_compat_idx - Index of compatible strings to drivers
+ *
+ * This is an open-addressed hash table with linear probing. Strings are not
+ * stored, so a driver found here must still be checked against the string
+ * being looked up. Where more than one driver has the same compatible string,
+ * only the first in the linker list is recorded, since that is the one that a
+ * linear search finds.
+ *
+ * @size: Number of slots
+ * @ent: Slots
+ */
+struct dm_compat_idx {
+	uint size;
+	struct dm_compat_ent ent[];
+};
+
+/* FNV-1a */
+static u32 compat_hash(const char *str)
+{
+	u32 hash = 0x811c9dc5;
+
+	while (*str)
+		hash = (hash ^ (u8)*str++) * 0x01000193;
+
+	return hash;
+}
+
+/* The tag of a hash, with 0 reserved to mark an empty slot */
+static u16 compat_tag(u32 hash)
+{
+	return hash >> 16 ?: 1;
+}
+
+/**
+ * compat_find() - Find the slot for a hash
+ *
+ * @idx: Index to search
+ * @hash: Hash of the compatible string
+ * Return: slot with the hash's tag, or the empty slot where it would go
+ */
+static struct dm_compat_ent *compat_find(struct dm_compat_idx *idx, u32 hash)
+{
+	u16 tag = compat_tag(hash);
+	uint slot;
+
+	for (slot = hash % idx->size; idx->ent[slot].tag;
+	     slot = (slot + 1) % idx->size) {
+		if (idx->ent[slot].tag == tag)
+			break;
+	}
+
+	return &idx->ent[slot];
+}
+
+int lists_compat_index_init(void)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_id;
+	struct dm_compat_idx *idx;
+	uint count, size, bytes, i;
+
+	if (gd_dm_compat_idx())
+		return 0;
+	if (n_ents >= DM_COMPAT_MULTI)
+		return -E2BIG;
+
+	count = 0;
+	for (i = 0; i < n_ents; i++) {
+		const struct udevice_id *of_match = driver[i].of_match;
+
+		while (of_match && of_match++->compatible)
+			count++;
+	}
+	if (!count)
+		return -ENOENT;
+
+	/* Keep the table no more than 3/4 full */
+	size = count + count / 3 + 1;
+	bytes = sizeof(*idx) + size * sizeof(struct dm_compat_ent);
+
+	/*
+	 * Before relocation the table comes from the small malloc_f area,
+	 * which devices need as well. Only use a quarter of what is left,
+	 * falling back to the linear search otherwise.
+	 */
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_F) &&
+	    !(gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+	    bytes > (gd->malloc_limit - gd->malloc_ptr) / 4) {
+		log_debug("No room for compatible index (%u bytes)\n", bytes);
+		return -ENOSPC;
+	}
+
+	idx = calloc(1, bytes);
+	if (!idx) {
+		log_debug("No memory for compatible index (%u slots)\n", size);
+		return -ENOMEM;
+	}
+	idx->size = size;
+
+	for (i = 0; i < n_ents; i++) {
+		const struct udevice_id *of_match = driver[i].of_match;
+
+		for (; of_match && of_match->compatible; of_match++) {
+			const char *compat = of_match->compatible;
+			u32 hash = compat_hash(compat);
+			struct dm_compat_ent *ent = compat_find(idx, hash);
+
+			/*
+			 * The first driver in the list takes precedence. If a
+			 * different string has the same tag, lookups in this
+			 * slot must use the linear search.
+			 */
+			if (!ent->tag) {
+				ent->tag = compat_tag(hash);
+				ent->drv = i;
+			} else if (ent->drv != DM_COMPAT_MULTI &&
+				   driver_check_compatible(driver[ent->drv].of_match,
+							   &of_id, compat)) {
+				ent->drv = DM_COMPAT_MULTI;
+			}
+		}
+	}
+	log_debug("Compatible index: %u strings, %u slots\n", count, size);
+	gd_set_dm_compat_idx(idx);
+
+	return 0;
+}
+
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct dm_compat_idx *idx = gd_dm_compat_idx();
+	struct driver *entry;
+
+	if (idx) {
+		struct dm_compat_ent *ent = compat_find(idx,
+							compat_hash(compat));
+
+		/* Every driver's strings are in the index */
+		if (!ent->tag)
+			return NULL;
+		if (ent->drv != DM_COMPAT_MULTI) {
+			entry = &driver[ent->drv];
+			if (driver_check_compatible(entry->of_match, idp,
+						    compat))
+				return NULL;
+			return entry;
+		}
+	}
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   struct driver *drv, bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -238,20 +417,17 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 			  compat);
 
 		id = NULL;
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			if (drv) {
-				if (drv != entry)
-					continue;
-				if (!entry->of_match)
-					break;
-			}
+		if (drv) {
+			entry = drv;
 			ret = driver_check_compatible(entry->of_match, &id,
 						      compat);
-			if (!ret)
-				break;
+			if (ret && entry->of_match)
+				continue;
+		} else {
+			entry = lists_driver_lookup_compat(compat, &id);
+			if (!entry)
+				continue;
 		}
-		if (entry == driver + n_ents)
-			continue;
 
 		if (pre_reloc_only) {
 			if (!ofnode_pre_reloc(node) &&
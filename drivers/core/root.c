@@ -12,6 +12,7 @@
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
+#include <uthread.h>
 #include <asm-generic/sections.h>
 #include <asm/global_data.h>
 #include <linux/libfdt.h>
@@ -106,6 +107,13 @@ int dm_init(bool of_live)
 		INIT_LIST_HEAD(DM_UCLASS_ROOT_NON_CONST);
 	}
 
+	if (CONFIG_IS_ENABLED(DM_COMPAT_INDEX)) {
+		/* Without the index, binding falls back to a linear search */
+		ret = lists_compat_index_init();
+		if (ret)
+			log_debug("Cannot build compatible index: %d\n", ret);
+	}
+
 	if (CONFIG_IS_ENABLED(OF_PLATDATA_INST)) {
 		ret = dm_setup_inst();
 		if (ret) {
@@ -150,6 +158,10 @@ int dm_remove_devices_flags(uint flags)
 
 void dm_remove_devices_active(void)
 {
+	/* Let background threads finish with the devices they are using */
+	while (uthread_schedule())
+		;
+
 	/* Remove non-vital devices first */
 	device_remove(dm_root(), DM_REMOVE_ACTIVE_ALL | DM_REMOVE_NON_VITAL);
 	device_remove(dm_root(), DM_REMOVE_ACTIVE_ALL);
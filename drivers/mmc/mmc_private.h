@@ -132,4 +132,30 @@ int mmc_switch_part(struct mmc *mmc, unsigned int part_num);
  */
 int mmc_switch(struct mmc *mmc, u8 set, u8 index, u8 value);
 
+/**
+ * mmc_set_block_count() - Set the number of blocks in the next transfer
+ *
+ * This sends CMD23, after which the next multi-block read or write ends by
+ * itself once @blkcnt blocks are transferred, without a CMD12.
+ *
+ * @mmc:	MMC device
+ * @blkcnt:	Number of blocks, at most 65535
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_set_block_count(struct mmc *mmc, lbaint_t blkcnt);
+
+/**
+ * mmc_use_cmd23() - Check whether to set up a transfer with CMD23
+ *
+ * @mmc:	MMC device
+ * @blkcnt:	Number of blocks to transfer
+ * Return: true if both card and host support CMD23 and the transfer is a
+ *	multi-block one which CMD23 can describe
+ */
+static inline bool mmc_use_cmd23(struct mmc *mmc, lbaint_t blkcnt)
+{
+	return blkcnt > 1 && blkcnt <= 0xffff && !mmc_host_is_spi(mmc) &&
+	       (mmc->card_caps & mmc->host_caps & MMC_CAP_CMD23);
+}
+
 #endif /* _MMC_PRIVATE_H_ */
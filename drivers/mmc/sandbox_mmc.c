@@ -30,6 +30,8 @@ struct sandbox_mmc_priv {
 	char *buf;
 	int csize;	/* CSIZE value to report */
 	int size;
+	uint blkcnt;	/* Block count set by CMD23, 0 if none */
+	bool stopped;	/* Last multi-block transfer ended by itself */
 };
 
 /**
@@ -77,17 +79,30 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 			resp[4] = (cmd->cmdarg & 0xF) << 24;
 		break;
 	}
+	case MMC_CMD_SET_BLOCK_COUNT:
+		priv->blkcnt = cmd->cmdarg & 0xffff;
+		break;
 	case MMC_CMD_READ_SINGLE_BLOCK:
 	case MMC_CMD_READ_MULTIPLE_BLOCK:
-		memcpy(data->dest, &priv->buf[cmd->cmdarg * data->blocksize],
-		       data->blocks * data->blocksize);
-		break;
 	case MMC_CMD_WRITE_SINGLE_BLOCK:
 	case MMC_CMD_WRITE_MULTIPLE_BLOCK:
-		memcpy(&priv->buf[cmd->cmdarg * data->blocksize], data->src,
-		       data->blocks * data->blocksize);
+		/* A transfer set up with CMD23 must be of that many blocks */
+		if (priv->blkcnt && priv->blkcnt != data->blocks)
+			return -EIO;
+		priv->stopped = priv->blkcnt;
+		priv->blkcnt = 0;
+		if (data->flags == MMC_DATA_READ)
+			memcpy(data->dest,
+			       &priv->buf[cmd->cmdarg * data->blocksize],
+			       data->blocks * data->blocksize);
+		else
+			memcpy(&priv->buf[cmd->cmdarg * data->blocksize],
+			       data->src, data->blocks * data->blocksize);
 		break;
 	case MMC_CMD_STOP_TRANSMISSION:
+		/* The card is back in transfer state, so CMD12 is illegal */
+		if (priv->stopped)
+			return -EILSEQ;
 		break;
 	case SD_CMD_ERASE_WR_BLK_START:
 		erase_start = cmd->cmdarg;
@@ -117,7 +132,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case SD_CMD_APP_SEND_SCR: {
 		u32 *scr = (u32 *)data->dest;
 
-		scr[0] = cpu_to_be32(2 << 24 | 1 << 15);  /* SD version 3 */
+		/* SD version 3, with CMD23 */
+		scr[0] = cpu_to_be32(2 << 24 | 1 << 15 | SD_SCR_CMD23);
 		break;
 	}
 	default:
@@ -212,7 +228,8 @@ static int sandbox_mmc_bind(struct udevice *dev)
 	struct mmc_config *cfg = &plat->cfg;
 
 	cfg->name = dev->name;
-	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT;
+	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT |
+			 MMC_CAP_CMD23;
 	cfg->voltages = MMC_VDD_165_195 | MMC_VDD_32_33 | MMC_VDD_33_34;
 	cfg->f_min = 1000000;
 	cfg->f_max = 52000000;
@@ -978,6 +978,8 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 		cfg->host_caps |= MMC_MODE_HS | MMC_MODE_HS_52MHz;
 
 	cfg->host_caps |= MMC_MODE_4BIT;
+	if (!(host->quirks & SDHCI_QUIRK_BROKEN_CMD23))
+		cfg->host_caps |= MMC_CAP_CMD23;
 
 	/* Since Host Controller Version3.0 */
 	if (SDHCI_GET_VERSION(host) >= SDHCI_SPEC_300) {
@@ -377,6 +377,29 @@ void sandbox_eth_set_tx_handler(int index, sandbox_eth_tx_hand_f *handler)
 		priv->tx_handler = sb_default_handler;
 }
 
+/*
+ * sandbox_eth_set_rx_handler()
+ *
+ * Set a function to queue more packets when the sandbox eth test driver has
+ *	none left to return as received
+ *
+ * index - interface to set the handler for
+ * handler - The func ptr to call when no packets are queued, or NULL for none
+ */
+void sandbox_eth_set_rx_handler(int index, sandbox_eth_rx_hand_f *handler)
+{
+	struct udevice *dev;
+	struct eth_sandbox_priv *priv;
+	int ret;
+
+	ret = uclass_get_device(UCLASS_ETH, index, &dev);
+	if (ret)
+		return;
+
+	priv = dev_get_priv(dev);
+	priv->rx_handler = handler;
+}
+
 /*
  * Set priv ptr
  *
@@ -397,6 +420,60 @@ void sandbox_eth_set_priv(int index, void *priv)
 	dev_priv->priv = priv;
 }
 
+/*
+ * sandbox_eth_set_rx_hold()
+ *
+ * Let the network stack hold received packets. While it may, each packet
+ * returned by recv() is taken off the receive queue and its buffer replaced
+ * with a spare one, so the packet stays valid until it is passed to
+ * free_pkt(), which puts the buffer back with the spares.
+ *
+ * index - interface to set it for
+ * count - number of packets which may be held, or 0
+ */
+int sandbox_eth_set_rx_hold(int index, int count)
+{
+	struct eth_sandbox_priv *priv;
+	struct eth_pdata *pdata;
+	struct udevice *dev;
+	int i, ret;
+
+	if (count < 0 || count > SANDBOX_ETH_RX_HOLD_MAX)
+		return -EINVAL;
+
+	ret = uclass_get_device(UCLASS_ETH, index, &dev);
+	if (ret)
+		return ret;
+
+	priv = dev_get_priv(dev);
+	pdata = dev_get_plat(dev);
+	if (priv->rx_held_count)
+		return -EBUSY;
+
+	pdata->rx_hold = 0;
+	priv->rx_spares = 0;
+	free(priv->rx_hold_bufs);
+	priv->rx_hold_bufs = NULL;
+	priv->recv_packets = 0;
+	for (i = 0; i < PKTBUFSRX; i++) {
+		priv->recv_packet_buffer[i] = net_rx_packets[i];
+		priv->recv_packet_length[i] = 0;
+	}
+	if (!count)
+		return 0;
+
+	/* one more than may be held, for the packet being processed */
+	priv->rx_hold_bufs = malloc((count + 1) * PKTSIZE_ALIGN);
+	if (!priv->rx_hold_bufs)
+		return -ENOMEM;
+	for (i = 0; i <= count; i++)
+		priv->rx_spare[i] = priv->rx_hold_bufs + i * PKTSIZE_ALIGN;
+	priv->rx_spares = count + 1;
+	pdata->rx_hold = count;
+
+	return 0;
+}
+
 static int sb_eth_start(struct udevice *dev)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -405,7 +482,9 @@ static int sb_eth_start(struct udevice *dev)
 
 	priv->recv_packets = 0;
 	for (int i = 0; i < PKTBUFSRX; i++) {
-		priv->recv_packet_buffer[i] = net_rx_packets[i];
+		/* held packets may still be using some of the buffers */
+		if (!priv->rx_hold_bufs)
+			priv->recv_packet_buffer[i] = net_rx_packets[i];
 		priv->recv_packet_length[i] = 0;
 	}
 
@@ -424,6 +503,39 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 	return priv->tx_handler(dev, packet, length);
 }
 
+/*
+ * Take the first packet off the receive queue, putting a spare buffer in its
+ * place, so that it stays valid until it is passed to free_pkt()
+ */
+static int sb_eth_recv_hold(struct eth_sandbox_priv *priv, uchar **packetp)
+{
+	int len, i;
+
+	/* with no spare buffer left, the receive ring would be empty */
+	if (!priv->recv_packets || !priv->rx_spares)
+		return -EAGAIN;
+
+	for (i = 0; priv->rx_held[i]; i++)
+		;
+	priv->rx_held[i] = priv->recv_packet_buffer[0];
+	priv->rx_held_count++;
+	*packetp = priv->recv_packet_buffer[0];
+	len = priv->recv_packet_length[0];
+
+	--priv->recv_packets;
+	for (i = 0; i < priv->recv_packets; i++) {
+		priv->recv_packet_buffer[i] = priv->recv_packet_buffer[i + 1];
+		priv->recv_packet_length[i] = priv->recv_packet_length[i + 1];
+	}
+	priv->recv_packet_buffer[i] = priv->rx_spare[--priv->rx_spares];
+	priv->recv_packet_length[i] = 0;
+
+	debug("eth_sandbox: received packet[%d], %d waiting, %d held\n", len,
+	      priv->recv_packets, priv->rx_held_count);
+
+	return len;
+}
+
 static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -433,6 +545,12 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		skip_timeout = false;
 	}
 
+	if (!priv->recv_packets && priv->rx_handler)
+		priv->rx_handler(dev);
+
+	if (priv->rx_hold_bufs)
+		return sb_eth_recv_hold(priv, packetp);
+
 	if (priv->recv_packets) {
 		int lcl_recv_packet_length = priv->recv_packet_length[0];
 
@@ -449,6 +567,18 @@ static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
 	int i;
 
+	if (priv->rx_hold_bufs) {
+		for (i = 0; i <= SANDBOX_ETH_RX_HOLD_MAX; i++) {
+			if (priv->rx_held[i] == packet) {
+				priv->rx_held[i] = NULL;
+				priv->rx_held_count--;
+				priv->rx_spare[priv->rx_spares++] = packet;
+				return 0;
+			}
+		}
+		return -EINVAL;
+	}
+
 	if (!priv->recv_packets)
 		return 0;
 
@@ -491,6 +621,12 @@ static const struct eth_ops sb_eth_ops = {
 
 static int sb_eth_remove(struct udevice *dev)
 {
+	struct eth_pdata *pdata = dev_get_plat(dev);
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	free(priv->rx_hold_bufs);
+	pdata->rx_hold = 0;
+
 	return 0;
 }
 
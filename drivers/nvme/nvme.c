@@ -17,7 +17,7 @@
 #include <linux/compat.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		CONFIG_NVME_QUEUE_DEPTH
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
@@ -25,7 +25,31 @@
 				      ARCH_DMA_MINALIGN)
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
+/* Upper limit on the data transferred by one I/O command */
+#define NVME_MAX_XFER_SHIFT	20
+
+/**
+ * struct nvme_rw - a block transfer split into one or more I/O commands
+ *
+ * @req:	Block request being transferred
+ * @ns:		Namespace to transfer to or from
+ * @write:	true for a write, false for a read
+ * @alloced:	true if this structure must be freed when the transfer ends
+ * @queued:	Number of blocks for which commands have been queued
+ * @inflight:	Number of commands queued and not yet complete
+ * @error:	First error reported by a command, 0 if none
+ * @list:	Node in nvme_dev->pending while blocks remain to be queued
+ */
+struct nvme_rw {
+	struct blk_req *req;
+	struct nvme_ns *ns;
+	bool write;
+	bool alloced;
+	lbaint_t queued;
+	uint inflight;
+	int error;
+	struct list_head list;
+};
 
 static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 {
@@ -44,16 +68,13 @@ static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
+static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp_list, u64 *prp2,
 			   int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
-	u64 *prp_pool;
 	int length = total_len;
 	int i, nprps;
-	u32 prps_per_page = page_size >> 3;
-	u32 num_pages;
 
 	length -= (page_size - offset);
 
@@ -70,40 +91,19 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 		return 0;
 	}
 
+	/* transfers are split so that the PRP list fits in one page */
 	nprps = DIV_ROUND_UP(length, page_size);
-	num_pages = DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
-
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		/*
-		 * Always increase in increments of pages.  It doesn't waste
-		 * much memory and reduces the number of allocations.
-		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = num_pages * (prps_per_page - 1) + 1;
-	}
+	if (nprps > page_size >> 3)
+		return -EINVAL;
 
-	prp_pool = dev->prp_pool;
-	i = 0;
-	while (nprps) {
-		if ((i == (prps_per_page - 1)) && nprps > 1) {
-			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
-					page_size);
-			i = 0;
-			prp_pool += page_size;
-		}
-		*(prp_pool + i++) = cpu_to_le64(dma_addr);
+	for (i = 0; i < nprps; i++) {
+		prp_list[i] = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
-		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)prp_list;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
-			   num_pages * page_size);
+	flush_dcache_range((ulong)prp_list, (ulong)prp_list +
+			   ALIGN(nprps * sizeof(u64), ARCH_DMA_MINALIGN));
 
 	return 0;
 }
@@ -667,6 +667,35 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 	return 0;
 }
 
+static int nvme_alloc_slots(struct nvme_dev *dev)
+{
+	struct nvme_ops *ops = (struct nvme_ops *)dev->udev->driver->ops;
+	int i;
+
+	INIT_LIST_HEAD(&dev->pending);
+
+	/* a queue of depth n holds at most n - 1 commands */
+	dev->nr_slots = dev->queues[NVME_IO_Q]->q_depth - 1;
+	if (ops && ops->submit_cmd)
+		dev->nr_slots = 1;
+	dev->nr_inflight = 0;
+
+	dev->slots = calloc(dev->nr_slots, sizeof(*dev->slots));
+	dev->prp_pool = memalign(dev->page_size,
+				 dev->nr_slots * dev->page_size);
+	if (!dev->slots || !dev->prp_pool) {
+		free(dev->slots);
+		free(dev->prp_pool);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < dev->nr_slots; i++)
+		dev->slots[i].prp_list = (void *)dev->prp_pool +
+			i * dev->page_size;
+
+	return 0;
+}
+
 int nvme_get_namespace_id(struct udevice *udev, u32 *ns_id, u8 *eui64)
 {
 	struct nvme_ns *ns = dev_get_priv(udev);
@@ -741,65 +770,266 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
-static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
-			 lbaint_t blkcnt, void *buffer, bool read)
+/* Number of blocks moved by a single I/O command of a namespace */
+static u32 nvme_xfer_blocks(struct nvme_ns *ns)
 {
-	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
-	struct nvme_command c;
-	struct blk_desc *desc = dev_get_uclass_plat(udev);
-	int status;
-	u64 prp2;
-	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
-	uintptr_t temp_buffer = (uintptr_t)buffer;
-
-	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
-
-	flush_dcache_range((unsigned long)buffer,
-			   (unsigned long)buffer + total_len);
-
-	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
-	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
-			total_lbas -= lbas;
+	u32 shift = min_t(u32, dev->max_transfer_shift, NVME_MAX_XFER_SHIFT);
+
+	/* the NLB field of the command is 16 bits, zero-based */
+	return min_t(u32, 1 << (shift - ns->lba_shift), 0x10000);
+}
+
+static int nvme_find_slot(struct nvme_dev *dev)
+{
+	int i;
+
+	for (i = 0; i < dev->nr_slots; i++) {
+		if (!dev->slots[i].busy)
+			return i;
+	}
+
+	return -EBUSY;
+}
+
+/**
+ * nvme_rw_queue() - queue as many commands of a transfer as will fit
+ *
+ * All commands are written to the submission queue before the doorbell is
+ * rung once for the whole batch.
+ *
+ * @dev:	NVMe device
+ * @rw:		Transfer to queue commands for
+ */
+static void nvme_rw_queue(struct nvme_dev *dev, struct nvme_rw *rw)
+{
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	struct nvme_ops *ops = (struct nvme_ops *)dev->udev->driver->ops;
+	struct blk_req *req = rw->req;
+	struct nvme_ns *ns = rw->ns;
+	u32 xfer = nvme_xfer_blocks(ns);
+	u16 tail = nvmeq->sq_tail;
+	int queued = 0;
+	int slot_id;
+
+	while (rw->queued < req->blkcnt) {
+		struct nvme_command *c;
+		struct nvme_slot *slot;
+		uintptr_t addr;
+		u32 lbas;
+		u64 prp2;
+
+		slot_id = nvme_find_slot(dev);
+		if (slot_id < 0)
+			break;
+		slot = &dev->slots[slot_id];
+
+		lbas = min_t(lbaint_t, xfer, req->blkcnt - rw->queued);
+		addr = (uintptr_t)req->buffer +
+			((ulong)rw->queued << ns->lba_shift);
+		if (nvme_setup_prps(dev, slot->prp_list, &prp2,
+				    lbas << ns->lba_shift, addr)) {
+			rw->error = -EIO;
+			rw->queued = req->blkcnt;
+			break;
 		}
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, temp_buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64(temp_buffer);
-		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
+		c = &slot->cmd;
+		memset(c, '\0', sizeof(*c));
+		c->rw.opcode = rw->write ? nvme_cmd_write : nvme_cmd_read;
+		c->rw.command_id = cpu_to_le16(slot_id);
+		c->rw.nsid = cpu_to_le32(ns->ns_id);
+		c->rw.slba = cpu_to_le64(req->start + rw->queued);
+		c->rw.length = cpu_to_le16(lbas - 1);
+		c->rw.prp1 = cpu_to_le64(addr);
+		c->rw.prp2 = cpu_to_le64(prp2);
+
+		slot->busy = true;
+		slot->rw = rw;
+		slot->blkcnt = lbas;
+		rw->queued += lbas;
+		rw->inflight++;
+		dev->nr_inflight++;
+
+		if (ops && ops->submit_cmd) {
+			/* controller-specific queues get one command at a time */
+			nvme_submit_cmd(nvmeq, c);
+			continue;
+		}
+
+		memcpy(&nvmeq->sq_cmds[tail], c, sizeof(*c));
+		flush_dcache_range((ulong)&nvmeq->sq_cmds[tail],
+				   (ulong)&nvmeq->sq_cmds[tail] + sizeof(*c));
+		if (++tail == nvmeq->q_depth)
+			tail = 0;
+		queued++;
+	}
+
+	if (queued) {
+		writel(tail, nvmeq->q_db);
+		nvmeq->sq_tail = tail;
+	}
+
+	if (rw->queued == req->blkcnt)
+		list_del_init(&rw->list);
+}
+
+/* Finish a transfer once all its commands are queued and complete */
+static void nvme_rw_check_done(struct nvme_rw *rw)
+{
+	struct blk_req *req = rw->req;
+
+	if (rw->queued != req->blkcnt || rw->inflight)
+		return;
+
+	if (!rw->write)
+		invalidate_dcache_range((ulong)req->buffer,
+					(ulong)req->buffer +
+					((ulong)req->blkcnt << rw->ns->lba_shift));
+	req->result = rw->error ? rw->error : req->blkcnt;
+	req->priv = NULL;
+	req->done = true;
+	if (rw->alloced)
+		free(rw);
+}
+
+/**
+ * nvme_io_poll() - reap I/O completions and queue further commands
+ *
+ * @dev:	NVMe device
+ * Return: number of commands that completed
+ */
+static int nvme_io_poll(struct nvme_dev *dev)
+{
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	struct nvme_ops *ops = (struct nvme_ops *)dev->udev->driver->ops;
+	u16 head = nvmeq->cq_head;
+	u16 phase = nvmeq->cq_phase;
+	struct nvme_rw *rw, *next;
+	int reaped = 0;
+
+	for (;;) {
+		struct nvme_slot *slot;
+		u16 status, cid;
+
+		status = nvme_read_completion_status(nvmeq, head);
+		if ((status & 0x01) != phase)
+			break;
+
+		cid = readw(&nvmeq->cqes[head].command_id);
+		if (++head == nvmeq->q_depth) {
+			head = 0;
+			phase = !phase;
+		}
+		reaped++;
+
+		if (cid >= dev->nr_slots || !dev->slots[cid].busy) {
+			printf("ERROR: unexpected command ID %u\n", cid);
+			continue;
+		}
+		slot = &dev->slots[cid];
+		if (ops && ops->complete_cmd)
+			ops->complete_cmd(nvmeq, &slot->cmd);
+
+		rw = slot->rw;
+		slot->busy = false;
+		slot->rw = NULL;
+		dev->nr_inflight--;
+		if (!rw)
+			continue;
+
+		rw->inflight--;
+		status >>= 1;
+		if (status) {
+			printf("ERROR: status = %x, phase = %d, head = %d\n",
+			       status, phase, head);
+			if (!rw->error)
+				rw->error = -EIO;
+		}
+		nvme_rw_check_done(rw);
+	}
+
+	if (reaped) {
+		writel(head, nvmeq->q_db + dev->db_stride);
+		nvmeq->cq_head = head;
+		nvmeq->cq_phase = phase;
+	}
+
+	/* use the slots just freed for transfers waiting to be queued */
+	list_for_each_entry_safe(rw, next, &dev->pending, list) {
+		if (dev->nr_inflight == dev->nr_slots)
 			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		temp_buffer += lbas << ns->lba_shift;
+		nvme_rw_queue(dev, rw);
+		nvme_rw_check_done(rw);
 	}
 
-	if (read)
-		invalidate_dcache_range((unsigned long)buffer,
-					(unsigned long)buffer + total_len);
+	return reaped;
+}
+
+static void nvme_rw_start(struct nvme_ns *ns, struct nvme_rw *rw,
+			  struct blk_req *req, bool write)
+{
+	struct nvme_dev *dev = ns->dev;
+
+	rw->req = req;
+	rw->ns = ns;
+	rw->write = write;
+	rw->queued = 0;
+	rw->inflight = 0;
+	rw->error = 0;
+	req->priv = rw;
+
+	flush_dcache_range((ulong)req->buffer, (ulong)req->buffer +
+			   ((ulong)req->blkcnt << ns->lba_shift));
+
+	/* queue now unless earlier transfers are still waiting for slots */
+	list_add_tail(&rw->list, &dev->pending);
+	if (dev->pending.next == &rw->list)
+		nvme_rw_queue(dev, rw);
+	nvme_rw_check_done(rw);
+}
+
+/* Stop tracking a transfer, e.g. after a timeout; its slots stay busy */
+static void nvme_rw_abandon(struct nvme_dev *dev, struct nvme_rw *rw)
+{
+	int i;
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	for (i = 0; i < dev->nr_slots; i++) {
+		if (dev->slots[i].rw == rw)
+			dev->slots[i].rw = NULL;
+	}
+	list_del_init(&rw->list);
+}
+
+static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
+			 lbaint_t blkcnt, void *buffer, bool read)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	ulong timeout_us = IO_TIMEOUT * 100000;
+	struct blk_req req = {
+		.dev = udev,
+		.start = blknr,
+		.blkcnt = blkcnt,
+		.buffer = buffer,
+	};
+	struct nvme_rw rw = {};
+	ulong start_time;
+
+	nvme_rw_start(ns, &rw, &req, !read);
+
+	start_time = timer_get_us();
+	while (!req.done) {
+		/* the timeout restarts each time a command completes */
+		if (nvme_io_poll(dev)) {
+			start_time = timer_get_us();
+		} else if (timer_get_us() - start_time >= timeout_us) {
+			nvme_rw_abandon(dev, &rw);
+			return -ETIMEDOUT;
+		}
+	}
+
+	return req.result;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -814,9 +1044,34 @@ static ulong nvme_blk_write(struct udevice *udev, lbaint_t blknr,
 	return nvme_blk_rw(udev, blknr, blkcnt, (void *)buffer, false);
 }
 
+static int nvme_blk_submit_read(struct udevice *udev, struct blk_req *req)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_rw *rw;
+
+	rw = calloc(1, sizeof(*rw));
+	if (!rw)
+		return -ENOMEM;
+	rw->alloced = true;
+	nvme_rw_start(ns, rw, req, false);
+
+	return 0;
+}
+
+static int nvme_blk_poll(struct udevice *udev)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+
+	nvme_io_poll(ns->dev);
+
+	return 0;
+}
+
 static const struct blk_ops nvme_blk_ops = {
 	.read	= nvme_blk_read,
 	.write	= nvme_blk_write,
+	.submit_read	= nvme_blk_submit_read,
+	.poll	= nvme_blk_poll,
 };
 
 U_BOOT_DRIVER(nvme_blk) = {
@@ -860,15 +1115,6 @@ int nvme_init(struct udevice *udev)
 		goto free_queue;
 	}
 
-	/* Allocate after the page size is known */
-	ndev->prp_pool = memalign(ndev->page_size, MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ret = nvme_setup_io_queues(ndev);
 	if (ret) {
 		log_debug("Unable to setup I/O queues(err=%dE)\n", ret);
@@ -877,6 +1123,13 @@ int nvme_init(struct udevice *udev)
 
 	nvme_get_info_from_identify(ndev);
 
+	/* Allocate after the page size and queue depth are known */
+	ret = nvme_alloc_slots(ndev);
+	if (ret) {
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	/* Create a blk device for each namespace */
 
 	id = memalign(ndev->page_size, sizeof(struct nvme_id_ns));
@@ -619,10 +619,35 @@ struct nvme_dev {
 	u32 page_size;
 	u8 vwc;
 	u64 *prp_pool;
-	u32 prp_entry_num;
+	struct nvme_slot *slots;
+	u16 nr_slots;
+	u16 nr_inflight;
+	struct list_head pending;
 	u32 nn;
 };
 
+/**
+ * struct nvme_slot - an I/O command which may be in flight
+ *
+ * The command ID of an I/O command is the index of its slot. Each slot has
+ * its own page in the PRP-list pool, which is allocated once, so that I/O
+ * commands can be queued back to back without allocating memory.
+ *
+ * @busy:	true while the command is owned by the controller
+ * @rw:		transfer the command belongs to, or NULL if that transfer has
+ *		been abandoned (the slot is freed when the command completes)
+ * @blkcnt:	number of blocks transferred by the command
+ * @prp_list:	PRP list page for the command
+ * @cmd:	the command, for controller-specific completion handling
+ */
+struct nvme_slot {
+	bool busy;
+	struct nvme_rw *rw;
+	u32 blkcnt;
+	u64 *prp_list;
+	struct nvme_command cmd;
+};
+
 /* Admin queue and a single I/O queue. */
 enum nvme_queue_id {
 	NVME_ADMIN_Q,
@@ -12,6 +12,7 @@
 #include <spl.h>
 #include <video.h>
 #include <video_console.h>
+#include <linux/list.h>
 
 /* Functions needed by stb_truetype.h */
 static int tt_floor(double val)
@@ -157,6 +158,51 @@ struct console_tt_metrics {
 	double scale;
 };
 
+/* Number of hash buckets in the glyph cache (must be a power of two) */
+#define GLYPH_HASH_SIZE		128
+
+#ifdef CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE
+#define GLYPH_CACHE_SIZE	CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE_SIZE
+#define GLYPH_SUBPIXELS		CONFIG_CONSOLE_TRUETYPE_GLYPH_SUBPIXELS
+#else
+#define GLYPH_CACHE_SIZE	0
+#define GLYPH_SUBPIXELS		0
+#endif
+
+/**
+ * struct tt_glyph - A rendered glyph
+ *
+ * Glyphs are held in the glyph cache, or returned directly from the renderer
+ * when the cache is not in use
+ *
+ * @lru:	Node in the cache's LRU list, most recently used first
+ * @node:	Node in the cache's hash bucket
+ * @font_data:	Font the glyph was rendered from
+ * @font_size:	Font size in pixels
+ * @cp:		Unicode code point
+ * @shift:	Sub-pixel X position the glyph was rendered at (0 <= shift < 1)
+ * @width:	Width of the bitmap in pixels
+ * @height:	Height of the bitmap in pixels
+ * @xoff:	X offset of the bitmap from the cursor position
+ * @yoff:	Y offset of the bitmap from the baseline
+ * @size:	Number of bytes used by this glyph in the cache
+ * @data:	8bpp bitmap, or NULL if the glyph is empty (e.g. a space)
+ */
+struct tt_glyph {
+	struct list_head lru;
+	struct hlist_node node;
+	const u8 *font_data;
+	int font_size;
+	int cp;
+	double shift;
+	int width;
+	int height;
+	int xoff;
+	int yoff;
+	uint size;
+	u8 *data;
+};
+
 /**
  * struct console_tt_priv - Private data for this driver
  *
@@ -169,6 +215,13 @@ struct console_tt_metrics {
  *		last character. We record enough characters to go back to the
  *		start of the current command line.
  * @pos_ptr:	Current position in the position history
+ * @glyph_lru:	List of cached glyphs (struct tt_glyph), most recently used
+ *		first
+ * @glyph_hash:	Hash table of cached glyphs, with GLYPH_HASH_SIZE buckets, or
+ *		NULL if the glyph cache is not in use
+ * @glyph_used:	Number of bytes used by cached glyphs
+ * @glyph_max:	Maximum number of bytes to use for cached glyphs
+ * @glyph_stats:	Glyph cache hits, misses and evictions
  */
 struct console_tt_priv {
 	struct console_tt_metrics *cur_met;
@@ -176,6 +229,11 @@ struct console_tt_priv {
 	int num_metrics;
 	struct pos_info pos[POS_HISTORY_SIZE];
 	int pos_ptr;
+	struct list_head glyph_lru;
+	struct hlist_head *glyph_hash;
+	uint glyph_used;
+	uint glyph_max;
+	struct console_tt_glyph_stats glyph_stats;
 };
 
 /**
@@ -270,6 +328,162 @@ static int console_truetype_move_rows(struct udevice *dev, uint rowdst,
 	return 0;
 }
 
+static uint glyph_hash(const u8 *font_data, int font_size, int cp,
+		       double shift)
+{
+	ulong hash = (ulong)font_data >> 4;
+
+	hash = hash * 31 + font_size;
+	hash = hash * 31 + cp;
+	hash = hash * 31 + (int)(shift * VID_FRAC_DIV);
+
+	return hash & (GLYPH_HASH_SIZE - 1);
+}
+
+static void glyph_drop(struct console_tt_priv *priv, struct tt_glyph *glyph)
+{
+	priv->glyph_used -= glyph->size;
+	list_del(&glyph->lru);
+	hlist_del(&glyph->node);
+	free(glyph);
+}
+
+/**
+ * glyph_add() - Add a rendered glyph to the cache
+ *
+ * The least recently used glyphs are dropped to make space if needed
+ *
+ * @priv:	Private data
+ * @tmp:	Glyph returned by the renderer
+ * Return: cached glyph, or NULL if it is too large or out of memory
+ */
+static struct tt_glyph *glyph_add(struct console_tt_priv *priv,
+				  struct tt_glyph *tmp)
+{
+	uint bytes = tmp->data ? tmp->width * tmp->height : 0;
+	uint size = sizeof(struct tt_glyph) + bytes;
+	struct tt_glyph *glyph;
+
+	if (size > priv->glyph_max)
+		return NULL;
+	while (priv->glyph_used + size > priv->glyph_max) {
+		glyph_drop(priv, list_last_entry(&priv->glyph_lru,
+						 struct tt_glyph, lru));
+		priv->glyph_stats.evictions++;
+	}
+
+	glyph = malloc(size);
+	if (!glyph)
+		return NULL;
+	*glyph = *tmp;
+	glyph->size = size;
+	if (tmp->data) {
+		glyph->data = (u8 *)(glyph + 1);
+		memcpy(glyph->data, tmp->data, bytes);
+	}
+	list_add(&glyph->lru, &priv->glyph_lru);
+	hlist_add_head(&glyph->node,
+		       &priv->glyph_hash[glyph_hash(glyph->font_data,
+						    glyph->font_size, glyph->cp,
+						    glyph->shift)]);
+	priv->glyph_used += size;
+
+	return glyph;
+}
+
+/**
+ * glyph_get() - Get a rendered glyph for a character
+ *
+ * This looks in the glyph cache first, then renders the glyph and adds it to
+ * the cache if it is not there. Unless GLYPH_SUBPIXELS is set, glyphs are
+ * matched on the exact sub-pixel position, so that the output is the same as
+ * with no cache.
+ *
+ * @priv:	Private data
+ * @met:	Font metrics to use
+ * @cp:		Unicode code point to render
+ * @x_shift:	Sub-pixel X position, 0 <= x_shift < 1
+ * @tmp:	Used to hold the glyph if it cannot be cached. In that case
+ *		the caller must free @tmp->data when finished with it
+ * Return: glyph, which is either @tmp or a cached glyph
+ */
+static struct tt_glyph *glyph_get(struct console_tt_priv *priv,
+				  struct console_tt_metrics *met, int cp,
+				  double x_shift, struct tt_glyph *tmp)
+{
+	struct tt_glyph *glyph;
+
+	if (GLYPH_SUBPIXELS)
+		x_shift = tt_floor(x_shift * GLYPH_SUBPIXELS) /
+			(double)GLYPH_SUBPIXELS;
+	if (priv->glyph_hash) {
+		struct hlist_head *head;
+
+		head = &priv->glyph_hash[glyph_hash(met->font_data,
+						    met->font_size, cp,
+						    x_shift)];
+		hlist_for_each_entry(glyph, head, node) {
+			if (glyph->cp == cp && glyph->shift == x_shift &&
+			    glyph->font_size == met->font_size &&
+			    glyph->font_data == met->font_data) {
+				list_move(&glyph->lru, &priv->glyph_lru);
+				priv->glyph_stats.hits++;
+				return glyph;
+			}
+		}
+	}
+
+	tmp->font_data = met->font_data;
+	tmp->font_size = met->font_size;
+	tmp->cp = cp;
+	tmp->shift = x_shift;
+	tmp->data = stbtt_GetCodepointBitmapSubpixel(&met->font, met->scale,
+						     met->scale, x_shift, 0,
+						     cp, &tmp->width,
+						     &tmp->height, &tmp->xoff,
+						     &tmp->yoff);
+	if (priv->glyph_hash) {
+		priv->glyph_stats.misses++;
+		glyph = glyph_add(priv, tmp);
+		if (glyph) {
+			free(tmp->data);
+			return glyph;
+		}
+	}
+
+	return tmp;
+}
+
+/**
+ * glyph_prewarm() - Render the printable ASCII characters into the cache
+ *
+ * Each character is rendered at every sub-pixel position. This stops once the
+ * cache is full, rather than evicting the glyphs it has just added.
+ *
+ * @priv:	Private data
+ */
+static void glyph_prewarm(struct console_tt_priv *priv)
+{
+	uint evictions = priv->glyph_stats.evictions;
+	int steps = GLYPH_SUBPIXELS;
+	struct tt_glyph *glyph, tmp;
+	int cp, i;
+
+	for (cp = ' '; cp <= '~'; cp++) {
+		for (i = 0; i < steps; i++) {
+			glyph = glyph_get(priv, priv->cur_met, cp,
+					  (double)i / steps, &tmp);
+			if (glyph == &tmp) {
+				free(tmp.data);
+				return;
+			}
+			if (priv->glyph_stats.evictions != evictions ||
+			    priv->glyph_used + glyph->size > priv->glyph_max)
+				return;
+		}
+	}
+}
+
 static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 				    int cp)
 {
@@ -284,7 +498,8 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	int lsb;
 	int width_frac, linenum;
 	struct pos_info *pos;
-	u8 *bits, *data;
+	struct tt_glyph *glyph, tmp;
+	const u8 *bits;
 	int advance;
 	void *start, *end, *line;
 	int row;
@@ -326,16 +541,18 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	 * Figure out how much past the start of a pixel we are, and pass this
 	 * information into the render, which will return a 8-bit-per-pixel
 	 * image of the character. For empty characters, like ' ', data will
-	 * return NULL;
+	 * be NULL;
 	 */
-	data = stbtt_GetCodepointBitmapSubpixel(font, met->scale, met->scale,
-						x_shift, 0, cp, &width, &height,
-						&xoff, &yoff);
-	if (!data)
+	glyph = glyph_get(priv, met, cp, x_shift, &tmp);
+	if (!glyph->data)
 		return width_frac;
+	width = glyph->width;
+	height = glyph->height;
+	xoff = glyph->xoff;
+	yoff = glyph->yoff;
 
 	/* Figure out where to write the character in the frame buffer */
-	bits = data;
+	bits = glyph->data;
 	start = vid_priv->fb + y * vid_priv->line_length +
 		VID_TO_PIXEL(x) * VNBYTES(vid_priv->bpix);
 	linenum = met->baseline + yoff;
@@ -421,7 +638,8 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 			break;
 		}
 		default:
-			free(data);
+			if (glyph == &tmp)
+				free(tmp.data);
 			return -ENOSYS;
 		}
 
@@ -434,7 +652,8 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 		     width,
 		     height);
 
-	free(data);
+	if (glyph == &tmp)
+		free(tmp.data);
 
 	return width_frac;
 }
@@ -1060,11 +1279,69 @@ static int console_truetype_probe(struct udevice *dev)
 
 	select_metrics(dev, &priv->metrics[ret]);
 
+	INIT_LIST_HEAD(&priv->glyph_lru);
+	priv->glyph_max = GLYPH_CACHE_SIZE;
+	if (IS_ENABLED(CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE)) {
+		/* Without the hash table, each glyph is rendered as needed */
+		priv->glyph_hash = calloc(GLYPH_HASH_SIZE,
+					  sizeof(struct hlist_head));
+		if (!priv->glyph_hash)
+			log_debug("No memory for glyph cache\n");
+	}
+
+	if (IS_ENABLED(CONFIG_CONSOLE_TRUETYPE_GLYPH_PREWARM) &&
+	    priv->glyph_hash)
+		glyph_prewarm(priv);
+
 	debug("%s: ready\n", __func__);
 
 	return 0;
 }
 
+static int console_truetype_remove(struct udevice *dev)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+	struct tt_glyph *glyph, *next;
+
+	if (priv->glyph_hash) {
+		list_for_each_entry_safe(glyph, next, &priv->glyph_lru, lru)
+			glyph_drop(priv, glyph);
+		free(priv->glyph_hash);
+		priv->glyph_hash = NULL;
+	}
+
+	return 0;
+}
+
+int console_truetype_glyph_stats(struct udevice *dev,
+				struct console_tt_glyph_stats *stats)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+
+	if (!priv->glyph_hash)
+		return -ENOSYS;
+	*stats = priv->glyph_stats;
+	stats->used = priv->glyph_used;
+
+	return 0;
+}
+
+int console_truetype_set_glyph_cache_size(struct udevice *dev, uint size)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+
+	if (!priv->glyph_hash)
+		return -ENOSYS;
+	while (priv->glyph_used > size) {
+		glyph_drop(priv, list_last_entry(&priv->glyph_lru,
+						 struct tt_glyph, lru));
+		priv->glyph_stats.evictions++;
+	}
+	priv->glyph_max = size;
+
+	return 0;
+}
+
 struct vidconsole_ops console_truetype_ops = {
 	.putc_xy	= console_truetype_putc_xy,
 	.move_rows	= console_truetype_move_rows,
@@ -1086,5 +1363,6 @@ U_BOOT_DRIVER(vidconsole_truetype) = {
 	.id	= UCLASS_VIDEO_CONSOLE,
 	.ops	= &console_truetype_ops,
 	.probe	= console_truetype_probe,
+	.remove	= console_truetype_remove,
 	.priv_auto	= sizeof(struct console_tt_priv),
 };
@@ -403,9 +403,52 @@ void video_set_default_colors(struct udevice *dev, bool invert)
 
 /* Notify about changes in the frame buffer */
 #ifdef CONFIG_VIDEO_DAMAGE
+static int damage_area(const struct video_damage_rect *rect)
+{
+	return (rect->xend - rect->xstart) * (rect->yend - rect->ystart);
+}
+
+static void damage_union(struct video_damage_rect *dst,
+			 const struct video_damage_rect *src)
+{
+	dst->xstart = min(dst->xstart, src->xstart);
+	dst->ystart = min(dst->ystart, src->ystart);
+	dst->xend = max(dst->xend, src->xend);
+	dst->yend = max(dst->yend, src->yend);
+}
+
+/* Merge rectangle @j into rectangle @i, then remove @j */
+static void damage_merge(struct video_priv *priv, int i, int j)
+{
+	damage_union(&priv->damage.rect[i], &priv->damage.rect[j]);
+	priv->damage.rect[j] = priv->damage.rect[--priv->damage.count];
+}
+
+/* Merge any two rectangles which overlap or touch, returning true if found */
+static bool damage_coalesce(struct video_priv *priv)
+{
+	struct video_damage_rect *rect = priv->damage.rect;
+	int i, j;
+
+	for (i = 0; i < priv->damage.count; i++) {
+		for (j = i + 1; j < priv->damage.count; j++) {
+			if (rect[i].xstart <= rect[j].xend &&
+			    rect[j].xstart <= rect[i].xend &&
+			    rect[i].ystart <= rect[j].yend &&
+			    rect[j].ystart <= rect[i].yend) {
+				damage_merge(priv, i, j);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
 void video_damage(struct udevice *vid, int x, int y, int width, int height)
 {
 	struct video_priv *priv = dev_get_uclass_priv(vid);
+	struct video_damage_rect *rect = priv->damage.rect;
 	int xend = x + width;
 	int yend = y + height;
 
@@ -421,11 +464,48 @@ void video_damage(struct udevice *vid, int x, int y, int width, int height)
 	if (yend > priv->ysize)
 		yend = priv->ysize;
 
-	/* Span a rectangle across all old and new damage */
-	priv->damage.xstart = min(x, priv->damage.xstart);
-	priv->damage.ystart = min(y, priv->damage.ystart);
-	priv->damage.xend = max(xend, priv->damage.xend);
-	priv->damage.yend = max(yend, priv->damage.yend);
+	if (xend <= x || yend <= y)
+		return;
+
+	/* There is always a spare slot for the new rectangle */
+	rect[priv->damage.count++] = (struct video_damage_rect){
+		.xstart = x, .ystart = y, .xend = xend, .yend = yend,
+	};
+
+	while (damage_coalesce(priv))
+		;
+
+	/*
+	 * If there are too many rectangles, merge the pair whose bounding box
+	 * covers the least extra area. This can make the result touch another
+	 * rectangle, so coalesce again.
+	 */
+	while (priv->damage.count > VIDEO_DAMAGE_RECTS) {
+		struct video_damage_rect merged;
+		int best_i = 0, best_j = 1;
+		int best = INT_MAX;
+		int i, j;
+
+		for (i = 0; i < priv->damage.count; i++) {
+			for (j = i + 1; j < priv->damage.count; j++) {
+				int extra;
+
+				merged = rect[i];
+				damage_union(&merged, &rect[j]);
+				extra = damage_area(&merged) -
+					damage_area(&rect[i]) -
+					damage_area(&rect[j]);
+				if (extra < best) {
+					best = extra;
+					best_i = i;
+					best_j = j;
+				}
+			}
+		}
+		damage_merge(priv, best_i, best_j);
+		while (damage_coalesce(priv))
+			;
+	}
 }
 #endif
 
@@ -434,6 +514,7 @@ static void video_flush_dcache(struct udevice *vid, bool use_copy)
 	struct video_priv *priv = dev_get_uclass_priv(vid);
 	ulong fb = use_copy ? (ulong)priv->copy_fb : (ulong)priv->fb;
 	uint cacheline_size = 32;
+	int i;
 
 #ifdef CONFIG_SYS_CACHELINE_SIZE
 	cacheline_size = CONFIG_SYS_CACHELINE_SIZE;
@@ -452,12 +533,13 @@ static void video_flush_dcache(struct udevice *vid, bool use_copy)
 		return;
 	}
 
-	if (priv->damage.xend && priv->damage.yend) {
-		int lstart = priv->damage.xstart * VNBYTES(priv->bpix);
-		int lend = priv->damage.xend * VNBYTES(priv->bpix);
+	for (i = 0; i < priv->damage.count; i++) {
+		const struct video_damage_rect *rect = &priv->damage.rect[i];
+		int lstart = rect->xstart * VNBYTES(priv->bpix);
+		int lend = rect->xend * VNBYTES(priv->bpix);
 		int y;
 
-		for (y = priv->damage.ystart; y < priv->damage.yend; y++) {
+		for (y = rect->ystart; y < rect->yend; y++) {
 			ulong start = fb + (y * priv->line_length) + lstart;
 			ulong end = start + lend - lstart;
 
@@ -472,16 +554,18 @@ static void video_flush_dcache(struct udevice *vid, bool use_copy)
 static void video_flush_copy(struct udevice *vid)
 {
 	struct video_priv *priv = dev_get_uclass_priv(vid);
+	int i;
 
 	if (!priv->copy_fb)
 		return;
 
-	if (priv->damage.xend && priv->damage.yend) {
-		int lstart = priv->damage.xstart * VNBYTES(priv->bpix);
-		int lend = priv->damage.xend * VNBYTES(priv->bpix);
+	for (i = 0; i < priv->damage.count; i++) {
+		const struct video_damage_rect *rect = &priv->damage.rect[i];
+		int lstart = rect->xstart * VNBYTES(priv->bpix);
+		int lend = rect->xend * VNBYTES(priv->bpix);
 		int y;
 
-		for (y = priv->damage.ystart; y < priv->damage.yend; y++) {
+		for (y = rect->ystart; y < rect->yend; y++) {
 			ulong offset = (y * priv->line_length) + lstart;
 			ulong len = lend - lstart;
 
@@ -521,12 +605,8 @@ int video_sync(struct udevice *vid, bool force)
 #endif
 	priv->last_sync = get_timer(0);
 
-	if (IS_ENABLED(CONFIG_VIDEO_DAMAGE)) {
-		priv->damage.xstart = priv->xsize;
-		priv->damage.ystart = priv->ysize;
-		priv->damage.xend = 0;
-		priv->damage.yend = 0;
-	}
+	if (IS_ENABLED(CONFIG_VIDEO_DAMAGE))
+		priv->damage.count = 0;
 
 	return 0;
 }
@@ -8,18 +8,52 @@
 
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
 #include "virtio_blk.h"
 
+/**
+ * struct virtio_blk_req - a request slot
+ *
+ * @out_hdr:	request header, always the first buffer of the chain
+ * @wz_hdr:	range for a write-zeroes request
+ * @status:	status written back by the device
+ */
+struct virtio_blk_req {
+	struct virtio_blk_outhdr out_hdr;
+	struct virtio_blk_discard_write_zeroes wz_hdr;
+	u8 status;
+};
+
+/**
+ * struct virtio_blk_priv - private data for a virtio block device
+ *
+ * @vq:		request virtqueue
+ * @reqs:	request slots, one per request that can be in flight
+ * @nr_reqs:	number of requests that fit in the ring at the same time
+ * @seg_max:	maximum number of data segments in one request
+ * @size_max:	maximum size of a data segment, in bytes
+ * @sg:		scatter-gather list used while building a request
+ * @sgs:	pointers into @sg, as taken by virtqueue_add()
+ */
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	struct virtio_blk_req *reqs;
+	uint nr_reqs;
+	uint seg_max;
+	u32 size_max;
+	struct virtio_sg *sg;
+	struct virtio_sg **sgs;
 };
 
 static const u32 feature[] = {
-	VIRTIO_BLK_F_WRITE_ZEROES
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+	VIRTIO_BLK_F_WRITE_ZEROES,
+	VIRTIO_RING_F_INDIRECT_DESC,
 };
 
 static void virtio_blk_init_header_sg(struct udevice *dev, u64 sector, u32 type,
@@ -53,63 +87,133 @@ static void virtio_blk_init_status_sg(u8 *status, struct virtio_sg *sg)
 	sg->length = sizeof(*status);
 }
 
-static void virtio_blk_init_data_sg(void *buffer, lbaint_t blkcnt, struct virtio_sg *sg)
+/* Split the data buffer into segments no larger than the device allows */
+static uint virtio_blk_init_data_sgs(struct virtio_blk_priv *priv,
+				     void *buffer, lbaint_t blkcnt,
+				     struct virtio_sg *sg)
 {
-	sg->addr = buffer;
-	sg->length = blkcnt * 512;
+	ulong len = blkcnt * 512;
+	uint n;
+
+	for (n = 0; len; n++) {
+		sg[n].addr = buffer;
+		sg[n].length = min_t(ulong, len, priv->size_max);
+		buffer += sg[n].length;
+		len -= sg[n].length;
+	}
+
+	return n;
 }
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+/* Largest number of sectors that fit in a single request */
+static lbaint_t virtio_blk_max_blks(struct virtio_blk_priv *priv)
+{
+	return (lbaint_t)priv->seg_max * (priv->size_max / 512);
+}
+
+static int virtio_blk_add_req(struct udevice *dev, struct virtio_blk_req *req,
+			      u64 sector, lbaint_t blkcnt, void *buffer,
+			      u32 type)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	struct virtio_blk_outhdr out_hdr;
-	struct virtio_blk_discard_write_zeroes wz_hdr;
+	struct virtio_sg *sg = priv->sg;
 	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg hdr_sg, wz_sg, data_sg, status_sg;
-	struct virtio_sg *sgs[3];
-	u8 status;
-	int ret;
+	uint i, nsegs;
 
-	virtio_blk_init_header_sg(dev, sector, type, &out_hdr, &hdr_sg);
-	sgs[num_out++] = &hdr_sg;
+	virtio_blk_init_header_sg(dev, sector, type, &req->out_hdr, &sg[0]);
+	num_out++;
 
 	switch (type) {
 	case VIRTIO_BLK_T_IN:
 	case VIRTIO_BLK_T_OUT:
-		virtio_blk_init_data_sg(buffer, blkcnt, &data_sg);
+		nsegs = virtio_blk_init_data_sgs(priv, buffer, blkcnt, &sg[1]);
 		if (type & VIRTIO_BLK_T_OUT)
-			sgs[num_out++] = &data_sg;
+			num_out += nsegs;
 		else
-			sgs[num_out + num_in++] = &data_sg;
+			num_in += nsegs;
 		break;
 
 	case VIRTIO_BLK_T_WRITE_ZEROES:
-		virtio_blk_init_write_zeroes_sg(dev, sector, blkcnt, &wz_hdr, &wz_sg);
-		sgs[num_out++] = &wz_sg;
+		virtio_blk_init_write_zeroes_sg(dev, sector, blkcnt,
+						&req->wz_hdr, &sg[1]);
+		num_out++;
 		break;
 
 	default:
 		return -EINVAL;
 	}
 
-	virtio_blk_init_status_sg(&status, &status_sg);
-	sgs[num_out + num_in++] = &status_sg;
-	log_debug("dev=%s, active=%d, priv=%p, priv->vq=%p\n", dev->name,
-		  device_active(dev), priv, priv->vq);
+	req->status = VIRTIO_BLK_S_IOERR;
+	virtio_blk_init_status_sg(&req->status, &sg[num_out + num_in]);
+	num_in++;
 
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
-	if (ret)
-		return ret;
+	for (i = 0; i < num_out + num_in; i++)
+		priv->sgs[i] = &sg[i];
 
-	virtqueue_kick(priv->vq);
+	return virtqueue_add(priv->vq, priv->sgs, num_out, num_in);
+}
 
-	log_debug("wait...");
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
-	log_debug("done\n");
+/*
+ * Post as many requests as the ring can hold, kick the device once and then
+ * reap all of them, so a large transfer only costs a notification per batch
+ * rather than per request.
+ */
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, u32 type)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	lbaint_t max_blks = virtio_blk_max_blks(priv);
+	lbaint_t posted = 0;
+	int ret = 0;
+
+	log_debug("dev=%s, active=%d, priv=%p, priv->vq=%p\n", dev->name,
+		  device_active(dev), priv, priv->vq);
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+	do {
+		uint inflight = 0;
+
+		while (inflight < priv->nr_reqs && (!inflight || posted < blkcnt)) {
+			lbaint_t cnt = blkcnt - posted;
+
+			if (type != VIRTIO_BLK_T_WRITE_ZEROES)
+				cnt = min(cnt, max_blks);
+			ret = virtio_blk_add_req(dev, &priv->reqs[inflight],
+						 sector + posted, cnt, buffer,
+						 type);
+			if (ret == -ENOSPC && inflight) {
+				ret = 0;
+				break;
+			}
+			if (ret)
+				break;
+			inflight++;
+			posted += cnt;
+			if (buffer)
+				buffer += cnt * 512;
+		}
+		if (!inflight)
+			break;
+
+		virtqueue_kick(priv->vq);
+
+		log_debug("wait %u...", inflight);
+		while (inflight) {
+			struct virtio_blk_outhdr *out_hdr;
+			struct virtio_blk_req *req;
+
+			out_hdr = virtqueue_get_buf(priv->vq, NULL);
+			if (!out_hdr)
+				continue;
+			req = container_of(out_hdr, struct virtio_blk_req,
+					   out_hdr);
+			if (req->status != VIRTIO_BLK_S_OK)
+				ret = -EIO;
+			inflight--;
+		}
+		log_debug("done\n");
+	} while (!ret && posted < blkcnt);
+
+	return ret ? ret : blkcnt;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
@@ -175,6 +279,7 @@ static int virtio_blk_probe(struct udevice *dev)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	uint num;
 	u64 cap;
 	int ret;
 
@@ -187,7 +292,71 @@ static int virtio_blk_probe(struct udevice *dev)
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
 	desc->lba = cap;
 
+	/* Without SEG_MAX the device only promises to take a single segment */
+	priv->seg_max = 1;
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_SEG_MAX)) {
+		virtio_cread(dev, struct virtio_blk_config, seg_max,
+			     &priv->seg_max);
+		priv->seg_max = max(priv->seg_max, 1U);
+	}
+	priv->size_max = U32_MAX;
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_SIZE_MAX))
+		virtio_cread(dev, struct virtio_blk_config, size_max,
+			     &priv->size_max);
+	priv->size_max = max(ALIGN_DOWN(priv->size_max, 512), 512U);
+
+	/*
+	 * A chain, indirect or not, may not be longer than the ring, so a
+	 * request needs at least three entries: header, data and status. An
+	 * indirect request only takes one ring slot; a direct one, which
+	 * virtqueue_add() falls back to when it cannot use an indirect table,
+	 * takes a slot per buffer but still fits in an empty ring.
+	 */
+	num = virtqueue_get_vring_size(priv->vq);
+	if (num < 3) {
+		log_debug("%s: ring of %u cannot hold a request\n", dev->name,
+			  num);
+		ret = -ENOSPC;
+		goto err;
+	}
+	priv->seg_max = clamp(priv->seg_max, 1U, num - 2);
+	if (virtio_has_feature(dev, VIRTIO_RING_F_INDIRECT_DESC))
+		priv->nr_reqs = num;
+	else
+		priv->nr_reqs = num / (priv->seg_max + 2);
+
+	priv->reqs = calloc(priv->nr_reqs, sizeof(*priv->reqs));
+	priv->sg = calloc(priv->seg_max + 2, sizeof(*priv->sg));
+	priv->sgs = calloc(priv->seg_max + 2, sizeof(*priv->sgs));
+	if (!priv->reqs || !priv->sg || !priv->sgs) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	log_debug("%s: seg_max %u size_max %#x, %u requests in flight\n",
+		  dev->name, priv->seg_max, priv->size_max, priv->nr_reqs);
+
 	return 0;
+
+err:
+	free(priv->reqs);
+	free(priv->sg);
+	free(priv->sgs);
+	virtio_del_vqs(dev);
+
+	return ret;
+}
+
+static int virtio_blk_remove(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	int ret;
+
+	ret = virtio_reset(dev);
+	free(priv->reqs);
+	free(priv->sg);
+	free(priv->sgs);
+
+	return ret;
 }
 
 static const struct blk_ops virtio_blk_ops = {
@@ -202,7 +371,7 @@ U_BOOT_DRIVER(virtio_blk) = {
 	.ops	= &virtio_blk_ops,
 	.bind	= virtio_blk_bind,
 	.probe	= virtio_blk_probe,
-	.remove	= virtio_reset,
+	.remove	= virtio_blk_remove,
 	.priv_auto	= sizeof(struct virtio_blk_priv),
 	.flags	= DM_FLAG_ACTIVE_DMA,
 };
@@ -194,6 +194,7 @@ static int virtio_net_probe(struct udevice *dev)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
 	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(dev->parent);
+	struct eth_pdata *pdata = dev_get_plat(dev);
 	int ret;
 
 	ret = virtio_find_vqs(dev, 2, priv->vqs);
@@ -212,6 +213,14 @@ static int virtio_net_probe(struct udevice *dev)
 	else
 		priv->net_hdr_len = sizeof(struct virtio_net_hdr_v1);
 
+	/*
+	 * Each buffer goes back in the rx ring when it is freed, in any order,
+	 * and the ring keeps running across stop() and start(). Keep half of
+	 * them for the device, so it does not run out while the network
+	 * stack holds on to packets.
+	 */
+	pdata->rx_hold = VIRTIO_NET_NUM_RX_BUFS / 2;
+
 	return 0;
 }
 
@@ -97,10 +97,40 @@ static void virtqueue_detach_desc(struct virtqueue *vq, unsigned int idx)
 	desc->addr = cpu_to_virtio64(vq->vdev, (u64)(uintptr_t)bb->user_buffer);
 }
 
+static struct vring_desc *virtqueue_alloc_indirect(struct virtqueue *vq,
+						   struct virtio_sg *sgs[],
+						   unsigned int out_sgs,
+						   unsigned int in_sgs)
+{
+	unsigned int total = out_sgs + in_sgs;
+	struct vring_desc *desc;
+	unsigned int n;
+
+	desc = memalign(sizeof(*desc), total * sizeof(*desc));
+	if (!desc)
+		return NULL;
+
+	for (n = 0; n < total; n++) {
+		u16 flags = 0;
+
+		if (n + 1 < total)
+			flags |= VRING_DESC_F_NEXT;
+		if (n >= out_sgs)
+			flags |= VRING_DESC_F_WRITE;
+		desc[n].addr = cpu_to_virtio64(vq->vdev,
+					       (u64)(uintptr_t)sgs[n]->addr);
+		desc[n].len = cpu_to_virtio32(vq->vdev, sgs[n]->length);
+		desc[n].flags = cpu_to_virtio16(vq->vdev, flags);
+		desc[n].next = cpu_to_virtio16(vq->vdev, n + 1);
+	}
+
+	return desc;
+}
+
 int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		  unsigned int out_sgs, unsigned int in_sgs)
 {
-	struct vring_desc *desc;
+	struct vring_desc *desc, *indir = NULL;
 	unsigned int descs_used = out_sgs + in_sgs;
 	unsigned int i, n, avail, uninitialized_var(prev);
 	int head;
@@ -112,7 +142,16 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	desc = vq->vring.desc;
 	i = head;
 
-	if (vq->num_free < descs_used) {
+	/*
+	 * A chain can go into a single indirect descriptor, unless we need
+	 * to bounce the buffers, which is only set up for the ring itself.
+	 * If the allocation fails we just fall back to a direct chain.
+	 */
+	if (vq->indirect && descs_used > 1 && !vq->vring.bouncebufs &&
+	    vq->num_free)
+		indir = virtqueue_alloc_indirect(vq, sgs, out_sgs, in_sgs);
+
+	if (vq->num_free < (indir ? 1 : descs_used)) {
 		debug("Can't add buf len %i - avail = %i\n",
 		      descs_used, vq->num_free);
 		/*
@@ -125,17 +164,28 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		return -ENOSPC;
 	}
 
-	for (n = 0; n < descs_used; n++) {
-		u16 flags = VRING_DESC_F_NEXT;
+	if (indir) {
+		struct virtio_sg sg = {
+			.addr = indir,
+			.length = descs_used * sizeof(*indir),
+		};
 
-		if (n >= out_sgs)
-			flags |= VRING_DESC_F_WRITE;
-		prev = i;
-		i = virtqueue_attach_desc(vq, i, sgs[n], flags);
+		i = virtqueue_attach_desc(vq, head, &sg, VRING_DESC_F_INDIRECT);
+		vq->vring_desc_shadow[head].indir_desc = indir;
+		descs_used = 1;
+	} else {
+		for (n = 0; n < descs_used; n++) {
+			u16 flags = VRING_DESC_F_NEXT;
+
+			if (n >= out_sgs)
+				flags |= VRING_DESC_F_WRITE;
+			prev = i;
+			i = virtqueue_attach_desc(vq, i, sgs[n], flags);
+		}
+		/* Last one doesn't continue */
+		vq->vring_desc_shadow[prev].flags &= ~VRING_DESC_F_NEXT;
+		desc[prev].flags = cpu_to_virtio16(vq->vdev, vq->vring_desc_shadow[prev].flags);
 	}
-	/* Last one doesn't continue */
-	vq->vring_desc_shadow[prev].flags &= ~VRING_DESC_F_NEXT;
-	desc[prev].flags = cpu_to_virtio16(vq->vdev, vq->vring_desc_shadow[prev].flags);
 
 	/* We're using some buffers from the free list. */
 	vq->num_free -= descs_used;
@@ -211,6 +261,10 @@ static void detach_buf(struct virtqueue *vq, unsigned int head)
 	/* Unmark the descriptor as the head of a chain. */
 	vq->vring_desc_shadow[head].chain_head = false;
 
+	/* An indirect table is ours alone, the ring only holds its address */
+	free(vq->vring_desc_shadow[head].indir_desc);
+	vq->vring_desc_shadow[head].indir_desc = NULL;
+
 	/* Put back on free list: unmap first-level descriptors and find end */
 	i = head;
 
@@ -236,8 +290,10 @@ static inline bool more_used(const struct virtqueue *vq)
 
 void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 {
+	struct vring_desc_shadow *desc_shadow;
 	unsigned int i;
 	u16 last_used;
+	void *buf;
 
 	if (!more_used(vq)) {
 		debug("(%s.%d): No more buffers in queue\n",
@@ -269,6 +325,14 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		return NULL;
 	}
 
+	/* Hand back the first buffer of the chain, as virtqueue_add() got it */
+	desc_shadow = &vq->vring_desc_shadow[i];
+	if (desc_shadow->indir_desc)
+		buf = (void *)(uintptr_t)virtio64_to_cpu(vq->vdev,
+						desc_shadow->indir_desc[0].addr);
+	else
+		buf = (void *)(uintptr_t)desc_shadow->addr;
+
 	detach_buf(vq, i);
 	vq->last_used_idx++;
 	/*
@@ -280,7 +344,7 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		virtio_store_mb(&vring_used_event(&vq->vring),
 				cpu_to_virtio16(vq->vdev, vq->last_used_idx));
 
-	return (void *)(uintptr_t)vq->vring_desc_shadow[i].addr;
+	return buf;
 }
 
 static struct virtqueue *__vring_new_virtqueue(unsigned int index,
@@ -315,6 +379,7 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	list_add_tail(&vq->list, &uc_priv->vqs);
 
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC);
 
 	/* Tell other side not to bother us */
 	vq->avail_flags_shadow |= VRING_AVAIL_F_NO_INTERRUPT;
@@ -394,6 +459,10 @@ err_free_queue:
 
 void vring_del_virtqueue(struct virtqueue *vq)
 {
+	unsigned int i;
+
+	for (i = 0; i < vq->vring.num; i++)
+		free(vq->vring_desc_shadow[i].indir_desc);
 	virtio_free_pages(vq->vdev, vq->vring.desc,
 			  DIV_ROUND_UP(vq->vring.size, PAGE_SIZE));
 	free(vq->vring_desc_shadow);
@@ -436,8 +505,9 @@ void virtqueue_dump(struct virtqueue *vq)
 	unsigned int i;
 
 	printf("virtqueue %p for dev %s:\n", vq, vq->vdev->name);
-	printf("\tindex %u, phys addr %p num %u\n",
-	       vq->index, vq->vring.desc, vq->vring.num);
+	printf("\tindex %u, phys addr %p num %u%s\n",
+	       vq->index, vq->vring.desc, vq->vring.num,
+	       vq->indirect ? " (indirect)" : "");
 	printf("\tfree_head %u, num_added %u, num_free %u\n",
 	       vq->free_head, vq->num_added, vq->num_free);
 	printf("\tlast_used_idx %u, avail_flags_shadow %u, avail_idx_shadow %u\n",
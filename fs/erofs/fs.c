@@ -253,6 +253,48 @@ int erofs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 	return 0;
 }
 
+int erofs_open_file(struct fs_file *file)
+{
+	struct erofs_inode *vi;
+	int err;
+
+	vi = malloc(sizeof(*vi));
+	if (!vi)
+		return -ENOMEM;
+
+	err = erofs_ilookup(file->name, vi);
+	if (!err && S_ISLNK(vi->i_mode))
+		err = erofs_readlink(vi);
+	if (!err && S_ISDIR(vi->i_mode))
+		err = -EISDIR;
+	if (err) {
+		free(vi);
+		return err;
+	}
+	file->size = vi->i_size;
+	file->priv = vi;
+
+	return 0;
+}
+
+int erofs_pread_file(struct fs_file *file, void *buf, loff_t offset,
+		     loff_t len, loff_t *actread)
+{
+	int err;
+
+	err = erofs_pread(file->priv, buf, len, offset);
+	if (err)
+		return err;
+	*actread = len;
+
+	return 0;
+}
+
+void erofs_closefile(struct fs_file *file)
+{
+	free(file->priv);
+}
+
 void erofs_close(void)
 {
 	ctxt.cur_dev = NULL;
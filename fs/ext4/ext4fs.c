@@ -371,6 +371,41 @@ int ext4fs_read(char *buf, loff_t offset, loff_t len, loff_t *actread)
 	return ext4fs_read_file(ext4fs_file, offset, len, buf, actread);
 }
 
+int ext4fs_open_file(struct fs_file *file)
+{
+	struct ext2fs_node *node = NULL;
+
+	if (!ext4fs_root)
+		return -ENODEV;
+
+	if (!ext4fs_find_file(file->name, &ext4fs_root->diropen, &node,
+			      FILETYPE_REG))
+		goto err;
+	if (!node->inode_read &&
+	    !ext4fs_read_inode(node->data, node->ino, &node->inode))
+		goto err;
+	file->size = le32_to_cpu(node->inode.size);
+	file->priv = node;
+
+	return 0;
+
+err:
+	if (node)
+		ext4fs_free_node(node, &ext4fs_root->diropen);
+	return -ENOENT;
+}
+
+int ext4fs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+		 loff_t *actread)
+{
+	return ext4fs_read_file(file->priv, offset, len, buf, actread);
+}
+
+void ext4fs_closefile(struct fs_file *file)
+{
+	ext4fs_free_node(file->priv, &ext4fs_root->diropen);
+}
+
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 struct disk_partition *fs_partition)
 {
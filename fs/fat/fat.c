@@ -12,6 +12,7 @@
 
 #include <blk.h>
 #include <config.h>
+#include <div64.h>
 #include <exports.h>
 #include <fat.h>
 #include <fs.h>
@@ -45,6 +46,8 @@ static void downcase(char *str, size_t len)
 static struct blk_desc *cur_dev;
 static struct disk_partition cur_part_info;
 
+static void fat_cache_drop(void);
+
 #define DOS_BOOT_MAGIC_OFFSET	0x1fe
 #define DOS_FS_TYPE_OFFSET	0x36
 #define DOS_FS32_TYPE_OFFSET	0x52
@@ -68,6 +71,10 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, struct disk_partition *info)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, buffer, dev_desc->blksz);
 
+	/* Nothing cached about the previous volume applies to this one */
+	if (dev_desc != cur_dev || info->start != cur_part_info.start)
+		fat_cache_drop();
+
 	cur_dev = dev_desc;
 	cur_part_info = *info;
 
@@ -161,6 +168,415 @@ int flush_dirty_fat_buffer(fsdata *mydata)
 }
 #endif
 
+/**
+ * struct fat_extent - run of consecutive clusters in a file
+ *
+ * @idx:	index of the first cluster within the file
+ * @clust:	first cluster on the disk
+ * @len:	number of clusters
+ */
+struct fat_extent {
+	__u32 idx;
+	__u32 clust;
+	__u32 len;
+};
+
+/**
+ * struct fat_chain - map of (part of) the cluster chain of a file
+ *
+ * The map is built by following the chain through the FAT as far as a read
+ * needs it. Clusters before @base have been forgotten, because the extent
+ * list ran out of room; going back to them means starting from the first
+ * cluster again.
+ *
+ * @start:	first cluster of the file, 0 if not in use
+ * @base:	index of the first cluster covered by @ext
+ * @mapped:	index of the first cluster not covered by @ext
+ * @next:	FAT entry of the last cluster covered, i.e. the next cluster
+ * @nr_ext:	number of extents in @ext
+ * @max_ext:	number of extents allocated in @ext, at least 2
+ * @ext:	extents, in file order
+ * @cached:	true if this is held in the FAT cache, so @ext may grow
+ * @stamp:	time of last use, for picking a chain to evict
+ */
+struct fat_chain {
+	__u32 start;
+	__u32 base;
+	__u32 mapped;
+	__u32 next;
+	uint nr_ext;
+	uint max_ext;
+	struct fat_extent *ext;
+	bool cached;
+	ulong stamp;
+};
+
+/* Largest extent list kept for a cached chain */
+#define FAT_CHAIN_MAX_EXTENTS	1024
+
+static void fat_chain_reset(struct fat_chain *chain)
+{
+	chain->base = 0;
+	chain->mapped = 0;
+	chain->next = chain->start;
+	chain->nr_ext = 0;
+}
+
+#if CONFIG_IS_ENABLED(FS_FAT_CACHE)
+/*
+ * Each call into the filesystem sets up a fresh fsdata, so what is worth
+ * keeping between calls lives here instead. It belongs to the device and
+ * partition it was filled from, and is dropped as soon as anything writes
+ * to that device.
+ */
+
+/* Number of FATBUFSIZE buffers held in each cached window */
+#define FAT_CACHE_WINDOW_BUFS	16
+#define FAT_CACHE_WINDOW_BLOCKS	(FAT_CACHE_WINDOW_BUFS * FATBUFBLOCKS)
+
+/**
+ * struct fat_cache_window - a window of the FAT
+ *
+ * @num:	window number, counting in FAT_CACHE_WINDOW_BLOCKS sectors
+ *		from the start of the FAT, or -1 if not in use
+ * @stamp:	time of last use, for picking a window to evict
+ * @buf:	contents of the window
+ */
+struct fat_cache_window {
+	int num;
+	ulong stamp;
+	__u8 *buf;
+};
+
+/* Longest path component held in the directory-entry cache */
+#define FAT_DCACHE_NAME_LEN	64
+
+/**
+ * struct fat_dcache_entry - result of looking up a name in a directory
+ *
+ * @parent:	first cluster of the directory which was searched
+ * @hash:	hash of @parent and @name, see fat_dcache_hash()
+ * @found:	true if the name exists, false if it was not found
+ * @stamp:	time of last use, for picking an entry to evict, 0 if unused
+ * @name:	name that was looked up, as given by the caller
+ * @dent:	directory entry found, if @found
+ */
+struct fat_dcache_entry {
+	__u32 parent;
+	__u32 hash;
+	bool found;
+	ulong stamp;
+	char name[FAT_DCACHE_NAME_LEN];
+	dir_entry dent;
+};
+
+static struct {
+	struct blk_desc *dev;
+	lbaint_t part_start;
+	ulong write_seq;
+	ulong clock;
+	bool used;
+	struct fat_cache_window win[CONFIG_FS_FAT_CACHE_WINDOWS];
+	struct fat_chain chain[CONFIG_FS_FAT_CACHE_FILES];
+	struct fat_dcache_entry dcache[CONFIG_FS_FAT_CACHE_DENTRIES];
+} fat_cache;
+
+/* Forget everything cached about the current volume */
+static void fat_cache_drop(void)
+{
+	int i;
+
+	if (!fat_cache.used)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(fat_cache.win); i++) {
+		free(fat_cache.win[i].buf);
+		fat_cache.win[i].buf = NULL;
+		fat_cache.win[i].num = -1;
+	}
+	for (i = 0; i < ARRAY_SIZE(fat_cache.chain); i++) {
+		free(fat_cache.chain[i].ext);
+		fat_cache.chain[i].ext = NULL;
+		fat_cache.chain[i].start = 0;
+	}
+	for (i = 0; i < ARRAY_SIZE(fat_cache.dcache); i++)
+		fat_cache.dcache[i].stamp = 0;
+	fat_cache.used = false;
+}
+
+/*
+ * Check that the cache still describes the current volume, dropping it if
+ * not. Return true if it can be used.
+ */
+static bool fat_cache_valid(void)
+{
+	ulong seq;
+
+	if (!cur_dev || !cur_dev->bdev)
+		return false;
+
+	seq = blk_get_write_seq(cur_dev->bdev);
+	if (fat_cache.dev != cur_dev ||
+	    fat_cache.part_start != cur_part_info.start ||
+	    fat_cache.write_seq != seq) {
+		fat_cache_drop();
+		fat_cache.dev = cur_dev;
+		fat_cache.part_start = cur_part_info.start;
+		fat_cache.write_seq = seq;
+	}
+	fat_cache.used = true;
+	fat_cache.clock++;
+
+	return true;
+}
+
+static struct fat_cache_window *fat_cache_get_window(fsdata *mydata, int num)
+{
+	struct fat_cache_window *win, *victim = NULL;
+	__u32 startblock, getsize;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(fat_cache.win); i++) {
+		win = &fat_cache.win[i];
+		if (!win->buf || win->num == -1) {
+			if (!victim || victim->num != -1)
+				victim = win;
+			continue;
+		}
+		if (win->num == num) {
+			win->stamp = fat_cache.clock;
+			return win;
+		}
+		if (!victim || (victim->num != -1 && win->stamp < victim->stamp))
+			victim = win;
+	}
+
+	win = victim;
+	if (!win->buf) {
+		win->buf = malloc_cache_aligned(FAT_CACHE_WINDOW_BUFS *
+						FATBUFSIZE);
+		if (!win->buf)
+			return NULL;
+	}
+
+	startblock = num * FAT_CACHE_WINDOW_BLOCKS;
+	getsize = min_t(__u32, FAT_CACHE_WINDOW_BLOCKS,
+			mydata->fatlength - startblock);
+	win->num = -1;
+	if (disk_read(mydata->fat_sect + startblock, getsize, win->buf) < 0)
+		return NULL;
+	win->num = num;
+	win->stamp = fat_cache.clock;
+
+	return win;
+}
+
+/*
+ * Read 'getsize' sectors of the FAT, starting from 'startblock' within it,
+ * through the window cache. The range must not cross a window boundary.
+ */
+static int fat_cache_read_fat(fsdata *mydata, __u32 startblock,
+			      __u32 getsize, __u8 *buf)
+{
+	struct fat_cache_window *win = NULL;
+
+	if (fat_cache_valid())
+		win = fat_cache_get_window(mydata,
+					   startblock / FAT_CACHE_WINDOW_BLOCKS);
+	if (!win)
+		return disk_read(mydata->fat_sect + startblock, getsize, buf);
+
+	memcpy(buf, win->buf + (startblock % FAT_CACHE_WINDOW_BLOCKS) *
+	       mydata->sect_size, getsize * mydata->sect_size);
+
+	return getsize;
+}
+
+/* Find the cached chain of the file starting at 'start', or make room */
+static struct fat_chain *fat_cache_get_chain(fsdata *mydata, __u32 start)
+{
+	struct fat_chain *chain, *victim = NULL;
+	int i;
+
+	if (CHECK_CLUST(start, mydata->fatsize) || !fat_cache_valid())
+		return NULL;
+
+	for (i = 0; i < ARRAY_SIZE(fat_cache.chain); i++) {
+		chain = &fat_cache.chain[i];
+		if (chain->start == start) {
+			chain->stamp = fat_cache.clock;
+			return chain;
+		}
+		if (!victim || !chain->start ||
+		    (victim->start && chain->stamp < victim->stamp))
+			victim = chain;
+	}
+
+	chain = victim;
+	if (!chain->ext) {
+		chain->ext = malloc(16 * sizeof(*chain->ext));
+		if (!chain->ext)
+			return NULL;
+		chain->max_ext = 16;
+	}
+	chain->start = start;
+	chain->cached = true;
+	chain->stamp = fat_cache.clock;
+	fat_chain_reset(chain);
+
+	return chain;
+}
+
+static int fat_chain_grow(struct fat_chain *chain)
+{
+	struct fat_extent *ext;
+	uint max = chain->max_ext * 2;
+
+	if (!chain->cached || max > FAT_CHAIN_MAX_EXTENTS)
+		return -ENOSPC;
+
+	ext = realloc(chain->ext, max * sizeof(*ext));
+	if (!ext)
+		return -ENOMEM;
+	chain->ext = ext;
+	chain->max_ext = max;
+
+	return 0;
+}
+
+/* Names are matched without regard to case, so hash them the same way */
+static __u32 fat_dcache_hash(__u32 parent, const char *name, int len)
+{
+	__u32 hash = parent;
+
+	while (len--)
+		hash = hash * 31 + tolower(*name++);
+
+	return hash;
+}
+
+/*
+ * Look up 'name' (of length 'len') in the directory starting at cluster
+ * 'parent'. Return the cached result, or NULL if the directory has to be
+ * searched.
+ */
+static struct fat_dcache_entry *fat_dcache_find(__u32 parent,
+						const char *name, int len)
+{
+	struct fat_dcache_entry *entry;
+	__u32 hash;
+	int i;
+
+	if (len >= FAT_DCACHE_NAME_LEN || !fat_cache_valid())
+		return NULL;
+
+	hash = fat_dcache_hash(parent, name, len);
+	for (i = 0; i < ARRAY_SIZE(fat_cache.dcache); i++) {
+		entry = &fat_cache.dcache[i];
+		if (entry->stamp && entry->hash == hash &&
+		    entry->parent == parent && !entry->name[len] &&
+		    !strncasecmp(entry->name, name, len)) {
+			entry->stamp = fat_cache.clock;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Record the result of searching the directory starting at cluster 'parent'
+ * for 'name'. 'dent' is the entry found, or NULL if there is none.
+ */
+static void fat_dcache_add(__u32 parent, const char *name, int len,
+			   const dir_entry *dent)
+{
+	struct fat_dcache_entry *entry, *victim = NULL;
+	int i;
+
+	if (len >= FAT_DCACHE_NAME_LEN || !fat_cache_valid())
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(fat_cache.dcache); i++) {
+		entry = &fat_cache.dcache[i];
+		if (!victim || entry->stamp < victim->stamp)
+			victim = entry;
+	}
+
+	entry = victim;
+	entry->parent = parent;
+	entry->hash = fat_dcache_hash(parent, name, len);
+	memcpy(entry->name, name, len);
+	entry->name[len] = '\0';
+	entry->found = dent;
+	if (dent)
+		entry->dent = *dent;
+	entry->stamp = fat_cache.clock;
+}
+#else
+static void fat_cache_drop(void)
+{
+}
+
+static inline int fat_cache_read_fat(fsdata *mydata, __u32 startblock,
+				     __u32 getsize, __u8 *buf)
+{
+	return disk_read(mydata->fat_sect + startblock, getsize, buf);
+}
+
+static inline struct fat_chain *fat_cache_get_chain(fsdata *mydata,
+						    __u32 start)
+{
+	return NULL;
+}
+
+static inline int fat_chain_grow(struct fat_chain *chain)
+{
+	return -ENOSPC;
+}
+
+struct fat_dcache_entry {
+	bool found;
+	dir_entry dent;
+};
+
+static inline struct fat_dcache_entry *fat_dcache_find(__u32 parent,
+						       const char *name,
+						       int len)
+{
+	return NULL;
+}
+
+static inline void fat_dcache_add(__u32 parent, const char *name, int len,
+				  const dir_entry *dent)
+{
+}
+#endif
+
+/*
+ * Read FATBUFSIZE window 'bufnum' of the FAT into mydata->fatbuf. The
+ * caller must have written back any changes to the previous window.
+ */
+static int fat_read_fatbuf(fsdata *mydata, __u32 bufnum)
+{
+	__u32 getsize = FATBUFBLOCKS;
+	__u32 fatlength = mydata->fatlength;
+	__u32 startblock = bufnum * FATBUFBLOCKS;
+
+	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+	if (startblock + getsize > fatlength)
+		getsize = fatlength - startblock;
+
+	if (fat_cache_read_fat(mydata, startblock, getsize,
+			       mydata->fatbuf) < 0) {
+		debug("Error reading FAT blocks\n");
+		return -1;
+	}
+	mydata->fatbufnum = bufnum;
+
+	return 0;
+}
+
 /*
  * Get the entry at index 'entry' in a FAT (12/16/32) table.
  * On failure 0x00 is returned.
@@ -200,26 +616,12 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 
 	/* Read a new block of FAT entries into the cache. */
 	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
-
 		/* Write back the fatbuf to the disk */
 		if (flush_dirty_fat_buffer(mydata) < 0)
 			return -1;
 
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
+		if (fat_read_fatbuf(mydata, bufnum) < 0)
 			return ret;
-		}
-		mydata->fatbufnum = bufnum;
 	}
 
 	/* Get the actual entry from the table */
@@ -308,6 +710,89 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/*
+ * Add the next cluster of the chain to the map. Return 0 on success, -1 if
+ * the chain ends or is broken.
+ */
+static int fat_chain_extend(fsdata *mydata, struct fat_chain *chain)
+{
+	__u32 clust = chain->next;
+	struct fat_extent *ext = NULL;
+
+	if (CHECK_CLUST(clust, mydata->fatsize)) {
+		debug("curclust: 0x%x\n", clust);
+		printf("Invalid FAT entry\n");
+		return -1;
+	}
+
+	if (chain->nr_ext)
+		ext = &chain->ext[chain->nr_ext - 1];
+	if (ext && ext->clust + ext->len == clust) {
+		ext->len++;
+	} else {
+		if (chain->nr_ext == chain->max_ext && fat_chain_grow(chain)) {
+			/* Out of room, keep only the last extent */
+			chain->ext[0] = *ext;
+			chain->base = ext->idx;
+			chain->nr_ext = 1;
+		}
+		ext = &chain->ext[chain->nr_ext++];
+		ext->idx = chain->mapped;
+		ext->clust = clust;
+		ext->len = 1;
+	}
+	chain->mapped++;
+	chain->next = get_fatent(mydata, clust);
+
+	return 0;
+}
+
+/*
+ * Find cluster 'idx' of a file, and how many clusters follow it on the
+ * disk. The map is extended as far as needed, but the run is only followed
+ * up to 'want' clusters.
+ */
+static int fat_chain_lookup(fsdata *mydata, struct fat_chain *chain,
+			    __u32 idx, __u32 want, __u32 *clustp, __u32 *lenp)
+{
+	struct fat_extent *ext;
+	uint lo, hi;
+
+	/* The map only goes forward, start again to go back */
+	if (idx < chain->base)
+		fat_chain_reset(chain);
+
+	while (chain->mapped <= idx) {
+		if (fat_chain_extend(mydata, chain))
+			return -1;
+	}
+
+	/* Grow the last run while it stays consecutive */
+	ext = &chain->ext[chain->nr_ext - 1];
+	while (idx >= ext->idx && chain->mapped < idx + want &&
+	       chain->next == ext->clust + ext->len &&
+	       !CHECK_CLUST(chain->next, mydata->fatsize)) {
+		if (fat_chain_extend(mydata, chain))
+			return -1;
+	}
+
+	lo = 0;
+	hi = chain->nr_ext;
+	while (hi - lo > 1) {
+		uint mid = (lo + hi) / 2;
+
+		if (chain->ext[mid].idx <= idx)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	ext = &chain->ext[lo];
+	*clustp = ext->clust + idx - ext->idx;
+	*lenp = min(ext->len - (idx - ext->idx), want);
+
+	return 0;
+}
+
 /**
  * get_contents() - read from file
  *
@@ -315,6 +800,10 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
  * into 'buffer'. Update the number of bytes read in *gotsize or return -1 on
  * fatal errors.
  *
+ * The cluster chain is looked up as a list of extents, which is kept in the
+ * FAT cache if enabled, so that each run of consecutive clusters is read in
+ * one go and repeated reads of a file do not walk the FAT again.
+ *
  * @mydata:	file system description
  * @dentprt:	directory entry pointer
  * @pos:	position from where to read
@@ -328,8 +817,9 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	struct fat_extent local_ext[2];
+	struct fat_chain local, *chain;
+	__u32 idx, clust, len;
 	loff_t actsize;
 
 	*gotsize = 0;
@@ -345,21 +835,19 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
-
-	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize += bytesperclust;
+	chain = fat_cache_get_chain(mydata, START(dentptr));
+	if (!chain) {
+		chain = &local;
+		chain->start = START(dentptr);
+		chain->max_ext = ARRAY_SIZE(local_ext);
+		chain->ext = local_ext;
+		chain->cached = false;
+		fat_chain_reset(chain);
 	}
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
+	/* go to cluster at pos */
+	idx = lldiv(pos, bytesperclust);
+	actsize = (loff_t)idx * bytesperclust;
 	filesize -= actsize;
 	pos -= actsize;
 
@@ -367,6 +855,9 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 	if (pos) {
 		__u8 *tmp_buffer;
 
+		if (fat_chain_lookup(mydata, chain, idx, 1, &clust, &len))
+			return -1;
+
 		actsize = min(filesize, (loff_t)bytesperclust);
 		tmp_buffer = malloc_cache_aligned(actsize);
 		if (!tmp_buffer) {
@@ -374,7 +865,7 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 			return -1;
 		}
 
-		if (get_cluster(mydata, curclust, tmp_buffer, actsize) != 0) {
+		if (get_cluster(mydata, clust, tmp_buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			free(tmp_buffer);
 			return -1;
@@ -384,62 +875,29 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 		memcpy(buffer, tmp_buffer + pos, actsize);
 		free(tmp_buffer);
 		*gotsize += actsize;
-		if (!filesize)
-			return 0;
 		buffer += actsize;
-
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
+		idx++;
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
+	/* read a run of consecutive clusters at a time */
+	while (filesize) {
+		__u32 want = lldiv(filesize + bytesperclust - 1, bytesperclust);
 
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
-				return -1;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
-		}
+		if (fat_chain_lookup(mydata, chain, idx, want, &clust, &len))
+			return -1;
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		actsize = min(filesize, (loff_t)len * bytesperclust);
+		if (get_cluster(mydata, clust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
+		idx += len;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -1099,6 +1557,53 @@ static int fat_itr_isdir(fat_itr *itr)
 #define TYPE_DIR  0x2
 #define TYPE_ANY  (TYPE_FILE | TYPE_DIR)
 
+static int fat_itr_resolve(fat_itr *itr, const char *path, unsigned type);
+
+/**
+ * fat_itr_resolve_cached() - continue resolving a path from a cached entry
+ *
+ * This does what fat_itr_resolve() does once it has found the entry for a
+ * path component, without searching the directory. If the path ends at a
+ * file, the iterator holds a copy of the file's directory entry in its
+ * block buffer: itr->dent can be used but the iterator cannot be stepped
+ * any further.
+ *
+ * @itr: iterator at the start of the directory holding the entry
+ * @entry: cached result of looking up the path component
+ * @next: rest of the path after this component
+ * @type: bitmask of allowable file types
+ * Return: 0 on success or -errno
+ */
+static int fat_itr_resolve_cached(fat_itr *itr, struct fat_dcache_entry *entry,
+				  const char *next, unsigned type)
+{
+	if (!entry->found)
+		return -ENOENT;
+
+	memcpy(itr->block, &entry->dent, sizeof(entry->dent));
+	itr->dent = (dir_entry *)itr->block;
+
+	if (fat_itr_isdir(itr)) {
+		fat_itr_child(itr, itr);
+		return fat_itr_resolve(itr, next, type);
+	} else if (next[0]) {
+		debug("bad trailing path: %s\n", next);
+		return -ENOENT;
+	} else if (!(type & TYPE_FILE)) {
+		return -ENOTDIR;
+	}
+
+	itr->remaining = 0;
+	itr->last_cluster = 1;
+	itr->dent_start = itr->dent;
+	itr->dent_rem = 0;
+	itr->dent_clust = itr->clust;
+	get_name(itr->dent, itr->s_name);
+	itr->name = itr->s_name;
+
+	return 0;
+}
+
 /**
  * fat_itr_resolve() - traverse directory structure to resolve the
  * requested path.
@@ -1116,6 +1621,8 @@ static int fat_itr_isdir(fat_itr *itr)
  */
 static int fat_itr_resolve(fat_itr *itr, const char *path, unsigned type)
 {
+	struct fat_dcache_entry *entry;
+	unsigned int parent;
 	const char *next;
 
 	/* chomp any extra leading slashes: */
@@ -1157,6 +1664,12 @@ static int fat_itr_resolve(fat_itr *itr, const char *path, unsigned type)
 		}
 	}
 
+	/* try the directory-entry cache before searching the directory */
+	parent = itr->start_clust;
+	entry = fat_dcache_find(parent, path, next - path);
+	if (entry)
+		return fat_itr_resolve_cached(itr, entry, next, type);
+
 	while (fat_itr_next(itr)) {
 		int match = 0;
 		unsigned n = max(strlen(itr->name), (size_t)(next - path));
@@ -1171,6 +1684,8 @@ static int fat_itr_resolve(fat_itr *itr, const char *path, unsigned type)
 		if (!match)
 			continue;
 
+		fat_dcache_add(parent, path, next - path, itr->dent);
+
 		if (fat_itr_isdir(itr)) {
 			/* recurse into directory: */
 			fat_itr_child(itr, itr);
@@ -1189,6 +1704,10 @@ static int fat_itr_resolve(fat_itr *itr, const char *path, unsigned type)
 		}
 	}
 
+	/* only remember a miss if the whole directory could be read */
+	if (itr->dent || itr->last_cluster)
+		fat_dcache_add(parent, path, next - path, NULL);
+
 	return -ENOENT;
 }
 
@@ -1334,6 +1853,75 @@ out_free_itr:
 	return ret;
 }
 
+/**
+ * struct fat_file - FAT state for a file opened with fs_open()
+ *
+ * @fsdata:	filesystem data, which keeps its FAT buffer between reads
+ * @dent:	directory entry of the file
+ */
+struct fat_file {
+	fsdata fsdata;
+	dir_entry dent;
+};
+
+int fat_open(struct fs_file *file)
+{
+	struct fat_file *ff;
+	fat_itr *itr;
+	int ret;
+
+	ff = calloc(1, sizeof(*ff));
+	itr = malloc_cache_aligned(sizeof(fat_itr));
+	if (!ff || !itr) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+	ret = fat_itr_root(itr, &ff->fsdata);
+	if (ret)
+		goto out_free;
+
+	ret = fat_itr_resolve(itr, file->name, TYPE_FILE);
+	if (ret) {
+		free(ff->fsdata.fatbuf);
+		goto out_free;
+	}
+	ff->dent = *itr->dent;
+	file->size = FAT2CPU32(ff->dent.size);
+	file->priv = ff;
+	free(itr);
+
+	return 0;
+
+out_free:
+	free(itr);
+	free(ff);
+	return ret;
+}
+
+int fat_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+	      loff_t *actread)
+{
+	struct fat_file *ff = file->priv;
+
+	return get_contents(&ff->fsdata, &ff->dent, offset, buf, len, actread);
+}
+
+void fat_closefile(struct fs_file *file)
+{
+	struct fat_file *ff = file->priv;
+
+	free(ff->fsdata.fatbuf);
+	free(ff);
+}
+
+void fat_forget(struct blk_desc *desc)
+{
+	if (desc != cur_dev)
+		return;
+	fat_cache_drop();
+	cur_dev = NULL;
+}
+
 int file_fat_read(const char *filename, void *buffer, int maxsize)
 {
 	loff_t actread;
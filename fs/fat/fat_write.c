@@ -463,29 +463,16 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 
 	/* Read a new block of FAT entries into the cache. */
 	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
 		if (flush_dirty_fat_buffer(mydata) < 0)
 			return -1;
 
-		startblock += mydata->fat_sect;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
+		if (fat_read_fatbuf(mydata, bufnum) < 0)
 			return -1;
-		}
-		mydata->fatbufnum = bufnum;
 	}
 
-	/* Mark as dirty */
+	/* Mark as dirty, anything cached about the FAT is now stale */
 	mydata->fat_dirty = 1;
+	fat_cache_drop();
 
 	/* Set the actual entry */
 	switch (mydata->fatsize) {
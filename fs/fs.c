@@ -13,6 +13,7 @@
 #include <lmb.h>
 #include <log.h>
 #include <malloc.h>
+#include <malloc_arena.h>
 #include <mapmem.h>
 #include <part.h>
 #include <ext4fs.h>
@@ -41,8 +42,50 @@ static int fs_dev_part;
 static struct disk_partition fs_partition;
 static int fs_type = FS_TYPE_ANY;
 
+/**
+ * struct fs_mount - A filesystem in the mount table
+ *
+ * Filesystem drivers only handle one filesystem at a time, so only the active
+ * mount has its driver state set up. Other mounts remember which driver to
+ * use, so that activating them only needs one probe.
+ *
+ * @desc:	block device, or NULL for a virtual filesystem
+ * @part:	partition number, or 0 for the whole device
+ * @info:	partition information
+ * @fs:		filesystem driver
+ * @refcount:	number of fs_mount() calls and open files using the mount
+ * @seq:	activation sequence number, used to tell whether the driver
+ *		state of an open file is still valid
+ * @files:	list of open files, see struct fs_file
+ * @removed:	true if the block device has gone, so the mount cannot be used
+ * @free_files:	list of closed files whose handles can be reused
+ * @arena:	arena holding the file handles, or NULL if none, released when
+ *		the mount is removed
+ * @sibling:	node in the mount table
+ */
+struct fs_mount {
+	struct blk_desc *desc;
+	int part;
+	struct disk_partition info;
+	struct fstype_info *fs;
+	int refcount;
+	uint seq;
+	struct list_head files;
+	bool removed;
+	struct list_head free_files;
+	struct malloc_arena *arena;
+	struct list_head sibling;
+};
+
+static LIST_HEAD(fs_mounts);
+static struct fs_mount *fs_active_mnt;
+static uint fs_mount_seq;
+
+static void fs_mount_deactivate(void);
+
 void fs_set_type(int type)
 {
+	fs_mount_deactivate();
 	fs_type = type;
 }
 
@@ -191,6 +234,25 @@ struct fstype_info {
 	int (*mkdir)(const char *dirname);
 	int (*ln)(const char *filename, const char *target);
 	int (*rename)(const char *old_path, const char *new_path);
+	/*
+	 * Resolve file->name, set file->size and set up file->priv for use
+	 * by pread(). On error return -errno. This is optional: without it
+	 * the fs layer uses size() and read() with the path. See fs_open().
+	 */
+	int (*open)(struct fs_file *file);
+	/*
+	 * Read from a file set up by open(). The range to read is never
+	 * empty and lies within the file. See fs_pread().
+	 */
+	int (*pread)(struct fs_file *file, void *buf, loff_t offset,
+		     loff_t len, loff_t *actread);
+	/* Release file->priv, as set up by open() */
+	void (*closefile)(struct fs_file *file);
+	/*
+	 * Drop anything kept between calls about a block device which is
+	 * being removed. This is optional. See fs_umount_blk().
+	 */
+	void (*forget)(struct blk_desc *desc);
 };
 
 static struct fstype_info fstypes[] = {
@@ -224,6 +286,10 @@ static struct fstype_info fstypes[] = {
 #else
 		.rename = fs_rename_unsupported,
 #endif
+		.open = fat_open,
+		.pread = fat_pread,
+		.closefile = fat_closefile,
+		.forget = fat_forget,
 	},
 #endif
 
@@ -252,6 +318,9 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.rename = fs_rename_unsupported,
+		.open = ext4fs_open_file,
+		.pread = ext4fs_pread,
+		.closefile = ext4fs_closefile,
 	},
 #endif
 #if IS_ENABLED(CONFIG_SANDBOX) && !IS_ENABLED(CONFIG_XPL_BUILD)
@@ -335,6 +404,9 @@ static struct fstype_info fstypes[] = {
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
 		.rename = fs_rename_unsupported,
+		.open = btrfs_open,
+		.pread = btrfs_pread,
+		.closefile = btrfs_closefile,
 	},
 #endif
 #endif
@@ -358,6 +430,10 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.rename = fs_rename_unsupported,
+		.open = sqfs_open,
+		.pread = sqfs_pread,
+		.closefile = sqfs_closefile,
+		.forget = sqfs_forget,
 	},
 #endif
 #if IS_ENABLED(CONFIG_FS_EROFS)
@@ -380,6 +456,9 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.rename = fs_rename_unsupported,
+		.open = erofs_open_file,
+		.pread = erofs_pread_file,
+		.closefile = erofs_closefile,
 	},
 #endif
 #if IS_ENABLED(CONFIG_FS_EXFAT)
@@ -469,6 +548,7 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	struct fstype_info *info;
 	int part, i;
 
+	fs_mount_deactivate();
 	part = part_get_info_by_dev_and_name_or_num(ifname, dev_part_str, &fs_dev_desc,
 						    &fs_partition, 1);
 	if (part < 0)
@@ -498,6 +578,7 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 	struct fstype_info *info;
 	int ret, i;
 
+	fs_mount_deactivate();
 	if (part >= 1)
 		ret = part_get_info(desc, part, &fs_partition);
 	else
@@ -526,6 +607,320 @@ void fs_close(void)
 	fs_type = FS_TYPE_ANY;
 }
 
+/* Release the driver state of the active mount, if any */
+static void fs_mount_deactivate(void)
+{
+	struct fs_mount *mnt = fs_active_mnt;
+	struct fs_file *file;
+
+	if (!mnt)
+		return;
+
+	list_for_each_entry(file, &mnt->files, sibling) {
+		if (file->seq != mnt->seq)
+			continue;
+		if (mnt->fs->closefile)
+			mnt->fs->closefile(file);
+		file->priv = NULL;
+		file->seq = 0;
+	}
+	mnt->fs->close();
+	fs_active_mnt = NULL;
+}
+
+/* Set up the driver state for a mount, so its files can be accessed */
+static int fs_mount_activate(struct fs_mount *mnt)
+{
+	if (fs_active_mnt == mnt)
+		return 0;
+	if (mnt->removed)
+		return log_msg_ret("rem", -ENODEV);
+
+	fs_mount_deactivate();
+
+	/* Drop anything set up by fs_set_blk_dev() */
+	if (fs_type != FS_TYPE_ANY)
+		fs_close();
+
+	if (mnt->fs->probe(mnt->desc, &mnt->info))
+		return log_msg_ret("act", -EIO);
+	mnt->seq = ++fs_mount_seq;
+	fs_active_mnt = mnt;
+
+	return 0;
+}
+
+int fs_mount(struct blk_desc *desc, int part, struct fs_mount **mntp)
+{
+	struct fstype_info *info;
+	struct fs_mount *mnt;
+	int ret, i;
+
+	list_for_each_entry(mnt, &fs_mounts, sibling) {
+		if (mnt->desc == desc && mnt->part == part) {
+			mnt->refcount++;
+			*mntp = mnt;
+			return 0;
+		}
+	}
+
+	mnt = calloc(1, sizeof(*mnt));
+	if (!mnt)
+		return log_msg_ret("mnt", -ENOMEM);
+	mnt->desc = desc;
+	mnt->part = part;
+	INIT_LIST_HEAD(&mnt->files);
+	INIT_LIST_HEAD(&mnt->free_files);
+	if (desc) {
+		if (part >= 1)
+			ret = part_get_info(desc, part, &mnt->info);
+		else
+			ret = part_get_info_whole_disk(desc, &mnt->info);
+		if (ret) {
+			free(mnt);
+			return log_msg_ret("prt", -ENOENT);
+		}
+	}
+
+	fs_mount_deactivate();
+	if (fs_type != FS_TYPE_ANY)
+		fs_close();
+
+	/* Skip the 'unsupported' sentinel */
+	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes) - 1; i++, info++) {
+		if (!desc && !info->null_dev_desc_ok)
+			continue;
+		if (!info->probe(desc, &mnt->info))
+			break;
+	}
+	if (i == ARRAY_SIZE(fstypes) - 1) {
+		free(mnt);
+		return log_msg_ret("typ", -EPROTONOSUPPORT);
+	}
+	log_debug("Mounted %s filesystem, part %d\n", info->name, part);
+
+	mnt->fs = info;
+	mnt->refcount = 1;
+	mnt->seq = ++fs_mount_seq;
+	fs_active_mnt = mnt;
+	list_add_tail(&mnt->sibling, &fs_mounts);
+	*mntp = mnt;
+
+	return 0;
+}
+
+void fs_umount(struct fs_mount *mnt)
+{
+	if (--mnt->refcount)
+		return;
+
+	if (fs_active_mnt == mnt)
+		fs_mount_deactivate();
+	list_del(&mnt->sibling);
+	if (CONFIG_IS_ENABLED(MALLOC_ARENA))
+		malloc_arena_destroy(mnt->arena);
+	free(mnt);
+}
+
+void fs_umount_blk(struct blk_desc *desc)
+{
+	struct fs_mount *mnt, *next;
+	struct fstype_info *info;
+	int i;
+
+	if (fs_type != FS_TYPE_ANY && fs_dev_desc == desc)
+		fs_close();
+
+	list_for_each_entry_safe(mnt, next, &fs_mounts, sibling) {
+		if (mnt->desc != desc)
+			continue;
+		if (fs_active_mnt == mnt)
+			fs_mount_deactivate();
+
+		/* Open files hold the mount until they are closed */
+		list_del_init(&mnt->sibling);
+		mnt->desc = NULL;
+		mnt->removed = true;
+	}
+
+	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
+		if (info->forget)
+			info->forget(desc);
+	}
+}
+
+int fs_mount_get_type(struct fs_mount *mnt)
+{
+	return mnt->fs->fstype;
+}
+
+/* Set up the driver state for a file on the active mount */
+static int fs_file_setup(struct fs_file *file)
+{
+	struct fs_mount *mnt = file->mnt;
+	int ret;
+
+	if (mnt->fs->open) {
+		ret = mnt->fs->open(file);
+		if (ret)
+			return ret;
+	} else {
+		struct fs_dir_stream *dirs;
+
+		/* Only regular files can be opened */
+		if (!mnt->fs->opendir(file->name, &dirs)) {
+			mnt->fs->closedir(dirs);
+			return -EISDIR;
+		}
+		if (mnt->fs->size(file->name, &file->size))
+			return -ENOENT;
+	}
+	file->seq = mnt->seq;
+
+	return 0;
+}
+
+/* Get a file handle, reusing one from a closed file if possible */
+static struct fs_file *fs_file_alloc(struct fs_mount *mnt)
+{
+	struct fs_file *file;
+
+	if (!CONFIG_IS_ENABLED(MALLOC_ARENA))
+		return calloc(1, sizeof(*file));
+
+	file = list_first_entry_or_null(&mnt->free_files, struct fs_file,
+					sibling);
+	if (file) {
+		list_del(&file->sibling);
+		memset(file, '\0', sizeof(*file));
+		return file;
+	}
+	if (!mnt->arena) {
+		mnt->arena = malloc_arena_create("fs_mount");
+		if (!mnt->arena)
+			return NULL;
+	}
+
+	return malloc_arena_zalloc(mnt->arena, sizeof(*file));
+}
+
+static void fs_file_free(struct fs_file *file)
+{
+	free(file->name);
+	if (CONFIG_IS_ENABLED(MALLOC_ARENA))
+		list_add(&file->sibling, &file->mnt->free_files);
+	else
+		free(file);
+}
+
+int fs_open(struct fs_mount *mnt, const char *filename,
+	    struct fs_file **filep)
+{
+	struct fs_file *file;
+	int ret;
+
+	file = fs_file_alloc(mnt);
+	if (!file)
+		return log_msg_ret("fil", -ENOMEM);
+	file->mnt = mnt;
+	file->name = strdup(filename);
+	if (!file->name) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	ret = fs_mount_activate(mnt);
+	if (ret)
+		goto err;
+	ret = fs_file_setup(file);
+	if (ret)
+		goto err;
+
+	mnt->refcount++;
+	list_add_tail(&file->sibling, &mnt->files);
+	*filep = file;
+
+	return 0;
+
+err:
+	fs_file_free(file);
+	return ret;
+}
+
+/* Make sure that a file's driver state is set up, reopening it if needed */
+static int fs_file_prepare(struct fs_file *file)
+{
+	struct fs_mount *mnt = file->mnt;
+	int ret;
+
+	ret = fs_mount_activate(mnt);
+	if (ret)
+		return ret;
+
+	/* The file was closed when something else was accessed */
+	if (file->seq != mnt->seq) {
+		ret = fs_file_setup(file);
+		if (ret)
+			return log_msg_ret("opn", ret);
+	}
+
+	return 0;
+}
+
+int fs_file_size(struct fs_file *file, loff_t *sizep)
+{
+	int ret;
+
+	ret = fs_file_prepare(file);
+	if (ret)
+		return ret;
+	*sizep = file->size;
+
+	return 0;
+}
+
+int fs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+	     loff_t *actread)
+{
+	struct fs_mount *mnt = file->mnt;
+	int ret;
+
+	*actread = 0;
+	ret = fs_file_prepare(file);
+	if (ret)
+		return ret;
+
+	if (offset >= file->size || !len)
+		return 0;
+	if (len > file->size - offset)
+		len = file->size - offset;
+
+	if (mnt->fs->pread)
+		ret = mnt->fs->pread(file, buf, offset, len, actread);
+	else
+		ret = mnt->fs->read(file->name, buf, offset, len, actread);
+	/* Some drivers return -1 on any error */
+	if (ret)
+		return log_msg_ret("rd", ret == -1 ? -EIO : ret);
+
+	return 0;
+}
+
+void fs_closefile(struct fs_file *file)
+{
+	struct fs_mount *mnt;
+
+	if (!file)
+		return;
+
+	mnt = file->mnt;
+	if (file->seq == mnt->seq && mnt->fs->closefile)
+		mnt->fs->closefile(file);
+	list_del(&file->sibling);
+	fs_file_free(file);
+	fs_umount(mnt);
+}
+
 int fs_uuid(char *uuid_str)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
@@ -8,6 +8,7 @@
  */
 
 #include <asm/unaligned.h>
+#include <blk.h>
 #include <div64.h>
 #include <errno.h>
 #include <fs.h>
@@ -98,6 +99,235 @@ static int sqfs_calc_n_blks(__le64 start, __le64 end, u64 *offset)
 	return DIV_ROUND_UP(table_size + *offset, ctxt.cur_dev->blksz);
 }
 
+/* Drop a reference to @tables, freeing them when the last one goes */
+static void sqfs_put_tables(struct sqfs_tables *tables)
+{
+	if (!tables || --tables->refs)
+		return;
+
+	free(tables->inode_table);
+	free(tables->dir_table);
+	free(tables->pos_list);
+	free(tables);
+}
+
+#if IS_ENABLED(CONFIG_FS_SQUASHFS_CACHE)
+/* Number of fragment blocks and fragment table blocks held in the cache */
+#define SQFS_CACHE_BLOCKS	16
+
+/**
+ * struct sqfs_cache_block - a block of the filesystem, as decompressed
+ *
+ * @start:	position of the block on the filesystem, 0 if unused
+ * @len:	number of bytes in @data
+ * @stamp:	time of last use, for picking a block to evict
+ * @data:	contents of the block
+ */
+struct sqfs_cache_block {
+	u64 start;
+	ulong len;
+	ulong stamp;
+	void *data;
+};
+
+/*
+ * The fs layer probes and closes the filesystem around every operation, so
+ * the cache lives on after sqfs_close() and is checked against the device
+ * and superblock in sqfs_probe(). Its total size, given by @size, stays
+ * within CONFIG_FS_SQUASHFS_CACHE_SIZE.
+ */
+static struct {
+	struct blk_desc *dev;
+	lbaint_t part_start;
+	ulong write_seq;
+	struct squashfs_super_block sblk;
+	ulong clock;
+	size_t size;
+	struct sqfs_tables *tables;
+	struct sqfs_cache_block blk[SQFS_CACHE_BLOCKS];
+} sqfs_cache;
+
+#define SQFS_CACHE_MAX_SIZE	(CONFIG_FS_SQUASHFS_CACHE_SIZE * 1024UL)
+
+static void sqfs_cache_evict(struct sqfs_cache_block *blk)
+{
+	sqfs_cache.size -= blk->len;
+	free(blk->data);
+	blk->data = NULL;
+	blk->start = 0;
+	blk->len = 0;
+}
+
+/* Forget everything cached about the filesystem */
+static void sqfs_cache_drop(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sqfs_cache.blk); i++) {
+		if (sqfs_cache.blk[i].start)
+			sqfs_cache_evict(&sqfs_cache.blk[i]);
+	}
+	sqfs_put_tables(sqfs_cache.tables);
+	sqfs_cache.tables = NULL;
+	sqfs_cache.size = 0;
+	sqfs_cache.dev = NULL;
+}
+
+/*
+ * Check that the cache still describes the filesystem just probed, dropping
+ * it if not.
+ */
+static void sqfs_cache_check(struct squashfs_super_block *sblk)
+{
+	ulong seq;
+
+	if (!ctxt.cur_dev->bdev) {
+		sqfs_cache_drop();
+		return;
+	}
+
+	seq = blk_get_write_seq(ctxt.cur_dev->bdev);
+	if (sqfs_cache.dev != ctxt.cur_dev ||
+	    sqfs_cache.part_start != ctxt.cur_part_info.start ||
+	    sqfs_cache.write_seq != seq ||
+	    memcmp(&sqfs_cache.sblk, sblk, sizeof(*sblk))) {
+		sqfs_cache_drop();
+		sqfs_cache.dev = ctxt.cur_dev;
+		sqfs_cache.part_start = ctxt.cur_part_info.start;
+		sqfs_cache.write_seq = seq;
+		sqfs_cache.sblk = *sblk;
+	}
+}
+
+/* Evict blocks until @len more bytes fit in the cache */
+static bool sqfs_cache_make_room(size_t len)
+{
+	struct sqfs_cache_block *victim;
+	int i;
+
+	if (len > SQFS_CACHE_MAX_SIZE)
+		return false;
+
+	while (sqfs_cache.size + len > SQFS_CACHE_MAX_SIZE) {
+		victim = NULL;
+		for (i = 0; i < ARRAY_SIZE(sqfs_cache.blk); i++) {
+			struct sqfs_cache_block *blk = &sqfs_cache.blk[i];
+
+			if (blk->start && (!victim || blk->stamp < victim->stamp))
+				victim = blk;
+		}
+		if (!victim)
+			return false;
+		sqfs_cache_evict(victim);
+	}
+
+	return true;
+}
+
+/* Find the block at @start, setting *@len to its size */
+static void *sqfs_cache_find(u64 start, ulong *len)
+{
+	int i;
+
+	if (!sqfs_cache.dev)
+		return NULL;
+
+	for (i = 0; i < ARRAY_SIZE(sqfs_cache.blk); i++) {
+		struct sqfs_cache_block *blk = &sqfs_cache.blk[i];
+
+		if (blk->start == start) {
+			blk->stamp = ++sqfs_cache.clock;
+			*len = blk->len;
+			return blk->data;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Hand @data, the block at @start, over to the cache. Return false if it
+ * does not fit, in which case @data still belongs to the caller.
+ */
+static bool sqfs_cache_add(u64 start, void *data, ulong len)
+{
+	struct sqfs_cache_block *blk = NULL;
+	int i;
+
+	if (!sqfs_cache.dev || !sqfs_cache_make_room(len))
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(sqfs_cache.blk); i++) {
+		if (!blk || !sqfs_cache.blk[i].start ||
+		    (blk->start && sqfs_cache.blk[i].stamp < blk->stamp))
+			blk = &sqfs_cache.blk[i];
+	}
+	if (blk->start)
+		sqfs_cache_evict(blk);
+
+	blk->start = start;
+	blk->data = data;
+	blk->len = len;
+	blk->stamp = ++sqfs_cache.clock;
+	sqfs_cache.size += len;
+
+	return true;
+}
+
+/* Return the cached inode and directory tables, if there are any */
+static struct sqfs_tables *sqfs_cache_get_tables(void)
+{
+	return sqfs_cache.dev ? sqfs_cache.tables : NULL;
+}
+
+/*
+ * Keep a reference to the tables, making room by evicting blocks. The tables
+ * are only dropped along with the whole cache.
+ */
+static void sqfs_cache_add_tables(struct sqfs_tables *tables)
+{
+	if (!sqfs_cache.dev || !sqfs_cache_make_room(tables->size))
+		return;
+
+	tables->refs++;
+	sqfs_cache.tables = tables;
+	sqfs_cache.size += tables->size;
+}
+
+static void sqfs_cache_forget(struct blk_desc *desc)
+{
+	if (sqfs_cache.dev == desc)
+		sqfs_cache_drop();
+}
+#else
+static inline void sqfs_cache_check(struct squashfs_super_block *sblk)
+{
+}
+
+static inline void *sqfs_cache_find(u64 start, ulong *len)
+{
+	return NULL;
+}
+
+static inline bool sqfs_cache_add(u64 start, void *data, ulong len)
+{
+	return false;
+}
+
+static inline struct sqfs_tables *sqfs_cache_get_tables(void)
+{
+	return NULL;
+}
+
+static inline void sqfs_cache_add_tables(struct sqfs_tables *tables)
+{
+}
+
+static inline void sqfs_cache_forget(struct blk_desc *desc)
+{
+}
+#endif
+
 /*
  * Retrieves fragment block entry and returns true if the fragment block is
  * compressed
@@ -106,10 +336,11 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 			    struct squashfs_fragment_block_entry *e)
 {
 	u64 start, end, exp_tbl, n_blks, src_len, table_offset, start_block;
-	unsigned char *metadata_buffer, *metadata, *table;
+	unsigned char *metadata_buffer, *metadata, *table, *index;
+	u64 index_start, index_size = 0;
 	struct squashfs_fragment_block_entry *entries;
 	struct squashfs_super_block *sblk = ctxt.sblk;
-	unsigned long dest_len;
+	unsigned long dest_len, index_len;
 	int block, offset, ret;
 	u16 header;
 
@@ -120,7 +351,16 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
 		return -EINVAL;
 
-	start = get_unaligned_le64(&sblk->fragment_table_start);
+	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
+	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+
+	/* The index (the list of fragment table metadata blocks) is cached */
+	index_start = get_unaligned_le64(&sblk->fragment_table_start);
+	index = sqfs_cache_find(index_start, &index_len);
+	if (index)
+		goto lookup_entry;
+
+	start = index_start;
 	end = get_unaligned_le64(&sblk->id_table_start);
 	exp_tbl = get_unaligned_le64(&sblk->export_table_start);
 
@@ -144,15 +384,43 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 		goto out;
 	}
 
-	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
-	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+	index = table + table_offset;
+	index_len = n_blks * ctxt.cur_dev->blksz - table_offset;
+	index_size = index_len;
+
+lookup_entry:
+	if ((block + 1) * sizeof(u64) > index_len) {
+		ret = -EINVAL;
+		goto out;
+	}
 
 	/*
 	 * Get the start offset of the metadata block that contains the right
 	 * fragment block entry
 	 */
-	start_block = get_unaligned_le64(table + table_offset + block *
-					 sizeof(u64));
+	start_block = get_unaligned_le64(index + block * sizeof(u64));
+
+	/* Keep just the index, rather than the blocks it was read from */
+	if (table) {
+		index_len = DIV_ROUND_UP(get_unaligned_le32(&sblk->fragments),
+					 SQFS_MAX_ENTRIES) * sizeof(u64);
+		if (index_len <= index_size) {
+			memmove(table, index, index_len);
+			if (sqfs_cache_add(index_start, table, index_len))
+				table = NULL;
+		}
+	}
+
+	entries = sqfs_cache_find(start_block, &dest_len);
+	if (entries) {
+		ret = -EINVAL;
+		if ((offset + 1) * sizeof(*e) <= dest_len) {
+			*e = entries[offset];
+			ret = SQFS_COMPRESSED_BLOCK(e->size);
+		}
+		entries = NULL;
+		goto out;
+	}
 
 	start = start_block / ctxt.cur_dev->blksz;
 	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block),
@@ -194,12 +462,21 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 			goto out;
 		}
 	} else {
-		memcpy(entries, metadata, SQFS_METADATA_SIZE(header));
+		dest_len = SQFS_METADATA_SIZE(header);
+		memcpy(entries, metadata, dest_len);
+	}
+
+	if ((offset + 1) * sizeof(*e) > dest_len) {
+		ret = -EINVAL;
+		goto out;
 	}
 
 	*e = entries[offset];
 	ret = SQFS_COMPRESSED_BLOCK(e->size);
 
+	if (sqfs_cache_add(start_block, entries, dest_len))
+		entries = NULL;
+
 out:
 	free(entries);
 	free(metadata_buffer);
@@ -224,8 +501,9 @@ static int sqfs_read_entry(struct squashfs_directory_entry **dest, void *src)
 	 * 'src' points to the begin of a directory entry, and 'sz' gets its
 	 * 'name_size' member's value. name_size is actually the string
 	 * length - 1, so adding 2 compensates this difference and adds space
-	 * for the trailling null byte.
+	 * for the trailling null byte. Any previous entry is dropped first.
 	 */
+	free(*dest);
 	*dest = malloc(sizeof(*tmp) + sz + 2);
 	if (!*dest)
 		return -ENOMEM;
@@ -710,6 +988,10 @@ static int sqfs_get_metablk_pos(u32 *pos_list, void *table, u32 offset,
 	return ret;
 }
 
+/*
+ * Reads and decompresses the whole inode table. Returns the number of metadata
+ * blocks in it, or a negative value on error.
+ */
 static int sqfs_read_inode_table(unsigned char **inode_table)
 {
 	struct squashfs_super_block *sblk = ctxt.sblk;
@@ -794,6 +1076,7 @@ static int sqfs_read_inode_table(unsigned char **inode_table)
 		table_offset += src_len + SQFS_HEADER_SIZE;
 		src_table += src_len + SQFS_HEADER_SIZE;
 	}
+	ret = metablks_count;
 
 free_itb:
 	free(itb);
@@ -905,13 +1188,53 @@ out:
 	return metablks_count;
 }
 
+/*
+ * Gets the decompressed inode and directory tables, from the cache or else by
+ * reading them. Drop the reference with sqfs_put_tables().
+ */
+static struct sqfs_tables *sqfs_get_tables(void)
+{
+	struct sqfs_tables *tables;
+	int inode_blks;
+
+	tables = sqfs_cache_get_tables();
+	if (tables) {
+		tables->refs++;
+		return tables;
+	}
+
+	tables = calloc(1, sizeof(*tables));
+	if (!tables)
+		return NULL;
+	tables->refs = 1;
+
+	inode_blks = sqfs_read_inode_table(&tables->inode_table);
+	if (inode_blks < 0)
+		goto err;
+
+	tables->metablks_count = sqfs_read_directory_table(&tables->dir_table,
+							   &tables->pos_list);
+	if (tables->metablks_count < 1)
+		goto err;
+
+	tables->size = (size_t)(inode_blks + tables->metablks_count) *
+		SQFS_METADATA_BLOCK_SIZE +
+		tables->metablks_count * sizeof(*tables->pos_list);
+	sqfs_cache_add_tables(tables);
+
+	return tables;
+
+err:
+	sqfs_put_tables(tables);
+
+	return NULL;
+}
+
 static int sqfs_opendir_nest(const char *filename, struct fs_dir_stream **dirsp)
 {
-	unsigned char *inode_table = NULL, *dir_table = NULL;
-	int j, token_count = 0, ret = 0, metablks_count;
+	int j, token_count = 0, ret = 0;
 	struct squashfs_dir_stream *dirs;
 	char **token_list = NULL, *path = NULL;
-	u32 *pos_list = NULL;
 
 	dirs = calloc(1, sizeof(*dirs));
 	if (!dirs)
@@ -924,14 +1247,8 @@ static int sqfs_opendir_nest(const char *filename, struct fs_dir_stream **dirsp)
 	dirs->inode_table = NULL;
 	dirs->dir_table = NULL;
 
-	ret = sqfs_read_inode_table(&inode_table);
-	if (ret) {
-		ret = -EINVAL;
-		goto out;
-	}
-
-	metablks_count = sqfs_read_directory_table(&dir_table, &pos_list);
-	if (metablks_count < 1) {
+	dirs->tables = sqfs_get_tables();
+	if (!dirs->tables) {
 		ret = -EINVAL;
 		goto out;
 	}
@@ -963,10 +1280,11 @@ static int sqfs_opendir_nest(const char *filename, struct fs_dir_stream **dirsp)
 	 * ldir's (extended directory) size is greater than dir, so it works as
 	 * a general solution for the malloc size, since 'i' is a union.
 	 */
-	dirs->inode_table = inode_table;
-	dirs->dir_table = dir_table;
-	ret = sqfs_search_dir(dirs, token_list, token_count, pos_list,
-			      metablks_count);
+	dirs->inode_table = dirs->tables->inode_table;
+	dirs->dir_table = dirs->tables->dir_table;
+	ret = sqfs_search_dir(dirs, token_list, token_count,
+			      dirs->tables->pos_list,
+			      dirs->tables->metablks_count);
 	if (ret)
 		goto out;
 
@@ -992,10 +1310,10 @@ out:
 			free(token_list[j]);
 		free(token_list);
 	}
-	free(pos_list);
 	free(path);
 	if (ret) {
-		free(inode_table);
+		sqfs_put_tables(dirs->tables);
+		free(dirs->dir_header);
 		free(dirs);
 	}
 
@@ -1151,6 +1469,7 @@ int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition
 	}
 
 	ctxt.sblk = sblk;
+	sqfs_cache_check(sblk);
 
 	ret = sqfs_decompressor_init(&ctxt);
 	if (ret) {
@@ -1360,36 +1679,43 @@ static int sqfs_get_lregfile_info(struct squashfs_lreg_inode *lreg,
 	return datablk_count;
 }
 
-static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
-			  loff_t len, loff_t *actread)
+/**
+ * struct sqfs_file - Location of the data of a regular file
+ *
+ * @finfo:		file information, including the data block sizes
+ * @frag_entry:		fragment entry, if @finfo.frag is set
+ * @datablk_count:	number of data blocks
+ */
+struct sqfs_file {
+	struct squashfs_file_info finfo;
+	struct squashfs_fragment_block_entry frag_entry;
+	int datablk_count;
+};
+
+/**
+ * sqfs_lookup_file_nest() - Find the data of a regular file
+ *
+ * Symbolic links are followed. On success, @sf->finfo.blk_sizes is allocated
+ * and must be freed by the caller.
+ *
+ * @filename:	full path of the file
+ * @sf:		returns the file information
+ * Return: 0 if OK, -ENOENT if not found, other -ve on error
+ */
+static int sqfs_lookup_file_nest(const char *filename, struct sqfs_file *sf)
 {
-	char *dir = NULL, *fragment_block, *datablock = NULL;
-	char *fragment = NULL, *file = NULL, *resolved, *data;
-	u64 start, n_blks, table_size, data_offset, table_offset, sparse_size;
-	int ret, j, i_number, datablk_count = 0;
 	struct squashfs_super_block *sblk = ctxt.sblk;
-	struct squashfs_fragment_block_entry frag_entry;
-	struct squashfs_file_info finfo = {0};
 	struct squashfs_symlink_inode *symlink;
 	struct fs_dir_stream *dirsp = NULL;
 	struct squashfs_dir_stream *dirs;
 	struct squashfs_lreg_inode *lreg;
 	struct squashfs_base_inode *base;
 	struct squashfs_reg_inode *reg;
-	unsigned long dest_len;
+	char *dir = NULL, *file = NULL;
 	struct fs_dirent *dent;
 	unsigned char *ipos;
-	size_t buf_size;
-
-	*actread = 0;
-
-	if (offset) {
-		/*
-		 * TODO: implement reading at an offset in file
-		 */
-		printf("Error: reading at a specific offset in a squashfs file is not supported yet.\n");
-		return -EINVAL;
-	}
+	int ret, i_number;
+	char *resolved;
 
 	/*
 	 * sqfs_opendir_nest will uncompress inode and directory tables, and will
@@ -1397,9 +1723,8 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 	 */
 	sqfs_split_path(&file, &dir, filename);
 	ret = sqfs_opendir_nest(dir, &dirsp);
-	if (ret) {
+	if (ret)
 		goto out;
-	}
 
 	dirs = (struct squashfs_dir_stream *)dirsp;
 
@@ -1414,8 +1739,6 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 	}
 
 	if (ret) {
-		printf("File not found.\n");
-		*actread = 0;
 		ret = -ENOENT;
 		goto out;
 	}
@@ -1432,28 +1755,31 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 	switch (get_unaligned_le16(&base->inode_type)) {
 	case SQFS_REG_TYPE:
 		reg = (struct squashfs_reg_inode *)ipos;
-		datablk_count = sqfs_get_regfile_info(reg, &finfo, &frag_entry,
-						      sblk->block_size);
-		if (datablk_count < 0) {
+		ret = sqfs_get_regfile_info(reg, &sf->finfo, &sf->frag_entry,
+					    sblk->block_size);
+		if (ret < 0) {
 			ret = -EINVAL;
 			goto out;
 		}
 
-		memcpy(finfo.blk_sizes, ipos + sizeof(*reg),
-		       datablk_count * sizeof(u32));
+		sf->datablk_count = ret;
+		memcpy(sf->finfo.blk_sizes, ipos + sizeof(*reg),
+		       ret * sizeof(u32));
+		ret = 0;
 		break;
 	case SQFS_LREG_TYPE:
 		lreg = (struct squashfs_lreg_inode *)ipos;
-		datablk_count = sqfs_get_lregfile_info(lreg, &finfo,
-						       &frag_entry,
-						       sblk->block_size);
-		if (datablk_count < 0) {
+		ret = sqfs_get_lregfile_info(lreg, &sf->finfo, &sf->frag_entry,
+					     sblk->block_size);
+		if (ret < 0) {
 			ret = -EINVAL;
 			goto out;
 		}
 
-		memcpy(finfo.blk_sizes, ipos + sizeof(*lreg),
-		       datablk_count * sizeof(u32));
+		sf->datablk_count = ret;
+		memcpy(sf->finfo.blk_sizes, ipos + sizeof(*lreg),
+		       ret * sizeof(u32));
+		ret = 0;
 		break;
 	case SQFS_SYMLINK_TYPE:
 	case SQFS_LSYMLINK_TYPE:
@@ -1464,7 +1790,7 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 
 		symlink = (struct squashfs_symlink_inode *)ipos;
 		resolved = sqfs_resolve_symlink(symlink, filename);
-		ret = sqfs_read_nest(resolved, buf, offset, len, actread);
+		ret = sqfs_lookup_file_nest(resolved, sf);
 		free(resolved);
 		goto out;
 	case SQFS_BLKDEV_TYPE:
@@ -1481,111 +1807,130 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 		goto out;
 	}
 
-	/* If the user specifies a length, check its sanity */
-	if (len) {
-		if (len > finfo.size) {
-			ret = -EINVAL;
-			goto out;
-		}
+out:
+	free(file);
+	free(dir);
+	sqfs_closedir(dirsp);
 
-		finfo.size = len;
-	} else {
-		len = finfo.size;
-	}
+	return ret;
+}
 
-	if (datablk_count) {
-		data_offset = finfo.start;
-		datablock = malloc(get_unaligned_le32(&sblk->block_size));
-		if (!datablock) {
-			ret = -ENOMEM;
-			goto out;
-		}
+/**
+ * sqfs_read_data() - Read part of a regular file
+ *
+ * Data blocks which lie entirely outside the range are skipped without being
+ * read or decompressed.
+ *
+ * @sf:		file to read, as found by sqfs_lookup_file_nest()
+ * @buf:	buffer to read into
+ * @offset:	offset within the file to read from
+ * @len:	number of bytes to read, which must be non-zero and must not
+ *		extend past the end of the file
+ * @actread:	returns the number of bytes read
+ * Return: 0 if OK, -ve on error
+ */
+static int sqfs_read_data(struct sqfs_file *sf, char *buf, u64 offset,
+			  u64 len, loff_t *actread)
+{
+	char *fragment = NULL, *fragment_block, *datablock = NULL;
+	u64 start, n_blks, table_size, data_offset, table_offset;
+	struct squashfs_super_block *sblk = ctxt.sblk;
+	struct squashfs_file_info *finfo = &sf->finfo;
+	u32 blksz = get_unaligned_le32(&sblk->block_size);
+	u64 pos, end = offset + len, from, to;
+	char *data, *data_buffer = NULL;
+	unsigned long dest_len;
+	size_t buf_size;
+	int ret, j;
+
+	*actread = 0;
+	if (sf->datablk_count) {
+		datablock = malloc(blksz);
+		if (!datablock)
+			return -ENOMEM;
 	}
 
-	for (j = 0; j < datablk_count; j++) {
-		char *data_buffer;
+	data_offset = finfo->start;
+	for (j = 0, pos = 0; j < sf->datablk_count && pos < end;
+	     j++, pos += blksz, data_offset += table_size) {
+		table_size = SQFS_BLOCK_SIZE(finfo->blk_sizes[j]);
+
+		/* Skip blocks before the start of the range */
+		if (pos + min_t(u64, blksz, finfo->size - pos) <= offset)
+			continue;
+		from = max(pos, offset);
+		to = min(pos + blksz, end);
+
+		if (finfo->blk_sizes[j] == 0) {
+			/* This is a sparse block */
+			memset(buf + from - offset, 0, to - from);
+			continue;
+		}
 
 		start = lldiv(data_offset, ctxt.cur_dev->blksz);
-		table_size = SQFS_BLOCK_SIZE(finfo.blk_sizes[j]);
 		table_offset = data_offset - (start * ctxt.cur_dev->blksz);
 		n_blks = DIV_ROUND_UP(table_size + table_offset,
 				      ctxt.cur_dev->blksz);
 
-		/* Don't load any data for sparse blocks */
-		if (finfo.blk_sizes[j] == 0) {
-			n_blks = 0;
-			table_offset = 0;
-			data_buffer = NULL;
-			data = NULL;
-		} else {
-			data_buffer = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-			if (!data_buffer) {
-				ret = -ENOMEM;
-				goto out;
-			}
-
-			ret = sqfs_disk_read(start, n_blks, data_buffer);
-			if (ret < 0) {
-				/*
-				 * Possible causes: too many data blocks or too large
-				 * SquashFS block size. Tip: re-compile the SquashFS
-				 * image with mksquashfs's -b <block_size> option.
-				 */
-				printf("Error: too many data blocks to be read.\n");
-				goto out;
-			}
+		data_buffer = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
+		if (!data_buffer) {
+			ret = -ENOMEM;
+			goto out;
+		}
 
-			data = data_buffer + table_offset;
+		ret = sqfs_disk_read(start, n_blks, data_buffer);
+		if (ret < 0) {
+			/*
+			 * Possible causes: too many data blocks or too large
+			 * SquashFS block size. Tip: re-compile the SquashFS
+			 * image with mksquashfs's -b <block_size> option.
+			 */
+			printf("Error: too many data blocks to be read.\n");
+			goto out;
 		}
 
-		/* Load the data */
-		if (finfo.blk_sizes[j] == 0) {
-			/* This is a sparse block */
-			sparse_size = get_unaligned_le32(&sblk->block_size);
-			if ((*actread + sparse_size) > len)
-				sparse_size = len - *actread;
-			memset(buf + *actread, 0, sparse_size);
-			*actread += sparse_size;
-		} else if (SQFS_COMPRESSED_BLOCK(finfo.blk_sizes[j])) {
-			dest_len = get_unaligned_le32(&sblk->block_size);
+		data = data_buffer + table_offset;
+		if (SQFS_COMPRESSED_BLOCK(finfo->blk_sizes[j])) {
+			dest_len = blksz;
 			ret = sqfs_decompress(&ctxt, datablock, &dest_len,
 					      data, table_size);
 			if (ret)
 				goto out;
-
-			if ((*actread + dest_len) > len)
-				dest_len = len - *actread;
-			memcpy(buf + *actread, datablock, dest_len);
-			*actread += dest_len;
+			data = datablock;
 		} else {
-			if ((*actread + table_size) > len)
-				table_size = len - *actread;
-			memcpy(buf + *actread, data, table_size);
-			*actread += table_size;
+			dest_len = table_size;
+		}
+		if (dest_len < to - pos) {
+			ret = -EINVAL;
+			goto out;
 		}
 
-		data_offset += table_size;
+		memcpy(buf + from - offset, data + from - pos, to - from);
 		free(data_buffer);
-		if (*actread >= len)
-			break;
+		data_buffer = NULL;
 	}
 
 	/*
-	 * There is no need to continue if the file is not fragmented.
+	 * There is no need to continue if the file is not fragmented, or the
+	 * range ends before the fragment.
 	 */
-	if (!finfo.frag) {
-		ret = 0;
-		goto out;
-	}
+	pos = (u64)sf->datablk_count * blksz;
+	if (!finfo->frag || end <= pos)
+		goto done;
+
+	fragment_block = sqfs_cache_find(sf->frag_entry.start, &dest_len);
+	if (fragment_block)
+		goto copy_fragment;
 
-	start = lldiv(frag_entry.start, ctxt.cur_dev->blksz);
-	table_size = SQFS_BLOCK_SIZE(frag_entry.size);
-	table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
+	start = lldiv(sf->frag_entry.start, ctxt.cur_dev->blksz);
+	table_size = SQFS_BLOCK_SIZE(sf->frag_entry.size);
+	table_offset = sf->frag_entry.start - (start * ctxt.cur_dev->blksz);
 	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
 
-	if (__builtin_mul_overflow(n_blks, ctxt.cur_dev->blksz, &buf_size))
-		return -EINVAL;
+	if (__builtin_mul_overflow(n_blks, ctxt.cur_dev->blksz, &buf_size)) {
+		ret = -EINVAL;
+		goto out;
+	}
 
 	fragment = malloc_cache_aligned(buf_size);
 
@@ -1599,8 +1944,8 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 		goto out;
 
 	/* File compressed and fragmented */
-	if (finfo.frag && finfo.comp) {
-		dest_len = get_unaligned_le32(&sblk->block_size);
+	if (finfo->comp) {
+		dest_len = blksz;
 		fragment_block = malloc(dest_len);
 		if (!fragment_block) {
 			ret = -ENOMEM;
@@ -1609,31 +1954,42 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 
 		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
 				      (void *)fragment  + table_offset,
-				      frag_entry.size);
+				      sf->frag_entry.size);
 		if (ret) {
 			free(fragment_block);
 			goto out;
 		}
 
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
+		/* Other files are likely to share the fragment block */
+		free(fragment);
+		fragment = fragment_block;
+	} else {
+		dest_len = table_size;
+		memmove(fragment, fragment + table_offset, dest_len);
+		fragment_block = fragment;
+	}
+	if (sqfs_cache_add(sf->frag_entry.start, fragment, dest_len))
+		fragment = NULL;
 
-		free(fragment_block);
+copy_fragment:
+	if (finfo->offset > dest_len ||
+	    finfo->size - pos > dest_len - finfo->offset) {
+		ret = -EINVAL;
+		goto out;
+	}
 
-	} else if (finfo.frag && !finfo.comp) {
-		fragment_block = (void *)fragment + table_offset;
+	from = max(pos, offset);
+	memcpy(buf + from - offset, &fragment_block[finfo->offset + from - pos],
+	       end - from);
 
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-	}
+done:
+	*actread = len;
+	ret = 0;
 
 out:
 	free(fragment);
+	free(data_buffer);
 	free(datablock);
-	free(file);
-	free(dir);
-	free(finfo.blk_sizes);
-	sqfs_closedir(dirsp);
 
 	return ret;
 }
@@ -1641,8 +1997,70 @@ out:
 int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 	      loff_t *actread)
 {
+	struct sqfs_file sf = {};
+	int ret;
+
+	*actread = 0;
+	symlinknest = 0;
+	ret = sqfs_lookup_file_nest(filename, &sf);
+	if (ret) {
+		if (ret == -ENOENT)
+			printf("File not found.\n");
+		return ret;
+	}
+
+	/* If the user specifies a length, check its sanity */
+	if (offset > sf.finfo.size || len > sf.finfo.size - offset) {
+		ret = -EINVAL;
+	} else {
+		if (!len)
+			len = sf.finfo.size - offset;
+		if (len)
+			ret = sqfs_read_data(&sf, buf, offset, len, actread);
+	}
+	free(sf.finfo.blk_sizes);
+
+	return ret;
+}
+
+int sqfs_open(struct fs_file *file)
+{
+	struct sqfs_file *sf;
+	int ret;
+
+	sf = calloc(1, sizeof(*sf));
+	if (!sf)
+		return -ENOMEM;
+
 	symlinknest = 0;
-	return sqfs_read_nest(filename, buf, offset, len, actread);
+	ret = sqfs_lookup_file_nest(file->name, sf);
+	if (ret) {
+		free(sf);
+		return ret;
+	}
+	file->size = sf->finfo.size;
+	file->priv = sf;
+
+	return 0;
+}
+
+int sqfs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+	       loff_t *actread)
+{
+	return sqfs_read_data(file->priv, buf, offset, len, actread);
+}
+
+void sqfs_closefile(struct fs_file *file)
+{
+	struct sqfs_file *sf = file->priv;
+
+	free(sf->finfo.blk_sizes);
+	free(sf);
+}
+
+void sqfs_forget(struct blk_desc *desc)
+{
+	sqfs_cache_forget(desc);
 }
 
 static int sqfs_size_nest(const char *filename, loff_t *size)
@@ -1808,8 +2226,8 @@ void sqfs_closedir(struct fs_dir_stream *dirs)
 		return;
 
 	sqfs_dirs = (struct squashfs_dir_stream *)dirs;
-	free(sqfs_dirs->inode_table);
-	free(sqfs_dirs->dir_table);
+	sqfs_put_tables(sqfs_dirs->tables);
+	free(sqfs_dirs->entry);
 	free(sqfs_dirs->dir_header);
 	free(sqfs_dirs);
 }
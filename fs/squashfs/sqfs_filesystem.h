@@ -247,6 +247,21 @@ struct squashfs_fragment_block_entry {
 	u32 _unused;
 };
 
+/*
+ * Decompressed inode and directory tables, shared between directory streams
+ * and the cache, and freed when the last reference is dropped.
+ */
+struct sqfs_tables {
+	int refs;
+	/* Total size of the tables, in bytes */
+	size_t size;
+	unsigned char *inode_table;
+	unsigned char *dir_table;
+	/* Position of each metadata block in the directory table */
+	u32 *pos_list;
+	int metablks_count;
+};
+
 struct squashfs_dir_stream {
 	struct fs_dir_stream fs_dirs;
 	struct fs_dirent dentp;
@@ -272,8 +287,9 @@ struct squashfs_dir_stream {
 	struct squashfs_ldir_inode i_ldir;
 	/*
 	 * References to the tables' beginnings. They are assigned in
-	 * sqfs_opendir() and freed in sqfs_closedir().
+	 * sqfs_opendir() and released in sqfs_closedir().
 	 */
+	struct sqfs_tables *tables;
 	unsigned char *inode_table;
 	unsigned char *dir_table;
 };
@@ -256,6 +256,13 @@ struct global_data {
 	 */
 	void *dm_priv_base;
 # endif
+# if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	/**
+	 * @dm_compat_idx: Hash index of driver compatible strings, or NULL if
+	 * not built yet
+	 */
+	struct dm_compat_idx *dm_compat_idx;
+# endif
 #endif
 #ifdef CONFIG_TIMER
 	/**
@@ -495,6 +502,14 @@ static_assert(sizeof(struct global_data) == GD_SIZE);
 #define gd_dm_priv_base()		NULL
 #endif
 
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+#define gd_set_dm_compat_idx(idx)	gd->dm_compat_idx = idx
+#define gd_dm_compat_idx()		gd->dm_compat_idx
+#else
+#define gd_set_dm_compat_idx(idx)
+#define gd_dm_compat_idx()		NULL
+#endif
+
 #ifdef CONFIG_ACPI
 #define gd_acpi_ctx()		gd->acpi_ctx
 #define gd_acpi_start()		gd->acpi_start
@@ -144,15 +144,45 @@ void blkcache_fill(int iftype, int dev,
  * blkcache_invalidate() - discard the cache for a set of blocks
  * because of a write or device (re)initialization.
  *
+ * The cached lines and read-ahead buffer of the device are freed. Its
+ * statistics are kept.
+ *
  * @iftype - UCLASS_ID_ for type of device, or -1 for any
  * @dev - device index of particular type, if @iftype is not -1
  */
 void blkcache_invalidate(int iftype, int dev);
 
+/**
+ * blkcache_readahead() - decide how much to read on a cache miss
+ *
+ * Widens a request that missed the cache to whole cache lines and, if the
+ * device is being read sequentially, adds a read-ahead window. The caller
+ * should read @ra_cntp blocks from @ra_startp into the returned buffer and
+ * pass them to blkcache_fill() before copying out the blocks it wanted.
+ *
+ * @param iftype - uclass_id_x for type of device
+ * @param dev - device index of particular type
+ * @param start - starting block number of the request
+ * @param blkcnt - number of blocks in the request
+ * @param blksz - size in bytes of each block
+ * @param lba - number of blocks on the device, or 0 if not known
+ * @param ra_startp - returns the first block to read
+ * @param ra_cntp - returns the number of blocks to read
+ *
+ * Return: buffer to read into, or NULL to read the request unchanged
+ */
+void *blkcache_readahead(int iftype, int dev,
+			 lbaint_t start, lbaint_t blkcnt,
+			 unsigned long blksz, lbaint_t lba,
+			 lbaint_t *ra_startp, lbaint_t *ra_cntp);
+
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
+ * The byte budget of the cache becomes @blocks * @entries * 512. Both values
+ * are rounded down to suit the set-associative layout.
+ *
+ * @param blocks - blocks per cache line (entry)
  * @param entries - maximum entries in cache
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
@@ -163,9 +193,25 @@ void blkcache_configure(unsigned blocks, unsigned entries);
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
+	unsigned evictions;
 	unsigned entries; /* current entry count */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
+	unsigned ways; /* entries per set */
+	unsigned long size; /* memory budget in bytes */
+	unsigned max_readahead; /* in blocks */
+};
+
+/*
+ * per-device statistics of the block cache
+ */
+struct block_cache_dev_stats {
+	int iftype;
+	int devnum;
+	unsigned hits;
+	unsigned misses;
+	unsigned evictions; /* lines of this device that were replaced */
+	unsigned readahead; /* blocks read beyond what was requested */
 };
 
 /**
@@ -175,6 +221,27 @@ struct block_cache_stats {
  */
 void blkcache_stats(struct block_cache_stats *stats);
 
+/**
+ * blkcache_dev_stats() - return statistics for a device and reset
+ *
+ * @param seq - index of the device, starting at 0
+ * @param stats - statistics are copied here
+ *
+ * Return: 0 if OK, -ENOENT if there is no device with index @seq
+ */
+int blkcache_dev_stats(int seq, struct block_cache_dev_stats *stats);
+
+/**
+ * blkcache_remove() - forget a device which is being removed
+ *
+ * This discards the cache and statistics for the device. The cache table is
+ * freed if nothing else is cached.
+ *
+ * @iftype: UCLASS_ID_ for type of device
+ * @devnum: device index of particular type
+ */
+void blkcache_remove(int iftype, int devnum);
+
 /** blkcache_free() - free all memory allocated to the block cache */
 void blkcache_free(void);
 
@@ -191,14 +258,52 @@ static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
 
+static inline void *blkcache_readahead(int iftype, int dev,
+				      lbaint_t start, lbaint_t blkcnt,
+				      unsigned long blksz, lbaint_t lba,
+				      lbaint_t *ra_startp, lbaint_t *ra_cntp)
+{
+	return NULL;
+}
+
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
+static inline void blkcache_remove(int iftype, int devnum) {}
+
 static inline void blkcache_free(void) {}
 
 #endif
 
 struct udevice;
 
+/**
+ * struct blk_req - an asynchronous block-read request
+ *
+ * This is filled in by blk_submit_read() and completed through
+ * blk_req_poll() or blk_req_wait(). The caller owns the structure and must
+ * keep it (and the buffer) valid until the request has completed.
+ *
+ * @dev:	Block device the request was submitted to
+ * @start:	Start block to read
+ * @blkcnt:	Number of blocks to read
+ * @buffer:	Place to put the data
+ * @result:	Number of blocks read, or -ve error, once @done is true
+ * @done:	true once the request has completed
+ * @native:	true if the driver handles the request through its
+ *		submit_read() and poll() operations, false if it is emulated
+ * @priv:	Private data for the driver while the request is in flight
+ */
+struct blk_req {
+	struct udevice *dev;
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	long result;
+	bool done;
+	bool native;
+	void *priv;
+};
+
 /* Operations on block devices */
 struct blk_ops {
 	/**
@@ -258,6 +363,36 @@ struct blk_ops {
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
 
+	/**
+	 * submit_read() - start an asynchronous read from a block device
+	 *
+	 * This is optional. Drivers for controllers with command queues can
+	 * implement it, along with poll(), to keep several reads in flight.
+	 * The driver must queue the request and return without waiting for
+	 * it to finish. When the request completes, poll() sets @req->result
+	 * and then @req->done.
+	 *
+	 * Requests are only submitted with a buffer that is suitable for DMA
+	 * by the device, i.e. the bounce buffer is never used.
+	 *
+	 * @dev:	Device to read from
+	 * @req:	Request to submit; @req->priv is free for the driver
+	 * @return 0 if queued, -EBUSY if the queue is full and poll() must be
+	 * called before trying again, other -ve on error
+	 */
+	int (*submit_read)(struct udevice *dev, struct blk_req *req);
+
+	/**
+	 * poll() - reap completed asynchronous requests
+	 *
+	 * This must not wait for requests to complete. Each request found to
+	 * be complete is marked as such, as described for submit_read().
+	 *
+	 * @dev:	Device to check
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*poll)(struct udevice *dev);
+
 #if IS_ENABLED(CONFIG_BOUNCE_BUFFER)
 	/**
 	 * buffer_aligned() - test memory alignment of block operation buffer
@@ -331,6 +466,58 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
  */
 long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt);
 
+/**
+ * blk_submit_read() - Start an asynchronous read from a block device
+ *
+ * The read is queued to the device if its driver implements submit_read().
+ * Otherwise it is run by a uthread (if CONFIG_UTHREAD is enabled) which
+ * makes progress whenever the caller yields, e.g. in blk_req_poll(), or
+ * synchronously before this function returns. Reads that hit the block cache
+ * complete immediately. Asynchronous reads are not added to the block cache.
+ *
+ * Use blk_req_poll() or blk_req_wait() to complete the request.
+ *
+ * @dev: Device to read from
+ * @start: Start block for the read
+ * @blkcnt: Number of blocks to read
+ * @buffer: Place to put the data
+ * @req: Request to fill in
+ * Return: 0 if the request was submitted, -ve on error
+ */
+int blk_submit_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+		    void *buffer, struct blk_req *req);
+
+/**
+ * blk_req_poll() - Make progress on an asynchronous read and check it
+ *
+ * @req: Request submitted with blk_submit_read()
+ * Return: 0 if the request has completed (see @req->result), -EBUSY if it is
+ * still in flight, other -ve on error
+ */
+int blk_req_poll(struct blk_req *req);
+
+/**
+ * blk_req_wait() - Wait for an asynchronous read to complete
+ *
+ * @req: Request submitted with blk_submit_read()
+ * Return: number of blocks read (which may be less than @req->blkcnt),
+ * or -ve on error
+ */
+long blk_req_wait(struct blk_req *req);
+
+/**
+ * blk_get_write_seq() - Get the write sequence number of a device
+ *
+ * The value changes each time the device is written or erased through the
+ * block uclass, and when it is probed. It is never reused, so a filesystem
+ * can record it alongside anything it caches about the contents of the
+ * device, and drop the cache once the value no longer matches.
+ *
+ * @dev: Block device
+ * Return: current write sequence number
+ */
+ulong blk_get_write_seq(struct udevice *dev);
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -303,6 +303,58 @@ int bootdev_hunt_prio(enum bootdev_prio_t prio, bool show);
  */
 int bootdev_unhunt(enum uclass_id id);
 
+#if CONFIG_IS_ENABLED(BOOTDEV_HUNT_PARALLEL)
+/**
+ * bootdev_hunt_start() - Start all unused hunters in the background
+ *
+ * Each hunter which has not been used yet runs in its own uthread, so that
+ * hunters which wait for hardware (e.g. enumerating a USB bus) overlap with
+ * each other and with whatever the caller does next. The hunters make progress
+ * whenever the caller yields, e.g. in udelay() or schedule().
+ *
+ * Nothing needs to change in the caller, since bootdev_hunt() and
+ * bootdev_hunt_prio() wait for any running hunter they need before returning.
+ *
+ * @show: true to show each hunter as it is used
+ * Return: 0 if OK, -ve on error
+ */
+int bootdev_hunt_start(bool show);
+
+/**
+ * bootdev_hunt_cancel() - Stop background hunters which have not started
+ *
+ * This is used once a bootflow has been chosen, when no more bootdevs are
+ * needed. Hunters which have not started yet are dropped and left unused, so
+ * that they run if they are needed later. Hunters which have started cannot
+ * safely be stopped part-way through probing, so they carry on whenever the
+ * caller yields. dm_remove_devices_active() lets them finish before devices
+ * are removed for the OS.
+ */
+void bootdev_hunt_cancel(void);
+
+/**
+ * bootdev_hunt_finish() - Stop background hunters and wait for the rest
+ *
+ * This cancels any hunters which have not started, as bootdev_hunt_cancel()
+ * does, then waits for those which have. It is used when a scan is abandoned,
+ * so that nothing is left half-way through probing when the command returns.
+ */
+void bootdev_hunt_finish(void);
+#else
+static inline int bootdev_hunt_start(bool show)
+{
+	return 0;
+}
+
+static inline void bootdev_hunt_cancel(void)
+{
+}
+
+static inline void bootdev_hunt_finish(void)
+{
+}
+#endif
+
 /**
  * bootdev_hunt_and_find_by_label() - Hunt for bootdevs by label
  *
@@ -15,6 +15,7 @@
 
 struct bootstd_priv;
 struct expo;
+struct malloc_arena;
 
 enum {
 	BOOTFLOW_MAX_USED_DEVS	= 16,
@@ -257,6 +258,9 @@ enum bootflow_meth_flags_t {
  *	happens before the normal ones)
  * @method_flags: flags controlling which methods should be used for this @dev
  * (enum bootflow_meth_flags_t)
+ * @arena: Arena for allocations which last only as long as the scan, e.g.
+ *	@method_order, or NULL if none. This is released by
+ *	bootflow_iter_uninit()
  */
 struct bootflow_iter {
 	int flags;
@@ -278,6 +282,7 @@ struct bootflow_iter {
 	struct udevice **method_order;
 	bool doing_global;
 	int method_flags;
+	struct malloc_arena *arena;
 };
 
 /**
@@ -385,6 +390,56 @@ int bootflow_next_glob(struct bootflow **bflowp);
  */
 void bootflow_free(struct bootflow *bflow);
 
+/* Environment variable holding the bootflow cache record */
+#define BOOTFLOW_CACHE_VAR	"bootflow_last"
+
+#if CONFIG_IS_ENABLED(BOOTFLOW_CACHE)
+/**
+ * bootflow_cache_find() - Find the bootflow which was booted last time
+ *
+ * This scans only the partition recorded in the bootflow cache, using the
+ * hunter for that media if needed. The bootflow is returned only if its
+ * bootmeth, filename, size and CRC32 all match the record.
+ *
+ * @flags: Flags for the scan (enum bootflow_iter_flags_t)
+ * @bflow: Returns the bootflow, which the caller must free
+ * Return: 0 if found, -ENOENT if there is no record or it does not match,
+ *	-EINVAL if the record is invalid
+ */
+int bootflow_cache_find(int flags, struct bootflow *bflow);
+
+/**
+ * bootflow_cache_save() - Record a bootflow which is about to be booted
+ *
+ * The environment is saved if the record changes. Bootflows from global
+ * bootmeths cannot be recorded, so they clear the record instead.
+ *
+ * @bflow: Bootflow to record
+ */
+void bootflow_cache_save(const struct bootflow *bflow);
+
+/**
+ * bootflow_cache_drop() - Clear the record, e.g. because the boot failed
+ *
+ * The environment is not saved, since the next bootflow to be booted saves
+ * its own record.
+ */
+void bootflow_cache_drop(void);
+#else
+static inline int bootflow_cache_find(int flags, struct bootflow *bflow)
+{
+	return -ENOSYS;
+}
+
+static inline void bootflow_cache_save(const struct bootflow *bflow)
+{
+}
+
+static inline void bootflow_cache_drop(void)
+{
+}
+#endif
+
 /**
  * bootflow_boot() - boot a bootflow
  *
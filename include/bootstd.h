@@ -42,6 +42,8 @@ struct udevice;
  * @theme: Node containing the theme information
  * @hunters_used: Bitmask of used hunters, indexed by their position in the
  * linker list. The bit is set if the hunter has been used already
+ * @hunters_busy: Bitmask of hunters running in the background, indexed in the
+ * same way (see bootdev_hunt_start())
  */
 struct bootstd_priv {
 	const char **prefixes;
@@ -55,6 +57,7 @@ struct bootstd_priv {
 	struct udevice *vbe_bootmeth;
 	ofnode theme;
 	uint hunters_used;
+	uint hunters_busy;
 };
 
 /**
@@ -10,6 +10,7 @@
 
 struct blk_desc;
 struct disk_partition;
+struct fs_file;
 
 int btrfs_probe(struct blk_desc *fs_dev_desc,
 		struct disk_partition *fs_partition);
@@ -17,6 +18,10 @@ int btrfs_ls(const char *);
 int btrfs_exists(const char *);
 int btrfs_size(const char *, loff_t *);
 int btrfs_read(const char *, void *, loff_t, loff_t, loff_t *);
+int btrfs_open(struct fs_file *file);
+int btrfs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+		loff_t *actread);
+void btrfs_closefile(struct fs_file *file);
 void btrfs_close(void);
 int btrfs_uuid(char *);
 void btrfs_list_subvols(void);
@@ -15,6 +15,24 @@
 #include <asm/types.h>
 #include <u-boot/schedule.h> // to be removed later
 
+/*
+ * Number of buckets in the latency histogram. Bucket n counts latencies
+ * below cyclic_lat_limit_us(n), each limit being four times the previous
+ * one, and the last bucket counts everything above that.
+ */
+#define CYCLIC_LAT_BUCKETS	8
+
+/**
+ * cyclic_lat_limit_us() - Get the upper latency limit of a histogram bucket
+ *
+ * @bucket: Bucket number, 0 to CYCLIC_LAT_BUCKETS - 2
+ * Return: latency in us below which calls are counted in @bucket
+ */
+static inline uint32_t cyclic_lat_limit_us(int bucket)
+{
+	return 16U << (2 * bucket);
+}
+
 /**
  * struct cyclic_info - Information about cyclic execution function
  *
@@ -27,8 +45,19 @@
  * @next_call: Next time in us, when the function shall be executed again
  * @list: List node
  * @already_warned: Flag that we've warned about exceeding CPU time usage
+ * @lat_total_us: Total latency in us, i.e. time between @next_call and the
+ *	actual call, over all calls
+ * @lat_max_us: Largest latency in us
+ * @lat_last_us: Latency of the last call in us
+ * @jitter: Smoothed difference between the latencies of successive calls,
+ *	in 1/16 us, as used for interarrival jitter in RFC 3550
+ * @lat_hist: Histogram of latencies, see CYCLIC_LAT_BUCKETS
  *
- * When !CONFIG_CYCLIC, this struct is empty.
+ * When !CONFIG_CYCLIC, this struct is empty. The latency statistics are only
+ * present with CONFIG_CYCLIC_LATENCY_STATS.
+ *
+ * The list of registered functions is kept sorted by @next_call, so that
+ * schedule() only has to look at the first entry when nothing is due.
  */
 struct cyclic_info {
 #if defined(CONFIG_CYCLIC)
@@ -41,6 +70,13 @@ struct cyclic_info {
 	uint64_t next_call;
 	struct hlist_node list;
 	bool already_warned;
+#if defined(CONFIG_CYCLIC_LATENCY_STATS)
+	uint64_t lat_total_us;
+	uint32_t lat_max_us;
+	uint32_t lat_last_us;
+	uint32_t jitter;
+	uint32_t lat_hist[CYCLIC_LAT_BUCKETS];
+#endif
 #endif
 };
 
@@ -12,6 +12,8 @@
 #include <dm/ofnode.h>
 #include <dm/uclass-id.h>
 
+struct udevice_id;
+
 /**
  * lists_driver_lookup_name() - Return u_boot_driver corresponding to name
  *
@@ -23,6 +25,33 @@
  */
 struct driver *lists_driver_lookup_name(const char *name);
 
+/**
+ * lists_driver_lookup_compat() - Find the driver for a compatible string
+ *
+ * This returns the first driver in the linker list with @compat in its
+ * of_match table. The hash index is used if it has been built, otherwise all
+ * drivers are searched.
+ *
+ * @compat: Compatible string to look up
+ * @idp: Returns the matching entry in the driver's of_match table
+ * Return: pointer to driver, or NULL if not found
+ */
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp);
+
+/**
+ * lists_compat_index_init() - Build the compatible-string index
+ *
+ * This creates a hash table covering the of_match tables of all drivers, so
+ * that lists_driver_lookup_compat() does not need to search them. It does
+ * nothing if the index already exists. Before relocation it is only built if
+ * it takes no more than a quarter of the remaining malloc_f space.
+ *
+ * Return: 0 if OK, -ENOSPC if the pre-relocation malloc area is too small,
+ * -ENOMEM if there is not enough memory
+ */
+int lists_compat_index_init(void);
+
 /**
  * lists_uclass_lookup() - Return uclass_driver based on ID of the class
  *
@@ -188,7 +188,8 @@ int dm_remove_devices_flags(uint flags);
  *                            device dependencies as far as know, i.e. removing
  *                            devices marked with DM_FLAG_VITAL last.
  *
- * All active devices will be removed
+ * All active devices will be removed. Any uthreads still running, e.g.
+ * background bootdev hunters, are allowed to finish first.
  */
 void dm_remove_devices_active(void);
 #else
@@ -145,6 +145,21 @@ struct efi_var_file {
  */
 efi_status_t efi_var_to_file(void);
 
+/**
+ * efi_var_append_to_file() - save a changed non-volatile variable
+ *
+ * The new value of the variable, or a record of its deletion, is appended to
+ * file ubootefi.var. The whole file is written instead if its content is
+ * unknown or if the records appended to it would take more space than the
+ * variables they update.
+ *
+ * @variable_name:	name of the changed variable
+ * @vendor:		vendor GUID of the changed variable
+ * Return:		status code
+ */
+efi_status_t efi_var_append_to_file(const u16 *variable_name,
+				    const efi_guid_t *vendor);
+
 /**
  * efi_var_collect() - collect variables in buffer
  *
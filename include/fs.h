@@ -6,6 +6,7 @@
 #define _FS_H
 
 #include <rtc.h>
+#include <linux/list.h>
 
 struct cmd_tbl;
 
@@ -283,6 +284,137 @@ int fs_mkdir(const char *filename);
  */
 int fs_rename(const char *old_path, const char *new_path);
 
+struct fs_mount;
+
+/**
+ * struct fs_file - Structure representing a file opened with fs_open()
+ *
+ * Filesystem drivers which support file handles resolve the path once in
+ * their open() method and store what they need to read the file in @priv.
+ * This is released by their closefile() method, which the fs layer calls
+ * whenever the mount stops being the active one, e.g. because another
+ * filesystem is accessed. The file is then reopened on the next read.
+ *
+ * @mnt:	mount which the file is on
+ * @name:	full path of the file within the filesystem
+ * @size:	size of the file in bytes
+ * @priv:	private data for the filesystem driver
+ * @seq:	value of the mount's activation sequence number when @priv
+ *		was set up
+ * @sibling:	node in the mount's list of open files
+ */
+struct fs_file {
+	struct fs_mount *mnt;
+	char *name;
+	loff_t size;
+	void *priv;
+	uint seq;
+	struct list_head sibling;
+};
+
+/**
+ * fs_mount() - Mount the filesystem on a block device and partition
+ *
+ * Looks up the partition in the mount table, adding it if it is not already
+ * mounted. The filesystem type is only detected when the partition is first
+ * mounted. While the mount is in use, the filesystem driver's state (such as
+ * its superblock) is kept, so that files can be read without probing again.
+ *
+ * Each call must be balanced by a call to fs_umount()
+ *
+ * @desc:	block device, or NULL for a virtual filesystem (e.g. sandbox)
+ * @part:	partition number, or 0 for the whole device
+ * @mntp:	returns the mount
+ * Return: 0 if OK, -ENOMEM if out of memory, -ENOENT if the partition does
+ * not exist, -EPROTONOSUPPORT if no filesystem was recognised
+ */
+int fs_mount(struct blk_desc *desc, int part, struct fs_mount **mntp);
+
+/**
+ * fs_umount() - Release a mount obtained with fs_mount()
+ *
+ * Once the last user has released the mount, it is removed from the mount
+ * table. All files opened on the mount must be closed first.
+ *
+ * @mnt:	mount to release
+ */
+void fs_umount(struct fs_mount *mnt);
+
+/**
+ * fs_umount_blk() - Drop the mounts on a block device which is going away
+ *
+ * The mounts are removed from the mount table, so a later device with the
+ * same descriptor does not find them. Mounts which are still in use stay
+ * allocated until they are released, but reading their files fails with
+ * -ENODEV. Filesystem drivers also drop anything they cache about the
+ * device.
+ *
+ * @desc:	block device being removed
+ */
+void fs_umount_blk(struct blk_desc *desc);
+
+/**
+ * fs_mount_get_type() - Get the filesystem type of a mount
+ *
+ * @mnt:	mount to check
+ * Return: filesystem type (FS_TYPE\_...)
+ */
+int fs_mount_get_type(struct fs_mount *mnt);
+
+/**
+ * fs_open() - Open a regular file for reading
+ *
+ * The path is resolved once, so later reads through the returned handle do
+ * not need to look it up again.
+ *
+ * @mnt:	mount containing the file
+ * @filename:	full path of the file
+ * @filep:	returns the file handle, which must be closed with
+ *		fs_closefile()
+ * Return: 0 if OK, -ENOMEM if out of memory, other -ve value if the file
+ * could not be found or is not a regular file
+ */
+int fs_open(struct fs_mount *mnt, const char *filename,
+	    struct fs_file **filep);
+
+/**
+ * fs_file_size() - Get the size of an open file
+ *
+ * If the filesystem has been accessed by other means since the file was
+ * opened, e.g. to write to it, the file is looked up again so that the size
+ * is up to date.
+ *
+ * @file:	file to check
+ * @sizep:	returns the size of the file in bytes
+ * Return: 0 if OK, -ve if the file could not be looked up again
+ */
+int fs_file_size(struct fs_file *file, loff_t *sizep);
+
+/**
+ * fs_pread() - Read from an open file at a given offset
+ *
+ * This does not change any file position, so a caller can keep its own.
+ * Reading at or beyond the end of the file is not an error but returns no
+ * data.
+ *
+ * @file:	file to read from
+ * @buf:	buffer to read into
+ * @offset:	offset within the file to read from
+ * @len:	maximum number of bytes to read
+ * @actread:	returns the number of bytes read, which is less than @len if
+ *		the end of the file was reached
+ * Return: 0 if OK, -ve on error
+ */
+int fs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+	     loff_t *actread);
+
+/**
+ * fs_closefile() - Close a file opened with fs_open()
+ *
+ * @file:	file to close (NULL is permitted and does nothing)
+ */
+void fs_closefile(struct fs_file *file);
+
 /*
  * Common implementation for various filesystem commands, optionally limited
  * to a specific filesystem type via the fstype parameter.
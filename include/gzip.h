@@ -34,6 +34,28 @@ int gzip_parse_header(const unsigned char *src, unsigned long len);
  */
 int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp);
 
+/**
+ * gunzip_tap() - Decompress gzipped data, passing the input to a callback
+ *
+ * This works like gunzip() but feeds the input to the decompressor in
+ * chunks. Each chunk is passed to @tap just before it is decompressed, so the
+ * caller can process it (e.g. hash it) while it is still in the cache. The
+ * gzip header is passed first and anything after the compressed data (such
+ * as the trailer) is passed last, so @tap sees all of @src in order.
+ *
+ * @dst: Destination for uncompressed data
+ * @dstlen: Size of destination buffer
+ * @src: Source data to decompress
+ * @lenp: On entry, length of data at @src. On exit, number of bytes written to
+ * @dst
+ * @tap: Function to call with each chunk of @src; a non-zero return value
+ * stops decompression
+ * @priv: Private data for @tap
+ * Return: 0 if OK, -1 on error
+ */
+int gunzip_tap(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+	       int (*tap)(void *priv, const void *buf, ulong len), void *priv);
+
 /**
  * zunzip() - Uncompress blocks compressed with zlib without headers
  *
@@ -42,3 +42,72 @@ static inline int is_sparse_image(void *buf)
 
 int write_sparse_image(struct sparse_storage *info, const char *part_name,
 		       void *data, char *response);
+
+/**
+ * struct sparse_stream - State for writing a sparse image as it arrives
+ *
+ * This allows a sparse image to be written without holding all of it in
+ * memory, by passing it to sparse_stream_write() in pieces of any size.
+ *
+ * @info: Storage to write to
+ * @state: Part of the image expected next (enum sparse_stream_state)
+ * @hdr: Sparse image header
+ * @chunk: Header of the current chunk
+ * @part: Header or fill value collected so far
+ * @part_len: Number of bytes in @part
+ * @skip: Number of bytes to skip before @state
+ * @left: Bytes of raw data left in the current chunk
+ * @chunks: Number of chunks done
+ * @blk: Next block to write
+ * @total_blocks: Number of blocks in the image output so far
+ * @buf: Buffer for raw data and fill patterns, aligned for DMA
+ * @buf_size: Size of @buf in bytes, a multiple of the storage block size
+ * @buf_used: Bytes of raw data in @buf
+ */
+struct sparse_stream {
+	struct sparse_storage *info;
+	int state;
+	sparse_header_t hdr;
+	chunk_header_t chunk;
+	u8 part[sizeof(sparse_header_t)];
+	uint part_len;
+	ulong skip;
+	u64 left;
+	uint chunks;
+	lbaint_t blk;
+	u32 total_blocks;
+	void *buf;
+	ulong buf_size;
+	ulong buf_used;
+};
+
+/**
+ * sparse_stream_init() - Prepare to write a sparse image in pieces
+ *
+ * @ss: Stream state to set up
+ * @info: Storage to write to; the image is written from block @info->start
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info);
+
+/**
+ * sparse_stream_write() - Write the next piece of a sparse image
+ *
+ * @ss: Stream state
+ * @data: Next part of the image
+ * @len: Number of bytes in @data
+ * Return: 0 if OK, -EINVAL if the image is not valid, -ENOSPC if it does not
+ *	fit, -EIO on write error
+ */
+int sparse_stream_write(struct sparse_stream *ss, const void *data, ulong len);
+
+/**
+ * sparse_stream_finish() - Check that the sparse image was complete
+ *
+ * This also frees the memory used by the stream.
+ *
+ * @ss: Stream state
+ * Return: size of the expanded image in bytes, including areas which were
+ *	not written, or -EINVAL if the image was incomplete
+ */
+s64 sparse_stream_finish(struct sparse_stream *ss);
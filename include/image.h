@@ -367,6 +367,11 @@ struct bootm_headers {
 	void		*fit_hdr_os;	/* os FIT image header */
 	const char	*fit_uname_os;	/* os subimage node unit name */
 	int		fit_noffset_os;	/* os subimage node offset */
+	/*
+	 * Set by bootm to let fit_image_load() leave the os hash check to
+	 * bootm_load_os(); cleared by fit_image_load() if it cannot do that
+	 */
+	bool		fit_os_hash_defer;
 
 	void		*fit_hdr_rd;	/* init ramdisk FIT image header */
 	const char	*fit_uname_rd;	/* init ramdisk subimage node unit name */
@@ -1012,6 +1017,53 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+/**
+ * image_move_tap() - move data, passing it to a callback
+ *
+ * This moves @len bytes from @src to @dst (which may overlap), passing each
+ * chunk to @tap, in order, just before it is moved.
+ *
+ * @dst:	Destination
+ * @src:	Source
+ * @len:	Number of bytes to move
+ * @tap:	Function to call with each chunk of @src; a non-zero return
+ *		value stops the move and is returned
+ * @priv:	Private data for @tap
+ * Return: 0 if OK, else the error returned by @tap
+ */
+int image_move_tap(void *dst, const void *src, ulong len,
+		   int (*tap)(void *priv, const void *buf, ulong len),
+		   void *priv);
+
+/**
+ * image_decomp_tap() - decompress an image, passing its data to a callback
+ *
+ * This works like image_decomp() but also passes all @image_len bytes of
+ * @image_buf to @tap, in order. Where the decompressor supports it, the data
+ * is passed in chunks just before each chunk is consumed, so the caller can
+ * hash it while it is still in the cache. Otherwise all of it is passed
+ * before decompression starts.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @load:	Destination load address in U-Boot memory
+ * @image_start Image start address (where we are decompressing from)
+ * @type:	OS type (IH_OS_...)
+ * @load_buf:	Place to decompress to
+ * @image_buf:	Address to decompress from
+ * @image_len:	Number of bytes in @image_buf to decompress
+ * @unc_len:	Available space for decompression
+ * @load_end:	Returns the end address of the decompressed data
+ * @tap:	Function to call with each chunk of @image_buf; a non-zero
+ *		return value stops decompression and is returned
+ * @priv:	Private data for @tap
+ * Return: 0 if OK, -ve on error (BOOTM_ERR_...)
+ */
+int image_decomp_tap(int comp, ulong load, ulong image_start, int type,
+		     void *load_buf, void *image_buf, ulong image_len,
+		     uint unc_len, ulong *load_end,
+		     int (*tap)(void *priv, const void *buf, ulong len),
+		     void *priv);
+
 /**
  * Set up properties in the FDT
  *
@@ -1069,6 +1121,8 @@ int booti_setup(ulong image, ulong *relocated_addr, ulong *size,
 #define FIT_ALGO_PROP		"algo"
 #define FIT_VALUE_PROP		"value"
 #define FIT_IGNORE_PROP		"uboot-ignore"
+#define FIT_CHUNK_SIZE_PROP	"chunk-size"
+#define FIT_CHUNK_VALUE_PROP	"chunk-value"
 #define FIT_SIG_NODENAME	"signature"
 #define FIT_KEY_REQUIRED	"required"
 #define FIT_KEY_HINT		"key-name-hint"
@@ -1258,6 +1312,34 @@ int fit_image_hash_get_algo(const void *fit, int noffset, const char **algo);
 int fit_image_hash_get_value(const void *fit, int noffset, uint8_t **value,
 				int *value_len);
 
+/**
+ * fit_image_hash_get_chunk_size() - Get the chunk size of a chunked hash
+ *
+ * A hash node with a chunk-size property holds the hash of each chunk of the
+ * data in its chunk-value property, and the hash of chunk-value in its value
+ * property
+ *
+ * @fit:	FIT to read
+ * @noffset:	Offset of the hash node
+ * @chunk_sizep: Returns the chunk size in bytes
+ * Return: 0 if OK, -ENOENT if the hash is not chunked, -EINVAL if the chunk
+ *	size is invalid
+ */
+int fit_image_hash_get_chunk_size(const void *fit, int noffset,
+				  uint *chunk_sizep);
+
+/**
+ * fit_hash_chunk_count() - Get the number of chunks in a chunked hash
+ *
+ * @size:	Size of the data in bytes
+ * @chunk_size:	Size of each chunk in bytes
+ * Return: number of chunks, the last of which may be partial
+ */
+static inline uint fit_hash_chunk_count(size_t size, uint chunk_size)
+{
+	return (size + chunk_size - 1) / chunk_size;
+}
+
 int fit_set_timestamp(void *fit, int noffset, time_t timestamp);
 
 /**
@@ -1341,6 +1423,100 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       size_t size);
 
 int fit_image_verify(const void *fit, int noffset);
+
+/* Maximum number of hash nodes which a struct fit_hash_stream can check */
+#define FIT_HASH_STREAM_MAX	4
+
+/**
+ * struct fit_hash_stream - Hashes of an image which are being calculated
+ *
+ * This allows the hashes of an image to be calculated while its data is
+ * copied or decompressed, rather than in a separate pass beforehand.
+ *
+ * @fit:	FIT containing the image
+ * @noffset:	Offset of the image node in @fit
+ * @count:	Number of hash nodes being calculated
+ * @node:	Offset of each hash node
+ * @algo:	Hash algorithm of each hash node
+ * @ctx:	Progressive-hash context of each hash node, NULL once freed
+ */
+struct fit_hash_stream {
+	const void *fit;
+	int noffset;
+	int count;
+	int node[FIT_HASH_STREAM_MAX];
+	struct hash_algo *algo[FIT_HASH_STREAM_MAX];
+	void *ctx[FIT_HASH_STREAM_MAX];
+};
+
+/**
+ * fit_image_hash_stream_check() - Check if an image's hashes can be streamed
+ *
+ * This is false if the image must be verified in one go by fit_image_verify(),
+ * e.g. because it has signature or cipher nodes, has a chunked hash, or uses a
+ * hash algorithm without progressive-hash support.
+ *
+ * @fit:	FIT containing the image
+ * @noffset:	Offset of the image node in @fit
+ * Return: true if fit_image_hash_stream_start() can be used for the image
+ */
+bool fit_image_hash_stream_check(const void *fit, int noffset);
+
+/**
+ * fit_image_hash_stream_start() - Start calculating the hashes of an image
+ *
+ * @hs:		Returns the hash state
+ * @fit:	FIT containing the image
+ * @noffset:	Offset of the image node in @fit
+ * Return: 0 if OK, -ENOTSUPP if fit_image_hash_stream_check() fails,
+ *	-ENOMEM if out of memory
+ */
+int fit_image_hash_stream_start(struct fit_hash_stream *hs, const void *fit,
+				int noffset);
+
+/**
+ * fit_image_hash_stream_update() - Add some image data to the hashes
+ *
+ * All of the image data must be passed in order, each byte exactly once.
+ *
+ * @hs:		Hash state
+ * @data:	Next part of the image data
+ * @len:	Number of bytes at @data
+ * Return: 0 if OK, -EIO on error
+ */
+int fit_image_hash_stream_update(struct fit_hash_stream *hs, const void *data,
+				 ulong len);
+
+/**
+ * fit_image_hash_stream_tap() - Add some image data to the hashes
+ *
+ * This is fit_image_hash_stream_update() in a form which can be passed as
+ * the @tap function of image_decomp_tap() and image_move_tap()
+ *
+ * @hs:		Hash state (struct fit_hash_stream *)
+ * @data:	Next part of the image data
+ * @len:	Number of bytes at @data
+ * Return: 0 if OK, -EIO on error
+ */
+int fit_image_hash_stream_tap(void *hs, const void *data, ulong len);
+
+/**
+ * fit_image_hash_stream_finish() - Check the hashes of an image
+ *
+ * This prints the algorithm name of each hash node in the same way as
+ * fit_image_verify(), then frees the hash state.
+ *
+ * @hs:		Hash state
+ * Return: 0 if all hashes match, -EACCES if not
+ */
+int fit_image_hash_stream_finish(struct fit_hash_stream *hs);
+
+/**
+ * fit_image_hash_stream_abort() - Free the hash state without checking it
+ *
+ * @hs:		Hash state
+ */
+void fit_image_hash_stream_abort(struct fit_hash_stream *hs);
 #if CONFIG_IS_ENABLED(FIT_SIGNATURE)
 int fit_config_verify(const void *fit, int conf_noffset);
 #else
@@ -1464,6 +1640,24 @@ int fit_check_ramdisk(const void *fit, int os_noffset,
 int calculate_hash(const void *data, int data_len, const char *algo,
 			uint8_t *value, int *value_len);
 
+/**
+ * calculate_chunk_hashes() - Hash data in fixed-size chunks
+ *
+ * The hashes of each chunk are written one after another to @values. The last
+ * chunk may be shorter than @chunk_size.
+ *
+ * @data:	Data to hash
+ * @size:	Size of data in bytes
+ * @algo:	Name of hash algorithm, e.g. "sha256"
+ * @chunk_size:	Size of each chunk in bytes
+ * @values:	Returns the hashes; must have space for FIT_MAX_HASH_LEN bytes
+ *		for each chunk (see fit_hash_chunk_count())
+ * @values_len:	Returns the number of bytes written to @values
+ * Return: 0 if OK, -1 if the algorithm is unsupported
+ */
+int calculate_chunk_hashes(const void *data, size_t size, const char *algo,
+			   uint chunk_size, uint8_t *values, int *values_len);
+
 /*
  * At present we only support signing on the host, and verification on the
  * device
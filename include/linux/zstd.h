@@ -455,4 +455,23 @@ struct abuf;
  */
 int zstd_decompress(struct abuf *in, struct abuf *out);
 
+/**
+ * zstd_decompress_tap() - Decompress Zstandard data, passing input to a callback
+ *
+ * This works like zstd_decompress() but decompresses one block at a time,
+ * passing each block of input to @tap just before it is decompressed. Only
+ * the first frame is decompressed; anything after it is passed to @tap at the
+ * end, so @tap sees all of @in in order.
+ *
+ * @in: Input buffer to decompress
+ * @out: Output buffer to hold the results (must be large enough)
+ * @tap: Function to call with each block of input; a non-zero return value
+ *	stops decompression and is returned
+ * @priv: Private data for @tap
+ * Return: size of the decompressed data, or -ve on error
+ */
+int zstd_decompress_tap(struct abuf *in, struct abuf *out,
+			int (*tap)(void *priv, const void *buf, ulong len),
+			void *priv);
+
 #endif  /* LINUX_ZSTD_H */
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Named arenas for allocations which are released together
+ */
+
+#ifndef __MALLOC_ARENA_H
+#define __MALLOC_ARENA_H
+
+#include <linux/list.h>
+#include <linux/types.h>
+
+struct arena_block;
+
+/**
+ * struct malloc_arena - An arena from which memory is allocated
+ *
+ * Memory is allocated from blocks obtained with malloc(), by moving a pointer
+ * along the current block. Individual allocations cannot be freed; everything
+ * is released at once by malloc_arena_reset() or malloc_arena_destroy().
+ *
+ * @name: Name of the arena, shown by the meminfo command
+ * @sibling: Node in the list of all arenas
+ * @blocks: Most recently allocated block, which is linked to the earlier ones
+ * @nblocks: Number of blocks held
+ * @size: Total bytes in the blocks, excluding their headers
+ * @used: Bytes allocated from the blocks, including alignment padding
+ * @peak: Largest value @used has reached
+ * @count: Number of allocations made
+ */
+struct malloc_arena {
+	const char *name;
+	struct list_head sibling;
+	struct arena_block *blocks;
+	uint nblocks;
+	ulong size;
+	ulong used;
+	ulong peak;
+	uint count;
+};
+
+/**
+ * malloc_arena_create() - Create a new arena
+ *
+ * @name: Name for the arena, which must remain valid until the arena is
+ *	destroyed
+ * Return: new arena, or NULL if out of memory
+ */
+struct malloc_arena *malloc_arena_create(const char *name);
+
+/**
+ * malloc_arena_alloc() - Allocate memory from an arena
+ *
+ * The memory is aligned as for malloc() and is not cleared
+ *
+ * @arena: Arena to allocate from
+ * @size: Number of bytes needed
+ * Return: pointer to the memory, or NULL if out of memory
+ */
+void *malloc_arena_alloc(struct malloc_arena *arena, size_t size);
+
+/**
+ * malloc_arena_zalloc() - Allocate zeroed memory from an arena
+ *
+ * @arena: Arena to allocate from
+ * @size: Number of bytes needed
+ * Return: pointer to the memory, or NULL if out of memory
+ */
+void *malloc_arena_zalloc(struct malloc_arena *arena, size_t size);
+
+/**
+ * malloc_arena_strdup() - Copy a string into an arena
+ *
+ * @arena: Arena to allocate from
+ * @str: String to copy
+ * Return: pointer to the copy, or NULL if out of memory
+ */
+char *malloc_arena_strdup(struct malloc_arena *arena, const char *str);
+
+/**
+ * malloc_arena_reset() - Release everything allocated from an arena
+ *
+ * The arena can be used again afterwards. Its peak usage is retained.
+ *
+ * @arena: Arena to reset
+ */
+void malloc_arena_reset(struct malloc_arena *arena);
+
+/**
+ * malloc_arena_destroy() - Release an arena and everything allocated from it
+ *
+ * @arena: Arena to destroy, or NULL to do nothing
+ */
+void malloc_arena_destroy(struct malloc_arena *arena);
+
+/**
+ * malloc_arena_list() - Get the list of arenas
+ *
+ * Return: list of struct malloc_arena, linked by @sibling
+ */
+struct list_head *malloc_arena_list(void);
+
+#endif
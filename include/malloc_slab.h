@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Size-class slabs for small malloc() allocations
+ */
+
+#ifndef __MALLOC_SLAB_H
+#define __MALLOC_SLAB_H
+
+#include <linux/types.h>
+
+/* Size of each slab page, which holds objects of a single size class */
+#define SLAB_PAGE_SIZE		4096
+
+/* Largest allocation served from the slabs */
+#define SLAB_MAX_SIZE		256
+
+/**
+ * struct malloc_slab_info - Usage of one slab size class
+ *
+ * @size: Object size for this class in bytes
+ * @pages: Number of pages assigned to the class
+ * @used: Number of objects currently allocated
+ * @peak: Largest value @used has reached
+ * @free: Number of free objects in the class's pages
+ */
+struct malloc_slab_info {
+	uint size;
+	uint pages;
+	uint used;
+	uint peak;
+	uint free;
+};
+
+/**
+ * malloc_slab_init() - Set up the slabs at the start of the malloc() pool
+ *
+ * The slab region is page-aligned and takes CONFIG_SYS_MALLOC_SLAB_LEN bytes.
+ * Any previous slab state is discarded.
+ *
+ * @start: Start of the malloc() pool
+ * @size: Size of the malloc() pool in bytes
+ * Return: number of bytes used from @start, which dlmalloc must not use, or 0
+ *	if the pool is too small to hold the slabs
+ */
+ulong malloc_slab_init(ulong start, ulong size);
+
+/**
+ * malloc_slab_alloc() - Allocate a small object
+ *
+ * The object is aligned to its size-class, which is a power of two
+ *
+ * @bytes: Number of bytes needed
+ * Return: pointer to the object, or NULL if @bytes is larger than
+ *	SLAB_MAX_SIZE or there is no room left in the slabs
+ */
+void *malloc_slab_alloc(size_t bytes);
+
+/**
+ * malloc_slab_owns() - Check whether memory came from the slabs
+ *
+ * @ptr: Pointer to check
+ * Return: true if @ptr is within the slab region
+ */
+bool malloc_slab_owns(const void *ptr);
+
+/**
+ * malloc_slab_free() - Free an object allocated by malloc_slab_alloc()
+ *
+ * @ptr: Object to free
+ */
+void malloc_slab_free(void *ptr);
+
+/**
+ * malloc_slab_usable_size() - Get the number of bytes usable in an object
+ *
+ * @ptr: Object allocated by malloc_slab_alloc()
+ * Return: size of the object's class
+ */
+size_t malloc_slab_usable_size(const void *ptr);
+
+/**
+ * malloc_slab_in_use() - Get the number of bytes allocated from the slabs
+ *
+ * This counts whole objects, so it includes the rounding up of each
+ * allocation to its size class.
+ *
+ * Return: bytes held by objects which have not been freed
+ */
+ulong malloc_slab_in_use(void);
+
+/**
+ * malloc_slab_get_info() - Get usage information for a size class
+ *
+ * @seq: Class number, starting from 0 for the smallest
+ * @info: Returns the usage information
+ * Return: 0 if OK, -ENOENT if @seq is beyond the last class
+ */
+int malloc_slab_get_info(uint seq, struct malloc_slab_info *info);
+
+#endif
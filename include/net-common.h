@@ -255,7 +255,8 @@ enum eth_recv_flags {
  *	 called if supplied
  * free_pkt: Give the driver an opportunity to manage its packet buffer memory
  *	     when the network stack is finished processing it. This will only be
- *	     called when no error was returned from recv - optional
+ *	     called when no error was returned from recv. See also
+ *	     eth_pdata::rx_hold - optional
  * stop: Stop the hardware from looking for packets - may be called even if
  *	 state == PASSIVE
  * mcast: Join or leave a multicast group (for TFTP) - optional
@@ -316,6 +317,11 @@ enum eth_state_t {
  * @phy_interface: PHY interface to use - see PHY_INTERFACE_MODE_...
  * @max_speed: Maximum speed of Ethernet connection supported by MAC
  * @priv_pdata: device specific plat
+ * @rx_hold: Number of received packets which the network stack may keep
+ *	     before passing them back with free_pkt(), so that it can use them
+ *	     without copying. A driver setting this must accept free_pkt() for
+ *	     these packets in any order and at any time, even after stop() and
+ *	     start(). If 0, free_pkt() is called before the next recv().
  */
 struct eth_pdata {
 	phys_addr_t iobase;
@@ -323,6 +329,7 @@ struct eth_pdata {
 	int phy_interface;
 	int max_speed;
 	void *priv_pdata;
+	int rx_hold;
 };
 
 struct ethernet_hdr {
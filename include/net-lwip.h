@@ -24,6 +24,16 @@ void net_lwip_remove_netif(struct netif *netif);
 struct netif *net_lwip_get_netif(void);
 int net_lwip_rx(struct udevice *udev, struct netif *netif);
 
+/**
+ * net_lwip_release_rx() - Stop lwIP using a device's receive buffers
+ *
+ * Packets received by @udev which lwIP still holds are copied, so that the
+ * device can be removed while lwIP is using them.
+ *
+ * @udev: Ethernet device being removed
+ */
+void net_lwip_release_rx(struct udevice *udev);
+
 /**
  * wget_validate_uri() - varidate the uri
  *
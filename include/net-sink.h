@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Writing network downloads to storage as they arrive
+ */
+
+#ifndef __NET_SINK_H
+#define __NET_SINK_H
+
+#include <image-sparse.h>
+#include <part.h>
+#include <linux/types.h>
+
+struct blk_desc;
+
+/**
+ * enum net_sink_type - Where a net sink writes its data
+ *
+ * @NET_SINK_BLK: Raw blocks, starting at a given block of a device
+ * @NET_SINK_SPARSE: Android sparse image, expanded onto a device or partition
+ * @NET_SINK_FILE: File in a filesystem
+ */
+enum net_sink_type {
+	NET_SINK_BLK,
+	NET_SINK_SPARSE,
+	NET_SINK_FILE,
+};
+
+/**
+ * struct net_sink - Destination for downloaded data
+ *
+ * The download is collected in a buffer of CONFIG_NET_SINK_BUF_SIZE bytes,
+ * which is written out whenever it is full, so only that much memory is
+ * needed however large the download is.
+ *
+ * @type: Type of sink
+ * @desc: Block device to write to, for NET_SINK_BLK and NET_SINK_SPARSE
+ * @start: First block to write, for NET_SINK_BLK and NET_SINK_SPARSE
+ * @size: Number of blocks available from @start
+ * @blk: Next block to write, for NET_SINK_BLK
+ * @ifname: Interface name, for NET_SINK_FILE
+ * @dev_part: Device and partition, for NET_SINK_FILE
+ * @fname: Filename, for NET_SINK_FILE
+ * @storage: Storage callbacks, for NET_SINK_SPARSE
+ * @stream: Sparse image parser state, for NET_SINK_SPARSE
+ * @buf: Buffer for data not written yet
+ * @used: Number of bytes in @buf
+ * @pos: Offset in the download of the start of @buf
+ */
+struct net_sink {
+	enum net_sink_type type;
+	struct blk_desc *desc;
+	lbaint_t start;
+	lbaint_t size;
+	lbaint_t blk;
+	const char *ifname;
+	const char *dev_part;
+	const char *fname;
+	struct sparse_storage storage;
+	struct sparse_stream stream;
+	char *buf;
+	ulong used;
+	u64 pos;
+};
+
+#if CONFIG_IS_ENABLED(NET_SINK)
+/**
+ * net_sink_start() - Send downloads to a sink
+ *
+ * Until net_sink_finish() is called, tftpboot and wget write what they
+ * download to @sink rather than to memory. The fields describing the
+ * destination must be set up by the caller.
+ *
+ * @sink: Sink to use
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int net_sink_start(struct net_sink *sink);
+
+/**
+ * net_sink_finish() - Write out what is left and stop using the sink
+ *
+ * @sink: Sink passed to net_sink_start()
+ * @abort: true if the download failed, in which case nothing more is written
+ * Return: number of bytes written, or -ve on error
+ */
+s64 net_sink_finish(struct net_sink *sink, bool abort);
+
+/**
+ * net_sink_active() - Check whether downloads go to a sink
+ *
+ * Return: true if a sink is in use
+ */
+bool net_sink_active(void);
+
+/**
+ * net_sink_size() - Get the number of bytes passed to the sink so far
+ *
+ * This is 64 bits wide so that downloads larger than 4GiB are counted
+ * correctly on 32-bit boards.
+ *
+ * Return: number of bytes received, which is also the next offset expected
+ */
+u64 net_sink_size(void);
+
+/**
+ * net_sink_write() - Pass downloaded data to the sink
+ *
+ * Data must be passed in order. A write at offset 0 after other data starts
+ * the download again, e.g. when a TFTP transfer is restarted.
+ *
+ * @offset: Offset of @data in the download
+ * @data: Data received
+ * @len: Number of bytes in @data
+ * Return: 0 if OK, -ESPIPE if @offset is not the next byte expected, other
+ *	-ve on write error
+ */
+int net_sink_write(u64 offset, const void *data, ulong len);
+#else
+static inline bool net_sink_active(void)
+{
+	return false;
+}
+
+static inline u64 net_sink_size(void)
+{
+	return 0;
+}
+
+static inline int net_sink_write(u64 offset, const void *data, ulong len)
+{
+	return -ENOSYS;
+}
+#endif
+
+#endif
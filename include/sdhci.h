@@ -253,6 +253,8 @@
 #define SDHCI_QUIRK_SUPPORT_SINGLE	(1 << 10)
 /* Capability register bit-63 indicates HS400 support */
 #define SDHCI_QUIRK_CAPS_BIT63_FOR_HS400	BIT(11)
+/* Multi-block transfers must be ended with CMD12, not set up with CMD23 */
+#define SDHCI_QUIRK_BROKEN_CMD23	BIT(12)
 
 /* to make gcc happy */
 struct sdhci_host;
@@ -11,6 +11,7 @@
 #define _SQFS_H_
 
 struct disk_partition;
+struct fs_file;
 
 int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp);
 int sqfs_readdir(struct fs_dir_stream *dirs, struct fs_dirent **dentp);
@@ -19,6 +20,11 @@ int sqfs_probe(struct blk_desc *fs_dev_desc,
 int sqfs_read(const char *filename, void *buf, loff_t offset,
 	      loff_t len, loff_t *actread);
 int sqfs_size(const char *filename, loff_t *size);
+int sqfs_open(struct fs_file *file);
+int sqfs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+	       loff_t *actread);
+void sqfs_closefile(struct fs_file *file);
+void sqfs_forget(struct blk_desc *desc);
 int sqfs_exists(const char *filename);
 void sqfs_close(void);
 void sqfs_closedir(struct fs_dir_stream *dirs);
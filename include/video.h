@@ -69,6 +69,27 @@ enum video_format {
 	VIDEO_X2R10G10B10,
 };
 
+#ifdef CONFIG_VIDEO_DAMAGE_RECTS
+#define VIDEO_DAMAGE_RECTS	CONFIG_VIDEO_DAMAGE_RECTS
+#else
+#define VIDEO_DAMAGE_RECTS	1
+#endif
+
+/**
+ * struct video_damage_rect - A damaged region of the frame buffer
+ *
+ * @xstart:	X start position in pixels from the left
+ * @ystart:	Y start position in pixels from the top
+ * @xend:	X end position in pixels from the left (exclusive)
+ * @yend:	Y end position in pixels from the top (exclusive)
+ */
+struct video_damage_rect {
+	int xstart;
+	int ystart;
+	int xend;
+	int yend;
+};
+
 /**
  * struct video_priv - Device information used by the video uclass
  *
@@ -85,11 +106,10 @@ enum video_format {
  * @fb_size:	Frame buffer size
  * @copy_fb:	Copy of the frame buffer to keep up to date; see struct
  *		video_uc_plat
- * @damage:	A bounding box of framebuffer regions updated since last sync
- * @damage.xstart:	X start position in pixels from the left
- * @damage.ystart:	Y start position in pixels from the top
- * @damage.xend:	X end position in pixels from the left
- * @damage.xend:	Y end position in pixels from the top
+ * @damage:	Framebuffer regions updated since last sync
+ * @damage.count:	Number of rectangles in use
+ * @damage.rect:	Damaged rectangles. These do not overlap or touch. There
+ *		is one more than VIDEO_DAMAGE_RECTS, for use while merging
  * @line_length:	Length of each frame buffer line, in bytes. This can be
  *		set by the driver, but if not, the uclass will set it after
  *		probing
@@ -120,10 +140,8 @@ struct video_priv {
 	int fb_size;
 	void *copy_fb;
 	struct {
-		int xstart;
-		int ystart;
-		int xend;
-		int yend;
+		int count;
+		struct video_damage_rect rect[VIDEO_DAMAGE_RECTS + 1];
 	} damage;
 	int line_length;
 	u32 colour_fg;
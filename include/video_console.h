@@ -594,4 +594,54 @@ int vidconsole_get_font_size(struct udevice *dev, const char **name, uint *sizep
  */
 void vidconsole_set_quiet(struct udevice *dev, bool quiet);
 
+/**
+ * struct console_tt_glyph_stats - Statistics for the TrueType glyph cache
+ *
+ * @hits: Number of glyphs found in the cache
+ * @misses: Number of glyphs rendered because they were not in the cache
+ * @evictions: Number of glyphs dropped from the cache to make space
+ * @used: Number of bytes used by cached glyphs
+ */
+struct console_tt_glyph_stats {
+	uint hits;
+	uint misses;
+	uint evictions;
+	uint used;
+};
+
+#if IS_ENABLED(CONFIG_CONSOLE_TRUETYPE)
+/**
+ * console_truetype_glyph_stats() - Get statistics for the glyph cache
+ *
+ * @dev: TrueType vidconsole device
+ * @stats: Returns the statistics, counted since the device was probed
+ * Return: 0 if OK, -ENOSYS if the glyph cache is not in use
+ */
+int console_truetype_glyph_stats(struct udevice *dev,
+				 struct console_tt_glyph_stats *stats);
+
+/**
+ * console_truetype_set_glyph_cache_size() - Set the size of the glyph cache
+ *
+ * The least recently used glyphs are dropped until the cache fits
+ *
+ * @dev: TrueType vidconsole device
+ * @size: Maximum number of bytes to use for cached glyphs, 0 to cache none
+ * Return: 0 if OK, -ENOSYS if the glyph cache is not in use
+ */
+int console_truetype_set_glyph_cache_size(struct udevice *dev, uint size);
+#else
+static inline int console_truetype_glyph_stats(struct udevice *dev,
+					struct console_tt_glyph_stats *stats)
+{
+	return -ENOSYS;
+}
+
+static inline int console_truetype_set_glyph_cache_size(struct udevice *dev,
+							uint size)
+{
+	return -ENOSYS;
+}
+#endif
+
 #endif
@@ -40,6 +40,9 @@ struct file_handle {
 	struct fs_dir_stream *dirs;
 	struct fs_dirent *dent;
 
+	/* for reading a regular file, see open_fs_file() */
+	struct fs_file *file;
+
 	char *path;
 };
 #define to_fh(x) container_of(x, struct file_handle, base)
@@ -59,6 +62,45 @@ static int set_blk_dev(struct file_handle *fh)
 	return fs_set_blk_dev_with_part(fh->fs->desc, fh->fs->part);
 }
 
+/**
+ * open_fs_file() - open a regular file for reading through the fs layer
+ *
+ * The path is only resolved once, and the file system stays mounted while the
+ * file is open, so that each read does not have to probe the file system and
+ * look up the path again.
+ *
+ * @fh:		file handle
+ * Return:	0 if OK, -ve if the path does not refer to a regular file
+ */
+static int open_fs_file(struct file_handle *fh)
+{
+	struct fs_mount *mnt;
+	int ret;
+
+	if (fh->file)
+		return 0;
+
+	ret = fs_mount(fh->fs->desc, fh->fs->part, &mnt);
+	if (ret)
+		return ret;
+	ret = fs_open(mnt, fh->path, &fh->file);
+	/* an open file holds its own reference to the mount */
+	fs_umount(mnt);
+
+	return ret;
+}
+
+/**
+ * close_fs_file() - close the file opened by open_fs_file(), if any
+ *
+ * @fh:		file handle
+ */
+static void close_fs_file(struct file_handle *fh)
+{
+	fs_closefile(fh->file);
+	fh->file = NULL;
+}
+
 /**
  * is_dir() - check if file handle points to directory
  *
@@ -221,6 +263,10 @@ static struct efi_file_handle *file_open(struct file_system *fs,
 		if (sanitize_path(fh->path))
 			goto error;
 
+		/* an existing regular file can be opened directly */
+		if (!open_fs_file(fh))
+			return &fh->base;
+
 		/* check if file exists: */
 		if (set_blk_dev(fh))
 			goto error;
@@ -371,6 +417,7 @@ out:
 
 static efi_status_t file_close(struct file_handle *fh)
 {
+	close_fs_file(fh);
 	fs_closedir(fh->dirs);
 	free(fh->path);
 	free(fh);
@@ -414,6 +461,12 @@ static efi_status_t EFIAPI efi_file_delete(struct efi_file_handle *file)
 static efi_status_t efi_get_file_size(struct file_handle *fh,
 				      loff_t *file_size)
 {
+	if (!fh->isdir && !open_fs_file(fh)) {
+		if (fs_file_size(fh->file, file_size))
+			return EFI_DEVICE_ERROR;
+		return EFI_SUCCESS;
+	}
+
 	if (set_blk_dev(fh))
 		return EFI_DEVICE_ERROR;
 
@@ -482,10 +535,9 @@ static efi_status_t file_read(struct file_handle *fh, u64 *buffer_size,
 		return ret;
 	}
 
-	if (set_blk_dev(fh))
+	if (open_fs_file(fh))
 		return EFI_DEVICE_ERROR;
-	if (fs_read(fh->path, map_to_sysmem(buffer), fh->offset,
-		    *buffer_size, &actread))
+	if (fs_pread(fh->file, buffer, fh->offset, *buffer_size, &actread))
 		return EFI_DEVICE_ERROR;
 
 	*buffer_size = actread;
@@ -1015,6 +1067,7 @@ static efi_status_t EFIAPI efi_file_setinfo(struct efi_file_handle *file,
 				ret = EFI_ACCESS_DENIED;
 				goto out;
 			}
+			close_fs_file(fh);
 			free(fh->path);
 			fh->path = new_path;
 			/* Prevent new_path from being freed on out */
@@ -25,6 +25,17 @@
 
 static const efi_guid_t shim_lock_guid = SHIM_LOCK_GUID;
 
+/*
+ * Length of file ubootefi.var and of the complete set of variables at its
+ * start, which may be followed by records of changed variables. Zero if the
+ * file content is not known.
+ */
+static loff_t __maybe_unused efi_var_file_len;
+static loff_t __maybe_unused efi_var_file_base_len;
+
+/* Set once the file system refused to append to ubootefi.var, e.g. ext4 */
+static bool __maybe_unused efi_var_file_no_append;
+
 /**
  * efi_set_blk_dev_to_system_partition() - select EFI system partition
  *
@@ -89,6 +100,11 @@ error:
 	if (ret != EFI_SUCCESS)
 		log_err("Failed to persist EFI variables\n");
 out:
+	if (ret == EFI_SUCCESS)
+		efi_var_file_base_len = len;
+	else
+		efi_var_file_base_len = 0;
+	efi_var_file_len = efi_var_file_base_len;
 	free(buf);
 	return ret;
 #else
@@ -96,6 +112,111 @@ out:
 #endif
 }
 
+/**
+ * efi_var_append_to_file() - save a changed non-volatile variable
+ *
+ * The new value of the variable is appended to file ubootefi.var, unless the
+ * whole file must be written.
+ *
+ * @variable_name:	name of the changed variable
+ * @vendor:		vendor GUID of the changed variable
+ * Return:		status code
+ */
+efi_status_t efi_var_append_to_file(const u16 *variable_name,
+				    const efi_guid_t *vendor)
+{
+#ifdef CONFIG_EFI_VARIABLE_FILE_STORE
+	struct efi_var_file *rec;
+	struct efi_var_entry *var;
+	efi_status_t ret;
+	loff_t actlen;
+	u32 len;
+	int r;
+
+	if (!IS_ENABLED(CONFIG_EFI_VARIABLE_FILE_LOG))
+		return efi_var_to_file();
+
+	var = efi_var_mem_find(vendor, variable_name, NULL);
+	if (var)
+		len = efi_var_entry_len(var);
+	else
+		len = ALIGN(sizeof(*var) +
+			    sizeof(u16) * (u16_strlen(variable_name) + 1), 8);
+	len += sizeof(*rec);
+
+	/*
+	 * Rewrite the whole file if the records would take more space than
+	 * the variables they update. This bounds both the file size and the
+	 * amortised cost of writing a change.
+	 */
+	if (efi_var_file_no_append || !efi_var_file_len ||
+	    efi_var_file_len + len > EFI_VAR_BUF_SIZE ||
+	    efi_var_file_len - efi_var_file_base_len + len >
+	    efi_var_file_base_len)
+		return efi_var_to_file();
+
+	rec = calloc(1, len);
+	if (!rec)
+		return efi_var_to_file();
+	rec->magic = EFI_VAR_FILE_MAGIC;
+	rec->length = len;
+	if (var) {
+		memcpy(rec->var, var, len - sizeof(*rec));
+	} else {
+		/* An entry without attributes marks a deleted variable */
+		memcpy(&rec->var->guid, vendor, sizeof(efi_guid_t));
+		u16_strcpy(rec->var->name, variable_name);
+	}
+	rec->crc32 = crc32(0, (u8 *)rec->var, len - sizeof(*rec));
+
+	ret = efi_set_blk_dev_to_system_partition();
+	if (ret != EFI_SUCCESS) {
+		free(rec);
+		return efi_var_to_file();
+	}
+
+	r = fs_write(EFI_VAR_FILE_NAME, map_to_sysmem(rec), efi_var_file_len,
+		     len, &actlen);
+	free(rec);
+	if (r || len != actlen) {
+		/*
+		 * Some file systems, e.g. ext4, cannot write at an offset. A
+		 * short write leaves a torn record. Either way write the whole
+		 * file, so that the change is not lost.
+		 */
+		log_debug("Cannot append to %s, rewriting it\n",
+			  EFI_VAR_FILE_NAME);
+		if (r)
+			efi_var_file_no_append = true;
+		return efi_var_to_file();
+	}
+	efi_var_file_len += len;
+
+	return EFI_SUCCESS;
+#else
+	return EFI_SUCCESS;
+#endif
+}
+
+/**
+ * efi_var_restore_allowed() - check whether a variable may be restored
+ *
+ * Secure boot related and volatile variables shall only be restored from
+ * U-Boot's preseed.
+ *
+ * @var:	variable
+ * @safe:	restoring from tamper-resistant storage
+ * Return:	true if the variable may be restored
+ */
+static bool efi_var_restore_allowed(struct efi_var_entry *var, bool safe)
+{
+	return safe ||
+	       (efi_auth_var_get_type(var->name, &var->guid) ==
+		EFI_AUTH_VAR_NONE &&
+		guidcmp(&var->guid, &shim_lock_guid) &&
+		(var->attr & EFI_VARIABLE_NON_VOLATILE));
+}
+
 efi_status_t efi_var_restore(struct efi_var_file *buf, bool safe)
 {
 	struct efi_var_entry *var, *last_var;
@@ -116,15 +237,7 @@ efi_status_t efi_var_restore(struct efi_var_file *buf, bool safe)
 
 		data = var->name + u16_strlen(var->name) + 1;
 
-		/*
-		 * Secure boot related and volatile variables shall only be
-		 * restored from U-Boot's preseed.
-		 */
-		if (!safe &&
-		    (efi_auth_var_get_type(var->name, &var->guid) !=
-		     EFI_AUTH_VAR_NONE ||
-		     !guidcmp(&var->guid, &shim_lock_guid) ||
-		     !(var->attr & EFI_VARIABLE_NON_VOLATILE)))
+		if (!efi_var_restore_allowed(var, safe))
 			continue;
 		if (!var->length)
 			continue;
@@ -139,6 +252,61 @@ efi_status_t efi_var_restore(struct efi_var_file *buf, bool safe)
 	return EFI_SUCCESS;
 }
 
+/**
+ * efi_var_restore_log() - apply the records following the variables in a file
+ *
+ * Each record has the same header as the file and holds the new value of a
+ * single variable. A variable without attributes has been deleted.
+ *
+ * @buf:	file content
+ * @len:	length of the file
+ * Return:	@len, or 0 if an invalid record was found
+ */
+static loff_t __maybe_unused efi_var_restore_log(struct efi_var_file *buf,
+						 loff_t len)
+{
+	struct efi_var_file *rec;
+	struct efi_var_entry *var, *old;
+	efi_status_t ret;
+	loff_t pos;
+	u16 *data;
+
+	for (pos = buf->length; pos < len; pos += rec->length) {
+		rec = (struct efi_var_file *)((u8 *)buf + pos);
+		var = rec->var;
+		if (len - pos < sizeof(*rec) + sizeof(*var) || rec->reserved ||
+		    rec->magic != EFI_VAR_FILE_MAGIC ||
+		    rec->length < sizeof(*rec) + sizeof(*var) ||
+		    rec->length > len - pos ||
+		    rec->crc32 != crc32(0, (u8 *)var,
+					rec->length - sizeof(*rec)) ||
+		    efi_var_entry_len(var) > rec->length - sizeof(*rec)) {
+			log_err("Invalid EFI variables file record\n");
+			return 0;
+		}
+
+		if (var->attr && !efi_var_restore_allowed(var, false))
+			continue;
+		old = efi_var_mem_find(&var->guid, var->name, NULL);
+		if (var->attr) {
+			data = var->name + u16_strlen(var->name) + 1;
+			ret = efi_var_mem_ins(var->name, &var->guid, var->attr,
+					      var->length, data, 0, NULL,
+					      var->time);
+			if (ret != EFI_SUCCESS) {
+				log_err("Failed to set EFI variable %ls\n",
+					var->name);
+				continue;
+			}
+		} else if (old && !efi_var_restore_allowed(old, false)) {
+			continue;
+		}
+		efi_var_mem_del(old);
+	}
+
+	return len;
+}
+
 /**
  * efi_var_from_file() - read variables from file
  *
@@ -167,6 +335,7 @@ efi_status_t efi_var_from_file(void)
 		return EFI_OUT_OF_RESOURCES;
 	}
 
+	efi_var_file_no_append = false;
 	ret = efi_set_blk_dev_to_system_partition();
 	if (ret != EFI_SUCCESS)
 		goto error;
@@ -176,8 +345,12 @@ efi_status_t efi_var_from_file(void)
 		log_err("Failed to load EFI variables\n");
 		goto error;
 	}
-	if (buf->length != len || efi_var_restore(buf, false) != EFI_SUCCESS)
+	if (buf->length > len || efi_var_restore(buf, false) != EFI_SUCCESS) {
 		log_err("Invalid EFI variables file\n");
+		goto error;
+	}
+	efi_var_file_base_len = buf->length;
+	efi_var_file_len = efi_var_restore_log(buf, len);
 error:
 	free(buf);
 #endif
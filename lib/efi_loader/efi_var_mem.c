@@ -9,8 +9,33 @@
 
 #include <efi_loader.h>
 #include <efi_variable.h>
+#include <linux/log2.h>
 #include <u-boot/crc.h>
 
+/*
+ * The index size is a power of two so that no division is needed, which
+ * might call a library function outside the runtime section.
+ */
+#define EFI_VAR_INDEX_SIZE	rounddown_pow_of_two(CONFIG_EFI_VAR_INDEX_SIZE)
+#define EFI_VAR_INDEX_MASK	(EFI_VAR_INDEX_SIZE - 1)
+#define EFI_VAR_INDEX_MAX	(EFI_VAR_INDEX_SIZE / 4 * 3)
+
+/**
+ * struct efi_var_slot - slot in the variable index
+ *
+ * The index is a hash table with linear probing which is kept after the end
+ * of efi_var_buf. Offsets are used rather than pointers so that nothing needs
+ * to be converted by SetVirtualAddressMap().
+ *
+ * @offset:	offset of the variable from the start of efi_var_buf, or 0 if
+ *		the slot is empty
+ * @hash:	hash of the vendor GUID and name of the variable
+ */
+struct efi_var_slot {
+	u32 offset;
+	u32 hash;
+};
+
 /*
  * The variables efi_var_file and efi_var_entry must be static to avoid
  * referencing them via the global offset table (section .got). The GOT
@@ -19,8 +44,130 @@
  */
 static struct efi_var_file __efi_runtime_data *efi_var_buf;
 static struct efi_var_entry __efi_runtime_data *efi_current_var;
+static struct efi_var_slot __efi_runtime_data *efi_var_index;
+static u32 __efi_runtime_data efi_var_index_used;
+static bool __efi_runtime_data efi_var_index_ok;
 static const u16 __efi_runtime_rodata vtf[] = u"VarToFile";
 
+/**
+ * efi_var_hash() - calculate the index hash of a variable
+ *
+ * This uses the FNV-1a hash over the vendor GUID and the name.
+ *
+ * @guid:	vendor GUID
+ * @name:	variable name
+ * Return:	hash value
+ */
+static u32 __efi_runtime efi_var_hash(const efi_guid_t *guid, const u16 *name)
+{
+	const u8 *data = (const u8 *)guid;
+	u32 hash = 2166136261;
+	int i;
+
+	for (i = 0; i < sizeof(efi_guid_t); ++i)
+		hash = (hash ^ data[i]) * 16777619;
+	for (; *name; ++name)
+		hash = (hash ^ *name) * 16777619;
+
+	return hash;
+}
+
+/**
+ * efi_var_index_add() - add a variable to the index
+ *
+ * If the index is full it is disabled and variables are found by searching
+ * efi_var_buf instead.
+ *
+ * @var:	variable in efi_var_buf
+ */
+static void __efi_runtime efi_var_index_add(struct efi_var_entry *var)
+{
+	u32 hash, i;
+
+	if (!efi_var_index_ok)
+		return;
+	if (efi_var_index_used >= EFI_VAR_INDEX_MAX) {
+		efi_var_index_ok = false;
+		return;
+	}
+
+	hash = efi_var_hash(&var->guid, var->name);
+	for (i = hash & EFI_VAR_INDEX_MASK; efi_var_index[i].offset;
+	     i = (i + 1) & EFI_VAR_INDEX_MASK)
+		;
+	efi_var_index[i].offset = (uintptr_t)var - (uintptr_t)efi_var_buf;
+	efi_var_index[i].hash = hash;
+	++efi_var_index_used;
+}
+
+/**
+ * efi_var_index_del() - remove a variable from the index
+ *
+ * The variables after @var in efi_var_buf are about to move down by @len
+ * bytes, so their offsets are adjusted.
+ *
+ * @var:	variable in efi_var_buf
+ * @len:	length of the variable entry
+ */
+static void __efi_runtime efi_var_index_del(struct efi_var_entry *var, u32 len)
+{
+	u32 offset = (uintptr_t)var - (uintptr_t)efi_var_buf;
+	u32 i, j, home;
+
+	if (!efi_var_index_ok)
+		return;
+
+	for (i = efi_var_hash(&var->guid, var->name) & EFI_VAR_INDEX_MASK;
+	     efi_var_index[i].offset != offset;
+	     i = (i + 1) & EFI_VAR_INDEX_MASK) {
+		if (!efi_var_index[i].offset)
+			return;
+	}
+
+	/*
+	 * Move later slots of the same cluster into the gap, unless that
+	 * would put them before their home slot, so that no probe sequence
+	 * ends early.
+	 */
+	for (j = i;;) {
+		j = (j + 1) & EFI_VAR_INDEX_MASK;
+		if (!efi_var_index[j].offset)
+			break;
+		home = efi_var_index[j].hash & EFI_VAR_INDEX_MASK;
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+		efi_var_index[i].offset = efi_var_index[j].offset;
+		efi_var_index[i].hash = efi_var_index[j].hash;
+		i = j;
+	}
+	efi_var_index[i].offset = 0;
+	--efi_var_index_used;
+
+	for (i = 0; i < EFI_VAR_INDEX_SIZE; ++i) {
+		if (efi_var_index[i].offset > offset)
+			efi_var_index[i].offset -= len;
+	}
+}
+
+/**
+ * efi_var_index_rebuild() - create the index for the content of efi_var_buf
+ */
+static void efi_var_index_rebuild(void)
+{
+	struct efi_var_entry *var, *last;
+
+	memset(efi_var_index, '\0',
+	       EFI_VAR_INDEX_SIZE * sizeof(struct efi_var_slot));
+	efi_var_index_used = 0;
+	efi_var_index_ok = true;
+
+	last = (struct efi_var_entry *)
+	       ((uintptr_t)efi_var_buf + efi_var_buf->length);
+	for (var = efi_var_buf->var; var < last;
+	     var = (void *)var + efi_var_entry_len(var))
+		efi_var_index_add(var);
+}
+
 /**
  * efi_var_mem_compare() - compare GUID and name with a variable
  *
@@ -105,6 +252,30 @@ struct efi_var_entry __efi_runtime
 		return efi_current_var;
 	}
 
+	if (efi_var_index_ok) {
+		u32 hash = efi_var_hash(guid, name);
+		u32 i;
+
+		for (i = hash & EFI_VAR_INDEX_MASK; efi_var_index[i].offset;
+		     i = (i + 1) & EFI_VAR_INDEX_MASK) {
+			struct efi_var_entry *pos;
+
+			if (efi_var_index[i].hash != hash)
+				continue;
+			var = (struct efi_var_entry *)
+			      ((uintptr_t)efi_var_buf +
+			       efi_var_index[i].offset);
+			if (efi_var_mem_compare(var, guid, name, &pos)) {
+				if (next)
+					*next = pos < last ? pos : NULL;
+				return var;
+			}
+		}
+		if (next)
+			*next = NULL;
+		return NULL;
+	}
+
 	var = efi_var_buf->var;
 	if (var < last) {
 		for (; var;) {
@@ -145,6 +316,7 @@ void __efi_runtime efi_var_mem_del(struct efi_var_entry *var)
 	++data;
 	next = (struct efi_var_entry *)
 	       ALIGN((uintptr_t)data + var->length, 8);
+	efi_var_index_del(var, (uintptr_t)next - (uintptr_t)var);
 	efi_var_buf->length -= (uintptr_t)next - (uintptr_t)var;
 
 	/* efi_memcpy_runtime() can be used because next >= var. */
@@ -162,11 +334,12 @@ efi_status_t __efi_runtime efi_var_mem_ins(
 				const u64 time)
 {
 	u16 *data;
-	struct efi_var_entry *var;
+	struct efi_var_entry *var, *new_var;
 	u32 var_name_len;
 
 	var = (struct efi_var_entry *)
 	      ((uintptr_t)efi_var_buf + efi_var_buf->length);
+	new_var = var;
 	var_name_len = u16_strlen(variable_name) + 1;
 	data = var->name + var_name_len;
 
@@ -190,6 +363,7 @@ efi_status_t __efi_runtime efi_var_mem_ins(
 	efi_var_buf->crc32 = crc32(0, (u8 *)efi_var_buf->var,
 				   efi_var_buf->length -
 				   sizeof(struct efi_var_file));
+	efi_var_index_add(new_var);
 
 	return EFI_SUCCESS;
 }
@@ -214,6 +388,7 @@ static void EFIAPI __efi_runtime
 efi_var_mem_notify_virtual_address_map(struct efi_event *event, void *context)
 {
 	efi_convert_pointer(0, (void **)&efi_var_buf);
+	efi_convert_pointer(0, (void **)&efi_var_index);
 	efi_current_var = NULL;
 }
 
@@ -222,11 +397,14 @@ efi_status_t efi_var_mem_init(void)
 	u64 memory;
 	efi_status_t ret;
 	struct efi_event *event;
+	efi_uintn_t size;
 
+	/* The index is kept in the same pages, after the variables */
+	size = ALIGN(EFI_VAR_BUF_SIZE, 8) +
+	       EFI_VAR_INDEX_SIZE * sizeof(struct efi_var_slot);
 	ret = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES,
 				 EFI_RUNTIME_SERVICES_DATA,
-				 efi_size_in_pages(EFI_VAR_BUF_SIZE),
-				 &memory);
+				 efi_size_in_pages(size), &memory);
 	if (ret != EFI_SUCCESS)
 		return ret;
 	efi_var_buf = (struct efi_var_file *)(uintptr_t)memory;
@@ -234,6 +412,9 @@ efi_status_t efi_var_mem_init(void)
 	efi_var_buf->magic = EFI_VAR_FILE_MAGIC;
 	efi_var_buf->length = (uintptr_t)efi_var_buf->var -
 			      (uintptr_t)efi_var_buf;
+	efi_var_index = (struct efi_var_slot *)
+			((uintptr_t)efi_var_buf + ALIGN(EFI_VAR_BUF_SIZE, 8));
+	efi_var_index_rebuild();
 
 	ret = efi_create_event(EVT_SIGNAL_VIRTUAL_ADDRESS_CHANGE, TPL_CALLBACK,
 			       efi_var_mem_notify_virtual_address_map, NULL,
@@ -399,4 +580,5 @@ skip:
 void efi_var_buf_update(struct efi_var_file *var_buf)
 {
 	memcpy(efi_var_buf, var_buf, EFI_VAR_BUF_SIZE);
+	efi_var_index_rebuild();
 }
@@ -12,6 +12,7 @@
 
 #define EFI_ST_MAX_DATA_SIZE 16
 #define EFI_ST_MAX_VARNAME_SIZE 80
+#define EFI_ST_MANY_VARS 200
 
 static struct efi_boot_services *boottime;
 static struct efi_runtime_services *runtime;
@@ -37,6 +38,116 @@ static int setup(const efi_handle_t img_handle,
 	return EFI_ST_SUCCESS;
 }
 
+/*
+ * Set the name of variable @i of the many variables test.
+ *
+ * @name	buffer for the name
+ * @i		number of the variable
+ */
+static void many_var_name(u16 *name, unsigned int i)
+{
+	static const char prefix[] = "efi_st_many";
+	int j;
+
+	for (j = 0; prefix[j]; ++j)
+		name[j] = prefix[j];
+	name[j++] = '0' + i / 100;
+	name[j++] = '0' + i / 10 % 10;
+	name[j++] = '0' + i % 10;
+	name[j] = 0;
+}
+
+/*
+ * Create many variables, delete some of them and check that all of the
+ * others can still be found.
+ */
+static int test_many_variables(void)
+{
+	u16 varname[EFI_ST_MAX_VARNAME_SIZE];
+	efi_status_t ret, expect;
+	unsigned int i, count;
+	efi_guid_t guid;
+	efi_uintn_t len;
+	u8 data;
+
+	for (i = 0; i < EFI_ST_MANY_VARS; ++i) {
+		many_var_name(varname, i);
+		data = i;
+		ret = runtime->set_variable(varname, &guid_vendor0,
+					    EFI_VARIABLE_BOOTSERVICE_ACCESS,
+					    1, &data);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("SetVariable failed for variable %u\n",
+				     i);
+			return EFI_ST_FAILURE;
+		}
+	}
+	for (i = 0; i < EFI_ST_MANY_VARS; i += 2) {
+		many_var_name(varname, i);
+		ret = runtime->set_variable(varname, &guid_vendor0, 0, 0,
+					    NULL);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("SetVariable failed for variable %u\n",
+				     i);
+			return EFI_ST_FAILURE;
+		}
+	}
+	for (i = 0; i < EFI_ST_MANY_VARS; ++i) {
+		many_var_name(varname, i);
+		len = 1;
+		data = 0xff;
+		ret = runtime->get_variable(varname, &guid_vendor0, NULL,
+					    &len, &data);
+		expect = i & 1 ? EFI_SUCCESS : EFI_NOT_FOUND;
+		if (ret != expect) {
+			efi_st_error("GetVariable returned %u for variable %u\n",
+				     (unsigned int)ret, i);
+			return EFI_ST_FAILURE;
+		}
+		if (ret == EFI_SUCCESS && data != (u8)i) {
+			efi_st_error("GetVariable returned wrong value for variable %u\n",
+				     i);
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	boottime->set_mem(&guid, 16, 0);
+	*varname = 0;
+	count = 0;
+	for (;;) {
+		len = sizeof(varname);
+		ret = runtime->get_next_variable_name(&len, varname, &guid);
+		if (ret == EFI_NOT_FOUND)
+			break;
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("GetNextVariableName failed (%u)\n",
+				     (unsigned int)ret);
+			return EFI_ST_FAILURE;
+		}
+		if (!memcmp(&guid, &guid_vendor0, sizeof(efi_guid_t)) &&
+		    !memcmp(varname, u"efi_st_many", 22))
+			++count;
+	}
+	if (count != EFI_ST_MANY_VARS / 2) {
+		efi_st_error("GetNextVariableName found %u variables, expected %u\n",
+			     count, EFI_ST_MANY_VARS / 2);
+		return EFI_ST_FAILURE;
+	}
+
+	for (i = 1; i < EFI_ST_MANY_VARS; i += 2) {
+		many_var_name(varname, i);
+		ret = runtime->set_variable(varname, &guid_vendor0, 0, 0,
+					    NULL);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("SetVariable failed for variable %u\n",
+				     i);
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
 /*
  * Execute unit test.
  */
@@ -277,7 +388,7 @@ static int execute(void)
 		return EFI_ST_FAILURE;
 	}
 
-	return EFI_ST_SUCCESS;
+	return test_many_variables();
 }
 
 EFI_UNIT_TEST(variables) = {
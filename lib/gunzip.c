@@ -82,6 +82,61 @@ __rcode int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *len
 	return zunzip(dst, dstlen, src, lenp, 1, offset);
 }
 
+int gunzip_tap(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+	       int (*tap)(void *priv, const void *buf, ulong len), void *priv)
+{
+	unsigned long left;
+	int offset, err = 0;
+	z_stream s;
+	int r;
+
+	offset = gzip_parse_header(src, *lenp);
+	if (offset < 0)
+		return offset;
+	if (tap(priv, src, offset))
+		return -1;
+
+	s.zalloc = gzalloc;
+	s.zfree = gzfree;
+
+	r = inflateInit2(&s, -MAX_WBITS);
+	if (r != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", r);
+		return -1;
+	}
+	s.next_in = src + offset;
+	s.avail_in = 0;
+	s.next_out = dst;
+	s.avail_out = dstlen;
+	left = *lenp - offset;
+	do {
+		/* Only show the next chunk to @tap when inflate() wants it */
+		if (!s.avail_in && left) {
+			uint chunk = min_t(unsigned long, left, CHUNKSZ);
+
+			if (tap(priv, s.next_in, chunk)) {
+				err = -1;
+				break;
+			}
+			s.avail_in = chunk;
+			left -= chunk;
+		}
+		r = inflate(&s, Z_NO_FLUSH);
+	} while (r == Z_OK);
+	*lenp = s.next_out - (unsigned char *)dst;
+	inflateEnd(&s);
+
+	if (!err && r != Z_STREAM_END) {
+		printf("Error: inflate() returned %d\n", r);
+		err = r;
+	}
+	/* Pass on the trailer too, so @tap sees all of @src */
+	if (!err && left && tap(priv, s.next_in + s.avail_in, left))
+		err = -1;
+
+	return err;
+}
+
 #ifdef CONFIG_CMD_UNZIP
 __weak
 void gzwrite_progress_init(ulong expectedsize)
@@ -316,3 +316,243 @@ int write_sparse_image(struct sparse_storage *info,
 
 	return 0;
 }
+
+enum sparse_stream_state {
+	SS_HEADER,
+	SS_CHUNK,
+	SS_RAW,
+	SS_FILL,
+	SS_DONE,
+};
+
+int sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info)
+{
+	memset(ss, '\0', sizeof(*ss));
+	ss->info = info;
+	ss->blk = info->start;
+	ss->buf_size = ROUNDUP(CONFIG_IMAGE_SPARSE_FILLBUF_SIZE, info->blksz);
+	ss->buf = memalign(ARCH_DMA_MINALIGN, ss->buf_size);
+	if (!ss->buf)
+		return -ENOMEM;
+
+	return 0;
+}
+
+/* Collect @want bytes of a header into ss->part, returning true when done */
+static bool sparse_stream_collect(struct sparse_stream *ss, const u8 **datap,
+				  ulong *lenp, uint want)
+{
+	uint n = min_t(ulong, want - ss->part_len, *lenp);
+
+	memcpy(ss->part + ss->part_len, *datap, n);
+	ss->part_len += n;
+	*datap += n;
+	*lenp -= n;
+	if (ss->part_len < want)
+		return false;
+	ss->part_len = 0;
+
+	return true;
+}
+
+static int sparse_stream_put(struct sparse_stream *ss, lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t blks;
+
+	blks = info->write(info, ss->blk, blkcnt, ss->buf);
+	/* blks might be > blkcnt (eg. NAND bad-blocks) */
+	if (IS_ERR_VALUE(blks) || blks < blkcnt) {
+		printf("%s: Write failed, block #" LBAFU " [" LBAFU "]\n",
+		       __func__, ss->blk, blkcnt);
+		return -EIO;
+	}
+	ss->blk += blks;
+
+	return 0;
+}
+
+static int sparse_stream_fill(struct sparse_stream *ss, u32 fill_val,
+			      lbaint_t blkcnt)
+{
+	lbaint_t max = ss->buf_size / ss->info->blksz;
+	u32 *fill_buf = ss->buf;
+	int i, ret;
+
+	for (i = 0; i < ss->buf_size / sizeof(fill_val); i++)
+		fill_buf[i] = fill_val;
+
+	while (blkcnt) {
+		lbaint_t n = min(blkcnt, max);
+
+		ret = sparse_stream_put(ss, n);
+		if (ret)
+			return ret;
+		blkcnt -= n;
+	}
+
+	return 0;
+}
+
+/* Handle a chunk header, once it has been collected */
+static int sparse_stream_chunk(struct sparse_stream *ss)
+{
+	struct sparse_storage *info = ss->info;
+	chunk_header_t *chunk = &ss->chunk;
+	u64 chunk_data_sz;
+	lbaint_t blkcnt;
+
+	chunk_data_sz = (u64)ss->hdr.blk_sz * chunk->chunk_sz;
+	blkcnt = DIV_ROUND_UP_ULL(chunk_data_sz, info->blksz);
+	ss->skip = ss->hdr.chunk_hdr_sz - sizeof(chunk_header_t);
+	if (chunk->chunk_type != CHUNK_TYPE_DONT_CARE &&
+	    chunk->chunk_type != CHUNK_TYPE_CRC32 &&
+	    ss->blk + blkcnt > info->start + info->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		return -ENOSPC;
+	}
+
+	switch (chunk->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (chunk->total_sz != ss->hdr.chunk_hdr_sz + chunk_data_sz)
+			return -EINVAL;
+		ss->left = chunk_data_sz;
+		if (ss->left)
+			ss->state = SS_RAW;
+		break;
+	case CHUNK_TYPE_FILL:
+		if (chunk->total_sz != ss->hdr.chunk_hdr_sz + sizeof(u32))
+			return -EINVAL;
+		ss->state = SS_FILL;
+		break;
+	case CHUNK_TYPE_DONT_CARE:
+		ss->blk += info->reserve(info, ss->blk, blkcnt);
+		break;
+	case CHUNK_TYPE_CRC32:
+		if (chunk->total_sz != ss->hdr.chunk_hdr_sz + sizeof(u32))
+			return -EINVAL;
+		/* The checksum is not checked */
+		ss->skip += sizeof(u32);
+		break;
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       chunk->chunk_type);
+		return -EINVAL;
+	}
+	ss->total_blocks += chunk->chunk_sz;
+
+	return 0;
+}
+
+/* Move on to the next chunk, or finish, once a chunk is done */
+static void sparse_stream_next(struct sparse_stream *ss)
+{
+	if (++ss->chunks == ss->hdr.total_chunks)
+		ss->state = SS_DONE;
+	else
+		ss->state = SS_CHUNK;
+}
+
+int sparse_stream_write(struct sparse_stream *ss, const void *data, ulong len)
+{
+	struct sparse_storage *info = ss->info;
+	const u8 *ptr = data;
+	u32 fill_val;
+	ulong n;
+	int ret;
+
+	while (len) {
+		if (ss->skip) {
+			n = min(ss->skip, len);
+			ss->skip -= n;
+			ptr += n;
+			len -= n;
+			continue;
+		}
+
+		switch (ss->state) {
+		case SS_HEADER:
+			if (!sparse_stream_collect(ss, &ptr, &len,
+						   sizeof(sparse_header_t)))
+				break;
+			memcpy(&ss->hdr, ss->part, sizeof(ss->hdr));
+			if (!is_sparse_image(&ss->hdr) ||
+			    ss->hdr.file_hdr_sz < sizeof(sparse_header_t) ||
+			    ss->hdr.chunk_hdr_sz < sizeof(chunk_header_t)) {
+				printf("%s: Not a sparse image\n", __func__);
+				return -EINVAL;
+			}
+			if (!ss->hdr.blk_sz || ss->hdr.blk_sz % info->blksz) {
+				printf("%s: Sparse image block size issue [%u]\n",
+				       __func__, ss->hdr.blk_sz);
+				return -EINVAL;
+			}
+			ss->skip = ss->hdr.file_hdr_sz - sizeof(sparse_header_t);
+			ss->state = ss->hdr.total_chunks ? SS_CHUNK : SS_DONE;
+			break;
+		case SS_CHUNK:
+			if (!sparse_stream_collect(ss, &ptr, &len,
+						   sizeof(chunk_header_t)))
+				break;
+			memcpy(&ss->chunk, ss->part, sizeof(ss->chunk));
+			ret = sparse_stream_chunk(ss);
+			if (ret)
+				return ret;
+			if (ss->state == SS_CHUNK)
+				sparse_stream_next(ss);
+			break;
+		case SS_RAW:
+			n = min3((u64)len, ss->left,
+				 (u64)(ss->buf_size - ss->buf_used));
+			memcpy(ss->buf + ss->buf_used, ptr, n);
+			ss->buf_used += n;
+			ss->left -= n;
+			ptr += n;
+			len -= n;
+
+			/* Raw data is a whole number of blocks */
+			if (ss->buf_used == ss->buf_size || !ss->left) {
+				ret = sparse_stream_put(ss, ss->buf_used /
+							info->blksz);
+				if (ret)
+					return ret;
+				ss->buf_used = 0;
+			}
+			if (!ss->left)
+				sparse_stream_next(ss);
+			break;
+		case SS_FILL:
+			if (!sparse_stream_collect(ss, &ptr, &len, sizeof(u32)))
+				break;
+			memcpy(&fill_val, ss->part, sizeof(fill_val));
+			ret = sparse_stream_fill(ss, fill_val,
+						 DIV_ROUND_UP_ULL((u64)ss->hdr.blk_sz *
+								  ss->chunk.chunk_sz,
+								  info->blksz));
+			if (ret)
+				return ret;
+			sparse_stream_next(ss);
+			break;
+		case SS_DONE:
+			/* Ignore anything after the last chunk */
+			return 0;
+		}
+	}
+
+	return 0;
+}
+
+s64 sparse_stream_finish(struct sparse_stream *ss)
+{
+	struct sparse_storage *info = ss->info;
+
+	free(ss->buf);
+	ss->buf = NULL;
+	if (ss->state != SS_DONE || ss->skip ||
+	    ss->total_blocks != ss->hdr.total_blks) {
+		printf("%s: Incomplete sparse image\n", __func__);
+		return -EINVAL;
+	}
+
+	return (s64)(ss->blk - info->start) * info->blksz;
+}
@@ -64,7 +64,7 @@
 #define MEM_ALIGNMENT                   8
 
 #define MEMP_NUM_TCP_SEG                16
-#define PBUF_POOL_SIZE                  8
+#define PBUF_POOL_SIZE                  CONFIG_LWIP_PBUF_POOL_SIZE
 
 #define LWIP_ARP                        1
 #define ARP_TABLE_SIZE                  4
@@ -132,6 +132,10 @@
 
 #define LWIP_LISTEN_BACKLOG             0
 
+#if defined(CONFIG_LWIP_RX_ZERO_COPY)
+#define LWIP_SUPPORT_CUSTOM_PBUF        1
+#endif
+
 #define PBUF_LINK_HLEN                  14
 #define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(TCP_MSS + 40 + PBUF_LINK_HLEN)
 
@@ -11,27 +11,41 @@
 #include <linux/errno.h>
 #include <linux/zstd.h>
 
-int zstd_decompress(struct abuf *in, struct abuf *out)
+static zstd_dctx *zstd_alloc_dctx(void **workspacep)
 {
 	zstd_dctx *ctx;
-	size_t wsize, len;
 	void *workspace;
-	int ret;
+	size_t wsize;
 
 	wsize = zstd_dctx_workspace_bound();
 	workspace = malloc(wsize);
 	if (!workspace) {
 		debug("%s: cannot allocate workspace of size %zu\n", __func__,
 			wsize);
-		return -ENOMEM;
+		return NULL;
 	}
 
 	ctx = zstd_init_dctx(workspace, wsize);
 	if (!ctx) {
 		log_err("%s: zstd_init_dctx() failed\n", __func__);
-		ret = -EPERM;
-		goto do_free;
+		free(workspace);
+		return NULL;
 	}
+	*workspacep = workspace;
+
+	return ctx;
+}
+
+int zstd_decompress(struct abuf *in, struct abuf *out)
+{
+	zstd_dctx *ctx;
+	void *workspace;
+	size_t len;
+	int ret;
+
+	ctx = zstd_alloc_dctx(&workspace);
+	if (!ctx)
+		return -ENOMEM;
 
 	/*
 	 * Find out how large the frame actually is, there may be junk at
@@ -59,3 +73,66 @@ do_free:
 	free(workspace);
 	return ret;
 }
+
+int zstd_decompress_tap(struct abuf *in, struct abuf *out,
+			int (*tap)(void *priv, const void *buf, ulong len),
+			void *priv)
+{
+	const char *src = abuf_data(in);
+	size_t left = abuf_size(in);
+	char *dst = abuf_data(out);
+	size_t space = abuf_size(out);
+	size_t in_len, len;
+	zstd_dctx *ctx;
+	void *workspace;
+	int ret;
+
+	ctx = zstd_alloc_dctx(&workspace);
+	if (!ctx)
+		return -ENOMEM;
+
+	/*
+	 * Use the buffer-less API: the output buffer holds the whole frame, so
+	 * earlier blocks are still there to be referenced and no window
+	 * buffer is needed. The input is consumed one block at a time.
+	 */
+	len = ZSTD_decompressBegin(ctx);
+	while (!zstd_is_error(len)) {
+		in_len = ZSTD_nextSrcSizeToDecompress(ctx);
+		if (!in_len)
+			break;
+		if (in_len > left) {
+			log_err("%s: compressed data is truncated\n", __func__);
+			ret = -EINVAL;
+			goto do_free;
+		}
+		ret = tap(priv, src, in_len);
+		if (ret)
+			goto do_free;
+		len = ZSTD_decompressContinue(ctx, dst, space, src, in_len);
+		if (!zstd_is_error(len)) {
+			src += in_len;
+			left -= in_len;
+			dst += len;
+			space -= len;
+		}
+	}
+	if (zstd_is_error(len)) {
+		log_err("%s: failed to decompress: %d\n", __func__,
+			zstd_get_error_code(len));
+		ret = -EINVAL;
+		goto do_free;
+	}
+
+	/* Pass on anything after the frame, so @tap sees all of @in */
+	if (left) {
+		ret = tap(priv, src, left);
+		if (ret)
+			goto do_free;
+	}
+
+	ret = dst - (char *)abuf_data(out);
+do_free:
+	free(workspace);
+	return ret;
+}
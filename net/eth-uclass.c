@@ -650,6 +650,11 @@ static int eth_pre_remove(struct udevice *dev)
 
 	eth_get_ops(dev)->stop(dev);
 
+#if CONFIG_IS_ENABLED(LWIP_RX_ZERO_COPY)
+	/* the driver frees its buffers when removed */
+	net_lwip_release_rx(dev);
+#endif
+
 	/* clear the MAC address */
 	memset(pdata->enetaddr, 0, ARP_HLEN);
 
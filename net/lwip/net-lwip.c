@@ -13,6 +13,8 @@
 #include <lwip/etharp.h>
 #include <lwip/init.h>
 #include <lwip/prot/etharp.h>
+#include <lwip/priv/tcp_priv.h>
+#include <malloc.h>
 #include <net.h>
 #include <timer.h>
 
@@ -276,6 +278,136 @@ static struct pbuf *alloc_pbuf_and_copy(uchar *data, int len)
 	return p;
 }
 
+#if CONFIG_IS_ENABLED(LWIP_RX_ZERO_COPY)
+/* Largest number of received packets held by lwIP at once, for all devices */
+#define RX_HOLD_MAX	32
+
+/**
+ * struct rx_pbuf - A received packet passed to lwIP without copying it
+ *
+ * @pc: Custom pbuf referring to the driver's packet buffer
+ * @used: true if lwIP holds the packet
+ * @dev: Ethernet device which received the packet, or NULL if the device was
+ *	removed, in which case @packet is a copy to be freed with free()
+ * @packet: Packet buffer, to be passed to free_pkt() once lwIP is done with it
+ * @len: Length of the packet
+ */
+struct rx_pbuf {
+	struct pbuf_custom pc;
+	bool used;
+	struct udevice *dev;
+	uchar *packet;
+	int len;
+};
+
+static struct rx_pbuf rx_pbufs[RX_HOLD_MAX];
+
+static void rx_pbuf_free(struct pbuf *p)
+{
+	struct rx_pbuf *rx = container_of((struct pbuf_custom *)p,
+					  struct rx_pbuf, pc);
+
+	if (rx->dev)
+		eth_get_ops(rx->dev)->free_pkt(rx->dev, rx->packet, rx->len);
+	else
+		free(rx->packet);
+	rx->used = false;
+}
+
+/* Move pointers lwIP keeps into a packet which has been copied to @copy */
+static void rx_pbuf_rebase(struct rx_pbuf *rx, uchar *copy)
+{
+	struct pbuf *p = &rx->pc.pbuf;
+#if LWIP_TCP && TCP_QUEUE_OOSEQ
+	struct tcp_pcb *pcb;
+	struct tcp_seg *seg;
+
+	/* out-of-sequence segments point at their TCP header */
+	for (pcb = tcp_active_pcbs; pcb; pcb = pcb->next) {
+		for (seg = pcb->ooseq; seg; seg = seg->next) {
+			uchar *hdr = (uchar *)seg->tcphdr;
+
+			if (hdr >= rx->packet && hdr < rx->packet + rx->len)
+				seg->tcphdr = (void *)(copy +
+						       (hdr - rx->packet));
+		}
+	}
+#endif
+	p->payload = copy + ((uchar *)p->payload - rx->packet);
+}
+
+void net_lwip_release_rx(struct udevice *udev)
+{
+	struct rx_pbuf *rx;
+	uchar *copy;
+
+	for (rx = rx_pbufs; rx < rx_pbufs + RX_HOLD_MAX; rx++) {
+		if (!rx->used || rx->dev != udev)
+			continue;
+
+		/*
+		 * lwIP may hold the packet for a while yet, e.g. on a TCP
+		 * out-of-sequence queue, but the driver is about to free it
+		 */
+		copy = malloc(rx->len);
+		if (copy) {
+			memcpy(copy, rx->packet, rx->len);
+			rx_pbuf_rebase(rx, copy);
+		} else {
+			log_err("%s: No memory to keep a received packet\n",
+				udev->name);
+		}
+		eth_get_ops(udev)->free_pkt(udev, rx->packet, rx->len);
+		rx->packet = copy;
+		rx->dev = NULL;
+	}
+}
+
+/*
+ * Wrap the driver's packet buffer in a pbuf, if the driver allows the packet
+ * to be held after recv() and not too many are held already. The packet is
+ * then passed back to the driver with free_pkt() when lwIP frees the pbuf.
+ */
+static struct pbuf *alloc_pbuf_ref(struct udevice *udev, uchar *data, int len)
+{
+	struct eth_pdata *pdata = dev_get_plat(udev);
+	struct rx_pbuf *rx, *free_rx = NULL;
+	struct pbuf *p;
+	int held = 0;
+
+	if (!pdata->rx_hold || !eth_get_ops(udev)->free_pkt)
+		return NULL;
+
+	for (rx = rx_pbufs; rx < rx_pbufs + RX_HOLD_MAX; rx++) {
+		if (!rx->used)
+			free_rx = rx;
+		else if (rx->dev == udev)
+			held++;
+	}
+	if (!free_rx || held >= pdata->rx_hold)
+		return NULL;
+
+	rx = free_rx;
+	rx->pc.custom_free_function = rx_pbuf_free;
+	p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &rx->pc, data, len);
+	if (!p)
+		return NULL;
+	rx->used = true;
+	rx->dev = udev;
+	rx->packet = data;
+	rx->len = len;
+
+	LINK_STATS_INC(link.recv);
+
+	return p;
+}
+#else
+static struct pbuf *alloc_pbuf_ref(struct udevice *udev, uchar *data, int len)
+{
+	return NULL;
+}
+#endif
+
 int net_lwip_rx(struct udevice *udev, struct netif *netif)
 {
 	struct pbuf *pbuf;
@@ -300,6 +432,13 @@ int net_lwip_rx(struct udevice *udev, struct netif *netif)
 					       packet, len, true);
 			}
 
+			pbuf = alloc_pbuf_ref(udev, packet, len);
+			if (pbuf) {
+				/* free_pkt() is called when lwIP frees it */
+				netif->input(pbuf, netif);
+				continue;
+			}
+
 			pbuf = alloc_pbuf_and_copy(packet, len);
 			if (pbuf)
 				netif->input(pbuf, netif);
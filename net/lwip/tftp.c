@@ -8,9 +8,11 @@
 #include <efi_loader.h>
 #include <image.h>
 #include <linux/delay.h>
+#include <linux/math64.h>
 #include <lwip/apps/tftp_client.h>
 #include <lwip/timeouts.h>
 #include <mapmem.h>
+#include <net-sink.h>
 #include <net.h>
 #include <time.h>
 
@@ -25,7 +27,7 @@ enum done_state {
 
 struct tftp_ctx {
 	ulong daddr;
-	ulong size;
+	u64 size;
 	ulong block_count;
 	ulong start_time;
 	enum done_state done;
@@ -40,6 +42,7 @@ static void tftp_close(void *handle)
 {
 	struct tftp_ctx *ctx = handle;
 	ulong elapsed;
+	char buf[17];
 
 	if (ctx->done == FAILURE || ctx->done == ABORTED) {
 		/* Closing after an error or Ctrl-C */
@@ -50,12 +53,13 @@ static void tftp_close(void *handle)
 	elapsed = get_timer(ctx->start_time);
 	if (elapsed > 0) {
 		puts("\n\t ");	/* Line up with "Loading: " */
-		print_size(ctx->size / elapsed * 1000, "/s");
+		print_size(div_u64(ctx->size, elapsed) * 1000, "/s");
 	}
 	puts("\ndone\n");
-	printf("Bytes transferred = %lu (%lx hex)\n", ctx->size, ctx->size);
+	printf("Bytes transferred = %llu (%llx hex)\n", ctx->size, ctx->size);
 
-	if (env_set_hex("filesize", ctx->size)) {
+	snprintf(buf, sizeof(buf), "%llx", ctx->size);
+	if (env_set("filesize", buf)) {
 		log_err("filesize not updated\n");
 		return;
 	}
@@ -72,7 +76,12 @@ static int tftp_write(void *handle, struct pbuf *p)
 	struct pbuf *q;
 
 	for (q = p; q; q = q->next) {
-		memcpy((void *)ctx->daddr, q->payload, q->len);
+		if (!net_sink_active()) {
+			memcpy((void *)ctx->daddr, q->payload, q->len);
+		} else if (net_sink_write(ctx->size, q->payload, q->len)) {
+			ctx->done = FAILURE;
+			return -1;
+		}
 		ctx->daddr += q->len;
 		ctx->size += q->len;
 		ctx->block_count++;
@@ -165,6 +174,9 @@ static int tftp_loop(struct udevice *udev, ulong addr, char *fname,
 	net_lwip_remove_netif(netif);
 
 	if (ctx.done == SUCCESS) {
+		/* a sink writes the data to storage, not memory */
+		if (net_sink_active())
+			return 0;
 		if (env_set_hex("fileaddr", addr)) {
 			log_err("fileaddr not updated\n");
 			return -1;
@@ -11,9 +11,11 @@
 #include <lwip/timeouts.h>
 #include <rng.h>
 #include <mapmem.h>
+#include <net-sink.h>
 #include <net.h>
 #include <time.h>
 #include <dm/uclass.h>
+#include <linux/math64.h>
 
 #define SERVER_NAME_SIZE 254
 #define HTTP_PORT_DEFAULT 80
@@ -32,8 +34,8 @@ struct wget_ctx {
 	char *path;
 	ulong daddr;
 	ulong saved_daddr;
-	ulong size;
-	ulong prevsize;
+	u64 size;
+	u64 prevsize;
 	ulong start_time;
 	enum done_state done;
 };
@@ -50,9 +52,9 @@ static void wget_lwip_fill_info(struct pbuf *hdr, u16_t hdr_len, u32_t hdr_cont_
 	wget_info->hdr_cont_len = (u32)hdr_cont_len;
 }
 
-static void wget_lwip_set_file_size(u32_t rx_content_len)
+static void wget_lwip_set_file_size(u64 size)
 {
-	wget_info->file_size = (ulong)rx_content_len;
+	wget_info->file_size = (ulong)size;
 }
 
 bool wget_validate_uri(char *uri);
@@ -214,7 +216,14 @@ static err_t httpc_recv_cb(void *arg, struct altcp_pcb *pcb, struct pbuf *pbuf,
 		ctx->start_time = get_timer(0);
 
 	for (buf = pbuf; buf; buf = buf->next) {
-		memcpy((void *)ctx->daddr, buf->payload, buf->len);
+		if (!net_sink_active()) {
+			memcpy((void *)ctx->daddr, buf->payload, buf->len);
+		} else if (net_sink_write(ctx->size, buf->payload, buf->len)) {
+			ctx->done = FAILURE;
+			pbuf_free(pbuf);
+			altcp_abort(pcb);
+			return ERR_ABRT;
+		}
 		ctx->daddr += buf->len;
 		ctx->size += buf->len;
 		if (ctx->size - ctx->prevsize > PROGRESS_PRINT_STEP_BYTES) {
@@ -233,6 +242,7 @@ static void httpc_result_cb(void *arg, httpc_result_t httpc_result,
 {
 	struct wget_ctx *ctx = arg;
 	ulong elapsed;
+	char buf[17];
 
 	wget_info->status_code = (u32)srv_res;
 
@@ -255,22 +265,33 @@ static void httpc_result_cb(void *arg, httpc_result_t httpc_result,
 	elapsed = get_timer(ctx->start_time);
 	if (!elapsed)
 		elapsed = 1;
-	if (rx_content_len > PROGRESS_PRINT_STEP_BYTES)
+	/* rx_content_len is only 32 bits wide, so use our own count */
+	if (ctx->size > PROGRESS_PRINT_STEP_BYTES)
 		printf("\n");
-	printf("%u bytes transferred in %lu ms (", rx_content_len, elapsed);
-	print_size(rx_content_len / elapsed * 1000, "/s)\n");
-	printf("Bytes transferred = %lu (%lx hex)\n", ctx->size, ctx->size);
-	if (wget_info->set_bootdev)
-		efi_set_bootdev("Http", ctx->server_name, ctx->path, map_sysmem(ctx->saved_daddr, 0),
-				rx_content_len);
-	wget_lwip_set_file_size(rx_content_len);
-	if (env_set_hex("filesize", rx_content_len) ||
-	    env_set_hex("fileaddr", ctx->saved_daddr)) {
-		log_err("Could not set filesize or fileaddr\n");
+	printf("%llu bytes transferred in %lu ms (", ctx->size, elapsed);
+	print_size(div_u64(ctx->size, elapsed) * 1000, "/s)\n");
+	printf("Bytes transferred = %llu (%llx hex)\n", ctx->size, ctx->size);
+	wget_lwip_set_file_size(ctx->size);
+	snprintf(buf, sizeof(buf), "%llx", ctx->size);
+	if (env_set("filesize", buf)) {
+		log_err("Could not set filesize\n");
 		ctx->done = FAILURE;
 		return;
 	}
 
+	/* with a sink the data went to storage, so nothing is in memory */
+	if (!net_sink_active()) {
+		if (wget_info->set_bootdev)
+			efi_set_bootdev("Http", ctx->server_name, ctx->path,
+					map_sysmem(ctx->saved_daddr, 0),
+					ctx->size);
+		if (env_set_hex("fileaddr", ctx->saved_daddr)) {
+			log_err("Could not set fileaddr\n");
+			ctx->done = FAILURE;
+			return;
+		}
+	}
+
 	ctx->done = SUCCESS;
 }
 
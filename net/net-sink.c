@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Writing network downloads to storage as they arrive
+ *
+ * The download protocols pass what they receive to net_sink_write(), which
+ * collects it in a buffer and writes it out to a block device, a sparse
+ * image or a file each time the buffer is full. While the buffer is being
+ * written, incoming packets wait in the Ethernet driver's receive ring and
+ * the TFTP window or TCP receive window, so the download carries on from
+ * where it was once the write is done.
+ */
+
+#include <blk.h>
+#include <fs.h>
+#include <log.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <memalign.h>
+#include <net-sink.h>
+#include <linux/errno.h>
+
+static struct net_sink *net_sink;
+
+static lbaint_t net_sink_sparse_write(struct sparse_storage *info,
+				      lbaint_t blk, lbaint_t blkcnt,
+				      const void *buffer)
+{
+	struct net_sink *sink = info->priv;
+
+	return blk_dwrite(sink->desc, blk, blkcnt, buffer);
+}
+
+static lbaint_t net_sink_sparse_reserve(struct sparse_storage *info,
+					lbaint_t blk, lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+/* Get ready to write the download from its start */
+static int net_sink_reset(struct net_sink *sink)
+{
+	sink->used = 0;
+	sink->pos = 0;
+	sink->blk = sink->start;
+	if (sink->type == NET_SINK_SPARSE) {
+		free(sink->stream.buf);
+		return sparse_stream_init(&sink->stream, &sink->storage);
+	}
+
+	return 0;
+}
+
+/* Write out the first @len bytes of the buffer */
+static int net_sink_flush(struct net_sink *sink, ulong len)
+{
+	lbaint_t blkcnt;
+	loff_t actwrite;
+	int ret;
+
+	switch (sink->type) {
+	case NET_SINK_BLK:
+		/* Pad the last block with zeroes */
+		blkcnt = DIV_ROUND_UP(len, sink->desc->blksz);
+		memset(sink->buf + len, '\0', blkcnt * sink->desc->blksz - len);
+		if (sink->blk + blkcnt > sink->start + sink->size) {
+			log_err("Download does not fit on the device\n");
+			return -ENOSPC;
+		}
+		if (blk_dwrite(sink->desc, sink->blk, blkcnt,
+			       sink->buf) != blkcnt) {
+			log_err("Write failed at block " LBAFU "\n", sink->blk);
+			return -EIO;
+		}
+		sink->blk += blkcnt;
+		break;
+	case NET_SINK_SPARSE:
+		ret = sparse_stream_write(&sink->stream, sink->buf, len);
+		if (ret)
+			return ret;
+		break;
+	case NET_SINK_FILE:
+		ret = fs_set_blk_dev(sink->ifname, sink->dev_part, FS_TYPE_ANY);
+		if (ret)
+			return -ENODEV;
+		ret = fs_write(sink->fname, map_to_sysmem(sink->buf), sink->pos,
+			       len, &actwrite);
+		if (ret || actwrite != len)
+			return -EIO;
+		break;
+	}
+
+	return 0;
+}
+
+int net_sink_start(struct net_sink *sink)
+{
+	if (sink->desc && CONFIG_NET_SINK_BUF_SIZE % sink->desc->blksz)
+		return -EINVAL;
+	sink->buf = malloc_cache_aligned(CONFIG_NET_SINK_BUF_SIZE);
+	if (!sink->buf)
+		return -ENOMEM;
+	if (sink->type == NET_SINK_SPARSE) {
+		sink->storage.blksz = sink->desc->blksz;
+		sink->storage.start = sink->start;
+		sink->storage.size = sink->size;
+		sink->storage.priv = sink;
+		sink->storage.write = net_sink_sparse_write;
+		sink->storage.reserve = net_sink_sparse_reserve;
+		sink->stream.buf = NULL;
+	}
+	if (net_sink_reset(sink)) {
+		free(sink->buf);
+		return -ENOMEM;
+	}
+	net_sink = sink;
+
+	return 0;
+}
+
+s64 net_sink_finish(struct net_sink *sink, bool abort)
+{
+	s64 ret = 0;
+
+	net_sink = NULL;
+	if (!abort && sink->used) {
+		ret = net_sink_flush(sink, sink->used);
+		sink->pos += sink->used;
+	}
+	if (!ret)
+		ret = sink->pos;
+	if (sink->type == NET_SINK_SPARSE) {
+		if (abort || ret < 0)
+			free(sink->stream.buf);
+		else
+			ret = sparse_stream_finish(&sink->stream);
+	}
+	free(sink->buf);
+
+	return ret;
+}
+
+bool net_sink_active(void)
+{
+	return net_sink;
+}
+
+u64 net_sink_size(void)
+{
+	return net_sink->pos + net_sink->used;
+}
+
+int net_sink_write(u64 offset, const void *data, ulong len)
+{
+	struct net_sink *sink = net_sink;
+	ulong n;
+	int ret;
+
+	/* The transfer was restarted */
+	if (!offset && (sink->pos || sink->used)) {
+		ret = net_sink_reset(sink);
+		if (ret)
+			return ret;
+	}
+	if (offset != sink->pos + sink->used) {
+		log_err("Download is not in order (offset %llx, expected %llx)\n",
+			offset, sink->pos + sink->used);
+		return -ESPIPE;
+	}
+
+	while (len) {
+		n = min(len, CONFIG_NET_SINK_BUF_SIZE - sink->used);
+		memcpy(sink->buf + sink->used, data, n);
+		sink->used += n;
+		data += n;
+		len -= n;
+		if (sink->used == CONFIG_NET_SINK_BUF_SIZE) {
+			ret = net_sink_flush(sink, sink->used);
+			if (ret)
+				return ret;
+			sink->pos += sink->used;
+			sink->used = 0;
+		}
+	}
+
+	return 0;
+}
@@ -92,6 +92,7 @@
 #if defined(CONFIG_LED_STATUS)
 #include <miiphy.h>
 #endif
+#include <net-sink.h>
 #include <net.h>
 #include <net6.h>
 #include <ndisc.h>
@@ -437,6 +438,7 @@ int net_loop(enum proto_t protocol)
 {
 	int ret = -EINVAL;
 	enum net_loop_state prev_net_state = net_state;
+	u64 size;
 
 #if defined(CONFIG_CMD_PING)
 	if (protocol != PING)
@@ -727,11 +729,19 @@ restart:
 
 		case NETLOOP_SUCCESS:
 			net_cleanup_loop();
-			if (net_boot_file_size > 0) {
-				printf("Bytes transferred = %u (%x hex)\n",
-				       net_boot_file_size, net_boot_file_size);
-				env_set_hex("filesize", net_boot_file_size);
-				env_set_hex("fileaddr", image_load_addr);
+			/* a sink may take more than fits in net_boot_file_size */
+			size = net_sink_active() ? net_sink_size() :
+				net_boot_file_size;
+			if (size > 0) {
+				char buf[17];
+
+				printf("Bytes transferred = %llu (%llx hex)\n",
+				       size, size);
+				snprintf(buf, sizeof(buf), "%llx", size);
+				env_set("filesize", buf);
+				/* a sink writes the data to storage, not memory */
+				if (!net_sink_active())
+					env_set_hex("fileaddr", image_load_addr);
 			}
 			if (protocol != NETCONS && protocol != NCSI)
 				eth_halt();
@@ -740,7 +750,7 @@ restart:
 
 			eth_set_last_protocol(protocol);
 
-			ret = net_boot_file_size;
+			ret = min_t(u64, size, INT_MAX);
 			debug_cond(DEBUG_INT_STATE, "--- net_loop Success!\n");
 			goto done;
 
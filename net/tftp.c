@@ -14,9 +14,11 @@
 #include <lmb.h>
 #include <log.h>
 #include <mapmem.h>
+#include <net-sink.h>
 #include <net.h>
 #include <net6.h>
 #include <asm/global_data.h>
+#include <linux/math64.h>
 #include <net/tftp.h>
 #include "bootp.h"
 
@@ -73,6 +75,14 @@ static int	tftp_remote_port;
 /* The UDP port at our end */
 static int	tftp_our_port;
 static int	timeout_count;
+/*
+ * Blocks which arrive ahead of a missing one are kept, as long as they are
+ * less than TFTP_REORDER_BLOCKS ahead. The server is only asked to send the
+ * missing block again once TFTP_REORDER_THRESHOLD blocks have arrived ahead
+ * of it, since it may just have been reordered on the way.
+ */
+#define TFTP_REORDER_BLOCKS	128
+#define TFTP_REORDER_THRESHOLD	3
 /* packet sequence number */
 static ulong	tftp_cur_block;
 /* last packet sequence number received */
@@ -80,7 +90,7 @@ static ulong	tftp_prev_block;
 /* count of sequence number wraparounds */
 static ulong	tftp_block_wrap;
 /* memory offset due to wrapping */
-static ulong	tftp_block_wrap_offset;
+static u64	tftp_block_wrap_offset;
 static int	tftp_state;
 static ulong	tftp_load_addr;
 #ifdef CONFIG_TFTP_TSIZE
@@ -95,6 +105,18 @@ static ushort	tftp_windowsize;
 static ushort	tftp_next_ack;
 /* Last nack block we send */
 static ushort	tftp_last_nack;
+/* Blocks received ahead of tftp_cur_block + 1, one bit per block number */
+static u32	tftp_ahead_map[TFTP_REORDER_BLOCKS / 32];
+/* Number of blocks received ahead since the last one received in order */
+static int	tftp_ahead_count;
+/* 1 if the final (short) block has been received ahead */
+static int	tftp_final_ahead;
+/* The final block, if tftp_final_ahead */
+static ushort	tftp_final_block;
+/* Number of windows in this transfer in which blocks were lost */
+static ulong	tftp_loss_count;
+/* 1 if blocks were lost in the current window */
+static int	tftp_window_lost;
 #ifdef CONFIG_CMD_TFTPPUT
 /* 1 if writing, else 0 */
 static int	tftp_put_active;
@@ -115,7 +137,8 @@ static int	tftp_put_final_block_sent;
 
 /* default TFTP block size */
 #define TFTP_BLOCK_SIZE		512
-#define TFTP_MTU_BLOCKSIZE6 (CONFIG_TFTP_BLOCKSIZE - 20)
+/* size of the TFTP header of a DATA packet */
+#define TFTP_HDR_SIZE		4
 /* sequence number is 16 bit */
 #define TFTP_SEQUENCE_SIZE	((ulong)(1<<16))
 
@@ -148,16 +171,26 @@ static char tftp_filename[MAX_LEN];
 
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = CONFIG_TFTP_BLOCKSIZE;
+/* The block size we ask for, from tftp_block_size_option */
+static unsigned short tftp_block_size_req;
 static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
+/* The window size we ask for, see tftp_adapt_window() */
+static unsigned short tftp_window_size_req = TFTP_WINDOWSIZE;
+/* The value of tftp_window_size_option that tftp_window_size_req is for */
+static unsigned short tftp_window_size_max = TFTP_WINDOWSIZE;
 
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
-	ulong offset = block * tftp_block_size + tftp_block_wrap_offset -
+	u64 offset = (u64)block * tftp_block_size + tftp_block_wrap_offset -
 			tftp_block_size;
 	ulong newsize = offset + len;
 	ulong store_addr = tftp_load_addr + offset;
 	void *ptr;
 
+	/* a sink keeps its own 64-bit count, see net_sink_size() */
+	if (net_sink_active())
+		return net_sink_write(offset, src, len) ? -1 : 0;
+
 	if (CONFIG_IS_ENABLED(LMB)) {
 		if (store_addr < tftp_load_addr ||
 		    lmb_read_check(store_addr, len)) {
@@ -177,12 +210,73 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 	return 0;
 }
 
+static bool tftp_ahead_test(ushort block)
+{
+	block %= TFTP_REORDER_BLOCKS;
+
+	return tftp_ahead_map[block / 32] & BIT(block % 32);
+}
+
+static void tftp_ahead_set(ushort block, bool set)
+{
+	block %= TFTP_REORDER_BLOCKS;
+	if (set)
+		tftp_ahead_map[block / 32] |= BIT(block % 32);
+	else
+		tftp_ahead_map[block / 32] &= ~BIT(block % 32);
+}
+
+/*
+ * Keep a block which arrived ahead of tftp_cur_block + 1, so that the server
+ * need not send it again. Return true if the block is held.
+ */
+static bool tftp_store_ahead(ushort block, uchar *src, unsigned int len)
+{
+	ushort ahead = block - (ushort)(tftp_cur_block + 1);
+
+	/* A net sink needs the blocks in order */
+	if (tftp_state != STATE_DATA || !ahead ||
+	    ahead >= TFTP_REORDER_BLOCKS || len > tftp_block_size ||
+	    net_sink_active())
+		return false;
+	if (tftp_final_ahead && (short)(block - tftp_final_block) > 0)
+		return false;
+	if (tftp_ahead_test(block))
+		return true;
+
+	/* store_block() takes care of wrapping past block 65535 */
+	if (store_block(tftp_cur_block + 1 + ahead, src, len))
+		return false;
+
+	tftp_ahead_set(block, true);
+	if (len < tftp_block_size) {
+		tftp_final_ahead = 1;
+		tftp_final_block = block;
+	}
+
+	return true;
+}
+
+/* Count a window in which blocks were lost, see tftp_adapt_window() */
+static void tftp_note_loss(void)
+{
+	if (!tftp_window_lost) {
+		tftp_window_lost = 1;
+		tftp_loss_count++;
+	}
+}
+
 /* Clear our state ready for a new transfer */
 static void new_transfer(void)
 {
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	memset(tftp_ahead_map, '\0', sizeof(tftp_ahead_map));
+	tftp_ahead_count = 0;
+	tftp_final_ahead = 0;
+	tftp_loss_count = 0;
+	tftp_window_lost = 0;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
@@ -220,7 +314,7 @@ static void tftp_timeout_handler(void);
 
 static void show_block_marker(void)
 {
-	ulong pos;
+	u64 pos;
 
 #ifdef CONFIG_TFTP_TSIZE
 	if (tftp_tsize) {
@@ -229,7 +323,7 @@ static void show_block_marker(void)
 		if (pos > tftp_tsize)
 			pos = tftp_tsize;
 
-		while (tftp_tsize_num_hash < pos * 50 / tftp_tsize) {
+		while (tftp_tsize_num_hash < div_u64(pos * 50, tftp_tsize)) {
 			putc('#');
 			tftp_tsize_num_hash++;
 		}
@@ -277,9 +371,38 @@ static void update_block_number(void)
 	show_block_marker();
 }
 
+/*
+ * Choose the window size to ask for in the next transfer, from the loss seen
+ * in this one. It is halved if the transfer failed, or if blocks were lost
+ * in more than one window in eight, and is doubled, up to
+ * tftp_window_size_option, if nothing was lost.
+ */
+static void tftp_adapt_window(bool failed)
+{
+	ulong blocks, windows;
+
+	if (!IS_ENABLED(CONFIG_TFTP_WINDOWSIZE_ADAPT) || tftp_put_active ||
+	    tftp_state != STATE_DATA)
+		return;
+
+	blocks = tftp_cur_block + tftp_block_wrap * TFTP_SEQUENCE_SIZE;
+	windows = DIV_ROUND_UP(blocks, tftp_windowsize);
+	if (failed || tftp_loss_count * 8 > windows) {
+		if (tftp_window_size_req > 1)
+			tftp_window_size_req /= 2;
+	} else if (!tftp_loss_count) {
+		tftp_window_size_req = min_t(uint, tftp_window_size_req * 2,
+					     tftp_window_size_max);
+	}
+	debug("TFTP lost %lu of %lu windows, next windowsize = %d\n",
+	      tftp_loss_count, windows, tftp_window_size_req);
+}
+
 /* The TFTP get or put is complete */
 static void tftp_complete(void)
 {
+	tftp_adapt_window(false);
+
 #ifdef CONFIG_TFTP_TSIZE
 	/* Print hash marks for the last packet received */
 	while (tftp_tsize && tftp_tsize_num_hash < 49) {
@@ -291,15 +414,17 @@ static void tftp_complete(void)
 #endif
 	time_start = get_timer(time_start);
 	if (time_start > 0) {
+		u64 size = net_sink_active() ? net_sink_size() :
+			   net_boot_file_size;
+
 		puts("\n\t ");	/* Line up with "Loading: " */
-		print_size(net_boot_file_size /
-			time_start * 1000, "/s");
+		print_size(div_u64(size, time_start) * 1000, "/s");
 	}
 	puts("\ndone\n");
 
 	led_activity_off();
 
-	if (!tftp_put_active)
+	if (!tftp_put_active && !net_sink_active())
 		efi_set_bootdev("Net", "", tftp_filename,
 				map_sysmem(tftp_load_addr, 0),
 				net_boot_file_size);
@@ -351,15 +476,15 @@ static void tftp_send(void)
 #endif
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
-				0, tftp_block_size_option, 0);
+				0, tftp_block_size_req, 0);
 
 		/* try for more effic. window size.
 		 * Implemented only for tftp get.
 		 * Don't bother sending if it's 1
 		 */
-		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_req > 1)
 			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
-					0, tftp_window_size_option, 0);
+					0, tftp_window_size_req, 0);
 		len = pkt - xp;
 		break;
 
@@ -456,6 +581,8 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	__be16 *s;
 	int i;
 	u16 timeout_val_rcvd;
+	ushort block;
+	bool last;
 
 	if (dest != tftp_our_port) {
 			return;
@@ -543,7 +670,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 					dectoul((char *)pkt + i + 8, NULL);
 				debug("Blocksize oack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
-				if (tftp_block_size > tftp_block_size_option) {
+				if (tftp_block_size > tftp_block_size_req) {
 					printf("Invalid blk size(=%d)\n",
 					       tftp_block_size);
 					tftp_state = STATE_INVALID_OPTION;
@@ -592,7 +719,8 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			return;
 		len -= 2;
 
-		if (ntohs(*(__be16 *)pkt) != (ushort)(tftp_cur_block + 1)) {
+		block = ntohs(*(__be16 *)pkt);
+		if (block != (ushort)(tftp_cur_block + 1)) {
 			debug("Received unexpected block: %d, expected: %d\n",
 			      ntohs(*(__be16 *)pkt),
 			      (ushort)(tftp_cur_block + 1));
@@ -602,7 +730,20 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 * (required to properly handle the server retransmitting
 			 *  the window)
 			 */
-			if ((ushort)(tftp_cur_block + 1) - (short)(ntohs(*(__be16 *)pkt)) > 0)
+			if ((short)(block - (ushort)(tftp_cur_block + 1)) < 0) {
+				/* The server is sending the window again */
+				if (tftp_state == STATE_DATA)
+					tftp_note_loss();
+				break;
+			}
+			/*
+			 * Hold on to the block and give the missing one a
+			 * chance to turn up, unless the server is waiting for
+			 * the ACK at the end of its window.
+			 */
+			if (tftp_store_ahead(block, pkt + 2, len) &&
+			    ++tftp_ahead_count < TFTP_REORDER_THRESHOLD &&
+			    block != tftp_next_ack)
 				break;
 			/*
 			 * If one packet is dropped most likely
@@ -615,6 +756,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				tftp_last_nack = tftp_cur_block;
 				tftp_next_ack = (ushort)(tftp_cur_block +
 							 tftp_windowsize);
+				tftp_note_loss();
 			}
 			break;
 		}
@@ -661,7 +803,22 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		}
 		timeout_count = 0;
 
-		if (len < tftp_block_size) {
+		tftp_ahead_count = 0;
+
+		last = len < tftp_block_size;
+
+		/* Move on over any blocks which arrived ahead of this one */
+		while (!last && tftp_ahead_test(tftp_cur_block + 1)) {
+			tftp_cur_block++;
+			tftp_cur_block %= TFTP_SEQUENCE_SIZE;
+			tftp_ahead_set(tftp_cur_block, false);
+			update_block_number();
+			tftp_prev_block = tftp_cur_block;
+			last = tftp_final_ahead &&
+				tftp_cur_block == tftp_final_block;
+		}
+
+		if (last) {
 			tftp_send();
 			tftp_complete();
 			break;
@@ -669,11 +826,13 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 		/*
 		 *	Acknowledge the block just received, which will prompt
-		 *	the remote for the next one.
+		 *	the remote for the next one. Having moved on over blocks
+		 *	which arrived ahead, we may be past the end of the window.
 		 */
-		if (tftp_cur_block == tftp_next_ack) {
+		if ((short)((ushort)tftp_cur_block - tftp_next_ack) >= 0) {
 			tftp_send();
-			tftp_next_ack += tftp_windowsize;
+			tftp_next_ack = tftp_cur_block + tftp_windowsize;
+			tftp_window_lost = 0;
 		}
 		break;
 
@@ -705,9 +864,11 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 static void tftp_timeout_handler(void)
 {
 	if (++timeout_count > timeout_count_max) {
+		tftp_adapt_window(true);
 		restart("Retry count exceeded");
 	} else {
 		puts("T ");
+		tftp_note_loss();
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
@@ -720,11 +881,28 @@ static int tftp_init_load_addr(void)
 	return 0;
 }
 
-static int saved_tftp_block_size_option;
+/* Largest block which fits in one Ethernet frame */
+static int tftp_mtu_block_size(void)
+{
+	int ip_hdr_size = IP_HDR_SIZE;
+
+	if (IS_ENABLED(CONFIG_IPV6) && use_ip6)
+		ip_hdr_size = IP6_HDR_SIZE;
+
+	return ETH_DATA_LEN - ip_hdr_size - UDP_HDR_SIZE - TFTP_HDR_SIZE;
+}
+
 static void sanitize_tftp_block_size_option(enum proto_t protocol)
 {
 	int cap, max_defrag;
 
+	/* An option of 0 asks for the largest block which is not fragmented */
+	if (!tftp_block_size_option) {
+		tftp_block_size_req = tftp_mtu_block_size();
+		return;
+	}
+
+	tftp_block_size_req = tftp_block_size_option;
 	switch (protocol) {
 	case TFTPGET:
 		max_defrag = config_opt_enabled(CONFIG_IP_DEFRAG, CONFIG_NET_MAXDEFRAG, 0);
@@ -749,25 +927,24 @@ static void sanitize_tftp_block_size_option(enum proto_t protocol)
 		 * (and small enough that it fits net_tx_packet which
 		 * has room for PKTSIZE_ALIGN bytes).
 		 */
-		cap = 1468;
+		cap = ETH_DATA_LEN - IP_UDP_HDR_SIZE - TFTP_HDR_SIZE;
 	}
-	if (tftp_block_size_option > cap) {
+	if (tftp_block_size_req > cap) {
 		printf("Capping tftp block size option to %d (was %d)\n",
 		       cap, tftp_block_size_option);
-		saved_tftp_block_size_option = tftp_block_size_option;
-		tftp_block_size_option = cap;
+		tftp_block_size_req = cap;
 	}
+
+	/* There is no reassembly for IPv6, which also has a larger header */
+	if (IS_ENABLED(CONFIG_IPV6) && use_ip6)
+		tftp_block_size_req = min_t(int, tftp_block_size_req,
+					    tftp_mtu_block_size());
 }
 
 void tftp_start(enum proto_t protocol)
 {
 	__maybe_unused char *ep;             /* Environment pointer */
 
-	if (saved_tftp_block_size_option) {
-		tftp_block_size_option = saved_tftp_block_size_option;
-		saved_tftp_block_size_option = 0;
-	}
-
 	if (IS_ENABLED(CONFIG_NET_TFTP_VARS)) {
 
 		/*
@@ -806,8 +983,16 @@ void tftp_start(enum proto_t protocol)
 
 	sanitize_tftp_block_size_option(protocol);
 
+	/* Start again from the configured window size if it changed */
+	if (tftp_window_size_max != tftp_window_size_option) {
+		tftp_window_size_max = tftp_window_size_option;
+		tftp_window_size_req = tftp_window_size_option;
+	}
+	if (!IS_ENABLED(CONFIG_TFTP_WINDOWSIZE_ADAPT))
+		tftp_window_size_req = tftp_window_size_option;
+
 	debug("TFTP blocksize = %i, TFTP windowsize = %d timeout = %ld ms\n",
-	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
+	      tftp_block_size_req, tftp_window_size_req, timeout_ms);
 
 	if (IS_ENABLED(CONFIG_IPV6))
 		tftp_remote_ip6 = net_server_ip6;
@@ -850,9 +1035,6 @@ void tftp_start(enum proto_t protocol)
 	if (IS_ENABLED(CONFIG_IPV6) && use_ip6) {
 		printf("TFTP from server %pI6c; our IP address is %pI6c",
 		       &tftp_remote_ip6, &net_ip6);
-
-		if (tftp_block_size_option > TFTP_MTU_BLOCKSIZE6)
-			tftp_block_size_option = TFTP_MTU_BLOCKSIZE6;
 	} else {
 		printf("TFTP %s server %pI4; our IP address is %pI4",
 #ifdef CONFIG_CMD_TFTPPUT
@@ -12,6 +12,7 @@
 #include <bootflow.h>
 #include <mapmem.h>
 #include <os.h>
+#include <uthread.h>
 #include <test/ut.h>
 #include "bootstd_common.h"
 
@@ -434,10 +435,17 @@ static int bootdev_test_cmd_hunt(struct unit_test_state *uts)
 	ut_assertok(run_command("bootdev hunt", 0));
 	ut_assert_nextline("Hunting with: ethernet");
 
-	/* This is the extension feature which has no uclass at present */
+	/*
+	 * This is the extension feature which has no uclass at present. When
+	 * the hunters run in parallel, the next one starts while this one
+	 * waits, so its output comes later
+	 */
 	ut_assert_nextline("Hunting with: simple_bus");
-	ut_assert_nextline("Found 2 extension board(s).");
+	if (!CONFIG_IS_ENABLED(BOOTDEV_HUNT_PARALLEL))
+		ut_assert_nextline("Found 2 extension board(s).");
 	ut_assert_nextline("Hunting with: ide");
+	if (CONFIG_IS_ENABLED(BOOTDEV_HUNT_PARALLEL))
+		ut_assert_nextline("Found 2 extension board(s).");
 
 	/* mmc hunter has already been used so should not run again */
 
@@ -447,8 +455,13 @@ static int bootdev_test_cmd_hunt(struct unit_test_state *uts)
 	ut_assert_nextline("scanning bus for devices...");
 	ut_assert_skip_to_line("Hunting with: spi_flash");
 	ut_assert_nextline("Hunting with: usb");
-	ut_assert_skip_to_line("Bus usb@1: 5 USB Device(s) found");
-	ut_assert_nextline("Hunting with: virtio");
+	if (CONFIG_IS_ENABLED(BOOTDEV_HUNT_PARALLEL)) {
+		ut_assert_nextline("Hunting with: virtio");
+		ut_assert_skip_to_line("Bus usb@1: 5 USB Device(s) found");
+	} else {
+		ut_assert_skip_to_line("Bus usb@1: 5 USB Device(s) found");
+		ut_assert_nextline("Hunting with: virtio");
+	}
 	ut_assert_console_end();
 
 	/* List available hunters */
@@ -489,12 +502,162 @@ static int bootdev_test_hunt_scan(struct unit_test_state *uts)
 	ut_assertok(bootflow_scan_first(NULL, NULL, &iter,
 					BOOTFLOWIF_SHOW | BOOTFLOWIF_HUNT |
 					BOOTFLOWIF_SKIP_GLOBAL, &bflow));
-	ut_asserteq(BIT(MMC_HUNTER) | BIT(1), std->hunters_used);
+
+	ut_asserteq(BIT(MMC_HUNTER) | BIT(1),
+		    std->hunters_used & (BIT(MMC_HUNTER) | BIT(1)));
+
+	/*
+	 * Hunters running in parallel which have started are finished, while
+	 * the others are cancelled
+	 */
+	bootflow_iter_uninit(&iter);
+	ut_asserteq(0, std->hunters_busy);
+	if (!CONFIG_IS_ENABLED(BOOTDEV_HUNT_PARALLEL))
+		ut_asserteq(BIT(MMC_HUNTER) | BIT(1), std->hunters_used);
 
 	return 0;
 }
 BOOTSTD_TEST(bootdev_test_hunt_scan, UTF_DM | UTF_SCAN_FDT);
 
+/* Bootdevs found by scanning with every hunter, in the order they are used */
+static const char *const hunt_order[] = {
+	"mmc2.bootdev",
+	"mmc1.bootdev",
+	"mmc0.bootdev",
+	"scsi.id0lun0.bootdev",
+	"usb_mass_storage.lun0.bootdev",
+	"usb_mass_storage.lun0.bootdev",
+	"usb_mass_storage.lun0.bootdev",
+	"eth@10002000.bootdev",
+	"eth@10003000.bootdev",
+	"sbe5.bootdev",
+	"eth@10004000.bootdev",
+	"phy-test-eth.bootdev",
+	"dsa-test-eth.bootdev",
+	"dsa-test@0.bootdev",
+	"dsa-test@1.bootdev",
+};
+
+/*
+ * Scan all bootdevs, hunting, and check the order in which they are used.
+ * This returns the hunters which were still busy when the first bootflow was
+ * found in @busyp
+ */
+static int check_hunt_order(struct unit_test_state *uts, uint *busyp)
+{
+	struct bootflow_iter iter;
+	struct bootstd_priv *std;
+	struct bootflow bflow;
+	int i, ret;
+
+	ut_assertok(bootstd_get_priv(&std));
+	ut_assertok(bootstd_test_drop_bootdev_order(uts));
+	ut_assertok(bootflow_scan_first(NULL, NULL, &iter, BOOTFLOWIF_HUNT,
+					&bflow));
+	*busyp = std->hunters_busy;
+	do {
+		bootflow_free(&bflow);
+		ret = bootflow_scan_next(&iter, &bflow);
+	} while (ret != -ENODEV);
+	ut_asserteq(ARRAY_SIZE(hunt_order), iter.num_devs);
+	for (i = 0; i < iter.num_devs; i++)
+		ut_asserteq_str(hunt_order[i], iter.dev_used[i]->name);
+	bootflow_iter_uninit(&iter);
+
+	/* Every hunter has run and none is left in the background */
+	ut_asserteq(GENMASK(MAX_HUNTER, 0), std->hunters_used);
+	ut_asserteq(0, std->hunters_busy);
+
+	return 0;
+}
+
+/* Check the bootdev order when each hunter is used in turn */
+static int bootdev_test_hunt_serial(struct unit_test_state *uts)
+{
+	struct bootdev_hunter *start;
+	int n_ent, i;
+	uint busy;
+
+	test_set_skip_delays(true);
+	test_set_eth_enable(false);
+	bootstd_reset_usb();
+
+	/* Hunting by name never runs a hunter in the background */
+	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
+	n_ent = ll_entry_count(struct bootdev_hunter, bootdev_hunter);
+	for (i = 0; i < n_ent; i++)
+		ut_assertok(bootdev_hunt(uclass_get_name(start[i].uclass),
+					 false));
+	ut_assertok(check_hunt_order(uts, &busy));
+	ut_asserteq(0, busy);
+
+	return 0;
+}
+BOOTSTD_TEST(bootdev_test_hunt_serial, UTF_DM | UTF_SCAN_FDT |
+	     UTF_ETH_BOOTDEV);
+
+/* Check that hunters run together and give the same order as serial hunting */
+static int bootdev_test_hunt_parallel(struct unit_test_state *uts)
+{
+	uint busy;
+
+	if (!CONFIG_IS_ENABLED(BOOTDEV_HUNT_PARALLEL))
+		return -EAGAIN;
+	test_set_skip_delays(true);
+	test_set_eth_enable(false);
+	bootstd_reset_usb();
+
+	/* The first bootflow is found while the slower hunters still run */
+	ut_assertok(check_hunt_order(uts, &busy));
+	ut_assert(busy);
+
+	return 0;
+}
+BOOTSTD_TEST(bootdev_test_hunt_parallel, UTF_DM | UTF_SCAN_FDT |
+	     UTF_ETH_BOOTDEV);
+
+/* Check cancelling hunters which run in parallel */
+static int bootdev_test_hunt_cancel(struct unit_test_state *uts)
+{
+	struct bootstd_priv *std;
+	uint busy, first;
+
+	if (!CONFIG_IS_ENABLED(BOOTDEV_HUNT_PARALLEL))
+		return -EAGAIN;
+	test_set_skip_delays(true);
+	test_set_eth_enable(false);
+	bootstd_reset_usb();
+	ut_assertok(bootstd_get_priv(&std));
+
+	/* Hunters which have not started yet do not run at all */
+	ut_assertok(bootdev_hunt_start(false));
+	busy = std->hunters_busy;
+	ut_assert(busy);
+	bootdev_hunt_cancel();
+	while (uthread_schedule())
+		;
+	ut_asserteq(0, std->hunters_busy);
+	ut_asserteq(0, std->hunters_used);
+
+	/* A cancelled hunter still runs when it is needed */
+	ut_assertok(bootdev_hunt("mmc", false));
+	ut_asserteq(BIT(MMC_HUNTER), std->hunters_used);
+
+	/* A hunter which has started is allowed to finish */
+	ut_assertok(bootdev_hunt_start(false));
+	busy = std->hunters_busy;
+	first = BIT(ffs(busy) - 1);
+	ut_assert(uthread_schedule());
+	bootdev_hunt_finish();
+	ut_asserteq(0, std->hunters_busy);
+	ut_asserteq(first, std->hunters_used & first);
+	ut_assert((std->hunters_used & busy) != busy);
+
+	return 0;
+}
+BOOTSTD_TEST(bootdev_test_hunt_cancel, UTF_DM | UTF_SCAN_FDT |
+	     UTF_ETH_BOOTDEV);
+
 /* Check that only bootable partitions are processed */
 static int bootdev_test_bootable(struct unit_test_state *uts)
 {
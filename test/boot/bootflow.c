@@ -14,8 +14,12 @@
 #include <dm.h>
 #include <efi.h>
 #include <efi_loader.h>
+#include <env.h>
 #include <expo.h>
+#include <fs.h>
+#include <malloc.h>
 #include <mapmem.h>
+#include <os.h>
 #ifdef CONFIG_SANDBOX
 #include <asm/test.h>
 #endif
@@ -144,6 +148,28 @@ static int bootflow_cmd_label(struct unit_test_state *uts)
 BOOTSTD_TEST(bootflow_cmd_label, UTF_DM | UTF_SCAN_FDT | UTF_ETH_BOOTDEV |
 	     UTF_CONSOLE);
 
+/* Check 'bootflow scan' with a label giving a partition */
+static int bootflow_cmd_label_part(struct unit_test_state *uts)
+{
+	test_set_eth_enable(false);
+
+	ut_assertok(run_command("bootflow scan -lH mmc1:1", 0));
+	ut_assert_nextline("Scanning for bootflows with label 'mmc1:1'");
+	ut_assert_skip_to_line(
+		"  0  extlinux     ready   mmc          1  mmc1.bootdev.part_1       /extlinux/extlinux.conf");
+	ut_assert_skip_to_line("(1 bootflow, 1 valid)");
+	ut_assert_console_end();
+
+	/* the second partition has no filesystem */
+	ut_assertok(run_command("bootflow scan -lH mmc1:2", 0));
+	ut_assert_nextline("Scanning for bootflows with label 'mmc1:2'");
+	ut_assert_skip_to_line("(0 bootflows, 0 valid)");
+	ut_assert_console_end();
+
+	return 0;
+}
+BOOTSTD_TEST(bootflow_cmd_label_part, UTF_DM | UTF_SCAN_FDT | UTF_CONSOLE);
+
 /* Check 'bootflow scan/list' commands using all bootdevs */
 static int bootflow_cmd_glob(struct unit_test_state *uts)
 {
@@ -307,6 +333,10 @@ static int bootflow_iter(struct unit_test_state *uts)
 	ut_asserteq_str("extlinux", iter.method->name);
 	ut_asserteq(0, bflow.err);
 
+	/* The method order is allocated from the scan's arena */
+	if (CONFIG_IS_ENABLED(MALLOC_ARENA))
+		ut_assertnonnull(iter.arena);
+
 	/*
 	 * This shows MEDIA even though there is none, since in
 	 * bootdev_find_in_blk() we call part_get_info() which returns
@@ -523,6 +553,209 @@ static int bootflow_cmd_boot(struct unit_test_state *uts)
 }
 BOOTSTD_TEST(bootflow_cmd_boot, UTF_DM | UTF_SCAN_FDT | UTF_CONSOLE);
 
+#ifdef CONFIG_ENV_IS_IN_EXT4
+/* Save the environment to a filesystem created in test_ut_dm_init */
+static int cache_env_setup(struct unit_test_state *uts)
+{
+	char fname[256];
+
+	if (!IS_ENABLED(CONFIG_BOOTFLOW_CACHE))
+		return -EAGAIN;
+	ut_assertok(bootstd_test_drop_bootdev_order(uts));
+	ut_assertok(os_persistent_file(fname, sizeof(fname), "2MB.ext2.img"));
+	ut_assertok(run_commandf("host bind 0 %s", fname));
+	ut_assertok(run_command("env select EXT4", 0));
+	ut_assert_nextline("Select Environment on EXT4: OK");
+	ut_assertok(env_set(BOOTFLOW_CACHE_VAR, NULL));
+
+	return 0;
+}
+
+static int cache_env_cleanup(struct unit_test_state *uts, int old_prio)
+{
+	ut_assertok(env_set(BOOTFLOW_CACHE_VAR, NULL));
+	gd->env_load_prio = old_prio;
+	ut_assertok(run_command("host unbind 0", 0));
+
+	return 0;
+}
+
+/* Read the bootflow-cache record from the environment saved to host 0 */
+static int get_saved_rec(struct unit_test_state *uts, char *rec, int size)
+{
+	char *buf, *p;
+	loff_t actread;
+
+	buf = calloc(1, CONFIG_ENV_SIZE + 1);
+	ut_assertnonnull(buf);
+	ut_assertok(fs_set_blk_dev("host", "0:0", FS_TYPE_ANY));
+	ut_assertok(fs_read(CONFIG_ENV_EXT4_FILE, map_to_sysmem(buf), 0,
+			    CONFIG_ENV_SIZE, &actread));
+
+	/* Skip the CRC32 and look through the variables */
+	*rec = '\0';
+	for (p = buf + sizeof(u32); *p; p += strlen(p) + 1) {
+		if (!strncmp(p, BOOTFLOW_CACHE_VAR "=",
+			     sizeof(BOOTFLOW_CACHE_VAR))) {
+			strlcpy(rec, p + sizeof(BOOTFLOW_CACHE_VAR), size);
+			break;
+		}
+	}
+	free(buf);
+
+	return 0;
+}
+
+/* Record the extlinux bootflow on mmc1 without booting it */
+static int record_mmc1(struct unit_test_state *uts, char *rec, int size)
+{
+	struct bootflow_iter iter;
+	struct bootflow bflow;
+
+	ut_assertok(bootflow_scan_first(NULL, "mmc1", &iter, 0, &bflow));
+	bootflow_iter_uninit(&iter);
+	ut_asserteq_str("mmc1.bootdev.part_1", bflow.name);
+	bootflow_cache_save(&bflow);
+	bootflow_free(&bflow);
+	ut_assert_nextlinen("Saving Environment to EXT4... ");
+	console_record_reset_enable();
+
+	ut_assertok(get_saved_rec(uts, rec, size));
+	ut_asserteq_strn("mmc1:1 extlinux /extlinux/extlinux.conf ", rec);
+	ut_asserteq_str(rec, env_get(BOOTFLOW_CACHE_VAR));
+
+	return 0;
+}
+
+/* Check that a bootflow is recorded when booted, if there is no record */
+static int bootflow_cache_miss(struct unit_test_state *uts)
+{
+	int old_prio = gd->env_load_prio;
+	struct bootflow bflow;
+	char rec[256];
+	int ret;
+
+	ret = cache_env_setup(uts);
+	if (ret)
+		return ret;
+
+	/* The full scan runs and bootflow_boot() saves the record */
+	ut_assertok(inject_response(uts));
+	ut_assertok(run_command("bootflow scan -lb", 0));
+	ut_assert_nextline("Scanning for bootflows in all bootdevs");
+	ut_assert_skip_to_line(
+		"** Booting bootflow 'mmc1.bootdev.part_1' with extlinux");
+	ut_assert_nextlinen("Saving Environment to EXT4... ");
+	ut_assert_skip_to_line("Boot failed (err=-14)");
+	console_record_reset_enable();
+
+	/* The boot failed, so the record is dropped, but not saved */
+	ut_assertnull(env_get(BOOTFLOW_CACHE_VAR));
+	ut_assertok(get_saved_rec(uts, rec, sizeof(rec)));
+	ut_asserteq_strn("mmc1:1 extlinux /extlinux/extlinux.conf ", rec);
+
+	/* With that record, the bootflow is found */
+	ut_assertok(env_set(BOOTFLOW_CACHE_VAR, rec));
+	ut_assertok(bootflow_cache_find(0, &bflow));
+	ut_asserteq_str("mmc1.bootdev.part_1", bflow.name);
+
+	/* Booting it again does not save the environment */
+	bootflow_cache_save(&bflow);
+	ut_assert_console_end();
+	ut_asserteq_str(rec, env_get(BOOTFLOW_CACHE_VAR));
+	bootflow_free(&bflow);
+
+	/* A record for a partition without the bootflow is not found */
+	ut_assertok(env_set(BOOTFLOW_CACHE_VAR,
+			    "mmc1:2 extlinux /extlinux/extlinux.conf 1 0"));
+	ut_asserteq(-ENOENT, bootflow_cache_find(0, &bflow));
+	ut_assertok(env_set(BOOTFLOW_CACHE_VAR, "mmc1:1"));
+	ut_asserteq(-EINVAL, bootflow_cache_find(0, &bflow));
+
+	return cache_env_cleanup(uts, old_prio);
+}
+BOOTSTD_TEST(bootflow_cache_miss, UTF_DM | UTF_SCAN_FDT | UTF_CONSOLE);
+
+/* Check that a stale record is ignored and replaced */
+static int bootflow_cache_stale(struct unit_test_state *uts)
+{
+	int old_prio = gd->env_load_prio;
+	struct bootflow bflow;
+	char rec[256], good[256];
+	char *p;
+	int ret;
+
+	ret = cache_env_setup(uts);
+	if (ret)
+		return ret;
+	ut_assertok(record_mmc1(uts, good, sizeof(good)));
+
+	/* The file has changed since the record was made */
+	strlcpy(rec, good, sizeof(rec));
+	p = strrchr(rec, ' ');
+	ut_assertnonnull(p);
+	strcpy(p + 1, "00000000");
+	ut_assertok(env_set(BOOTFLOW_CACHE_VAR, rec));
+	ut_asserteq(-ENOENT, bootflow_cache_find(0, &bflow));
+
+	/* The full scan runs and the record is saved again */
+	ut_assertok(inject_response(uts));
+	ut_assertok(run_command("bootflow scan -lb", 0));
+	ut_assert_nextline("Scanning for bootflows in all bootdevs");
+	ut_assert_nextlinen("Seq");
+	ut_assert_nextlinen("---");
+	ut_assert_nextline("Scanning global bootmeth 'firmware0':");
+	ut_assert_skip_to_line(
+		"** Booting bootflow 'mmc1.bootdev.part_1' with extlinux");
+	ut_assert_nextlinen("Saving Environment to EXT4... ");
+	ut_assert_skip_to_line("Boot failed (err=-14)");
+	console_record_reset_enable();
+
+	ut_assertok(get_saved_rec(uts, rec, sizeof(rec)));
+	ut_asserteq_str(good, rec);
+
+	return cache_env_cleanup(uts, old_prio);
+}
+BOOTSTD_TEST(bootflow_cache_stale, UTF_DM | UTF_SCAN_FDT | UTF_CONSOLE);
+
+/* Check that the last bootflow booted is tried before scanning */
+static int bootflow_cache_hit(struct unit_test_state *uts)
+{
+	int old_prio = gd->env_load_prio;
+	char rec[256], saved[256];
+	int ret;
+
+	ret = cache_env_setup(uts);
+	if (ret)
+		return ret;
+	ut_assertok(record_mmc1(uts, rec, sizeof(rec)));
+
+	/* The bootflow is booted first, without saving the environment */
+	ut_assertok(inject_response(uts));
+	ut_assertok(inject_response(uts));
+	ut_assertok(run_command("bootflow scan -lb", 0));
+	ut_assert_nextline("Scanning for bootflows in all bootdevs");
+	ut_assert_nextlinen("Seq");
+	ut_assert_nextlinen("---");
+	ut_assert_nextline("Using bootflow from last boot");
+	ut_assert_nextline(
+		"** Booting bootflow 'mmc1.bootdev.part_1' with extlinux");
+	ut_assert_nextline("Ignoring unknown command: ui");
+	ut_assert_skip_to_line("Boot failed (err=-14)");
+
+	/* That failed, so the full scan follows */
+	ut_assert_nextline("Scanning global bootmeth 'firmware0':");
+	console_record_reset_enable();
+
+	/* The record is unchanged */
+	ut_assertok(get_saved_rec(uts, saved, sizeof(saved)));
+	ut_asserteq_str(rec, saved);
+
+	return cache_env_cleanup(uts, old_prio);
+}
+BOOTSTD_TEST(bootflow_cache_hit, UTF_DM | UTF_SCAN_FDT | UTF_CONSOLE);
+#endif
+
 /**
  * prep_mmc_bootdev() - Set up an mmc bootdev so we can access other distros
  *
@@ -6,7 +6,11 @@
  * Written by Simon Glass <sjg@chromium.org>
  */
 
+#include <bootstage.h>
 #include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <linux/libfdt.h>
 #include <test/ut.h>
 #include "bootstd_common.h"
 
@@ -32,3 +36,158 @@ static int test_image_phase(struct unit_test_state *uts)
 	return 0;
 }
 BOOTSTD_TEST(test_image_phase, 0);
+
+/* Test verifying an image with a chunked hash */
+static int test_image_chunked_hash(struct unit_test_state *uts)
+{
+	const uint chunk_size = 0x1000, size = chunk_size * 5 + 0x123;
+	u8 values[6 * FIT_MAX_HASH_LEN], root[FIT_MAX_HASH_LEN];
+	u8 digest[FIT_MAX_HASH_LEN];
+	int values_len, root_len, digest_len, node, hash;
+	u8 *data, *fit_data, *fit_values;
+	char *fit;
+	uint i;
+
+	data = malloc(size);
+	ut_assertnonnull(data);
+	for (i = 0; i < size; i++)
+		data[i] = i * 13;
+
+	ut_assertok(calculate_chunk_hashes(data, size, "sha256", chunk_size,
+					   values, &values_len));
+	ut_asserteq(6 * 32, values_len);
+	ut_assertok(calculate_hash(values, values_len, "sha256", root,
+				   &root_len));
+
+	/* The last chunk is short */
+	ut_assertok(calculate_hash(data + chunk_size * 5, 0x123, "sha256",
+				   digest, &digest_len));
+	ut_asserteq_mem(digest, values + 5 * 32, 32);
+
+	fit = malloc(0x8000);
+	ut_assertnonnull(fit);
+	ut_assertok(fdt_create_empty_tree(fit, 0x8000));
+	node = fdt_add_subnode(fit, 0, "images");
+	ut_assert(node > 0);
+	node = fdt_add_subnode(fit, node, "kernel");
+	ut_assert(node > 0);
+	ut_assertok(fdt_setprop(fit, node, FIT_DATA_PROP, data, size));
+	hash = fdt_add_subnode(fit, node, "hash-1");
+	ut_assert(hash > 0);
+	ut_assertok(fdt_setprop_string(fit, hash, FIT_ALGO_PROP, "sha256"));
+	ut_assertok(fdt_setprop_u32(fit, hash, FIT_CHUNK_SIZE_PROP,
+				    chunk_size));
+	ut_assertok(fdt_setprop(fit, hash, FIT_CHUNK_VALUE_PROP, values,
+				values_len));
+	ut_assertok(fdt_setprop(fit, hash, FIT_VALUE_PROP, root, root_len));
+	node = fdt_path_offset(fit, "/images/kernel");
+	hash = fdt_subnode_offset(fit, node, "hash-1");
+
+	ut_asserteq(1, fit_image_verify(fit, node));
+
+	/* Corrupt the last chunk */
+	fit_data = fdt_getprop_w(fit, node, FIT_DATA_PROP, NULL);
+	fit_data[size - 1] ^= 1;
+	ut_asserteq(0, fit_image_verify(fit, node));
+	ut_assert_nextline("sha256+ sha256 error!");
+	ut_assert_nextline("Bad chunk hash value for 'hash-1' hash node in 'kernel' image node");
+	fit_data[size - 1] ^= 1;
+
+	/* Corrupt a chunk hash, which no longer matches the root hash */
+	fit_values = fdt_getprop_w(fit, hash, FIT_CHUNK_VALUE_PROP, NULL);
+	fit_values[0] ^= 1;
+	ut_asserteq(0, fit_image_verify(fit, node));
+	ut_assert_nextline("sha256 error!");
+	ut_assert_nextline("Bad hash value for 'hash-1' hash node in 'kernel' image node");
+	ut_assert_console_end();
+
+	free(fit);
+	free(data);
+
+	return 0;
+}
+BOOTSTD_TEST(test_image_chunked_hash, UTF_CONSOLE);
+
+/* Test loading an image with a chunked hash, as bootm does */
+static int test_image_chunked_hash_load(struct unit_test_state *uts)
+{
+	const uint chunk_size = 0x1000, size = chunk_size * 3 + 0x40;
+	const ulong addr = 0x10000, load = 0x20000;
+	struct bootm_headers images = { .verify = 1 };
+	u8 values[4 * FIT_MAX_HASH_LEN], root[FIT_MAX_HASH_LEN];
+	int values_len, root_len, node, hash;
+	const char *uname = NULL, *uname_config = NULL;
+	ulong data, len;
+	u8 *buf, *fit_data;
+	char *fit;
+	uint i;
+
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	for (i = 0; i < size; i++)
+		buf[i] = i * 7;
+	ut_assertok(calculate_chunk_hashes(buf, size, "sha256", chunk_size,
+					   values, &values_len));
+	ut_assertok(calculate_hash(values, values_len, "sha256", root,
+				   &root_len));
+
+	fit = map_sysmem(addr, 0x8000);
+	ut_assertok(fdt_create_empty_tree(fit, 0x8000));
+	ut_assertok(fdt_setprop_string(fit, 0, FIT_DESC_PROP, "chunked"));
+	ut_assertok(fdt_setprop_u32(fit, 0, FIT_TIMESTAMP_PROP, 0));
+	node = fdt_add_subnode(fit, 0, "configurations");
+	ut_assert(node > 0);
+	ut_assertok(fdt_setprop_string(fit, node, FIT_DEFAULT_PROP, "conf-1"));
+	node = fdt_add_subnode(fit, node, "conf-1");
+	ut_assert(node > 0);
+	ut_assertok(fdt_setprop_string(fit, node, FIT_KERNEL_PROP, "kernel"));
+
+	node = fdt_add_subnode(fit, 0, "images");
+	ut_assert(node > 0);
+	node = fdt_add_subnode(fit, node, "kernel");
+	ut_assert(node > 0);
+	ut_assertok(fdt_setprop(fit, node, FIT_DATA_PROP, buf, size));
+	ut_assertok(fdt_setprop_string(fit, node, FIT_TYPE_PROP, "kernel"));
+	ut_assertok(fdt_setprop_string(fit, node, FIT_OS_PROP, "linux"));
+	ut_assertok(fdt_setprop_string(fit, node, FIT_ARCH_PROP, "sandbox"));
+	ut_assertok(fdt_setprop_string(fit, node, FIT_COMP_PROP, "none"));
+	ut_assertok(fdt_setprop_u32(fit, node, FIT_LOAD_PROP, load));
+	hash = fdt_add_subnode(fit, node, "hash-1");
+	ut_assert(hash > 0);
+	ut_assertok(fdt_setprop_string(fit, hash, FIT_ALGO_PROP, "sha256"));
+	ut_assertok(fdt_setprop_u32(fit, hash, FIT_CHUNK_SIZE_PROP,
+				    chunk_size));
+	ut_assertok(fdt_setprop(fit, hash, FIT_CHUNK_VALUE_PROP, values,
+				values_len));
+	ut_assertok(fdt_setprop(fit, hash, FIT_VALUE_PROP, root, root_len));
+	node = fdt_path_offset(fit, "/images/kernel");
+
+	/* The value is not a hash of the data, so it cannot be streamed */
+	if (CONFIG_IS_ENABLED(FIT_HASH_STREAM))
+		ut_assert(!fit_image_hash_stream_check(fit, node));
+
+	ut_asserteq(node, fit_image_load(&images, addr, &uname, &uname_config,
+					 IH_ARCH_DEFAULT, IH_TYPE_KERNEL,
+					 BOOTSTAGE_ID_FIT_KERNEL_START,
+					 FIT_LOAD_REQUIRED, &data, &len));
+	ut_asserteq(load, data);
+	ut_asserteq(size, len);
+	ut_asserteq_mem(buf, map_sysmem(load, size), size);
+
+	/* A corrupt chunk must stop the image being loaded */
+	fit_data = fdt_getprop_w(fit, node, FIT_DATA_PROP, NULL);
+	fit_data[chunk_size + 1] ^= 1;
+	uname = NULL;
+	uname_config = NULL;
+	ut_asserteq(-EACCES, fit_image_load(&images, addr, &uname,
+					    &uname_config, IH_ARCH_DEFAULT,
+					    IH_TYPE_KERNEL,
+					    BOOTSTAGE_ID_FIT_KERNEL_START,
+					    FIT_LOAD_REQUIRED, &data, &len));
+
+	unmap_sysmem(fit);
+	free(buf);
+
+	return 0;
+}
+BOOTSTD_TEST(test_image_chunked_hash_load, 0);
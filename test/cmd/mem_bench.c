@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for 'mem bench' command
+ */
+
+#include <command.h>
+#include <console.h>
+#include <test/ut.h>
+
+/* Declare a new mem test */
+#define MEM_TEST(_name, _flags)	UNIT_TEST(_name, _flags, mem)
+
+/* Test 'mem bench' reports each size class */
+static int mem_test_bench(struct unit_test_state *uts)
+{
+	ut_assertok(run_command("mem bench 400", 0));
+	ut_assert_nextline("      Size        memcpy       memmove        memset");
+	ut_assert_nextlinen("        40  ");
+	ut_assert_nextlinen("       100  ");
+	ut_assert_nextlinen("       400  ");
+	ut_assert_console_end();
+
+	ut_asserteq(1, run_command("mem bench 10", 0));
+	ut_assert_nextline("Size must be at least 0x40");
+	ut_assert_console_end();
+
+	return 0;
+}
+MEM_TEST(mem_test_bench, UTF_CONSOLE);
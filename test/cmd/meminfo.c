@@ -6,6 +6,7 @@
  * Written by Simon Glass <sjg@chromium.org>
  */
 
+#include <malloc_arena.h>
 #include <dm/test.h>
 #include <test/cmd.h>
 #include <test/ut.h>
@@ -13,6 +14,14 @@
 /* Test 'meminfo' command */
 static int cmd_test_meminfo(struct unit_test_state *uts)
 {
+	struct malloc_arena *arena = NULL;
+
+	if (CONFIG_IS_ENABLED(MALLOC_ARENA)) {
+		arena = malloc_arena_create("test");
+		ut_assertnonnull(arena);
+		ut_assertnonnull(malloc_arena_alloc(arena, 0x20));
+	}
+
 	ut_assertok(run_command("meminfo", 0));
 	ut_assert_nextline("DRAM:  256 MiB");
 	ut_assert_nextline_empty();
@@ -35,7 +44,24 @@ static int cmd_test_meminfo(struct unit_test_state *uts)
 	ut_assert_nextlinen("lmb");
 	ut_assert_skip_to_linen("free");
 
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)) {
+		ut_assert_nextline_empty();
+		ut_assert_nextline("Slab            Pages     Used     Peak     Free");
+		ut_assert_nextlinen("-");
+		ut_assert_nextlinen("16 ");
+		ut_assert_skip_to_linen("256 ");
+	}
+
+	if (CONFIG_IS_ENABLED(MALLOC_ARENA)) {
+		ut_assert_nextline_empty();
+		ut_assert_nextline("Arena          Blocks     Size     Used     Peak");
+		ut_assert_nextlinen("-");
+		ut_assert_skip_to_line("test                1     1000       20       20");
+	}
+
 	ut_assert_console_end();
+	if (CONFIG_IS_ENABLED(MALLOC_ARENA))
+		malloc_arena_destroy(arena);
 
 	return 0;
 }
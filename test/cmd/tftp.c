@@ -0,0 +1,339 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for TFTP transfers over a link which drops and reorders packets
+ */
+
+#include <command.h>
+#include <dm.h>
+#include <env.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <net.h>
+#include <time.h>
+#include <vsprintf.h>
+#include <asm/eth.h>
+#include <test/cmd.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Well known TFTP port # */
+#define TFTP_PORT	69
+/* Transaction ID, chosen at random */
+#define TFTP_TID	21313
+
+/*
+ *	TFTP operations.
+ */
+#define TFTP_RRQ	1
+#define TFTP_DATA	3
+#define TFTP_ACK	4
+#define TFTP_OACK	6
+
+#define TEST_BLKSIZE	512
+#define TEST_BLOCKS	190
+/* The final block is a short one */
+#define TEST_SIZE	(TEST_BLOCKS * TEST_BLKSIZE + 100)
+#define TEST_ADDR	0x1000000
+/* Time which passes each time the client polls an idle link */
+#define TEST_IDLE_MS	250
+
+/**
+ * struct tftp_test_server - TFTP server at the other end of the sandbox link
+ *
+ * The server sends a window of blocks in reply to each ACK, as in RFC 7440.
+ * The packets are only queued as the client reads them, so a window may be
+ * larger than the sandbox receive queue.
+ *
+ * @data: File being served
+ * @drop: true to drop some blocks the first time they are sent
+ * @reorder: true to swap some blocks with the block after them, the first
+ *	time they are sent
+ * @window: Window size agreed for this transfer
+ * @req_window: Window size asked for by the last read request, 1 if none
+ * @rrqs: Number of read requests received
+ * @nacks: Number of ACKs received for a block before the end of the window
+ * @dropped: Number of blocks dropped
+ * @reordered: Number of blocks sent after the one following them
+ * @client_hwaddr: Client's MAC address
+ * @client_ip: Client's IP address
+ * @server_ip: Our IP address
+ * @client_port: Client's UDP port
+ * @next: Next block to send, 0 for the OACK
+ * @end: Last block to send before waiting for an ACK
+ * @sent: true for each block which has been sent at least once
+ */
+struct tftp_test_server {
+	u8 *data;
+	bool drop;
+	bool reorder;
+	int window;
+	int req_window;
+	int rrqs;
+	int nacks;
+	int dropped;
+	int reordered;
+	u8 client_hwaddr[ARP_HLEN];
+	struct in_addr client_ip;
+	struct in_addr server_ip;
+	u16 client_port;
+	uint next;
+	uint end;
+	bool sent[TEST_BLOCKS + 2];
+};
+
+static struct tftp_test_server *tftp_test_srv(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	return priv->priv;
+}
+
+/* Queue a DATA packet for @block, or the OACK if it is 0 */
+static int tftp_test_queue(struct udevice *dev, uint block)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct tftp_test_server *srv = priv->priv;
+	struct ethernet_hdr *eth;
+	struct ip_udp_hdr *ip;
+	__be16 *s;
+	char *pkt;
+	int len;
+
+	/* Don't allow the buffer to overrun */
+	if (priv->recv_packets >= PKTBUFSRX)
+		return -EOVERFLOW;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, srv->client_hwaddr, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	ip = (void *)eth + ETHER_HDR_SIZE;
+	s = (void *)ip + IP_UDP_HDR_SIZE;
+	if (!block) {
+		*s = htons(TFTP_OACK);
+		pkt = (char *)(s + 1);
+		pkt += sprintf(pkt, "blksize%c%d%c", 0, TEST_BLKSIZE, 0);
+		if (srv->window > 1)
+			pkt += sprintf(pkt, "windowsize%c%d%c", 0, srv->window,
+				       0);
+		len = pkt - (char *)s;
+	} else {
+		int size = min_t(int, TEST_SIZE - (block - 1) * TEST_BLKSIZE,
+				 TEST_BLKSIZE);
+
+		s[0] = htons(TFTP_DATA);
+		s[1] = htons(block);
+		memcpy(s + 2, srv->data + (block - 1) * TEST_BLKSIZE, size);
+		len = 4 + size;
+	}
+
+	net_set_ip_header((uchar *)ip, srv->client_ip, srv->server_ip,
+			  IP_UDP_HDR_SIZE + len, IPPROTO_UDP);
+	ip->udp_src = htons(TFTP_TID);
+	ip->udp_dst = htons(srv->client_port);
+	ip->udp_len = htons(UDP_HDR_SIZE + len);
+	ip->udp_xsum = 0;
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len;
+	++priv->recv_packets;
+	srv->sent[block] = true;
+
+	return 0;
+}
+
+/* Send the rest of the window, as far as it fits in the receive queue */
+static int tftp_test_rx_handler(struct udevice *dev)
+{
+	struct tftp_test_server *srv = tftp_test_srv(dev);
+	uint block;
+
+	/* Nothing to send, so let time pass until the client times out */
+	if (srv->next > srv->end) {
+		timer_test_add_offset(TEST_IDLE_MS);
+		return 0;
+	}
+
+	while (srv->next <= srv->end) {
+		block = srv->next;
+		if (block && !srv->sent[block]) {
+			/* losing the final block needs a timeout to recover */
+			if (srv->drop && (block % 16 == 5 ||
+					  block == TEST_BLOCKS + 1)) {
+				srv->sent[block] = true;
+				srv->dropped++;
+				srv->next++;
+				continue;
+			}
+			/*
+			 * The client asks again at once for a block missing at
+			 * the end of the window, so only swap blocks within it
+			 */
+			if (srv->reorder && block % 16 == 11 &&
+			    block + 1 < srv->end) {
+				if (tftp_test_queue(dev, block + 1) ||
+				    tftp_test_queue(dev, block))
+					break;
+				srv->reordered++;
+				srv->next += 2;
+				continue;
+			}
+		}
+		if (tftp_test_queue(dev, block))
+			break;
+		srv->next++;
+	}
+
+	return 0;
+}
+
+static void tftp_test_rrq(struct tftp_test_server *srv, char *opt, int len)
+{
+	char *end = opt + len;
+
+	/* skip the file name and mode */
+	opt += strnlen(opt, end - opt) + 1;
+	opt += strnlen(opt, end - opt) + 1;
+
+	srv->req_window = 1;
+	while (opt < end) {
+		char *val = opt + strnlen(opt, end - opt) + 1;
+
+		if (val >= end)
+			break;
+		if (!strcmp(opt, "windowsize"))
+			srv->req_window = dectoul(val, NULL);
+		opt = val + strnlen(val, end - val) + 1;
+	}
+
+	srv->window = srv->req_window;
+	srv->rrqs++;
+	memset(srv->sent, '\0', sizeof(srv->sent));
+	srv->next = 0;
+	srv->end = 0;
+}
+
+static void tftp_test_ack(struct tftp_test_server *srv, uint block)
+{
+	if (block != srv->end)
+		srv->nacks++;
+	srv->next = block + 1;
+	srv->end = min(block + srv->window, (uint)TEST_BLOCKS + 1);
+}
+
+static int tftp_test_tx_handler(struct udevice *dev, void *packet,
+				unsigned int len)
+{
+	struct tftp_test_server *srv = tftp_test_srv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	__be16 *s = (void *)ip + IP_UDP_HDR_SIZE;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return 0;
+
+	if (ntohs(ip->udp_dst) == TFTP_PORT && ntohs(s[0]) == TFTP_RRQ) {
+		memcpy(srv->client_hwaddr, eth->et_src, ARP_HLEN);
+		net_copy_ip(&srv->client_ip, &ip->ip_src);
+		net_copy_ip(&srv->server_ip, &ip->ip_dst);
+		srv->client_port = ntohs(ip->udp_src);
+		tftp_test_rrq(srv, (char *)(s + 1),
+			      ntohs(ip->udp_len) - UDP_HDR_SIZE - 2);
+	} else if (ntohs(ip->udp_dst) == TFTP_TID &&
+		   ntohs(s[0]) == TFTP_ACK) {
+		tftp_test_ack(srv, ntohs(s[1]));
+	}
+
+	return 0;
+}
+
+/* Fetch the file and check that it arrives intact */
+static int tftp_test_get(struct unit_test_state *uts,
+			 struct tftp_test_server *srv)
+{
+	srv->rrqs = 0;
+	srv->nacks = 0;
+	srv->dropped = 0;
+	srv->reordered = 0;
+	memset(map_sysmem(TEST_ADDR, TEST_SIZE), '\0', TEST_SIZE);
+
+	ut_assertok(run_commandf("tftpboot %x 1.1.2.4:test.bin", TEST_ADDR));
+	ut_asserteq(TEST_SIZE, env_get_hex("filesize", 0));
+	ut_asserteq_mem(srv->data, map_sysmem(TEST_ADDR, TEST_SIZE),
+			TEST_SIZE);
+
+	/* a restart would mean the client gave up on the window */
+	ut_asserteq(1, srv->rrqs);
+
+	return 0;
+}
+
+static int net_test_tftp_lossy(struct unit_test_state *uts)
+{
+	struct tftp_test_server *srv;
+	int i;
+
+	srv = calloc(1, sizeof(*srv));
+	ut_assertnonnull(srv);
+	srv->data = malloc(TEST_SIZE);
+	ut_assertnonnull(srv->data);
+	for (i = 0; i < TEST_SIZE; i++)
+		srv->data[i] = i * 13 + (i >> 9);
+
+	sandbox_eth_set_tx_handler(0, tftp_test_tx_handler);
+	sandbox_eth_set_rx_handler(0, tftp_test_rx_handler);
+	sandbox_eth_set_priv(0, srv);
+	ut_assertok(env_set("ethact", "eth@10002000"));
+	ut_assertok(env_set("ethrotate", "no"));
+	ut_assertok(env_set("tftpblocksize", "512"));
+	ut_assertok(env_set("tftptimeout", "1000"));
+
+	/* start from the largest window, whatever earlier transfers saw */
+	ut_assertok(env_set("tftpwindowsize", "1"));
+	ut_assertok(tftp_test_get(uts, srv));
+	ut_assertok(env_set("tftpwindowsize", "8"));
+
+	/* reordered blocks are kept, so they are not asked for again */
+	srv->reorder = true;
+	ut_assertok(tftp_test_get(uts, srv));
+	ut_asserteq(8, srv->req_window);
+	ut_assert(srv->reordered > 0);
+	ut_asserteq(0, srv->nacks);
+
+	/* lost blocks are asked for again */
+	srv->drop = true;
+	ut_assertok(tftp_test_get(uts, srv));
+	ut_asserteq(8, srv->req_window);
+	ut_assert(srv->dropped > 0);
+	ut_assert(srv->nacks >= srv->dropped);
+
+	/* loss in more than one window in eight halves the next window */
+	srv->drop = false;
+	srv->reorder = false;
+	ut_assertok(tftp_test_get(uts, srv));
+	ut_asserteq(4, srv->req_window);
+	ut_asserteq(0, srv->nacks);
+
+	/* and a clean transfer doubles it, up to tftpwindowsize */
+	ut_assertok(tftp_test_get(uts, srv));
+	ut_asserteq(8, srv->req_window);
+	ut_assertok(tftp_test_get(uts, srv));
+	ut_asserteq(8, srv->req_window);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_rx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+	env_set("tftpwindowsize", NULL);
+	env_set("tftptimeout", NULL);
+	env_set("tftpblocksize", NULL);
+	env_set("ethrotate", NULL);
+	free(srv->data);
+	free(srv);
+
+	return 0;
+}
+CMD_TEST(net_test_tftp_lossy, 0);
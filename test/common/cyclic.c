@@ -37,3 +37,63 @@ static int dm_test_cyclic_running(struct unit_test_state *uts)
 	return 0;
 }
 COMMON_TEST(dm_test_cyclic_running, 0);
+
+static struct cyclic_count {
+	struct cyclic_info cyclic;
+	int count;
+} cyclic_slow, cyclic_zero;
+
+static void count_cb(struct cyclic_info *c)
+{
+	struct cyclic_count *t = container_of(c, struct cyclic_count, cyclic);
+
+	t->count++;
+}
+
+/* Test that cyclic functions are run in order and at most once per call */
+static int dm_test_cyclic_order(struct unit_test_state *uts)
+{
+	struct cyclic_info *cyclic;
+	u64 prev = 0;
+
+	cyclic_slow.count = 0;
+	cyclic_zero.count = 0;
+	cyclic_register(&cyclic_slow.cyclic, count_cb, 100 * 1000 * 1000,
+			"cyclic_slow");
+	cyclic_register(&cyclic_zero.cyclic, count_cb, 0, "cyclic_zero");
+
+	/* Both are due straight away, but the zero delay one only runs once */
+	schedule();
+	ut_asserteq(1, cyclic_slow.count);
+	ut_asserteq(1, cyclic_zero.count);
+
+	schedule();
+	schedule();
+	ut_asserteq(1, cyclic_slow.count);
+	ut_asserteq(3, cyclic_zero.count);
+
+	/* The list is sorted by the time of the next call */
+	hlist_for_each_entry(cyclic, cyclic_get_list(), list) {
+		ut_assert(prev <= cyclic->next_call);
+		prev = cyclic->next_call;
+	}
+
+#if defined(CONFIG_CYCLIC_LATENCY_STATS)
+	{
+		u32 total = 0;
+		int i;
+
+		for (i = 0; i < CYCLIC_LAT_BUCKETS; i++)
+			total += cyclic_zero.cyclic.lat_hist[i];
+		ut_asserteq(3, total);
+		ut_assert(cyclic_zero.cyclic.lat_max_us * 3ULL >=
+			  cyclic_zero.cyclic.lat_total_us);
+	}
+#endif
+
+	cyclic_unregister(&cyclic_zero.cyclic);
+	cyclic_unregister(&cyclic_slow.cyclic);
+
+	return 0;
+}
+COMMON_TEST(dm_test_cyclic_order, 0);
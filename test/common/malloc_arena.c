@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for malloc() arenas
+ */
+
+#include <malloc_arena.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Test allocating from an arena and releasing it */
+static int common_test_malloc_arena(struct unit_test_state *uts)
+{
+	struct malloc_arena *arena, *iter;
+	char *str, *big;
+	ulong *val, used;
+	bool found;
+
+	arena = malloc_arena_create("test");
+	ut_assertnonnull(arena);
+	found = false;
+	list_for_each_entry(iter, malloc_arena_list(), sibling)
+		found |= iter == arena;
+	ut_assert(found);
+
+	str = malloc_arena_strdup(arena, "arena");
+	ut_asserteq_str("arena", str);
+	val = malloc_arena_zalloc(arena, sizeof(*val));
+	ut_asserteq(0, *val);
+	ut_asserteq(0, (ulong)val % (2 * sizeof(size_t)));
+	ut_asserteq(1, arena->nblocks);
+	ut_asserteq(2, arena->count);
+	ut_asserteq(CONFIG_MALLOC_ARENA_BLOCK_SIZE, arena->size);
+
+	/* A large allocation gets its own block */
+	used = arena->used;
+	big = malloc_arena_alloc(arena, CONFIG_MALLOC_ARENA_BLOCK_SIZE * 2);
+	ut_assertnonnull(big);
+	ut_asserteq(2, arena->nblocks);
+	ut_asserteq(3 * CONFIG_MALLOC_ARENA_BLOCK_SIZE, arena->size);
+	ut_asserteq(used + 2 * CONFIG_MALLOC_ARENA_BLOCK_SIZE, arena->used);
+
+	/* Resetting releases everything but keeps the peak */
+	malloc_arena_reset(arena);
+	ut_asserteq(0, arena->nblocks);
+	ut_asserteq(0, arena->size);
+	ut_asserteq(0, arena->used);
+	ut_asserteq(used + 2 * CONFIG_MALLOC_ARENA_BLOCK_SIZE, arena->peak);
+
+	malloc_arena_destroy(arena);
+	found = false;
+	list_for_each_entry(iter, malloc_arena_list(), sibling)
+		found |= iter == arena;
+	ut_assert(!found);
+
+	return 0;
+}
+COMMON_TEST(common_test_malloc_arena, 0);
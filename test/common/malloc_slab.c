@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the malloc() slabs
+ */
+
+#include <malloc.h>
+#include <malloc_slab.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Get the number of objects in use in the slab class for @size */
+static uint slab_used(uint size)
+{
+	struct malloc_slab_info info;
+	uint seq;
+
+	for (seq = 0; !malloc_slab_get_info(seq, &info); seq++) {
+		if (info.size >= size)
+			return info.used;
+	}
+
+	return 0;
+}
+
+/* Test that small allocations are served from the slabs */
+static int common_test_malloc_slab(struct unit_test_state *uts)
+{
+	uint used16 = slab_used(16);
+	uint used64 = slab_used(64);
+	char *ptr, *ptr2, *big;
+
+	ptr = malloc(10);
+	ut_assertnonnull(ptr);
+	ut_assert(malloc_slab_owns(ptr));
+	ut_asserteq(16, malloc_usable_size(ptr));
+	ut_asserteq(used16 + 1, slab_used(16));
+
+	/* A freed object is reused first */
+	free(ptr);
+	ut_asserteq(used16, slab_used(16));
+	ptr2 = malloc(16);
+	ut_asserteq_ptr(ptr, ptr2);
+
+	/* Growing moves the object to a larger class, keeping the data */
+	strcpy(ptr2, "slab");
+	ptr = realloc(ptr2, 40);
+	ut_assertnonnull(ptr);
+	ut_assert(malloc_slab_owns(ptr));
+	ut_asserteq_str("slab", ptr);
+	ut_asserteq(used16, slab_used(16));
+	ut_asserteq(used64 + 1, slab_used(64));
+
+	/* ...and then out of the slabs */
+	big = realloc(ptr, SLAB_MAX_SIZE + 1);
+	ut_assertnonnull(big);
+	ut_assert(!malloc_slab_owns(big));
+	ut_asserteq_str("slab", big);
+	ut_asserteq(used64, slab_used(64));
+	free(big);
+
+	/* calloc() clears slab objects */
+	ptr = malloc(32);
+	memset(ptr, 0xff, 32);
+	free(ptr);
+	ptr = calloc(1, 32);
+	ut_assert(malloc_slab_owns(ptr));
+	ut_assert(!memchr(ptr, 0xff, 32));
+	free(ptr);
+
+	/* memalign() gets an object aligned to its size */
+	ptr = memalign(64, 20);
+	ut_assertnonnull(ptr);
+	ut_asserteq(0, (ulong)ptr % 64);
+	free(ptr);
+
+	return 0;
+}
+COMMON_TEST(common_test_malloc_slab, 0);
+
+/* Test that slab objects are counted by mallinfo(), for leak checks */
+static int common_test_malloc_slab_mallinfo(struct unit_test_state *uts)
+{
+	ulong start;
+	char *ptr;
+
+	start = ut_check_free();
+	ptr = malloc(24);
+	ut_assert(malloc_slab_owns(ptr));
+	ut_asserteq(32, ut_check_delta(start));
+	free(ptr);
+	ut_asserteq(0, ut_check_delta(start));
+
+	return 0;
+}
+COMMON_TEST(common_test_malloc_slab_mallinfo, 0);
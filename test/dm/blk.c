@@ -4,13 +4,17 @@
  */
 
 #include <blk.h>
+#include <blkmap.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
 #include <sandbox_host.h>
 #include <usb.h>
 #include <asm/global_data.h>
 #include <asm/state.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
+#include <linux/sizes.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -334,3 +338,173 @@ static int dm_test_blk_foreach(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_foreach, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Test asynchronous reads on a device without native queue support */
+static int dm_test_blk_async(struct unit_test_state *uts)
+{
+	static char mem[16 * 512], out[16 * 512];
+	struct blk_req req[2];
+	struct udevice *dev, *blk;
+	int i;
+
+	for (i = 0; i < sizeof(mem); i++)
+		mem[i] = i / 512 + 1;
+
+	ut_assertok(blkmap_create("async", &dev));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+	ut_assertok(blkmap_map_mem(dev, 0, 16, mem));
+
+	memset(out, '\0', sizeof(out));
+	ut_assertok(blk_submit_read(blk, 0, 8, out, &req[0]));
+	ut_assertok(blk_submit_read(blk, 8, 8, out + 8 * 512, &req[1]));
+	ut_asserteq(false, req[0].native);
+
+	/* with uthreads the reads only run when we yield */
+	if (IS_ENABLED(CONFIG_UTHREAD)) {
+		ut_asserteq(-EBUSY, blk_req_poll(&req[1]));
+		ut_asserteq(false, req[1].done);
+	}
+
+	ut_asserteq(8, blk_req_wait(&req[1]));
+	ut_asserteq(8, blk_req_wait(&req[0]));
+	ut_asserteq_mem(mem, out, sizeof(mem));
+
+	/* a completed request stays complete */
+	ut_assertok(blk_req_poll(&req[0]));
+
+	ut_assertok(blkmap_destroy(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async, 0);
+
+#if CONFIG_IS_ENABLED(BLOCK_CACHE)
+/* Test the set-associative block cache and its read-ahead */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_dev_stats dstats;
+	struct block_cache_stats stats;
+	lbaint_t ra_start, ra_cnt;
+	char buf[16 * 512], out[16 * 512];
+	char *big;
+	int i;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i / 512;
+
+	/* 16 lines of 8 blocks: four sets of four ways */
+	blkcache_configure(8, 16);
+	blkcache_stats(&stats);
+	ut_asserteq(16, stats.max_entries);
+	ut_asserteq(4, stats.ways);
+	ut_asserteq(8 * 16 * 512, stats.size);
+
+	/* partial lines are not cached */
+	blkcache_fill(UCLASS_HOST, 5, 4, 8, 512, buf);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 5, 4, 8, 512, out));
+
+	/* a read spanning two cached lines is served from the cache */
+	blkcache_fill(UCLASS_HOST, 5, 0, 16, 512, buf);
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 5, 3, 10, 512, out));
+	ut_asserteq_mem(buf + 3 * 512, out, 10 * 512);
+
+	/* other devices do not see the data */
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 6, 3, 10, 512, out));
+
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(2, stats.misses);
+	ut_asserteq(2, stats.entries);
+
+	ut_assertok(blkcache_dev_stats(0, &dstats));
+	ut_asserteq(UCLASS_HOST, dstats.iftype);
+	ut_asserteq(6, dstats.devnum);
+	ut_asserteq(1, dstats.misses);
+	ut_assertok(blkcache_dev_stats(1, &dstats));
+	ut_asserteq(5, dstats.devnum);
+	ut_asserteq(1, dstats.hits);
+	ut_asserteq(-ENOENT, blkcache_dev_stats(2, &dstats));
+
+	/* a random read is widened to a whole line */
+	ut_assertnonnull(blkcache_readahead(UCLASS_HOST, 5, 100, 1, 512, 0,
+					    &ra_start, &ra_cnt));
+	ut_asserteq(96, ra_start);
+	ut_asserteq(8, ra_cnt);
+
+	/* sequential misses grow the read-ahead window */
+	ut_assertnonnull(blkcache_readahead(UCLASS_HOST, 5, 104, 1, 512, 0,
+					    &ra_start, &ra_cnt));
+	ut_asserteq(104, ra_start);
+	ut_asserteq(16, ra_cnt);
+	ut_assertnonnull(blkcache_readahead(UCLASS_HOST, 5, 120, 1, 512, 0,
+					    &ra_start, &ra_cnt));
+	ut_asserteq(120, ra_start);
+	ut_asserteq(24, ra_cnt);
+
+	/* ...but never beyond the end of the device */
+	ut_assertnonnull(blkcache_readahead(UCLASS_HOST, 5, 144, 1, 512, 150,
+					    &ra_start, &ra_cnt));
+	ut_asserteq(144, ra_start);
+	ut_asserteq(6, ra_cnt);
+
+	/* invalidation drops only the given device */
+	blkcache_fill(UCLASS_HOST, 6, 0, 16, 512, buf);
+	blkcache_invalidate(UCLASS_HOST, 5);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 5, 0, 8, 512, out));
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 6, 0, 8, 512, out));
+
+	/* ...keeps its statistics, but restarts read-ahead */
+	ut_assertok(blkcache_dev_stats(1, &dstats));
+	ut_asserteq(5, dstats.devnum);
+	ut_asserteq(1, dstats.misses);
+	ut_assert(dstats.readahead > 0);
+	ut_assertnonnull(blkcache_readahead(UCLASS_HOST, 5, 145, 1, 512, 0,
+					    &ra_start, &ra_cnt));
+	ut_asserteq(144, ra_start);
+	ut_asserteq(8, ra_cnt);
+
+	/* removing a device drops its statistics too */
+	blkcache_remove(UCLASS_HOST, 5);
+	ut_assertok(blkcache_dev_stats(0, &dstats));
+	ut_asserteq(6, dstats.devnum);
+	ut_asserteq(-ENOENT, blkcache_dev_stats(1, &dstats));
+
+	/* only two lines of 4K blocks fit the budget, so older ones go */
+	big = malloc(8 * SZ_4K);
+	ut_assertnonnull(big);
+	blkcache_invalidate(-1, 0);
+	blkcache_stats(&stats);
+	for (i = 0; i < 4; i++) {
+		memset(big, i, 8 * SZ_4K);
+		blkcache_fill(UCLASS_HOST, 7, i * 8, 8, SZ_4K, big);
+	}
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.entries);
+	ut_asserteq(2, stats.evictions);
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 7, 24, 8, SZ_4K, big));
+	ut_asserteq(3, big[0]);
+	ut_asserteq(3, big[8 * SZ_4K - 1]);
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 7, 16, 8, SZ_4K, big));
+	ut_asserteq(2, big[0]);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 7, 0, 8, SZ_4K, big));
+
+	/* a line of smaller blocks makes room by dropping the oldest line */
+	blkcache_fill(UCLASS_HOST, 5, 0, 8, 512, buf);
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 5, 0, 8, 512, out));
+	ut_asserteq_mem(buf, out, 8 * 512);
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 7, 16, 8, SZ_4K, big));
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 7, 24, 8, SZ_4K, big));
+	blkcache_remove(UCLASS_HOST, 7);
+	free(big);
+
+	/* restore the default geometry */
+	blkcache_configure(CONFIG_BLOCK_CACHE_LINE_BLOCKS,
+			   CONFIG_BLOCK_CACHE_SIZE /
+			   (CONFIG_BLOCK_CACHE_LINE_BLOCKS * 512));
+	blkcache_free();
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, 0);
+#endif
@@ -12,11 +12,13 @@
 #include <malloc.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
 #include <linux/list.h>
+#include <linux/sizes.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -1443,3 +1445,101 @@ static int dm_test_try_first_device(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_try_first_device, 0);
+
+/* Test that the compatible index finds the same driver as a linear search */
+static int dm_test_compat_index(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id, *of_match;
+	struct dm_compat_idx *idx;
+	struct driver *drv, *entry;
+	int count = 0;
+
+	if (!CONFIG_IS_ENABLED(DM_COMPAT_INDEX))
+		return -EAGAIN;
+	idx = gd_dm_compat_idx();
+	ut_assertnonnull(idx);
+
+	for (drv = driver; drv != driver + n_ents; drv++) {
+		for (of_match = drv->of_match; of_match && of_match->compatible;
+		     of_match++) {
+			const char *compat = of_match->compatible;
+			const struct udevice_id *expect = NULL;
+
+			/* The first driver with this string should win */
+			for (entry = driver; !expect; entry++) {
+				for (id = entry->of_match;
+				     id && id->compatible && !expect; id++) {
+					if (!strcmp(id->compatible, compat))
+						expect = id;
+				}
+			}
+			ut_asserteq_ptr(entry - 1,
+					lists_driver_lookup_compat(compat,
+								   &id));
+			ut_asserteq_ptr(expect, id);
+			count++;
+		}
+	}
+	ut_assert(count > 0);
+	ut_assertnull(lists_driver_lookup_compat("not-a-driver", &id));
+
+	/* Without the index, the linear search should give the same result */
+	gd_set_dm_compat_idx(NULL);
+	drv = lists_driver_lookup_compat("denx,u-boot-fdt-test", &id);
+	gd_set_dm_compat_idx(idx);
+	ut_assertnonnull(drv);
+	entry = lists_driver_lookup_compat("denx,u-boot-fdt-test", &of_match);
+	ut_asserteq_ptr(entry, drv);
+	ut_asserteq_ptr(of_match, id);
+
+	return 0;
+}
+DM_TEST(dm_test_compat_index, 0);
+
+/* Test that the index fits in malloc_f, but not if it would starve it */
+static int dm_test_compat_index_malloc_f(struct unit_test_state *uts)
+{
+	struct dm_compat_idx *idx __maybe_unused = gd_dm_compat_idx();
+	struct dm_compat_idx *new_idx;
+	ulong flags = gd->flags, limit = gd->malloc_limit;
+	ulong ptr = gd->malloc_ptr;
+	const struct udevice_id *id;
+	struct driver *drv;
+	int ret;
+
+	if (!CONFIG_IS_ENABLED(DM_COMPAT_INDEX) ||
+	    !CONFIG_IS_ENABLED(SYS_MALLOC_F))
+		return -EAGAIN;
+
+	/* Pretend to be before relocation, with 8KB of malloc_f left */
+	gd_set_dm_compat_idx(NULL);
+	gd->flags &= ~GD_FLG_FULL_MALLOC_INIT;
+	gd->malloc_limit = gd->malloc_ptr + SZ_8K;
+	ret = lists_compat_index_init();
+	gd->malloc_limit = limit;
+	gd->flags = flags;
+	new_idx = gd_dm_compat_idx();
+	drv = lists_driver_lookup_compat("denx,u-boot-fdt-test", &id);
+	ut_asserteq(0, ret);
+	ut_assertnonnull(new_idx);
+	ut_assert(gd->malloc_ptr - ptr <= SZ_2K);
+	ut_assertnonnull(drv);
+	ut_asserteq_str("denx,u-boot-fdt-test", id->compatible);
+
+	/* With only 1KB left, the index should not be built */
+	gd_set_dm_compat_idx(NULL);
+	gd->flags &= ~GD_FLG_FULL_MALLOC_INIT;
+	gd->malloc_limit = gd->malloc_ptr + SZ_1K;
+	ret = lists_compat_index_init();
+	gd->malloc_limit = limit;
+	gd->flags = flags;
+	new_idx = gd_dm_compat_idx();
+	gd_set_dm_compat_idx(idx);
+	ut_asserteq(-ENOSPC, ret);
+	ut_assertnull(new_idx);
+
+	return 0;
+}
+DM_TEST(dm_test_compat_index_malloc_f, 0);
@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test appending changed UEFI variables to ubootefi.var
+ */
+
+#include <blk.h>
+#include <dm.h>
+#include <efi_loader.h>
+#include <efi_variable.h>
+#include <fs.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <os.h>
+#include <sandbox_host.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+static const efi_guid_t guid_test =
+	EFI_GUID(0x61b4d8b2, 0x5f2f, 0x4f4b,
+		 0x9a, 0x1c, 0x3e, 0x6e, 0x2a, 0x51, 0x6c, 0x07);
+
+#define ATTR_NV	(EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS)
+
+/* Use a host file as the EFI system partition */
+static int attach_esp(struct unit_test_state *uts, const char *label,
+		      const char *img)
+{
+	struct udevice *dev, *blk;
+	struct blk_desc *desc;
+	char fname[256];
+
+	ut_assertok(os_persistent_file(fname, sizeof(fname), img));
+	ut_assertok(host_create_attach_file(label, fname, false, DEFAULT_BLKSZ,
+					    &dev));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	desc = dev_get_uclass_plat(blk);
+	efi_system_partition.uclass_id = UCLASS_HOST;
+	efi_system_partition.devnum = desc->devnum;
+	efi_system_partition.part = 0;
+
+	return 0;
+}
+
+static int set_var(struct unit_test_state *uts, const u16 *name,
+		   const char *val)
+{
+	ut_asserteq(EFI_SUCCESS,
+		    efi_set_variable_int(name, &guid_test, ATTR_NV,
+					 val ? strlen(val) + 1 : 0, val,
+					 false));
+
+	return 0;
+}
+
+static int check_var(struct unit_test_state *uts, const u16 *name,
+		     const char *expect)
+{
+	char buf[512];
+	efi_uintn_t size = sizeof(buf);
+	efi_status_t ret;
+
+	ret = efi_get_variable_int(name, &guid_test, NULL, &size, buf, NULL);
+	if (!expect) {
+		ut_asserteq_64(EFI_NOT_FOUND, ret);
+		return 0;
+	}
+	ut_asserteq(EFI_SUCCESS, ret);
+	ut_asserteq(strlen(expect) + 1, size);
+	ut_asserteq_str(expect, buf);
+
+	return 0;
+}
+
+/* Drop the test variables from memory, as if rebooting */
+static void forget_vars(void)
+{
+	static const u16 *const names[] = {
+		u"Base", u"Log1", u"Log2", u"Log3", u"Log4",
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(names); i++)
+		efi_var_mem_del(efi_var_mem_find(&guid_test, names[i], NULL));
+}
+
+static int select_esp(void)
+{
+	char part_str[10];
+
+	snprintf(part_str, sizeof(part_str), "%x:0",
+		 efi_system_partition.devnum);
+
+	return fs_set_blk_dev("host", part_str, FS_TYPE_ANY);
+}
+
+static loff_t file_size(void)
+{
+	loff_t size;
+
+	if (select_esp() || fs_size(EFI_VAR_FILE_NAME, &size))
+		return -1;
+
+	return size;
+}
+
+/* Re-read ubootefi.var and check which part of it is records */
+static int reload(struct unit_test_state *uts, loff_t *basep, loff_t *sizep)
+{
+	struct efi_var_file hdr;
+	loff_t actread;
+
+	forget_vars();
+	ut_assertok(efi_var_from_file());
+
+	*sizep = file_size();
+	ut_assertok(select_esp());
+	ut_assertok(fs_read(EFI_VAR_FILE_NAME, map_to_sysmem(&hdr), 0,
+			    sizeof(hdr), &actread));
+	*basep = hdr.length;
+
+	return 0;
+}
+
+/* Length of a record holding a variable with a NUL-terminated string */
+static loff_t rec_len(const u16 *name, const char *val)
+{
+	return sizeof(struct efi_var_file) +
+	       ALIGN(sizeof(struct efi_var_entry) +
+		     (u16_strlen(name) + 1) * sizeof(u16) +
+		     (val ? strlen(val) + 1 : 0), 8);
+}
+
+/* Test appending records of changes and replaying them */
+static int dm_test_efi_var_file_log(struct unit_test_state *uts)
+{
+	struct efi_system_partition old_esp = efi_system_partition;
+	char base_val[400], val[20];
+	loff_t base, size, prev, actwrite;
+	bool rewritten;
+	void *buf;
+	int i;
+
+	ut_asserteq(EFI_SUCCESS, efi_init_obj_list());
+	ut_assertok(attach_esp(uts, "esp", "1MB.fat32.img"));
+
+	/* Start with a file without records, big enough to take several */
+	memset(base_val, 'x', sizeof(base_val) - 1);
+	base_val[sizeof(base_val) - 1] = '\0';
+	ut_asserteq(EFI_SUCCESS, efi_var_from_file());
+	forget_vars();
+	ut_assertok(set_var(uts, u"Base", base_val));
+	ut_asserteq(EFI_SUCCESS, efi_var_to_file());
+	ut_assertok(reload(uts, &base, &size));
+	ut_asserteq(base, size);
+	ut_assertok(check_var(uts, u"Base", base_val));
+
+	/* Each change appends one record, including deletions */
+	ut_assertok(set_var(uts, u"Log1", "one"));
+	ut_assertok(set_var(uts, u"Log2", "two"));
+	ut_assertok(set_var(uts, u"Log1", "uno"));
+	ut_assertok(set_var(uts, u"Log2", NULL));
+	ut_assertok(reload(uts, &prev, &size));
+	ut_asserteq(base, prev);
+	ut_asserteq(base + 2 * rec_len(u"Log1", "one") +
+		    rec_len(u"Log2", "two") + rec_len(u"Log2", NULL), size);
+	ut_assertok(check_var(uts, u"Base", base_val));
+	ut_assertok(check_var(uts, u"Log1", "uno"));
+	ut_assertok(check_var(uts, u"Log2", NULL));
+
+	/* Tear the last record, as a power failure while writing would */
+	ut_assertok(set_var(uts, u"Log3", "three"));
+	ut_asserteq(size + rec_len(u"Log3", "three"), file_size());
+	size = file_size();
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	ut_assertok(select_esp());
+	ut_assertok(fs_read(EFI_VAR_FILE_NAME, map_to_sysmem(buf), 0, size,
+			    &actwrite));
+	ut_assertok(select_esp());
+	ut_assertok(fs_write(EFI_VAR_FILE_NAME, map_to_sysmem(buf), 0,
+			     size - 4, &actwrite));
+	free(buf);
+
+	/* The torn record is dropped and the earlier ones still apply */
+	ut_assertok(reload(uts, &prev, &size));
+	ut_assertok(check_var(uts, u"Log1", "uno"));
+	ut_assertok(check_var(uts, u"Log3", NULL));
+
+	/* The next change rewrites the whole file */
+	ut_assertok(set_var(uts, u"Log4", "four"));
+	ut_assertok(reload(uts, &base, &size));
+	ut_asserteq(base, size);
+	ut_assertok(check_var(uts, u"Log1", "uno"));
+	ut_assertok(check_var(uts, u"Log4", "four"));
+
+	/* Once the records outgrow the variables, the file is compacted */
+	rewritten = false;
+	prev = size;
+	for (i = 0; i < 40; i++) {
+		snprintf(val, sizeof(val), "value %d", i);
+		ut_assertok(set_var(uts, u"Log1", val));
+		size = file_size();
+		ut_assert(size <= 2 * base + rec_len(u"Log1", val));
+		if (size < prev)
+			rewritten = true;
+		prev = size;
+	}
+	ut_assert(rewritten);
+	ut_assertok(reload(uts, &base, &size));
+	ut_assertok(check_var(uts, u"Log1", val));
+	ut_assertok(check_var(uts, u"Log4", "four"));
+
+	/* Clean up */
+	ut_assertok(set_var(uts, u"Base", NULL));
+	ut_assertok(set_var(uts, u"Log1", NULL));
+	ut_assertok(set_var(uts, u"Log4", NULL));
+	efi_system_partition = old_esp;
+
+	return 0;
+}
+DM_TEST(dm_test_efi_var_file_log, UTF_SCAN_FDT);
+
+/* Test that changes are not lost if the file system cannot append */
+static int dm_test_efi_var_file_no_append(struct unit_test_state *uts)
+{
+	struct efi_system_partition old_esp = efi_system_partition;
+	loff_t base, size;
+
+	ut_asserteq(EFI_SUCCESS, efi_init_obj_list());
+
+	/* ext4 rejects writes at a non-zero offset */
+	ut_assertok(attach_esp(uts, "esp", "2MB.ext2.img"));
+	ut_asserteq(EFI_SUCCESS, efi_var_from_file());
+	forget_vars();
+	ut_assertok(set_var(uts, u"Base", "a value long enough for records"));
+	ut_assertok(set_var(uts, u"Log1", "one"));
+	ut_assertok(reload(uts, &base, &size));
+	ut_asserteq(base, size);
+	ut_assertok(check_var(uts, u"Log1", "one"));
+
+	ut_assertok(set_var(uts, u"Log1", "two"));
+	ut_assertok(reload(uts, &base, &size));
+	ut_asserteq(base, size);
+	ut_assertok(check_var(uts, u"Log1", "two"));
+
+	ut_assertok(set_var(uts, u"Base", NULL));
+	ut_assertok(set_var(uts, u"Log1", NULL));
+	efi_system_partition = old_esp;
+
+	return 0;
+}
+DM_TEST(dm_test_efi_var_file_no_append, UTF_SCAN_FDT);
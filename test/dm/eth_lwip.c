@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the lwIP receive path with the sandbox Ethernet driver
+ */
+
+#include <dm.h>
+#include <net.h>
+#include <asm/eth.h>
+#include <dm/device-internal.h>
+#include <dm/test.h>
+#include <lwip/udp.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define RX_HOLD_PORT	4321
+#define RX_HOLD_LEN	64
+
+/**
+ * struct rx_hold_test - datagrams received by the test
+ *
+ * @p: Datagrams kept, as an application would until it is done with them
+ * @count: Number of entries in @p
+ */
+struct rx_hold_test {
+	struct pbuf *p[SANDBOX_ETH_RX_HOLD_MAX + 1];
+	int count;
+};
+
+static void rx_hold_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+			     const ip_addr_t *addr, u16_t port)
+{
+	struct rx_hold_test *test = arg;
+
+	if (test->count < ARRAY_SIZE(test->p))
+		test->p[test->count++] = p;
+	else
+		pbuf_free(p);
+}
+
+/* Queue a UDP datagram for @netif, with each byte of the payload set to @id */
+static int sb_eth_recv_udp(struct udevice *dev, struct netif *netif, u8 id)
+{
+	static const u8 host_hwaddr[ARP_HLEN] = { 0x02, 0, 0, 0, 0, 0x01 };
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth;
+	struct ip_udp_hdr *ip;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return -EOVERFLOW;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, netif->hwaddr, ARP_HLEN);
+	memcpy(eth->et_src, host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	ip = (void *)eth + ETHER_HDR_SIZE;
+	memset(ip, '\0', IP_UDP_HDR_SIZE);
+	ip->ip_hl_v = 0x45;
+	ip->ip_len = htons(IP_UDP_HDR_SIZE + RX_HOLD_LEN);
+	ip->ip_id = htons(id);
+	ip->ip_off = htons(IP_FLAGS_DFRAG);
+	ip->ip_ttl = 255;
+	ip->ip_p = IPPROTO_UDP;
+	ip->ip_src = string_to_ip("192.0.2.2");
+	ip->ip_dst.s_addr = ip4_addr_get_u32(netif_ip4_addr(netif));
+	ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
+	ip->udp_src = htons(1234);
+	ip->udp_dst = htons(RX_HOLD_PORT);
+	ip->udp_len = htons(UDP_HDR_SIZE + RX_HOLD_LEN);
+	memset((void *)ip + IP_UDP_HDR_SIZE, id, RX_HOLD_LEN);
+
+	priv->recv_packet_length[priv->recv_packets++] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + RX_HOLD_LEN;
+
+	return 0;
+}
+
+static int check_rx_hold_data(struct unit_test_state *uts, struct pbuf *p,
+			      u8 id)
+{
+	u8 expect[RX_HOLD_LEN];
+
+	memset(expect, id, RX_HOLD_LEN);
+	ut_asserteq(RX_HOLD_LEN, p->tot_len);
+	ut_asserteq_mem(expect, p->payload, RX_HOLD_LEN);
+
+	return 0;
+}
+
+/* Check that lwIP holds on to received packets instead of copying them */
+static int dm_test_eth_rx_hold(struct unit_test_state *uts)
+{
+	struct rx_hold_test test = {};
+	struct eth_sandbox_priv *priv;
+	struct udp_pcb *pcb;
+	struct netif *netif;
+	struct udevice *dev;
+	const int hold = 2;
+	int i;
+
+	ut_assertok(net_init());
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	priv = dev_get_priv(dev);
+	ut_assertok(sandbox_eth_set_rx_hold(0, hold));
+	netif = net_lwip_new_netif(dev);
+	ut_assertnonnull(netif);
+
+	pcb = udp_new();
+	ut_assertnonnull(pcb);
+	ut_assertok(udp_bind(pcb, IP_ADDR_ANY, RX_HOLD_PORT));
+	udp_recv(pcb, rx_hold_udp_recv, &test);
+
+	/* the first packets are used in place, the one after that is copied */
+	for (i = 0; i <= hold; i++)
+		ut_assertok(sb_eth_recv_udp(dev, netif, i));
+	ut_assertok(net_lwip_rx(dev, netif));
+	ut_asserteq(hold + 1, test.count);
+	ut_asserteq(hold, priv->rx_held_count);
+	for (i = 0; i < hold; i++) {
+		ut_assert(test.p[i]->flags & PBUF_FLAG_IS_CUSTOM);
+		ut_asserteq_ptr(priv->rx_held[i] + ETHER_HDR_SIZE +
+				IP_UDP_HDR_SIZE, test.p[i]->payload);
+		ut_assertok(check_rx_hold_data(uts, test.p[i], i));
+	}
+	ut_assert(!(test.p[hold]->flags & PBUF_FLAG_IS_CUSTOM));
+	ut_assertok(check_rx_hold_data(uts, test.p[hold], hold));
+
+	/* packets go back to the driver when freed, in any order */
+	pbuf_free(test.p[0]);
+	ut_asserteq(hold - 1, priv->rx_held_count);
+	ut_assertnull(priv->rx_held[0]);
+	for (i = hold; i > 0; i--)
+		pbuf_free(test.p[i]);
+	ut_asserteq(0, priv->rx_held_count);
+
+	/* and the buffers are used again */
+	test.count = 0;
+	ut_assertok(sb_eth_recv_udp(dev, netif, 0x55));
+	ut_assertok(net_lwip_rx(dev, netif));
+	ut_asserteq(1, test.count);
+	ut_asserteq(1, priv->rx_held_count);
+	ut_assert(test.p[0]->flags & PBUF_FLAG_IS_CUSTOM);
+	ut_assertok(check_rx_hold_data(uts, test.p[0], 0x55));
+	pbuf_free(test.p[0]);
+	ut_asserteq(0, priv->rx_held_count);
+
+	udp_remove(pcb);
+	net_lwip_remove_netif(netif);
+	ut_assertok(sandbox_eth_set_rx_hold(0, 0));
+
+	return 0;
+}
+DM_TEST(dm_test_eth_rx_hold, UTF_SCAN_FDT);
+
+/* Check that packets held by lwIP survive the removal of their device */
+static int dm_test_eth_rx_hold_remove(struct unit_test_state *uts)
+{
+	struct rx_hold_test test = {};
+	struct eth_sandbox_priv *priv;
+	struct udp_pcb *pcb;
+	struct netif *netif;
+	struct udevice *dev;
+	void *payload[2];
+	int i;
+
+	ut_assertok(net_init());
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	priv = dev_get_priv(dev);
+	ut_assertok(sandbox_eth_set_rx_hold(0, 2));
+	netif = net_lwip_new_netif(dev);
+	ut_assertnonnull(netif);
+
+	pcb = udp_new();
+	ut_assertnonnull(pcb);
+	ut_assertok(udp_bind(pcb, IP_ADDR_ANY, RX_HOLD_PORT));
+	udp_recv(pcb, rx_hold_udp_recv, &test);
+
+	for (i = 0; i < 2; i++)
+		ut_assertok(sb_eth_recv_udp(dev, netif, 0x11 * (i + 1)));
+	ut_assertok(net_lwip_rx(dev, netif));
+	ut_asserteq(2, test.count);
+	ut_asserteq(2, priv->rx_held_count);
+	for (i = 0; i < 2; i++) {
+		ut_assert(test.p[i]->flags & PBUF_FLAG_IS_CUSTOM);
+		payload[i] = test.p[i]->payload;
+	}
+	net_lwip_remove_netif(netif);
+
+	/* the driver frees its buffers, so lwIP must have its own copy */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	for (i = 0; i < 2; i++) {
+		ut_assert(test.p[i]->payload != payload[i]);
+		ut_assertok(check_rx_hold_data(uts, test.p[i], 0x11 * (i + 1)));
+	}
+
+	/* freeing them now must not call into the removed driver */
+	pbuf_free(test.p[1]);
+	pbuf_free(test.p[0]);
+
+	/* the device can be used again */
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	priv = dev_get_priv(dev);
+	ut_assertok(sandbox_eth_set_rx_hold(0, 2));
+	netif = net_lwip_new_netif(dev);
+	ut_assertnonnull(netif);
+	test.count = 0;
+	ut_assertok(sb_eth_recv_udp(dev, netif, 0x33));
+	ut_assertok(net_lwip_rx(dev, netif));
+	ut_asserteq(1, test.count);
+	ut_asserteq(1, priv->rx_held_count);
+	ut_assertok(check_rx_hold_data(uts, test.p[0], 0x33));
+	pbuf_free(test.p[0]);
+	ut_asserteq(0, priv->rx_held_count);
+
+	udp_remove(pcb);
+	net_lwip_remove_netif(netif);
+	ut_assertok(sandbox_eth_set_rx_hold(0, 0));
+
+	return 0;
+}
+DM_TEST(dm_test_eth_rx_hold_remove, UTF_SCAN_FDT);
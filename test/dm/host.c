@@ -7,11 +7,14 @@
 #include <blk.h>
 #include <dm.h>
 #include <fs.h>
+#include <malloc.h>
+#include <mapmem.h>
 #include <os.h>
 #include <sandbox_host.h>
 #include <asm/test.h>
 #include <dm/device-internal.h>
 #include <dm/test.h>
+#include <linux/sizes.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -74,6 +77,545 @@ static int dm_test_host(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_host, UTF_SCAN_FDT);
 
+/*
+ * Size of the file used for reading through a mount. On squashfs with 4KB
+ * blocks the last 0xa00 bytes are in a fragment.
+ */
+#define MOUNT_FILE_SIZE	0x2a00
+
+/* Attach a filesystem image to a new host device */
+static int attach_image(struct unit_test_state *uts, const char *img,
+			struct udevice **devp, struct blk_desc **descp)
+{
+	static char label[] = "test";
+	struct udevice *blk;
+	char fname[256];
+
+	ut_assertok(host_create_device(label, true, DEFAULT_BLKSZ, devp));
+	ut_assertok(os_persistent_file(fname, sizeof(fname), img));
+	ut_assertok(host_attach_file(*devp, fname));
+	ut_assertok(blk_get_from_parent(*devp, &blk));
+	ut_assertok(device_probe(blk));
+	*descp = dev_get_uclass_plat(blk);
+
+	return 0;
+}
+
+static int detach_image(struct unit_test_state *uts, struct udevice *dev,
+			struct blk_desc *desc)
+{
+	/* drop the blocks read, so they are not counted as a leak */
+	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+
+	return 0;
+}
+
+/* Read /mount.bin through a mount and check it holds the expected data */
+static int check_fs_open(struct unit_test_state *uts, struct blk_desc *desc,
+			 int fstype, const u8 *data)
+{
+	struct fs_mount *mnt, *mnt2;
+	struct fs_file *file, *file2, *old;
+	loff_t actual, size;
+	u8 *buf;
+
+	/* The same partition should give the same mount */
+	ut_assertok(fs_mount(desc, 0, &mnt));
+	ut_asserteq(fstype, fs_mount_get_type(mnt));
+	ut_assertok(fs_mount(desc, 0, &mnt2));
+	ut_asserteq_ptr(mnt, mnt2);
+	fs_umount(mnt2);
+
+	ut_assert(fs_open(mnt, "/missing", &file));
+	ut_assertok(fs_open(mnt, "/mount.bin", &file));
+	ut_assertok(fs_file_size(file, &size));
+	ut_asserteq(MOUNT_FILE_SIZE, size);
+
+	/* Read from the middle of a block */
+	buf = malloc(MOUNT_FILE_SIZE);
+	ut_assertnonnull(buf);
+	ut_assertok(fs_pread(file, buf, 0x1234, 0x100, &actual));
+	ut_asserteq(0x100, actual);
+	ut_asserteq_mem(data + 0x1234, buf, 0x100);
+
+	/* Using the existing interface closes the file, so it is reopened */
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_asserteq(1, fs_exists("/mount.bin"));
+
+	/* Read across the end of the last full block */
+	ut_assertok(fs_pread(file, buf, 0x1f80, 0x100, &actual));
+	ut_asserteq(0x100, actual);
+	ut_asserteq_mem(data + 0x1f80, buf, 0x100);
+
+	/* Reads are cut short at the end of the file */
+	ut_assertok(fs_pread(file, buf, 0x2900, 0x1000, &actual));
+	ut_asserteq(0x100, actual);
+	ut_asserteq_mem(data + 0x2900, buf, 0x100);
+	ut_assertok(fs_pread(file, buf, MOUNT_FILE_SIZE, 0x10, &actual));
+	ut_asserteq(0, actual);
+
+	/* The handle of a closed file is reused */
+	ut_assertok(fs_open(mnt, "/mount.bin", &file2));
+	old = file2;
+	fs_closefile(file2);
+	ut_assertok(fs_open(mnt, "/mount.bin", &file2));
+	if (CONFIG_IS_ENABLED(MALLOC_ARENA))
+		ut_asserteq_ptr(old, file2);
+	fs_closefile(file2);
+
+	/* The file holds the mount until it is closed */
+	fs_umount(mnt);
+	ut_assertok(fs_pread(file, buf, 0, MOUNT_FILE_SIZE, &actual));
+	ut_asserteq(MOUNT_FILE_SIZE, actual);
+	ut_asserteq_mem(data, buf, MOUNT_FILE_SIZE);
+	fs_closefile(file);
+	free(buf);
+
+	return 0;
+}
+
+/* Write /mount.bin to an image with the existing interface */
+static int write_image(struct unit_test_state *uts, const char *img,
+		       const u8 *data)
+{
+	struct blk_desc *desc;
+	struct udevice *dev;
+	loff_t actual;
+
+	ut_assertok(attach_image(uts, img, &dev, &desc));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_write("/mount.bin", map_to_sysmem(data), 0,
+			     MOUNT_FILE_SIZE, &actual));
+	ut_asserteq(MOUNT_FILE_SIZE, actual);
+	ut_assertok(detach_image(uts, dev, desc));
+
+	return 0;
+}
+
+/* Test reading files through a mount on each type of filesystem */
+static int dm_test_host_fs_open(struct unit_test_state *uts)
+{
+	struct blk_desc *desc;
+	struct udevice *dev;
+	ulong mem_start;
+	u8 *data;
+	int i;
+
+	data = malloc(MOUNT_FILE_SIZE);
+	ut_assertnonnull(data);
+	for (i = 0; i < MOUNT_FILE_SIZE; i++)
+		data[i] = i * 7;
+
+	/*
+	 * Write the files first, since a FAT write probes the RTC and keeps
+	 * a cluster buffer, which would otherwise count as a leak
+	 */
+	ut_assertok(write_image(uts, "2MB.ext2.img", data));
+	ut_assertok(write_image(uts, "1MB.fat32.img", data));
+	mem_start = ut_check_delta(0);
+
+	ut_assertok(attach_image(uts, "2MB.ext2.img", &dev, &desc));
+	ut_assertok(check_fs_open(uts, desc, FS_TYPE_EXT, data));
+	ut_assertok(detach_image(uts, dev, desc));
+
+	ut_assertok(attach_image(uts, "1MB.fat32.img", &dev, &desc));
+	ut_assertok(check_fs_open(uts, desc, FS_TYPE_FAT, data));
+	ut_assertok(detach_image(uts, dev, desc));
+
+	/* squashfs is read-only, so the file is created by test_ut_dm_init */
+	ut_assertok(attach_image(uts, "test.squashfs.img", &dev, &desc));
+	ut_assertok(check_fs_open(uts, desc, FS_TYPE_SQUASHFS, data));
+	ut_assertok(detach_image(uts, dev, desc));
+
+	/* check there were no memory leaks */
+	ut_asserteq(0, ut_check_delta(mem_start));
+	free(data);
+
+	return 0;
+}
+DM_TEST(dm_test_host_fs_open, UTF_SCAN_FDT);
+
+/* Small files on the squashfs image, which share fragment blocks */
+#define FRAG_FILES	80
+#define FRAG_FILE_SIZE	1000
+
+/* Read one of the small files with the existing interface and check it */
+static int check_sqfs_frag(struct unit_test_state *uts, struct blk_desc *desc,
+			   int n, u8 *buf)
+{
+	u8 expect[FRAG_FILE_SIZE];
+	char fname[20];
+	loff_t actual;
+	int i;
+
+	for (i = 0; i < FRAG_FILE_SIZE; i++)
+		expect[i] = i + n * 13;
+	snprintf(fname, sizeof(fname), "/frag%02d.bin", n);
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_read(fname, map_to_sysmem(buf), 0, 0, &actual));
+	ut_asserteq(FRAG_FILE_SIZE, actual);
+	ut_asserteq_mem(expect, buf, FRAG_FILE_SIZE);
+
+	return 0;
+}
+
+/*
+ * Test reading squashfs files from more fragment blocks than are cached, so
+ * that blocks are evicted and decompressed again
+ */
+static int dm_test_host_sqfs_frag(struct unit_test_state *uts)
+{
+	struct blk_desc *desc;
+	struct udevice *dev;
+	u8 *buf;
+	int i;
+
+	buf = malloc(FRAG_FILE_SIZE);
+	ut_assertnonnull(buf);
+	ut_assertok(attach_image(uts, "test.squashfs.img", &dev, &desc));
+
+	/* in order, so that files mostly share the block read before */
+	for (i = 0; i < FRAG_FILES; i++)
+		ut_assertok(check_sqfs_frag(uts, desc, i, buf));
+
+	/*
+	 * Four files fit in each block, so this reads a file from each block
+	 * in turn and every read has to evict a block
+	 */
+	for (i = 0; i < FRAG_FILES; i++)
+		ut_assertok(check_sqfs_frag(uts, desc,
+					    i % 20 * 4 + i / 20, buf));
+
+	/* backwards, starting with blocks which are still cached */
+	for (i = FRAG_FILES - 1; i >= 0; i--)
+		ut_assertok(check_sqfs_frag(uts, desc, i, buf));
+
+	ut_assertok(detach_image(uts, dev, desc));
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_host_sqfs_frag, UTF_SCAN_FDT);
+
+/* Fill @buf with a pattern which is different for each @seed */
+static void fill_pattern(u8 *buf, int size, int seed)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = i * 3 + seed + (i >> 9);
+}
+
+/* Write @len bytes from @data to @fname at @offset */
+static int fat_put(struct unit_test_state *uts, struct blk_desc *desc,
+		   const char *fname, const u8 *data, loff_t offset,
+		   loff_t len)
+{
+	loff_t actual;
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_write(fname, map_to_sysmem(data + offset), offset, len,
+			     &actual));
+	ut_asserteq(len, actual);
+
+	return 0;
+}
+
+/* Read @len bytes of @fname at @offset and check them against @expect */
+static int fat_check(struct unit_test_state *uts, struct blk_desc *desc,
+		     const char *fname, const u8 *expect, loff_t offset,
+		     loff_t len, u8 *buf)
+{
+	loff_t actual;
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_read(fname, map_to_sysmem(buf), offset, len, &actual));
+	ut_asserteq(len, actual);
+	ut_asserteq_mem(expect + offset, buf, len);
+
+	return 0;
+}
+
+static int fat_check_size(struct unit_test_state *uts, struct blk_desc *desc,
+			  const char *fname, loff_t expect)
+{
+	loff_t size;
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_size(fname, &size));
+	ut_asserteq(expect, size);
+
+	return 0;
+}
+
+/* Large enough to go past the first window of the FAT, with 512B clusters */
+#define FAT_BIG_SIZE	(7 << 20)
+
+/*
+ * Test reading FAT files made of several runs of clusters, some of them in
+ * different windows of the FAT, while they are written and read again
+ */
+static int dm_test_host_fat_extents(struct unit_test_state *uts)
+{
+	static const char *const names[] = {
+		"/a.bin", "/b.bin", "/c.bin", "/d.bin", "/e.bin", "/big.bin",
+	};
+	struct blk_desc *desc;
+	struct udevice *dev;
+	u8 *a, *d, *e, *big, *buf;
+	int i;
+
+	a = malloc(SZ_8K);
+	d = malloc(SZ_64K);
+	e = malloc(SZ_256K);
+	big = malloc(FAT_BIG_SIZE);
+	buf = malloc(FAT_BIG_SIZE);
+	ut_assert(a && d && e && big && buf);
+	ut_assertok(attach_image(uts, "16MB.fat32.img", &dev, &desc));
+
+	/* start from an empty filesystem, even if an earlier run failed */
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+		fs_unlink(names[i]);
+	}
+
+	/* clusters are allocated first fit, so b.bin leaves a hole */
+	fill_pattern(a, SZ_8K, 1);
+	fill_pattern(d, SZ_64K, 2);
+	ut_assertok(fat_put(uts, desc, "/a.bin", a, 0, SZ_4K));
+	ut_assertok(fat_put(uts, desc, "/b.bin", d, 0, SZ_4K));
+	ut_assertok(fat_put(uts, desc, "/c.bin", d, 0, SZ_4K));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_unlink("/b.bin"));
+
+	/* d.bin fills the hole and carries on after c.bin */
+	ut_assertok(fat_put(uts, desc, "/d.bin", d, 0, SZ_64K));
+	ut_assertok(fat_check(uts, desc, "/d.bin", d, 0, SZ_64K, buf));
+	ut_assertok(fat_check(uts, desc, "/d.bin", d, SZ_4K - 0x80, 0x100,
+			      buf));
+	ut_assertok(fat_check(uts, desc, "/d.bin", d, SZ_32K + 0x10, 0x3000,
+			      buf));
+	ut_assertok(fat_check(uts, desc, "/d.bin", d, SZ_4K - 0x80, 0x100,
+			      buf));
+
+	/* extending a.bin adds a run after d.bin to a chain already read */
+	ut_assertok(fat_check(uts, desc, "/a.bin", a, 0, SZ_4K, buf));
+	ut_assertok(fat_put(uts, desc, "/a.bin", a, SZ_4K, SZ_4K));
+	ut_assertok(fat_check_size(uts, desc, "/a.bin", SZ_8K));
+	ut_assertok(fat_check(uts, desc, "/a.bin", a, 0, SZ_8K, buf));
+	ut_assertok(fat_check(uts, desc, "/a.bin", a, SZ_4K - 0x80, 0x100,
+			      buf));
+
+	/* rewriting d.bin with less data gives back most of its clusters */
+	fill_pattern(d, SZ_64K, 3);
+	ut_assertok(fat_put(uts, desc, "/d.bin", d, 0, SZ_2K));
+	ut_assertok(fat_check_size(uts, desc, "/d.bin", SZ_2K));
+	ut_assertok(fat_check(uts, desc, "/d.bin", d, 0, SZ_2K, buf));
+
+	/* big.bin goes on past the first window of the FAT */
+	fill_pattern(big, FAT_BIG_SIZE, 4);
+	ut_assertok(fat_put(uts, desc, "/big.bin", big, 0, FAT_BIG_SIZE));
+	ut_assertok(fat_check(uts, desc, "/big.bin", big,
+			      FAT_BIG_SIZE - SZ_64K, SZ_64K, buf));
+	ut_assertok(fat_check(uts, desc, "/big.bin", big, 0, FAT_BIG_SIZE,
+			      buf));
+
+	/* e.bin fills the holes and goes on after big.bin */
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_unlink("/c.bin"));
+	fill_pattern(e, SZ_256K, 5);
+	ut_assertok(fat_put(uts, desc, "/e.bin", e, 0, SZ_256K));
+	ut_assertok(fat_check(uts, desc, "/e.bin", e, 0, SZ_256K, buf));
+	for (i = 0; i < SZ_256K; i += 0x3f80)
+		ut_assertok(fat_check(uts, desc, "/e.bin", e, i,
+				      min(0x400, SZ_256K - i), buf));
+
+	/* the other files are still intact */
+	ut_assertok(fat_check(uts, desc, "/a.bin", a, 0, SZ_8K, buf));
+	ut_assertok(fat_check(uts, desc, "/d.bin", d, 0, SZ_2K, buf));
+	ut_assertok(fat_check(uts, desc, "/big.bin", big, 0, FAT_BIG_SIZE,
+			      buf));
+
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+		fs_unlink(names[i]);
+	}
+	ut_assertok(detach_image(uts, dev, desc));
+	free(buf);
+	free(big);
+	free(e);
+	free(d);
+	free(a);
+
+	return 0;
+}
+DM_TEST(dm_test_host_fat_extents, UTF_SCAN_FDT);
+
+static int fat_exists(struct unit_test_state *uts, struct blk_desc *desc,
+		      const char *fname)
+{
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+
+	return fs_exists(fname);
+}
+
+/* More names than there are entries in the FAT dentry cache */
+#define FAT_DENT_FILES	40
+
+/*
+ * Test looking up FAT files as they are created, renamed and deleted, so that
+ * any lookup which is remembered past a change to its directory shows up
+ */
+static int dm_test_host_fat_dentry(struct unit_test_state *uts)
+{
+	static const char *const names[] = {
+		"/new.bin", "/ren.bin", "/dir/f.bin", "/dir",
+	};
+	struct blk_desc *desc;
+	struct udevice *dev;
+	char fname[20];
+	u8 *data, *buf;
+	int i;
+
+	data = malloc(SZ_16K);
+	buf = malloc(SZ_16K);
+	ut_assert(data && buf);
+	ut_assertok(attach_image(uts, "16MB.fat32.img", &dev, &desc));
+
+	/* start from an empty filesystem, even if an earlier run failed */
+	for (i = 0; i < FAT_DENT_FILES; i++) {
+		snprintf(fname, sizeof(fname), "/dir/f%02d.bin", i);
+		ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+		fs_unlink(fname);
+	}
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+		fs_unlink(names[i]);
+	}
+
+	/* a file which was not found is found once it is created */
+	ut_asserteq(0, fat_exists(uts, desc, "/new.bin"));
+	fill_pattern(data, SZ_16K, 6);
+	ut_assertok(fat_put(uts, desc, "/new.bin", data, 0, SZ_4K));
+	ut_asserteq(1, fat_exists(uts, desc, "/new.bin"));
+	ut_asserteq(1, fat_exists(uts, desc, "/NEW.bin"));
+	ut_assertok(fat_check(uts, desc, "/New.Bin", data, 0, SZ_4K, buf));
+
+	/* the old name goes away and the new one has the same contents */
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_rename("/new.bin", "/ren.bin"));
+	ut_asserteq(0, fat_exists(uts, desc, "/new.bin"));
+	ut_asserteq(0, fat_exists(uts, desc, "/NEW.BIN"));
+	ut_assertok(fat_check(uts, desc, "/ren.bin", data, 0, SZ_4K, buf));
+	ut_assertok(fat_check(uts, desc, "/REN.BIN", data, 0, SZ_4K, buf));
+
+	/* a larger file written under the same name has a new size */
+	fill_pattern(data, SZ_16K, 7);
+	ut_assertok(fat_put(uts, desc, "/ren.bin", data, 0, SZ_16K));
+	ut_assertok(fat_check_size(uts, desc, "/Ren.bin", SZ_16K));
+	ut_assertok(fat_check(uts, desc, "/ren.bin", data, 0, SZ_16K, buf));
+
+	/* once deleted it is gone, and a new file by that name is new */
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_unlink("/ren.bin"));
+	ut_asserteq(0, fat_exists(uts, desc, "/ren.bin"));
+	fill_pattern(data, SZ_16K, 8);
+	ut_assertok(fat_put(uts, desc, "/REN.BIN", data, 0, SZ_2K));
+	ut_assertok(fat_check_size(uts, desc, "/ren.bin", SZ_2K));
+	ut_assertok(fat_check(uts, desc, "/ren.bin", data, 0, SZ_2K, buf));
+
+	/* the same goes for a directory and the files in it */
+	ut_asserteq(0, fat_exists(uts, desc, "/dir/f.bin"));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_mkdir("/dir"));
+	ut_assertok(fat_put(uts, desc, "/dir/f.bin", data, 0, SZ_4K));
+	ut_assertok(fat_check(uts, desc, "/DIR/F.BIN", data, 0, SZ_4K, buf));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_unlink("/dir/f.bin"));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_unlink("/dir"));
+	ut_asserteq(0, fat_exists(uts, desc, "/dir/f.bin"));
+	ut_asserteq(0, fat_exists(uts, desc, "/dir"));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_mkdir("/dir"));
+	ut_asserteq(0, fat_exists(uts, desc, "/dir/f.bin"));
+	fill_pattern(data, SZ_16K, 9);
+	ut_assertok(fat_put(uts, desc, "/dir/f.bin", data, 0, SZ_8K));
+	ut_assertok(fat_check(uts, desc, "/dir/f.bin", data, 0, SZ_8K, buf));
+
+	/* lookups which push others out of the cache are still correct */
+	for (i = 0; i < FAT_DENT_FILES; i++) {
+		snprintf(fname, sizeof(fname), "/dir/f%02d.bin", i);
+		ut_asserteq(0, fat_exists(uts, desc, fname));
+		ut_assertok(fat_put(uts, desc, fname, data + i * 0x40, 0, 0x40));
+	}
+	for (i = FAT_DENT_FILES - 1; i >= 0; i--) {
+		snprintf(fname, sizeof(fname), "/DIR/F%02d.BIN", i);
+		ut_assertok(fat_check(uts, desc, fname, data + i * 0x40, 0,
+				      0x40, buf));
+	}
+	for (i = 0; i < FAT_DENT_FILES; i++) {
+		snprintf(fname, sizeof(fname), "/dir/f%02d.bin", i);
+		ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+		ut_assertok(fs_unlink(fname));
+		ut_asserteq(0, fat_exists(uts, desc, fname));
+	}
+	ut_assertok(fat_check(uts, desc, "/dir/f.bin", data, 0, SZ_8K, buf));
+
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+		fs_unlink(names[i]);
+	}
+	ut_asserteq(0, fat_exists(uts, desc, "/dir"));
+	ut_assertok(detach_image(uts, dev, desc));
+	free(buf);
+	free(data);
+
+	return 0;
+}
+DM_TEST(dm_test_host_fat_dentry, UTF_SCAN_FDT);
+
+/* Test that removing a block device drops its mounts */
+static int dm_test_host_fs_remove(struct unit_test_state *uts)
+{
+	struct fs_mount *mnt, *mnt2;
+	struct blk_desc *desc;
+	struct fs_file *file;
+	struct udevice *dev;
+	ulong mem_start;
+	loff_t actual;
+	char buf[0x10];
+
+	ut_asserteq(-ENODEV, uclass_first_device_err(UCLASS_HOST, &dev));
+	mem_start = ut_check_delta(0);
+
+	ut_assertok(attach_image(uts, "2MB.ext2.img", &dev, &desc));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_write("/remove.bin", 0, 0, sizeof(buf), &actual));
+	ut_assertok(fs_mount(desc, 0, &mnt));
+	ut_assertok(fs_open(mnt, "/remove.bin", &file));
+	fs_umount(mnt);
+
+	/* The open file keeps the mount, but it can no longer be read */
+	ut_assertok(detach_image(uts, dev, desc));
+	ut_asserteq(-ENODEV, fs_pread(file, buf, 0, sizeof(buf), &actual));
+
+	/* A new device must not pick up the old mount */
+	ut_assertok(attach_image(uts, "2MB.ext2.img", &dev, &desc));
+	ut_assertok(fs_mount(desc, 0, &mnt2));
+	ut_assert(mnt2 != mnt);
+	fs_umount(mnt2);
+
+	fs_closefile(file);
+	ut_assertok(detach_image(uts, dev, desc));
+	ut_asserteq(0, ut_check_delta(mem_start));
+
+	return 0;
+}
+DM_TEST(dm_test_host_fs_remove, UTF_SCAN_FDT);
+
 /* reusing the same label should work */
 static int dm_test_host_dup(struct unit_test_state *uts)
 {
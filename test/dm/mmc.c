@@ -51,3 +51,37 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Test multi-block transfers with and without CMD23 */
+static int dm_test_mmc_cmd23(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct blk_desc *dev_desc;
+	struct mmc *mmc;
+	char write[8 * 512], read[8 * 512];
+	int i;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = mmc_get_mmc_dev(dev);
+
+	/* The sandbox card and host both support CMD23 */
+	ut_assert(mmc->card_caps & mmc->host_caps & MMC_CAP_CMD23);
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i * 3;
+	ut_asserteq(8, blk_dwrite(dev_desc, 8, 8, write));
+	ut_asserteq(8, blk_dread(dev_desc, 8, 8, read));
+	ut_asserteq_mem(write, read, sizeof(write));
+
+	/* Without it, transfers are ended with CMD12 */
+	mmc->host_caps &= ~MMC_CAP_CMD23;
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i * 5;
+	ut_asserteq(8, blk_dwrite(dev_desc, 8, 8, write));
+	ut_asserteq(8, blk_dread(dev_desc, 8, 8, read));
+	ut_asserteq_mem(write, read, sizeof(write));
+	mmc->host_caps |= MMC_CAP_CMD23;
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_cmd23, UTF_SCAN_PDATA | UTF_SCAN_FDT);
@@ -17,6 +17,7 @@
 #include <asm/sdl.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
+#include <linux/sizes.h>
 #include <test/lib.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -633,6 +634,144 @@ static int dm_test_video_truetype_bs(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_video_truetype_bs, UTF_SCAN_PDATA | UTF_SCAN_FDT);
 
+/* Test that redrawing from the glyph cache gives the same output */
+static int dm_test_video_truetype_cache(struct unit_test_state *uts)
+{
+	struct console_tt_glyph_stats before, after;
+	struct udevice *dev, *con;
+	const char *test_string = "Criticism may not be agreeable, but it is necessary. It fulfils the same function as pain in the human body.";
+	int size;
+
+	if (!IS_ENABLED(CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE))
+		return -EAGAIN;
+
+	ut_assertok(video_get_nologo(uts, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	vidconsole_put_string(con, test_string);
+	size = video_compress_fb(uts, dev, false);
+	ut_assert(size > 46);
+
+	/* Draw it again, this time using cached glyphs */
+	ut_assertok(console_truetype_glyph_stats(con, &before));
+	ut_assert(before.misses > 0);
+	ut_assertok(vidconsole_clear_and_reset(con));
+	ut_asserteq(46, video_compress_fb(uts, dev, false));
+	vidconsole_put_string(con, test_string);
+	ut_asserteq(size, video_compress_fb(uts, dev, false));
+	ut_assertok(video_check_copy_fb(uts, dev));
+	ut_assertok(console_truetype_glyph_stats(con, &after));
+	ut_asserteq(strlen(test_string), after.hits - before.hits);
+	ut_asserteq(before.misses, after.misses);
+	ut_asserteq(0, after.evictions);
+
+	/* Glyphs for another size should not be picked up by mistake */
+	ut_assertok(vidconsole_clear_and_reset(con));
+	ut_assertok(vidconsole_select_font(con, "nimbus_sans_l_regular", 40));
+	vidconsole_put_string(con, test_string);
+	ut_assert(video_compress_fb(uts, dev, false) != size);
+	ut_assertok(console_truetype_glyph_stats(con, &before));
+	ut_assert(before.misses > after.misses);
+
+	ut_assertok(vidconsole_clear_and_reset(con));
+	ut_assertok(vidconsole_select_font(con, NULL, 0));
+	vidconsole_put_string(con, test_string);
+	ut_asserteq(size, video_compress_fb(uts, dev, false));
+	ut_assertok(console_truetype_glyph_stats(con, &after));
+	ut_asserteq(before.misses, after.misses);
+
+	return 0;
+}
+DM_TEST(dm_test_video_truetype_cache, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Draw @cp and check whether it came from the glyph cache */
+static int check_glyph(struct unit_test_state *uts, struct udevice *con,
+		       int cp, bool hit)
+{
+	struct console_tt_glyph_stats before, after;
+
+	ut_assertok(console_truetype_glyph_stats(con, &before));
+	ut_assert(vidconsole_putc_xy(con, 0, 0, cp) > 0);
+	ut_assertok(console_truetype_glyph_stats(con, &after));
+	ut_asserteq(hit, after.hits - before.hits);
+	ut_asserteq(!hit, after.misses - before.misses);
+
+	return 0;
+}
+
+/* Test that the least recently used glyphs are dropped from a full cache */
+static int dm_test_video_truetype_cache_lru(struct unit_test_state *uts)
+{
+	struct console_tt_glyph_stats stats;
+	struct udevice *dev, *con;
+	uint used;
+
+	if (!IS_ENABLED(CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE))
+		return -EAGAIN;
+
+	ut_assertok(video_get_nologo(uts, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+
+	/* start with an empty cache */
+	ut_assertok(console_truetype_set_glyph_cache_size(con, 0));
+	ut_assertok(console_truetype_glyph_stats(con, &stats));
+	ut_asserteq(0, stats.used);
+	ut_assertok(check_glyph(uts, con, 'A', false));
+	ut_assertok(check_glyph(uts, con, 'A', false));
+
+	/* make the cache just large enough for A, W and C */
+	ut_assertok(console_truetype_set_glyph_cache_size(con, SZ_1M));
+	ut_assertok(check_glyph(uts, con, 'A', false));
+	ut_assertok(check_glyph(uts, con, 'W', false));
+	ut_assertok(check_glyph(uts, con, 'C', false));
+	ut_assertok(console_truetype_glyph_stats(con, &stats));
+	used = stats.used;
+	ut_assertok(console_truetype_set_glyph_cache_size(con, used));
+	ut_assertok(console_truetype_glyph_stats(con, &stats));
+	ut_asserteq(used, stats.used);
+	ut_asserteq(0, stats.evictions);
+
+	/* using A again leaves W as the least recently used */
+	ut_assertok(check_glyph(uts, con, 'A', true));
+
+	/* W is larger than i, so only W is dropped to make space */
+	ut_assertok(check_glyph(uts, con, 'i', false));
+	ut_assertok(console_truetype_glyph_stats(con, &stats));
+	ut_asserteq(1, stats.evictions);
+	ut_assertok(check_glyph(uts, con, 'A', true));
+	ut_assertok(check_glyph(uts, con, 'C', true));
+	ut_assertok(check_glyph(uts, con, 'i', true));
+	ut_assertok(check_glyph(uts, con, 'W', false));
+	ut_assertok(console_truetype_glyph_stats(con, &stats));
+	ut_assert(stats.evictions > 1);
+	ut_assert(stats.used <= used);
+
+	return 0;
+}
+DM_TEST(dm_test_video_truetype_cache_lru, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Test that prewarming fills the glyph cache without overflowing it */
+static int dm_test_video_truetype_prewarm(struct unit_test_state *uts)
+{
+	struct console_tt_glyph_stats stats;
+	struct udevice *dev, *con;
+
+	if (!IS_ENABLED(CONFIG_CONSOLE_TRUETYPE_GLYPH_PREWARM))
+		return -EAGAIN;
+
+	ut_assertok(video_get_nologo(uts, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	ut_assertok(console_truetype_glyph_stats(con, &stats));
+	ut_assert(stats.misses > 0);
+	ut_asserteq(0, stats.evictions);
+	ut_assert(stats.used <= CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE_SIZE);
+
+	/* The first characters are always rendered */
+	ut_assertok(check_glyph(uts, con, '!', true));
+
+	return 0;
+}
+DM_TEST(dm_test_video_truetype_prewarm, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
 /* Test partial rendering onto hardware frame buffer */
 static int dm_test_video_copy(struct unit_test_state *uts)
 {
@@ -677,8 +816,8 @@ static int dm_test_video_copy(struct unit_test_state *uts)
 	/*
 	 * We should have the full content on the main buffer, but only
 	 * 'damage' should have been copied to the copy buffer. This consists
-	 * of a while rectangle with the Denx logo and four lines of text. The
-	 * rest of the display is black.
+	 * of the rectangles covering the four lines of text. The rest of the
+	 * display is black.
 	 *
 	 * An easy way to try this is by changing video_sync() to call
 	 * sandbox_sdl_sync(priv->copy_fb) instead of priv->fb then running the
@@ -691,12 +830,31 @@ static int dm_test_video_copy(struct unit_test_state *uts)
 	vidconsole_put_string(con, test_string);
 	video_sync(dev, true);
 	ut_asserteq(7589, video_compress_fb(uts, dev, false));
-	ut_asserteq(7704, video_compress_fb(uts, dev, true));
+	ut_asserteq(7677, video_compress_fb(uts, dev, true));
 
 	return 0;
 }
 DM_TEST(dm_test_video_copy, UTF_SCAN_PDATA | UTF_SCAN_FDT);
 
+/* Check that a damage rectangle is present */
+static int check_damage(struct unit_test_state *uts, struct video_priv *priv,
+			int xstart, int ystart, int xend, int yend)
+{
+	int i;
+
+	for (i = 0; i < priv->damage.count; i++) {
+		const struct video_damage_rect *rect = &priv->damage.rect[i];
+
+		if (rect->xstart == xstart && rect->ystart == ystart &&
+		    rect->xend == xend && rect->yend == yend)
+			return 0;
+	}
+	ut_reportf("No damage at (%d, %d) - (%d, %d)", xstart, ystart, xend,
+		   yend);
+
+	return CMD_RET_FAILURE;
+}
+
 /* Test video damage tracking */
 static int dm_test_video_damage(struct unit_test_state *uts)
 {
@@ -721,30 +879,31 @@ static int dm_test_video_damage(struct unit_test_state *uts)
 
 	vidconsole_position_cursor(con, 14, 10);
 	vidconsole_put_string(con, test_string_2);
-	ut_asserteq(449, priv->damage.xstart);
-	ut_asserteq(325, priv->damage.ystart);
-	ut_asserteq(661, priv->damage.xend);
-	ut_asserteq(350, priv->damage.yend);
+	ut_asserteq(4, priv->damage.count);
+	ut_assertok(check_damage(uts, priv, 449, 325, 504, 345));
+	ut_assertok(check_damage(uts, priv, 512, 325, 529, 345));
+	ut_assertok(check_damage(uts, priv, 538, 330, 642, 345));
+	ut_assertok(check_damage(uts, priv, 643, 330, 661, 350));
 
 	vidconsole_position_cursor(con, 7, 5);
 	vidconsole_put_string(con, test_string_1);
-	ut_asserteq(225, priv->damage.xstart);
-	ut_asserteq(164, priv->damage.ystart);
-	ut_asserteq(661, priv->damage.xend);
-	ut_asserteq(350, priv->damage.yend);
+	ut_asserteq(4, priv->damage.count);
+	ut_assertok(check_damage(uts, priv, 449, 325, 529, 345));
+	ut_assertok(check_damage(uts, priv, 538, 330, 661, 350));
+	ut_assertok(check_damage(uts, priv, 225, 164, 366, 185));
+	ut_assertok(check_damage(uts, priv, 367, 165, 586, 190));
 
+	/* Each line should end up with its own rectangles */
 	vidconsole_position_cursor(con, 21, 15);
 	vidconsole_put_string(con, test_string_3);
-	ut_asserteq(225, priv->damage.xstart);
-	ut_asserteq(164, priv->damage.ystart);
-	ut_asserteq(1280, priv->damage.xend);
-	ut_asserteq(510, priv->damage.yend);
+	ut_asserteq(4, priv->damage.count);
+	ut_assertok(check_damage(uts, priv, 449, 325, 661, 350));
+	ut_assertok(check_damage(uts, priv, 225, 164, 586, 190));
+	ut_assertok(check_damage(uts, priv, 674, 485, 998, 505));
+	ut_assertok(check_damage(uts, priv, 1006, 485, 1280, 510));
 
 	video_sync(dev, true);
-	ut_asserteq(priv->xsize, priv->damage.xstart);
-	ut_asserteq(priv->ysize, priv->damage.ystart);
-	ut_asserteq(0, priv->damage.xend);
-	ut_asserteq(0, priv->damage.yend);
+	ut_asserteq(0, priv->damage.count);
 
 	ut_asserteq(7339, video_compress_fb(uts, dev, false));
 	ut_assertok(video_check_copy_fb(uts, dev));
@@ -753,6 +912,66 @@ static int dm_test_video_damage(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_video_damage, UTF_SCAN_PDATA | UTF_SCAN_FDT);
 
+/* Test merging of damage rectangles */
+static int dm_test_video_damage_merge(struct unit_test_state *uts)
+{
+	struct video_priv *priv;
+	struct udevice *dev;
+
+	if (!IS_ENABLED(CONFIG_VIDEO_DAMAGE) || VIDEO_DAMAGE_RECTS != 4)
+		return -EAGAIN;
+
+	ut_assertok(video_get_nologo(uts, &dev));
+	priv = dev_get_uclass_priv(dev);
+	video_sync(dev, true);
+	ut_asserteq(0, priv->damage.count);
+
+	/* Separate regions are tracked separately */
+	video_damage(dev, 0, 0, 10, 10);
+	video_damage(dev, 100, 100, 10, 10);
+	ut_asserteq(2, priv->damage.count);
+
+	/* Overlapping and touching regions are merged */
+	video_damage(dev, 5, 5, 10, 10);
+	ut_asserteq(2, priv->damage.count);
+	ut_assertok(check_damage(uts, priv, 0, 0, 15, 15));
+	video_damage(dev, 15, 0, 5, 5);
+	ut_asserteq(2, priv->damage.count);
+	ut_assertok(check_damage(uts, priv, 0, 0, 20, 15));
+	ut_assertok(check_damage(uts, priv, 100, 100, 110, 110));
+
+	/* Empty regions are ignored */
+	video_damage(dev, 500, 500, 0, 10);
+	ut_asserteq(2, priv->damage.count);
+
+	/* When full, the two closest regions are merged */
+	video_damage(dev, 200, 0, 10, 10);
+	video_damage(dev, 300, 0, 10, 10);
+	ut_asserteq(4, priv->damage.count);
+	video_damage(dev, 1000, 700, 10, 10);
+	ut_asserteq(4, priv->damage.count);
+	ut_assertok(check_damage(uts, priv, 0, 0, 20, 15));
+	ut_assertok(check_damage(uts, priv, 100, 100, 110, 110));
+	ut_assertok(check_damage(uts, priv, 200, 0, 310, 10));
+	ut_assertok(check_damage(uts, priv, 1000, 700, 1010, 710));
+
+	/* A merge that touches another region causes that to merge too */
+	video_damage(dev, 15, 10, 90, 90);
+	ut_asserteq(3, priv->damage.count);
+	ut_assertok(check_damage(uts, priv, 0, 0, 110, 110));
+
+	/* Damage is clipped to the display */
+	video_damage(dev, 0, 0, priv->xsize + 10, priv->ysize + 10);
+	ut_asserteq(1, priv->damage.count);
+	ut_assertok(check_damage(uts, priv, 0, 0, priv->xsize, priv->ysize));
+
+	video_sync(dev, true);
+	ut_asserteq(0, priv->damage.count);
+
+	return 0;
+}
+DM_TEST(dm_test_video_damage_merge, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
 /* Test font measurement */
 static int dm_test_font_measure(struct unit_test_state *uts)
 {
@@ -195,3 +195,81 @@ static int dm_test_virtio_ring(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_virtio_ring, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Test the virtio ring with indirect descriptors */
+static int dm_test_virtio_ring_indirect(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct virtio_dev_priv *uc_priv;
+	struct vring_desc *indir;
+	struct virtqueue *vq;
+	struct virtio_sg sg[3];
+	struct virtio_sg *sgs[3];
+	unsigned int len, num_free;
+	u8 buffer[3][16];
+	int i;
+
+	/* check probe success */
+	ut_assertok(uclass_first_device_err(UCLASS_VIRTIO, &bus));
+	ut_assertnonnull(bus);
+
+	/* check the child virtio-blk device is bound */
+	ut_assertok(device_find_first_child(bus, &dev));
+	ut_assertnonnull(dev);
+
+	/* fake the device probe and pretend the device offers indirect */
+	uc_priv = dev_get_uclass_priv(bus);
+	ut_assertnonnull(uc_priv);
+	uc_priv->vdev = dev;
+	uc_priv->features |= BIT_ULL(VIRTIO_RING_F_INDIRECT_DESC);
+
+	for (i = 0; i < 3; i++) {
+		sg[i].addr = buffer[i];
+		sg[i].length = sizeof(buffer[i]);
+		sgs[i] = &sg[i];
+	}
+
+	/* a chain of three buffers only takes up one slot in the ring */
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	ut_assert(vq->indirect);
+	num_free = vq->num_free;
+	ut_assertok(virtqueue_add(vq, sgs, 1, 2));
+	ut_asserteq(num_free - 1, vq->num_free);
+	ut_asserteq(VRING_DESC_F_INDIRECT,
+		    virtio16_to_cpu(dev, vq->vring.desc[0].flags));
+	ut_asserteq(3 * sizeof(*indir),
+		    virtio32_to_cpu(dev, vq->vring.desc[0].len));
+
+	indir = (void *)(uintptr_t)virtio64_to_cpu(dev, vq->vring.desc[0].addr);
+	ut_asserteq_ptr(buffer[0],
+			(void *)(uintptr_t)virtio64_to_cpu(dev, indir[0].addr));
+	ut_asserteq(VRING_DESC_F_NEXT, virtio16_to_cpu(dev, indir[0].flags));
+	ut_asserteq(VRING_DESC_F_NEXT | VRING_DESC_F_WRITE,
+		    virtio16_to_cpu(dev, indir[1].flags));
+	ut_asserteq(VRING_DESC_F_WRITE, virtio16_to_cpu(dev, indir[2].flags));
+
+	/* a single buffer still goes straight into the ring */
+	ut_assertok(virtqueue_add(vq, sgs, 0, 1));
+	ut_asserteq(num_free - 2, vq->num_free);
+	ut_asserteq_ptr(buffer[0], (void *)(uintptr_t)
+			virtio64_to_cpu(dev, vq->vring.desc[1].addr));
+
+	/* completing the chain hands back the first buffer and frees it */
+	vq->vring.used->idx = 2;
+	vq->vring.used->ring[0].id = 0;
+	vq->vring.used->ring[0].len = 33;
+	vq->vring.used->ring[1].id = 1;
+	vq->vring.used->ring[1].len = 16;
+	ut_asserteq_ptr(buffer, virtqueue_get_buf(vq, &len));
+	ut_asserteq(33, len);
+	ut_assertnull(vq->vring_desc_shadow[0].indir_desc);
+	ut_asserteq_ptr(buffer, virtqueue_get_buf(vq, &len));
+	ut_asserteq(16, len);
+	ut_asserteq(num_free, vq->num_free);
+	ut_assertok(virtio_del_vqs(dev));
+
+	uc_priv->features &= ~BIT_ULL(VIRTIO_RING_F_INDIRECT_DESC);
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_ring_indirect, UTF_SCAN_PDATA | UTF_SCAN_FDT);
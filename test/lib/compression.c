@@ -13,6 +13,7 @@
 #include <mapmem.h>
 #include <asm/io.h>
 
+#include <u-boot/crc.h>
 #include <u-boot/lz4.h>
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -606,3 +607,131 @@ static int compression_test_bootm_none(struct unit_test_state *uts)
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
 }
 LIB_TEST(compression_test_bootm_none, 0);
+
+/**
+ * struct tap_state - Records what image_decomp_tap() passes on
+ *
+ * @next:	Where the next chunk is expected to start
+ * @total:	Number of bytes passed on so far
+ * @crc:	CRC32 of the bytes passed on so far
+ * @calls:	Number of calls made
+ */
+struct tap_state {
+	const char *next;
+	ulong total;
+	u32 crc;
+	int calls;
+};
+
+static int check_tap(void *priv, const void *buf, ulong len)
+{
+	struct tap_state *ts = priv;
+
+	/* Chunks must be passed in order without gaps */
+	if (buf != ts->next)
+		return -EFAULT;
+	ts->next += len;
+	ts->total += len;
+	ts->crc = crc32(ts->crc, buf, len);
+	ts->calls++;
+
+	return 0;
+}
+
+/**
+ * run_bootm_tap_test() - Check image_decomp_tap() passes on all the input
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * Return: 0 if OK, non-zero on failure
+ */
+static int run_bootm_tap_test(struct unit_test_state *uts, int comp_type,
+			      mutate_func compress)
+{
+	ulong compress_size = 1024;
+	const ulong image_start = 0;
+	const ulong load_addr = 0x1000;
+	struct tap_state ts;
+	void *compress_buff;
+	ulong load_end;
+	int unc_len;
+
+	compress_buff = map_sysmem(image_start, 0);
+	unc_len = strlen(plain);
+	ut_assertok(compress(uts, (void *)plain, unc_len, compress_buff,
+			     compress_size, &compress_size));
+
+	memset(&ts, '\0', sizeof(ts));
+	ts.next = compress_buff;
+	ut_assertok(image_decomp_tap(comp_type, load_addr, image_start,
+				     IH_TYPE_KERNEL, map_sysmem(load_addr, 0),
+				     compress_buff, compress_size, unc_len,
+				     &load_end, check_tap, &ts));
+	ut_asserteq(load_addr + unc_len, load_end);
+	ut_asserteq_mem(plain, map_sysmem(load_addr, 0), unc_len);
+	ut_asserteq(compress_size, ts.total);
+	ut_asserteq(crc32(0, compress_buff, compress_size), ts.crc);
+
+	/* An error from the tap stops decompression */
+	ts.next = NULL;
+	ut_asserteq(-EFAULT,
+		    image_decomp_tap(comp_type, load_addr, image_start,
+				     IH_TYPE_KERNEL, map_sysmem(load_addr, 0),
+				     compress_buff, compress_size, unc_len,
+				     &load_end, check_tap, &ts));
+
+	return 0;
+}
+
+static int compression_test_bootm_tap(struct unit_test_state *uts)
+{
+	ut_assertok(run_bootm_tap_test(uts, IH_COMP_NONE, compress_using_none));
+	ut_assertok(run_bootm_tap_test(uts, IH_COMP_GZIP, compress_using_gzip));
+	ut_assertok(run_bootm_tap_test(uts, IH_COMP_ZSTD, compress_using_zstd));
+
+	/* this is passed on in one go before decompression */
+	ut_assertok(run_bootm_tap_test(uts, IH_COMP_LZ4, compress_using_lz4));
+
+	return 0;
+}
+LIB_TEST(compression_test_bootm_tap, 0);
+
+/* Check image_move_tap() passes on the data before overwriting it */
+static int compression_test_move_tap(struct unit_test_state *uts)
+{
+	const ulong size = CHUNKSZ * 2 + 100;
+	struct tap_state ts;
+	char *buf, *copy;
+	int i;
+
+	buf = malloc(size * 2);
+	copy = malloc(size);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(copy);
+	for (i = 0; i < size; i++)
+		copy[i] = i * 7;
+
+	/* forwards, overlapping the start of the source */
+	memcpy(buf + 10, copy, size);
+	memset(&ts, '\0', sizeof(ts));
+	ts.next = buf + 10;
+	ut_assertok(image_move_tap(buf, buf + 10, size, check_tap, &ts));
+	ut_asserteq(size, ts.total);
+	ut_asserteq(crc32(0, copy, size), ts.crc);
+	ut_asserteq_mem(copy, buf, size);
+	ut_assert(ts.calls > 1);
+
+	/* backwards, overlapping the end of the source */
+	memset(&ts, '\0', sizeof(ts));
+	ts.next = buf;
+	ut_assertok(image_move_tap(buf + 10, buf, size, check_tap, &ts));
+	ut_asserteq(size, ts.total);
+	ut_asserteq(crc32(0, copy, size), ts.crc);
+	ut_asserteq_mem(copy, buf + 10, size);
+
+	free(copy);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(compression_test_move_tap, 0);
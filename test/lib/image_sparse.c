@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing Android sparse images in pieces
+ */
+
+#include <image-sparse.h>
+#include <malloc.h>
+#include <string.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define TEST_BLKSZ	512
+#define TEST_BLKS	64
+#define TEST_SPARSE_BLKSZ	1024
+
+static u8 test_disk[TEST_BLKS * TEST_BLKSZ];
+
+static lbaint_t test_write(struct sparse_storage *info, lbaint_t blk,
+			   lbaint_t blkcnt, const void *buffer)
+{
+	memcpy(test_disk + blk * TEST_BLKSZ, buffer, blkcnt * TEST_BLKSZ);
+
+	return blkcnt;
+}
+
+static lbaint_t test_reserve(struct sparse_storage *info, lbaint_t blk,
+			     lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static u8 *add_chunk(u8 *ptr, u16 type, u32 chunk_sz, u32 data_sz)
+{
+	chunk_header_t chunk = {
+		.chunk_type = type,
+		.chunk_sz = chunk_sz,
+		.total_sz = sizeof(chunk) + data_sz,
+	};
+
+	memcpy(ptr, &chunk, sizeof(chunk));
+
+	return ptr + sizeof(chunk);
+}
+
+/*
+ * Build an image with raw, fill, don't-care and CRC32 chunks, along with the
+ * disk contents expected from it
+ */
+static int make_image(u8 *img, u8 *expect)
+{
+	sparse_header_t hdr = {
+		.magic = SPARSE_HEADER_MAGIC,
+		.major_version = 1,
+		.file_hdr_sz = sizeof(hdr),
+		.chunk_hdr_sz = sizeof(chunk_header_t),
+		.blk_sz = TEST_SPARSE_BLKSZ,
+		.total_blks = 9,
+		.total_chunks = 5,
+	};
+	u32 fill = 0x12345678;
+	u8 *ptr = img;
+	int i;
+
+	memcpy(ptr, &hdr, sizeof(hdr));
+	ptr += sizeof(hdr);
+
+	ptr = add_chunk(ptr, CHUNK_TYPE_RAW, 3, 3 * TEST_SPARSE_BLKSZ);
+	for (i = 0; i < 3 * TEST_SPARSE_BLKSZ; i++)
+		*ptr++ = *expect++ = i * 7;
+
+	ptr = add_chunk(ptr, CHUNK_TYPE_FILL, 2, sizeof(fill));
+	memcpy(ptr, &fill, sizeof(fill));
+	ptr += sizeof(fill);
+	for (i = 0; i < 2 * TEST_SPARSE_BLKSZ; i += sizeof(fill))
+		memcpy(expect + i, &fill, sizeof(fill));
+	expect += 2 * TEST_SPARSE_BLKSZ;
+
+	ptr = add_chunk(ptr, CHUNK_TYPE_DONT_CARE, 3, 0);
+	memset(expect, 0xff, 3 * TEST_SPARSE_BLKSZ);
+	expect += 3 * TEST_SPARSE_BLKSZ;
+
+	ptr = add_chunk(ptr, CHUNK_TYPE_CRC32, 0, sizeof(u32));
+	ptr += sizeof(u32);
+
+	ptr = add_chunk(ptr, CHUNK_TYPE_RAW, 1, TEST_SPARSE_BLKSZ);
+	for (i = 0; i < TEST_SPARSE_BLKSZ; i++)
+		*ptr++ = *expect++ = i * 13;
+
+	return ptr - img;
+}
+
+/* Write a sparse image in pieces of various sizes */
+static int lib_test_sparse_stream(struct unit_test_state *uts)
+{
+	static const int piece_sizes[] = { 1, 5, 512, 1000, 0x10000 };
+	struct sparse_storage info = {
+		.blksz = TEST_BLKSZ,
+		.start = 4,
+		.size = TEST_BLKS - 4,
+		.write = test_write,
+		.reserve = test_reserve,
+	};
+	const int out_size = 9 * TEST_SPARSE_BLKSZ;
+	struct sparse_stream ss;
+	u8 *img, *expect;
+	int i, len, pos;
+
+	img = malloc(0x4000);
+	expect = malloc(out_size);
+	ut_assertnonnull(img);
+	ut_assertnonnull(expect);
+	len = make_image(img, expect);
+
+	for (i = 0; i < ARRAY_SIZE(piece_sizes); i++) {
+		memset(test_disk, 0xff, sizeof(test_disk));
+		ut_assertok(sparse_stream_init(&ss, &info));
+		for (pos = 0; pos < len; pos += piece_sizes[i]) {
+			ut_assertok(sparse_stream_write(&ss, img + pos,
+					min(piece_sizes[i], len - pos)));
+		}
+		ut_asserteq(out_size, sparse_stream_finish(&ss));
+		ut_asserteq_mem(expect, test_disk + 4 * TEST_BLKSZ, out_size);
+	}
+
+	/* An incomplete image is reported */
+	ut_assertok(sparse_stream_init(&ss, &info));
+	ut_assertok(sparse_stream_write(&ss, img, len - 1));
+	ut_asserteq(-EINVAL, sparse_stream_finish(&ss));
+
+	/* So is an image which does not fit */
+	info.size = 8;
+	ut_assertok(sparse_stream_init(&ss, &info));
+	ut_asserteq(-ENOSPC, sparse_stream_write(&ss, img, len));
+	sparse_stream_finish(&ss);
+
+	free(expect);
+	free(img);
+
+	return 0;
+}
+LIB_TEST(lib_test_sparse_stream, 0);
@@ -487,6 +487,25 @@ def setup_cedit_file(ubman):
         ubman, f'{expo_tool} -e {inhname} -l {infname} -o {outfname}')
 
 @pytest.mark.buildconfigspec('ut_dm')
+def setup_squashfs_image(ubman):
+    """Create a squashfs image with files which end in a fragment
+
+    This uses 4K blocks, so the last 0xa00 bytes of mount.bin are in a fragment.
+    The 80 small files share about 20 fragment blocks, more than U-Boot caches.
+    """
+    fn = os.path.join(ubman.config.persistent_data_dir, 'test.squashfs.img')
+    srcdir = os.path.join(ubman.config.build_dir, 'test_squashfs')
+    utils.run_and_log(ubman, f'rm -rf {srcdir}')
+    mkdir_cond(srcdir)
+    with open(os.path.join(srcdir, 'mount.bin'), 'wb') as outf:
+        outf.write(bytes((i * 7) & 0xff for i in range(0x2a00)))
+    for n in range(80):
+        with open(os.path.join(srcdir, f'frag{n:02d}.bin'), 'wb') as outf:
+            outf.write(bytes((i + n * 13) & 0xff for i in range(1000)))
+    utils.run_and_log(
+        ubman, f'mksquashfs {srcdir} {fn} -b 4096 -noappend -all-root')
+
+
 def test_ut_dm_init(ubman):
     """Initialize data for ut dm tests."""
 
@@ -514,6 +533,9 @@ def test_ut_dm_init(ubman):
 
     fs_helper.mk_fs(ubman.config, 'ext2', 0x200000, '2MB', None)
     fs_helper.mk_fs(ubman.config, 'fat32', 0x100000, '1MB', None)
+    # 512-byte clusters, so the FAT takes more than one 96-sector window
+    fs_helper.mk_fs(ubman.config, 'fat32', 0x1000000, '16MB', None)
+    setup_squashfs_image(ubman)
 
     mmc_dev = 6
     fn = os.path.join(ubman.config.source_dir, f'mmc{mmc_dev}.img')
@@ -86,21 +86,63 @@ class EfiVariableStore:
         if os.path.exists(self.infile) and os.stat(self.infile).st_size > self.efi.var_file_size:
             with open(self.infile, 'rb') as f:
                 buf = f.read()
-                self._check_header(buf)
-                self.ents = buf[self.efi.var_file_size:]
+                length = self._check_header(buf)
+                self.ents = buf[self.efi.var_file_size:length]
+                self._apply_records(buf, length)
         else:
             self.ents = bytearray()
 
     def _check_header(self, buf):
         hdr = struct.unpack_from(self.efi.var_file_fmt, buf, 0)
-        magic, crc32 = hdr[1], hdr[3]
+        magic, length, crc32 = hdr[1], hdr[2], hdr[3]
 
         if magic != UBOOT_EFI_VAR_FILE_MAGIC:
             print("err: invalid magic number: %s"%hex(magic))
             exit(1)
-        if crc32 != calc_crc32(buf[self.efi.var_file_size:]):
+        if length > len(buf) or length < self.efi.var_file_size:
+            print("err: invalid length: %s"%hex(length))
+            exit(1)
+        if crc32 != calc_crc32(buf[self.efi.var_file_size:length]):
             print("err: invalid crc32: %s"%hex(crc32))
             exit(1)
+        return length
+
+    def _apply_records(self, buf, offs):
+        """Apply the records appended with CONFIG_EFI_VARIABLE_FILE_LOG
+
+        Each record has the same header as the file and holds a single
+        variable. A variable without attributes has been deleted. Like
+        U-Boot, stop at the first invalid record, e.g. a truncated one.
+        """
+        hsize = self.efi.var_file_size
+        while offs < len(buf):
+            if len(buf) - offs < hsize + self.efi.var_entry_size:
+                print("warning: ignoring truncated record at %s"%hex(offs))
+                return
+            _, magic, length, crc32 = struct.unpack_from(self.efi.var_file_fmt,
+                                                         buf, offs)
+            ent = buf[offs + hsize:offs + length]
+            if (magic != UBOOT_EFI_VAR_FILE_MAGIC or
+                    length < hsize + self.efi.var_entry_size or
+                    length > len(buf) - offs or crc32 != calc_crc32(ent)):
+                print("warning: ignoring invalid record at %s"%hex(offs))
+                return
+            _, attrs, _, guid = struct.unpack_from(self.efi.var_entry_fmt, ent, 0)
+            name, _ = self._get_var_name(ent[self.efi.var_entry_size:])
+            self._remove_var(str(uuid.UUID(bytes_le=guid)), name)
+            if attrs:
+                self.ents += ent
+            offs += length
+
+    def _remove_var(self, guid, name):
+        offs = 0
+        while offs < len(self.ents):
+            var, loffs = self._next_var(offs)
+            if var.name == name and str(var.guid) == guid:
+                self.ents = self.ents[:offs] + self.ents[loffs:]
+                return var
+            offs = loffs
+        return None
 
     def _get_var_name(self, buf):
         name = ''
@@ -238,6 +280,10 @@ def cmd_set(args):
     env.set_var(guid=guid, name=name, data=data, size=size, attrs=attrs)
     env.save()
 
+def cmd_compact(args):
+    env = EfiVariableStore(args.infile)
+    env.save()
+
 def print_var(var):
     print(var.name+':')
     print("    "+str(var.guid)+' '+''.join([x for x in var_guids if str(var.guid) == var_guids[x]]))
@@ -345,6 +391,10 @@ def main():
     delp.add_argument('--guid', '-g', help="vendor GUID (default: %s)"%EFI_GLOBAL_VARIABLE_GUID)
     delp.set_defaults(func=cmd_del)
 
+    compactp = subp.add_parser('compact', help='apply appended records and rewrite the file')
+    compactp.add_argument('--infile', '-i', required=True, help='file to save the EFI variables')
+    compactp.set_defaults(func=cmd_compact)
+
     signp = subp.add_parser('sign', help='sign time-based EFI payload')
     signp.add_argument('--cert', '-c', required=True, help='x509 certificate filename in PEM format')
     signp.add_argument('--key', '-k', required=True, help='signing certificate filename in PEM format')
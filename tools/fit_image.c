@@ -245,6 +245,9 @@ static void fit_add_hash_or_sign(struct image_tool_params *params, void *fdt,
 	if (do_hash) {
 		fdt_begin_node(fdt, FIT_HASH_NODENAME);
 		fdt_property_string(fdt, FIT_ALGO_PROP, hash_algo);
+		if (params->hash_chunk_size)
+			fdt_property_u32(fdt, FIT_CHUNK_SIZE_PROP,
+					 params->hash_chunk_size);
 		fdt_end_node(fdt);
 	}
 
@@ -54,6 +54,54 @@ static int fit_set_hash_value(void *fit, int noffset, uint8_t *value,
 	return 0;
 }
 
+/**
+ * fit_image_process_chunks() - Calculate a chunked hash
+ *
+ * The hash of each chunk is stored in the chunk-value property and the hash of
+ * those hashes is returned, to be stored in the value property
+ *
+ * @fit:	pointer to the FIT format image header
+ * @noffset:	hash node offset
+ * @algo:	hash algorithm name
+ * @chunk_size:	chunk size in bytes
+ * @data:	data to process
+ * @size:	size of data in bytes
+ * @value:	returns the root hash
+ * @value_len:	returns the length of the root hash
+ * Return: 0 if ok, -ENOSPC if the FIT needs more space, other -ve on error
+ */
+static int fit_image_process_chunks(void *fit, int noffset, const char *algo,
+				    uint chunk_size, const void *data,
+				    size_t size, uint8_t *value, int *value_len)
+{
+	uint8_t *values;
+	int values_len;
+	int ret;
+
+	values = malloc(fit_hash_chunk_count(size, chunk_size) *
+			FIT_MAX_HASH_LEN + 1);
+	if (!values)
+		return -ENOMEM;
+	if (calculate_chunk_hashes(data, size, algo, chunk_size, values,
+				   &values_len) ||
+	    calculate_hash(values, values_len, algo, value, value_len)) {
+		free(values);
+		return -EPROTONOSUPPORT;
+	}
+
+	ret = fdt_setprop(fit, noffset, FIT_CHUNK_VALUE_PROP, values,
+			  values_len);
+	free(values);
+	if (ret) {
+		fprintf(stderr, "Can't set hash '%s' property for '%s' node(%s)\n",
+			FIT_CHUNK_VALUE_PROP, fit_get_name(fit, noffset, NULL),
+			fdt_strerror(ret));
+		return ret == -FDT_ERR_NOSPACE ? -ENOSPC : -EIO;
+	}
+
+	return 0;
+}
+
 /**
  * fit_image_process_hash - Process a single subnode of the images/ node
  *
@@ -72,6 +120,7 @@ static int fit_image_process_hash(void *fit, const char *image_name,
 {
 	uint8_t value[FIT_MAX_HASH_LEN];
 	const char *node_name;
+	uint chunk_size;
 	int value_len;
 	const char *algo;
 	int ret;
@@ -85,7 +134,22 @@ static int fit_image_process_hash(void *fit, const char *image_name,
 		return -ENOENT;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	ret = fit_image_hash_get_chunk_size(fit, noffset, &chunk_size);
+	if (ret == -EINVAL) {
+		fprintf(stderr,
+			"Invalid chunk size for '%s' hash node in '%s' image node\n",
+			node_name, image_name);
+		return ret;
+	} else if (!ret) {
+		ret = fit_image_process_chunks(fit, noffset, algo, chunk_size,
+					       data, size, value, &value_len);
+		if (ret == -EPROTONOSUPPORT)
+			fprintf(stderr,
+				"Unsupported hash algorithm (%s) for '%s' hash node in '%s' image node\n",
+				algo, node_name, image_name);
+		if (ret)
+			return ret;
+	} else if (calculate_hash(data, size, algo, value, &value_len)) {
 		fprintf(stderr,
 			"Unsupported hash algorithm (%s) for '%s' hash node in '%s' image node\n",
 			algo, node_name, image_name);
@@ -104,7 +104,7 @@ static void usage(const char *msg)
 		"          -v ==> verbose\n",
 		params.cmdname);
 	fprintf(stderr,
-		"       %s [-D dtc_options] [-f fit-image.its|-f auto|-f auto-conf|-F] [-b <dtb> [-b <dtb>]] [-E] [-B size] [-i <ramdisk.cpio.gz>] fit-image\n"
+		"       %s [-D dtc_options] [-f fit-image.its|-f auto|-f auto-conf|-F] [-b <dtb> [-b <dtb>]] [-E] [-B size] [-H size] [-i <ramdisk.cpio.gz>] fit-image\n"
 		"           <dtb> file is used with -f auto, it may occur multiple times.\n",
 		params.cmdname);
 	fprintf(stderr,
@@ -113,6 +113,7 @@ static void usage(const char *msg)
 		"          -i => input filename for ramdisk file\n"
 		"          -E => place data outside of the FIT structure\n"
 		"          -B => align size in hex for FIT structure and header\n"
+		"          -H => hash images in chunks of this size in hex, with -f auto\n"
 		"          -b => append the device tree binary to the FIT\n"
 		"          -t => update the timestamp in the FIT\n");
 #if CONFIG_IS_ENABLED(FIT_SIGNATURE)
@@ -160,7 +161,7 @@ static int add_content(int type, const char *fname)
 }
 
 static const char optstring[] =
-	"a:A:b:B:c:C:d:D:e:Ef:Fg:G:i:k:K:ln:N:o:O:p:qrR:stT:vVx";
+	"a:A:b:B:c:C:d:D:e:Ef:Fg:G:H:i:k:K:ln:N:o:O:p:qrR:stT:vVx";
 
 static const struct option longopts[] = {
 	{ "load-address", required_argument, NULL, 'a' },
@@ -178,6 +179,7 @@ static const struct option longopts[] = {
 	{ "key-name-hint", required_argument, NULL, 'g' },
 	{ "key-file", required_argument, NULL, 'G' },
 	{ "help", no_argument, NULL, 'h' },
+	{ "hash-chunk-size", required_argument, NULL, 'H' },
 	{ "initramfs", required_argument, NULL, 'i' },
 	{ "key-dir", required_argument, NULL, 'k' },
 	{ "key-dest", required_argument, NULL, 'K' },
@@ -292,6 +294,14 @@ static void process_args(int argc, char **argv)
 		case 'G':
 			params.keyfile = optarg;
 			break;
+		case 'H':
+			params.hash_chunk_size = strtoul(optarg, &ptr, 16);
+			if (*ptr || !params.hash_chunk_size) {
+				fprintf(stderr, "%s: invalid hash chunk size %s\n",
+					params.cmdname, optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case 'i':
 			params.fit_ramdisk = optarg;
 			break;